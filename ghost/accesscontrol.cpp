@@ -0,0 +1,265 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "ghostdb.h"
+#include "accesscontrol.h"
+
+#include <boost/filesystem.hpp>
+
+bool UTIL_ParseIPRange( string range, uint32_t *address, uint32_t *prefixLength )
+{
+	string IP = range;
+	*prefixLength = 32;
+	string :: size_type Slash = range.find( '/' );
+
+	if( Slash != string :: npos )
+	{
+		IP = range.substr( 0, Slash );
+		string Length = range.substr( Slash + 1 );
+
+		if( Length.empty( ) || Length.size( ) > 2 || Length.find_first_not_of( "1234567890" ) != string :: npos )
+			return false;
+
+		*prefixLength = UTIL_ToUInt32( Length );
+
+		if( *prefixLength > 32 )
+			return false;
+	}
+
+	if( IP.empty( ) || IP[IP.size( ) - 1] == '.' || IP.find_first_not_of( "1234567890." ) != string :: npos )
+		return false;
+
+	uint32_t Address = 0;
+	uint32_t NumOctets = 0;
+	stringstream SS( IP );
+	string Octet;
+
+	while( getline( SS, Octet, '.' ) )
+	{
+		if( Octet.empty( ) || Octet.size( ) > 3 || NumOctets == 4 )
+			return false;
+
+		uint32_t Value = UTIL_ToUInt32( Octet );
+
+		if( Value > 255 )
+			return false;
+
+		Address = ( Address << 8 ) | Value;
+		++NumOctets;
+	}
+
+	if( NumOctets != 4 )
+		return false;
+
+	*address = Address;
+	return true;
+}
+
+//
+// CBanIndex
+//
+
+CBanIndex :: CBanIndex( )
+{
+
+}
+
+CBanIndex :: ~CBanIndex( )
+{
+	Clear( );
+}
+
+void CBanIndex :: Add( CDBBan *ban )
+{
+	// the names are stored in lower case so they can be looked up case insensitively
+
+	string Name = ban->GetName( );
+	transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+	m_Names.insert( make_pair( Name, ban ) );
+
+	uint32_t Address;
+	uint32_t PrefixLength;
+
+	if( UTIL_ParseIPRange( ban->GetIP( ), &Address, &PrefixLength ) )
+		m_IPs.Add( Address, PrefixLength, ban );
+}
+
+void CBanIndex :: Remove( string name )
+{
+	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
+	pair<boost :: unordered_multimap<string, CDBBan *> :: iterator, boost :: unordered_multimap<string, CDBBan *> :: iterator> Range = m_Names.equal_range( name );
+
+	for( boost :: unordered_multimap<string, CDBBan *> :: iterator i = Range.first; i != Range.second; ++i )
+	{
+		// only remove the IP range if it belongs to this ban (another ban for the same range may have been added first)
+		// note: if another ban shares the range it won't be matched by IP until the next time the whole index is replaced
+
+		uint32_t Address;
+		uint32_t PrefixLength;
+
+		if( UTIL_ParseIPRange( i->second->GetIP( ), &Address, &PrefixLength ) )
+		{
+			CDBBan **Ban = m_IPs.Find( Address, PrefixLength );
+
+			if( Ban && *Ban == i->second )
+				m_IPs.Remove( Address, PrefixLength );
+		}
+
+		m_Removed.push_back( i->second );
+	}
+
+	m_Names.erase( Range.first, Range.second );
+}
+
+void CBanIndex :: Replace( vector<CDBBan *> bans )
+{
+	Clear( );
+
+	for( vector<CDBBan *> :: iterator i = bans.begin( ); i != bans.end( ); ++i )
+		Add( *i );
+}
+
+CDBBan *CBanIndex :: FindName( string name )
+{
+	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
+	boost :: unordered_multimap<string, CDBBan *> :: iterator i = m_Names.find( name );
+	return i != m_Names.end( ) ? i->second : NULL;
+}
+
+CDBBan *CBanIndex :: FindIP( string ip )
+{
+	uint32_t Address;
+	uint32_t PrefixLength;
+
+	if( !UTIL_ParseIPRange( ip, &Address, &PrefixLength ) || PrefixLength != 32 )
+		return NULL;
+
+	CDBBan **Ban = m_IPs.Match( Address );
+	return Ban ? *Ban : NULL;
+}
+
+void CBanIndex :: Clear( )
+{
+	for( boost :: unordered_multimap<string, CDBBan *> :: iterator i = m_Names.begin( ); i != m_Names.end( ); ++i )
+		delete i->second;
+
+	for( vector<CDBBan *> :: iterator i = m_Removed.begin( ); i != m_Removed.end( ); ++i )
+		delete *i;
+
+	m_Names.clear( );
+	m_IPs.Clear( );
+	m_Removed.clear( );
+}
+
+//
+// CIPBlackList
+//
+
+CIPBlackList :: CIPBlackList( ) : m_LastWriteTime( 0 )
+{
+
+}
+
+CIPBlackList :: ~CIPBlackList( )
+{
+
+}
+
+void CIPBlackList :: Load( string file )
+{
+	if( file.empty( ) )
+	{
+		m_Ranges.Clear( );
+		m_File.clear( );
+		return;
+	}
+
+	// don't read the file again unless it has been modified since we last loaded it
+
+	time_t LastWriteTime = 0;
+
+	try
+	{
+		LastWriteTime = boost :: filesystem :: last_write_time( boost :: filesystem :: path( file ) );
+	}
+	catch( boost :: filesystem :: filesystem_error &ex )
+	{
+		// the error is reported below when we try to open the file
+	}
+
+	if( file == m_File && LastWriteTime != 0 && LastWriteTime == m_LastWriteTime )
+		return;
+
+	ifstream in;
+	in.open( file.c_str( ) );
+
+	if( in.fail( ) )
+	{
+		CONSOLE_Print( "[GHOST] error loading IP blacklist file [" + file + "]" );
+		return;
+	}
+
+	CONSOLE_Print( "[GHOST] loading IP blacklist file [" + file + "]" );
+	m_Ranges.Clear( );
+	m_File = file;
+	m_LastWriteTime = LastWriteTime;
+	string Line;
+
+	while( !in.eof( ) )
+	{
+		getline( in, Line );
+
+		// ignore blank lines and comments
+
+		if( Line.empty( ) || Line[0] == '#' )
+			continue;
+
+		// remove newlines and partial newlines to help fix issues with Windows formatted files on Linux systems
+
+		Line.erase( remove( Line.begin( ), Line.end( ), ' ' ), Line.end( ) );
+		Line.erase( remove( Line.begin( ), Line.end( ), '\r' ), Line.end( ) );
+		Line.erase( remove( Line.begin( ), Line.end( ), '\n' ), Line.end( ) );
+
+		// ignore lines that don't look like IP addresses or CIDR ranges
+
+		uint32_t Address;
+		uint32_t PrefixLength;
+
+		if( UTIL_ParseIPRange( Line, &Address, &PrefixLength ) )
+			m_Ranges.Add( Address, PrefixLength, true );
+	}
+
+	in.close( );
+
+	CONSOLE_Print( "[GHOST] loaded " + UTIL_ToString( m_Ranges.GetNumRanges( ) ) + " ranges from IP blacklist file" );
+}
+
+bool CIPBlackList :: IsBlackListed( string ip )
+{
+	uint32_t Address;
+	uint32_t PrefixLength;
+
+	if( !UTIL_ParseIPRange( ip, &Address, &PrefixLength ) )
+		return false;
+
+	return m_Ranges.Match( Address ) != NULL;
+}
@@ -0,0 +1,166 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#ifndef ACCESSCONTROL_H
+#define ACCESSCONTROL_H
+
+#include <boost/unordered_map.hpp>
+
+//
+// CIPPrefixMap
+//
+
+// maps IPv4 ranges (a single address or a CIDR block such as 10.0.0.0/8) to a value
+// there's one hash table per prefix length so adding or removing a range is O(1) and a lookup only probes the prefix lengths which are actually in use
+// the longest (most specific) matching range wins
+
+template<class T> class CIPPrefixMap
+{
+private:
+	boost :: unordered_map<uint32_t, T> m_Ranges[33];	// the ranges keyed by their network address, indexed by prefix length
+	uint32_t m_NumRanges;								// the total number of ranges
+
+public:
+	CIPPrefixMap( ) : m_NumRanges( 0 ) { }
+
+	uint32_t GetNumRanges( )					{ return m_NumRanges; }
+
+	static uint32_t Mask( uint32_t address, uint32_t prefixLength )
+	{
+		return prefixLength == 0 ? 0 : address & ( 0xFFFFFFFF << ( 32 - prefixLength ) );
+	}
+
+	// returns false (and keeps the existing value) if the range is already in the map
+
+	bool Add( uint32_t address, uint32_t prefixLength, T value )
+	{
+		if( !m_Ranges[prefixLength].insert( make_pair( Mask( address, prefixLength ), value ) ).second )
+			return false;
+
+		++m_NumRanges;
+		return true;
+	}
+
+	bool Remove( uint32_t address, uint32_t prefixLength )
+	{
+		if( m_Ranges[prefixLength].erase( Mask( address, prefixLength ) ) == 0 )
+			return false;
+
+		--m_NumRanges;
+		return true;
+	}
+
+	T *Find( uint32_t address, uint32_t prefixLength )
+	{
+		typename boost :: unordered_map<uint32_t, T> :: iterator i = m_Ranges[prefixLength].find( Mask( address, prefixLength ) );
+		return i != m_Ranges[prefixLength].end( ) ? &i->second : NULL;
+	}
+
+	T *Match( uint32_t address )
+	{
+		if( m_NumRanges == 0 )
+			return NULL;
+
+		for( int i = 32; i >= 0; --i )
+		{
+			if( !m_Ranges[i].empty( ) )
+			{
+				T *Value = Find( address, i );
+
+				if( Value )
+					return Value;
+			}
+		}
+
+		return NULL;
+	}
+
+	void Clear( )
+	{
+		for( uint32_t i = 0; i <= 32; ++i )
+			m_Ranges[i].clear( );
+
+		m_NumRanges = 0;
+	}
+};
+
+// parses "a.b.c.d" (a /32) or "a.b.c.d/n" into an address in host byte order and a prefix length
+
+bool UTIL_ParseIPRange( string range, uint32_t *address, uint32_t *prefixLength );
+
+//
+// CBanIndex
+//
+
+// the bans of one realm indexed by (lower case) name and by IP address or range
+// a ban can be added or removed in O(1) so the bans added and removed by commands don't require reloading the whole list from the database
+// the index owns the bans, removed bans are kept alive until the whole index is replaced or deleted because other threads may still be holding a pointer to them
+// note: the index isn't thread safe, the owner must serialize access to it
+
+class CDBBan;
+
+class CBanIndex
+{
+private:
+	boost :: unordered_multimap<string, CDBBan *> m_Names;	// the bans keyed by name
+	CIPPrefixMap<CDBBan *> m_IPs;							// the bans with a valid IP address or range (only the first ban for each range is indexed)
+	vector<CDBBan *> m_Removed;								// the bans which have been removed from the index but not deleted yet
+
+public:
+	CBanIndex( );
+	~CBanIndex( );
+
+	uint32_t GetNumBans( )				{ return m_Names.size( ); }
+
+	void Add( CDBBan *ban );
+	void Remove( string name );
+	void Replace( vector<CDBBan *> bans );
+	CDBBan *FindName( string name );
+	CDBBan *FindIP( string ip );
+
+private:
+	void Clear( );
+};
+
+//
+// CIPBlackList
+//
+
+// the IP blacklist file (bot_ipblacklistfile) is loaded once and shared by every game
+// each line is either a single IP address or a CIDR range, the file is only read again when it has been modified
+
+class CIPBlackList
+{
+private:
+	CIPPrefixMap<bool> m_Ranges;		// the blacklisted ranges
+	string m_File;						// the file the ranges were loaded from
+	time_t m_LastWriteTime;				// the modification time of the file when it was loaded
+
+public:
+	CIPBlackList( );
+	~CIPBlackList( );
+
+	uint32_t GetNumRanges( )			{ return m_Ranges.GetNumRanges( ); }
+
+	void Load( string file );
+	bool IsBlackListed( string ip );
+};
+
+#endif
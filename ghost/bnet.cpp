@@ -29,6 +29,7 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include "bnlsclient.h"
 #include "bnetprotocol.h"
 #include "bnet.h"
+#include "accesscontrol.h"
 #include "map.h"
 #include "packed.h"
 #include "savegame.h"
@@ -53,8 +54,15 @@ CBNET :: CBNET( CGHost *nGHost, string nServer, string nServerAlias, string nBNL
 	m_Protocol = new CBNETProtocol( );
 	m_BNLSClient = NULL;
 	m_BNCSUtil = new CBNCSUtilInterface( nUserName, nUserPassword );
-	m_CallableAdminList = m_GHost->m_DB->ThreadedAdminList( nServer );
-	m_CallableBanList = m_GHost->m_DB->ThreadedBanList( nServer );
+	m_Mailbox = CCallableMailboxPtr( new CCallableMailbox( m_GHost->m_Wakeup ) );
+	m_Bans = new CBanIndex( );
+
+	{
+		CCallableMailboxScope MailboxScope( m_Mailbox.get( ) );
+		m_CallableAdminList = m_GHost->m_DB->ThreadedAdminList( nServer );
+		m_CallableBanList = m_GHost->m_DB->ThreadedBanList( nServer );
+	}
+
 	m_Exiting = false;
 	m_Server = nServer;
 	string LowerServer = m_Server;
@@ -110,6 +118,16 @@ CBNET :: CBNET( CGHost *nGHost, string nServer, string nServerAlias, string nBNL
 	m_FirstChannel = nFirstChannel;
 	m_RootAdmin = nRootAdmin;
 	transform( m_RootAdmin.begin( ), m_RootAdmin.end( ), m_RootAdmin.begin( ), (int(*)(int))tolower );
+
+	// multiple root admins can be seperated by a space, e.g. "Varlock Kilranin Instinct121"
+
+	stringstream SS;
+	string RootAdmin;
+	SS << m_RootAdmin;
+
+	while( SS >> RootAdmin )
+		m_RootAdmins.insert( RootAdmin );
+
 	m_CommandTrigger = nCommandTrigger;
 	m_War3Version = nWar3Version;
 	m_EXEVersion = nEXEVersion;
@@ -137,6 +155,9 @@ CBNET :: CBNET( CGHost *nGHost, string nServer, string nServerAlias, string nBNL
 
 CBNET :: ~CBNET( )
 {
+	// our callables are orphaned below and might outlive the main thread's wakeup
+
+	m_Mailbox->SetWakeup( NULL );
 	delete m_Socket;
 	delete m_Protocol;
 	delete m_BNLSClient;
@@ -185,8 +206,7 @@ CBNET :: ~CBNET( )
 	if( m_CallableBanList )
 		m_GHost->m_Callables.push_back( m_CallableBanList );
 
-	for( vector<CDBBan *> :: iterator i = m_Bans.begin( ); i != m_Bans.end( ); ++i )
-		delete *i;
+	delete m_Bans;
 }
 
 BYTEARRAY CBNET :: GetUniqueName( )
@@ -210,12 +230,8 @@ unsigned int CBNET :: SetFD( void *fd, void *send_fd, int *nfds )
 	return NumFDs;
 }
 
-bool CBNET :: Update( void *fd, void *send_fd )
+void CBNET :: UpdateCallables( )
 {
-	//
-	// update callables
-	//
-
 	for( vector<PairedAdminCount> :: iterator i = m_PairedAdminCounts.begin( ); i != m_PairedAdminCounts.end( ); )
 	{
 		if( i->second->GetReady( ) )
@@ -401,39 +417,66 @@ bool CBNET :: Update( void *fd, void *send_fd )
 			++i;
 	}
 
-	// refresh the admin list every 5 minutes
-
-	if( !m_CallableAdminList && GetTime( ) - m_LastAdminRefreshTime >= 300 )
-		m_CallableAdminList = m_GHost->m_DB->ThreadedAdminList( m_Server );
-
 	if( m_CallableAdminList && m_CallableAdminList->GetReady( ) )
 	{
 		// CONSOLE_Print( "[BNET: " + m_ServerAlias + "] refreshed admin list (" + UTIL_ToString( m_Admins.size( ) ) + " -> " + UTIL_ToString( m_CallableAdminList->GetResult( ).size( ) ) + " admins)" );
-		m_Admins = m_CallableAdminList->GetResult( );
+
+		vector<string> Admins = m_CallableAdminList->GetResult( );
+
+		for( vector<string> :: iterator i = Admins.begin( ); i != Admins.end( ); ++i )
+			transform( i->begin( ), i->end( ), i->begin( ), (int(*)(int))tolower );
+
+		{
+			boost :: mutex :: scoped_lock Lock( m_AdminsMutex );
+			m_Admins = boost :: unordered_set<string>( Admins.begin( ), Admins.end( ) );
+		}
+
 		m_GHost->m_DB->RecoverCallable( m_CallableAdminList );
 		delete m_CallableAdminList;
 		m_CallableAdminList = NULL;
 		m_LastAdminRefreshTime = GetTime( );
 	}
 
-	// refresh the ban list every 60 minutes
-
-	if( !m_CallableBanList && GetTime( ) - m_LastBanRefreshTime >= 3600 )
-		m_CallableBanList = m_GHost->m_DB->ThreadedBanList( m_Server );
-
 	if( m_CallableBanList && m_CallableBanList->GetReady( ) )
 	{
-		// CONSOLE_Print( "[BNET: " + m_ServerAlias + "] refreshed ban list (" + UTIL_ToString( m_Bans.size( ) ) + " -> " + UTIL_ToString( m_CallableBanList->GetResult( ).size( ) ) + " bans)" );
+		// CONSOLE_Print( "[BNET: " + m_ServerAlias + "] refreshed ban list (" + UTIL_ToString( m_Bans->GetNumBans( ) ) + " -> " + UTIL_ToString( m_CallableBanList->GetResult( ).size( ) ) + " bans)" );
+		// the bans added and removed since the last refresh were applied to the index as they happened so this only picks up changes made by other bots sharing the database
 
-		for( vector<CDBBan *> :: iterator i = m_Bans.begin( ); i != m_Bans.end( ); ++i )
-			delete *i;
+		{
+			boost :: mutex :: scoped_lock Lock( m_BansMutex );
+			m_Bans->Replace( m_CallableBanList->GetResult( ) );
+		}
 
-		m_Bans = m_CallableBanList->GetResult( );
 		m_GHost->m_DB->RecoverCallable( m_CallableBanList );
 		delete m_CallableBanList;
 		m_CallableBanList = NULL;
 		m_LastBanRefreshTime = GetTime( );
 	}
+}
+
+bool CBNET :: Update( void *fd, void *send_fd )
+{
+	// any callables created while updating are ours
+
+	CCallableMailboxScope MailboxScope( m_Mailbox.get( ) );
+
+	//
+	// update callables
+	// we only walk our pending callables when one of them has completed (see CCallableMailbox)
+	//
+
+	if( m_Mailbox->CheckCallables( ) )
+		UpdateCallables( );
+
+	// refresh the admin list every 5 minutes
+
+	if( !m_CallableAdminList && GetTime( ) - m_LastAdminRefreshTime >= 300 )
+		m_CallableAdminList = m_GHost->m_DB->ThreadedAdminList( m_Server );
+
+	// refresh the ban list every 60 minutes
+
+	if( !m_CallableBanList && GetTime( ) - m_LastBanRefreshTime >= 3600 )
+		m_CallableBanList = m_GHost->m_DB->ThreadedBanList( m_Server );
 
 	// we return at the end of each if statement so we don't have to deal with errors related to the order of the if statements
 	// that means it might take a few ms longer to complete a task involving multiple steps (in this case, reconnecting) due to blocking or sleeping
@@ -633,32 +676,29 @@ void CBNET :: ExtractPackets( )
 {
 	// extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
 
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
 
 	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
 
-	while( Bytes.size( ) >= 4 )
+	while( RecvBuffer->GetSize( ) >= 4 )
 	{
+		const unsigned char *Bytes = RecvBuffer->GetData( );
+
 		// byte 0 is always 255
 
 		if( Bytes[0] == BNET_HEADER_CONSTANT )
 		{
 			// bytes 2 and 3 contain the length of the packet
 
-			uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
+			int32_t Length = RecvBuffer->FramePacket( 2, 4 );
 
-			if( Length >= 4 )
+			if( Length > 0 )
 			{
-				if( Bytes.size( ) >= Length )
-				{
-					m_Packets.push( new CCommandPacket( BNET_HEADER_CONSTANT, Bytes[1], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-					*RecvBuffer = RecvBuffer->substr( Length );
-					Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
-				}
-				else
-					return;
+				m_Packets.push( new CCommandPacket( BNET_HEADER_CONSTANT, Bytes[1], BYTEARRAY( Bytes, Bytes + Length ) ) );
+				RecvBuffer->Consume( Length );
 			}
+			else if( Length == 0 )
+				return;
 			else
 			{
 				CONSOLE_Print( "[BNET: " + m_ServerAlias + "] error - received invalid packet from battle.net (bad length), disconnecting" );
@@ -1497,6 +1537,8 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 
 					uint32_t GameNumber = UTIL_ToUInt32( Payload ) - 1;
 
+					m_GHost->LockGames( );
+
 					if( GameNumber < m_GHost->m_Games.size( ) )
 					{
 						// if the game owner is still in the game only allow the root admin to end the game
@@ -1512,6 +1554,8 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 					}
 					else
 						QueueChatCommand( m_GHost->m_Language->GameNumberDoesntExist( Payload ), User, Whisper );
+
+					m_GHost->UnlockGames( );
 				}
 
 				//
@@ -1532,8 +1576,7 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 						{
 							QueueChatCommand( m_GHost->m_Language->LoadingReplay( File ), User, Whisper );
 							CReplay *Replay = new CReplay( );
-							Replay->Load( File, false );
-							Replay->ParseReplay( false );
+							Replay->LoadHeader( File );
 							m_GHost->m_EnforcePlayers = Replay->GetPlayers( );
 							delete Replay;
 						}
@@ -1595,10 +1638,14 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 				{
 					uint32_t GameNumber = UTIL_ToUInt32( Payload ) - 1;
 
+					m_GHost->LockGames( );
+
 					if( GameNumber < m_GHost->m_Games.size( ) )
 						QueueChatCommand( m_GHost->m_Language->GameNumberIs( Payload, m_GHost->m_Games[GameNumber]->GetDescription( ) ), User, Whisper );
 					else
 						QueueChatCommand( m_GHost->m_Language->GameNumberDoesntExist( Payload ), User, Whisper );
+
+					m_GHost->UnlockGames( );
 				}
 
 				//
@@ -2000,10 +2047,14 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 								if( Start != string :: npos )
 									Message = Message.substr( Start );
 
+								m_GHost->LockGames( );
+
 								if( GameNumber - 1 < m_GHost->m_Games.size( ) )
 									m_GHost->m_Games[GameNumber - 1]->SendAllChat( "ADMIN: " + Message );
 								else
 									QueueChatCommand( m_GHost->m_Language->GameNumberDoesntExist( UTIL_ToString( GameNumber ) ), User, Whisper );
+
+								m_GHost->UnlockGames( );
 							}
 						}
 					}
@@ -2022,8 +2073,12 @@ void CBNET :: ProcessChatEvent( CIncomingChatEvent *chatEvent )
 						if( m_GHost->m_CurrentGame )
 							m_GHost->m_CurrentGame->SendAllChat( Payload );
 
+						m_GHost->LockGames( );
+
 						for( vector<CBaseGame *> :: iterator i = m_GHost->m_Games.begin( ); i != m_GHost->m_Games.end( ); ++i )
 							(*i)->SendAllChat( "ADMIN: " + Payload );
+
+						m_GHost->UnlockGames( );
 					}
 					else
 						QueueChatCommand( m_GHost->m_Language->YouDontHaveAccessToThatCommand( ), User, Whisper );
@@ -2473,105 +2528,55 @@ void CBNET :: UnqueueGameRefreshes( )
 bool CBNET :: IsAdmin( string name )
 {
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-
-	for( vector<string> :: iterator i = m_Admins.begin( ); i != m_Admins.end( ); ++i )
-	{
-		if( *i == name )
-			return true;
-	}
-
-	return false;
+	boost :: mutex :: scoped_lock Lock( m_AdminsMutex );
+	return m_Admins.find( name ) != m_Admins.end( );
 }
 
 bool CBNET :: IsRootAdmin( string name )
 {
-	// m_RootAdmin was already transformed to lower case in the constructor
+	// m_RootAdmins was already transformed to lower case in the constructor
 
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-
-	// updated to permit multiple root admins seperated by a space, e.g. "Varlock Kilranin Instinct121"
-	// note: this function gets called frequently so it would be better to parse the root admins just once and store them in a list somewhere
-	// however, it's hardly worth optimizing at this point since the code's already written
-
-	stringstream SS;
-	string s;
-	SS << m_RootAdmin;
-
-	while( !SS.eof( ) )
-	{
-		SS >> s;
-
-		if( name == s )
-			return true;
-	}
-
-	return false;
+	return m_RootAdmins.find( name ) != m_RootAdmins.end( );
 }
 
 CDBBan *CBNET :: IsBannedName( string name )
 {
-	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-
-	// todotodo: optimize this - maybe use a map?
-
-	for( vector<CDBBan *> :: iterator i = m_Bans.begin( ); i != m_Bans.end( ); ++i )
-	{
-		if( (*i)->GetName( ) == name )
-			return *i;
-	}
-
-	return NULL;
+	boost :: mutex :: scoped_lock Lock( m_BansMutex );
+	return m_Bans->FindName( name );
 }
 
 CDBBan *CBNET :: IsBannedIP( string ip )
 {
-	// todotodo: optimize this - maybe use a map?
-
-	for( vector<CDBBan *> :: iterator i = m_Bans.begin( ); i != m_Bans.end( ); ++i )
-	{
-		if( (*i)->GetIP( ) == ip )
-			return *i;
-	}
-
-	return NULL;
+	boost :: mutex :: scoped_lock Lock( m_BansMutex );
+	return m_Bans->FindIP( ip );
 }
 
 void CBNET :: AddAdmin( string name )
 {
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-	m_Admins.push_back( name );
+	boost :: mutex :: scoped_lock Lock( m_AdminsMutex );
+	m_Admins.insert( name );
 }
 
 void CBNET :: AddBan( string name, string ip, string gamename, string admin, string reason )
 {
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-	m_Bans.push_back( new CDBBan( m_Server, name, ip, "N/A", gamename, admin, reason ) );
+	boost :: mutex :: scoped_lock Lock( m_BansMutex );
+	m_Bans->Add( new CDBBan( m_Server, name, ip, "N/A", gamename, admin, reason ) );
 }
 
 void CBNET :: RemoveAdmin( string name )
 {
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-
-	for( vector<string> :: iterator i = m_Admins.begin( ); i != m_Admins.end( ); )
-	{
-		if( *i == name )
-			i = m_Admins.erase( i );
-		else
-			++i;
-	}
+	boost :: mutex :: scoped_lock Lock( m_AdminsMutex );
+	m_Admins.erase( name );
 }
 
 void CBNET :: RemoveBan( string name )
 {
-	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-
-	for( vector<CDBBan *> :: iterator i = m_Bans.begin( ); i != m_Bans.end( ); )
-	{
-		if( (*i)->GetName( ) == name )
-			i = m_Bans.erase( i );
-		else
-			++i;
-	}
+	boost :: mutex :: scoped_lock Lock( m_BansMutex );
+	m_Bans->Remove( name );
 }
 
 void CBNET :: HoldFriends( CBaseGame *game )
@@ -21,6 +21,10 @@
 #ifndef BNET_H
 #define BNET_H
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_set.hpp>
+
 //
 // CBNET
 //
@@ -33,6 +37,7 @@ class CBNLSClient;
 class CIncomingFriendList;
 class CIncomingClanList;
 class CIncomingChatEvent;
+class CCallableMailbox;
 class CCallableAdminCount;
 class CCallableAdminAdd;
 class CCallableAdminRemove;
@@ -44,6 +49,7 @@ class CCallableBanList;
 class CCallableGamePlayerSummaryCheck;
 class CCallableDotAPlayerSummaryCheck;
 class CDBBan;
+class CBanIndex;
 
 typedef pair<string,CCallableAdminCount *> PairedAdminCount;
 typedef pair<string,CCallableAdminAdd *> PairedAdminAdd;
@@ -78,8 +84,11 @@ private:
 	vector<PairedDPSCheck> m_PairedDPSChecks;		// vector of paired threaded database DotA player summary checks in progress
 	CCallableAdminList *m_CallableAdminList;		// threaded database admin list in progress
 	CCallableBanList *m_CallableBanList;			// threaded database ban list in progress
-	vector<string> m_Admins;						// vector of cached admins
-	vector<CDBBan *> m_Bans;						// vector of cached bans
+	boost :: shared_ptr<CCallableMailbox> m_Mailbox;	// the mailbox our callables post to when they complete
+	boost :: unordered_set<string> m_Admins;		// set of cached admins (in lower case)
+	boost :: mutex m_AdminsMutex;					// protects m_Admins (games owned by worker threads check for admins too)
+	CBanIndex *m_Bans;								// index of cached bans
+	boost :: mutex m_BansMutex;						// protects m_Bans (games owned by worker threads check for bans too)
 	bool m_Exiting;									// set to true and this class will be deleted next update
 	string m_Server;								// battle.net server to connect to
 	string m_ServerIP;								// battle.net server to connect to (the IP address so we don't have to resolve it every time we connect)
@@ -97,6 +106,7 @@ private:
 	string m_FirstChannel;							// the first chat channel to join upon entering chat (note: we hijack this to store the last channel when entering a game)
 	string m_CurrentChannel;						// the current chat channel
 	string m_RootAdmin;								// the root admin
+	set<string> m_RootAdmins;						// the root admins parsed from m_RootAdmin (in lower case)
 	char m_CommandTrigger;							// the character prefix to identify commands
 	unsigned char m_War3Version;					// custom warcraft 3 version for PvPGN users
 	BYTEARRAY m_EXEVersion;							// custom exe version for PvPGN users
@@ -152,6 +162,7 @@ public:
 	// processing functions
 
 	unsigned int SetFD( void *fd, void *send_fd, int *nfds );
+	void UpdateCallables( );
 	bool Update( void *fd, void *send_fd );
 	void ExtractPackets( );
 	void ProcessPackets( );
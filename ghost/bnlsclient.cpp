@@ -128,24 +128,22 @@ bool CBNLSClient :: Update( void *fd, void *send_fd )
 
 void CBNLSClient :: ExtractPackets( )
 {
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
 
-	while( Bytes.size( ) >= 3 )
+	while( RecvBuffer->GetSize( ) >= 3 )
 	{
-		uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false );
+		// bytes 0 and 1 contain the length of the packet
 
-		if( Length >= 3 )
+		int32_t Length = RecvBuffer->FramePacket( 0, 3 );
+
+		if( Length > 0 )
 		{
-			if( Bytes.size( ) >= Length )
-			{
-				m_Packets.push( new CCommandPacket( 0, Bytes[2], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-				*RecvBuffer = RecvBuffer->substr( Length );
-				Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
-			}
-			else
-				return;
+			const unsigned char *Bytes = RecvBuffer->GetData( );
+			m_Packets.push( new CCommandPacket( 0, Bytes[2], BYTEARRAY( Bytes, Bytes + Length ) ) );
+			RecvBuffer->Consume( Length );
 		}
+		else if( Length == 0 )
+			return;
 		else
 		{
 			CONSOLE_Print( "[BNLSC: " + m_Server + ":" + UTIL_ToString( m_Port ) + ":C" + UTIL_ToString( m_WardenCookie ) + "] error - received invalid packet from BNLS server (bad length), disconnecting" );
@@ -1,24 +1,227 @@
 #include "ghost.h"
 #include "crc32.h"
 
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+ #define CRC32_X86
+ #include <emmintrin.h>
+ #include <smmintrin.h>
+ #include <wmmintrin.h>
+
+ #ifdef _MSC_VER
+  #include <intrin.h>
+  #define CRC32_TARGET_PCLMUL
+ #else
+  #include <cpuid.h>
+  #define CRC32_TARGET_PCLMUL __attribute__(( target( "sse4.1,pclmul" ) ))
+ #endif
+#endif
+
+#if defined( __aarch64__ ) && defined( __linux__ )
+ #define CRC32_ARMV8
+ #include <arm_acle.h>
+ #include <sys/auxv.h>
+ #include <asm/hwcap.h>
+ #define CRC32_TARGET_ARMV8 __attribute__(( target( "+crc" ) ))
+#endif
+
+#ifdef CRC32_X86
+
+//
+// PCLMULQDQ engine
+// this is the folding algorithm from Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" paper
+// the constants are for the bit reflected CRC32 polynomial
+// ulLength must be at least 64 and a multiple of 16
+//
+
+CRC32_TARGET_PCLMUL static uint32_t PartialCRCPCLMUL( uint32_t ulCRC, const unsigned char *sData, uint32_t ulLength )
+{
+	const __m128i K1K2 = _mm_set_epi64x( 0x01c6e41596LL, 0x0154442bd4LL );
+	const __m128i K3K4 = _mm_set_epi64x( 0x00ccaa009eLL, 0x01751997d0LL );
+	const __m128i K5K0 = _mm_set_epi64x( 0, 0x0163cd6124LL );
+	const __m128i Poly = _mm_set_epi64x( 0x01f7011641LL, 0x01db710641LL );
+	const __m128i Mask = _mm_setr_epi32( ~0, 0, ~0, 0 );
+
+	// load the first 64 bytes and fold in the initial crc
+
+	__m128i X1 = _mm_loadu_si128( (const __m128i *)( sData + 0x00 ) );
+	__m128i X2 = _mm_loadu_si128( (const __m128i *)( sData + 0x10 ) );
+	__m128i X3 = _mm_loadu_si128( (const __m128i *)( sData + 0x20 ) );
+	__m128i X4 = _mm_loadu_si128( (const __m128i *)( sData + 0x30 ) );
+	X1 = _mm_xor_si128( X1, _mm_cvtsi32_si128( ulCRC ) );
+	sData += 64;
+	ulLength -= 64;
+
+	// fold 64 bytes at a time
+
+	while( ulLength >= 64 )
+	{
+		__m128i X5 = _mm_clmulepi64_si128( X1, K1K2, 0x00 );
+		__m128i X6 = _mm_clmulepi64_si128( X2, K1K2, 0x00 );
+		__m128i X7 = _mm_clmulepi64_si128( X3, K1K2, 0x00 );
+		__m128i X8 = _mm_clmulepi64_si128( X4, K1K2, 0x00 );
+		X1 = _mm_clmulepi64_si128( X1, K1K2, 0x11 );
+		X2 = _mm_clmulepi64_si128( X2, K1K2, 0x11 );
+		X3 = _mm_clmulepi64_si128( X3, K1K2, 0x11 );
+		X4 = _mm_clmulepi64_si128( X4, K1K2, 0x11 );
+		X1 = _mm_xor_si128( _mm_xor_si128( X1, X5 ), _mm_loadu_si128( (const __m128i *)( sData + 0x00 ) ) );
+		X2 = _mm_xor_si128( _mm_xor_si128( X2, X6 ), _mm_loadu_si128( (const __m128i *)( sData + 0x10 ) ) );
+		X3 = _mm_xor_si128( _mm_xor_si128( X3, X7 ), _mm_loadu_si128( (const __m128i *)( sData + 0x20 ) ) );
+		X4 = _mm_xor_si128( _mm_xor_si128( X4, X8 ), _mm_loadu_si128( (const __m128i *)( sData + 0x30 ) ) );
+		sData += 64;
+		ulLength -= 64;
+	}
+
+	// fold the four 128 bit values into one
+
+	__m128i X5 = _mm_clmulepi64_si128( X1, K3K4, 0x00 );
+	X1 = _mm_clmulepi64_si128( X1, K3K4, 0x11 );
+	X1 = _mm_xor_si128( _mm_xor_si128( X1, X2 ), X5 );
+	X5 = _mm_clmulepi64_si128( X1, K3K4, 0x00 );
+	X1 = _mm_clmulepi64_si128( X1, K3K4, 0x11 );
+	X1 = _mm_xor_si128( _mm_xor_si128( X1, X3 ), X5 );
+	X5 = _mm_clmulepi64_si128( X1, K3K4, 0x00 );
+	X1 = _mm_clmulepi64_si128( X1, K3K4, 0x11 );
+	X1 = _mm_xor_si128( _mm_xor_si128( X1, X4 ), X5 );
+
+	// fold 16 bytes at a time
+
+	while( ulLength >= 16 )
+	{
+		X5 = _mm_clmulepi64_si128( X1, K3K4, 0x00 );
+		X1 = _mm_clmulepi64_si128( X1, K3K4, 0x11 );
+		X1 = _mm_xor_si128( _mm_xor_si128( X1, _mm_loadu_si128( (const __m128i *)sData ) ), X5 );
+		sData += 16;
+		ulLength -= 16;
+	}
+
+	// fold 128 bits to 64 bits
+
+	X2 = _mm_clmulepi64_si128( X1, K3K4, 0x10 );
+	X1 = _mm_xor_si128( _mm_srli_si128( X1, 8 ), X2 );
+	X2 = _mm_srli_si128( X1, 4 );
+	X1 = _mm_and_si128( X1, Mask );
+	X1 = _mm_clmulepi64_si128( X1, K5K0, 0x00 );
+	X1 = _mm_xor_si128( X1, X2 );
+
+	// barrett reduction to 32 bits
+
+	X2 = _mm_and_si128( X1, Mask );
+	X2 = _mm_clmulepi64_si128( X2, Poly, 0x10 );
+	X2 = _mm_and_si128( X2, Mask );
+	X2 = _mm_clmulepi64_si128( X2, Poly, 0x00 );
+	X1 = _mm_xor_si128( X1, X2 );
+	return _mm_extract_epi32( X1, 1 );
+}
+
+static bool CPUHasPCLMUL( )
+{
+	// we need SSE4.1 (ecx bit 19) for _mm_extract_epi32 and PCLMULQDQ (ecx bit 1)
+
+#ifdef _MSC_VER
+	int Info[4];
+	__cpuid( Info, 1 );
+	unsigned int ECX = Info[2];
+#else
+	unsigned int EAX, EBX, ECX, EDX;
+
+	if( !__get_cpuid( 1, &EAX, &EBX, &ECX, &EDX ) )
+		return false;
+#endif
+
+	return ( ECX & ( 1 << 19 ) ) && ( ECX & ( 1 << 1 ) );
+}
+
+#endif
+
+#ifdef CRC32_ARMV8
+
+//
+// ARMv8 CRC32 engine
+//
+
+CRC32_TARGET_ARMV8 static uint32_t PartialCRCARMv8( uint32_t ulCRC, const unsigned char *sData, uint32_t ulLength )
+{
+	while( ulLength > 0 && ( (uintptr_t)sData & 7 ) )
+	{
+		ulCRC = __crc32b( ulCRC, *sData++ );
+		--ulLength;
+	}
+
+	while( ulLength >= 8 )
+	{
+		uint64_t Value;
+		memcpy( &Value, sData, 8 );
+		ulCRC = __crc32d( ulCRC, Value );
+		sData += 8;
+		ulLength -= 8;
+	}
+
+	while( ulLength-- )
+		ulCRC = __crc32b( ulCRC, *sData++ );
+
+	return ulCRC;
+}
+
+static bool CPUHasARMv8CRC( )
+{
+	return ( getauxval( AT_HWCAP ) & HWCAP_CRC32 ) != 0;
+}
+
+#endif
+
+//
+// CCRC32
+//
+
 void CCRC32 :: Initialize( )
 {
-        for( int iCodes = 0; iCodes <= 0xFF; ++iCodes )
+	for( int iCodes = 0; iCodes <= 0xFF; ++iCodes )
 	{
-		ulTable[iCodes] = Reflect( iCodes, 8 ) << 24;
+		ulTable[0][iCodes] = Reflect( iCodes, 8 ) << 24;
 
 		for( int iPos = 0; iPos < 8; iPos++ )
-			ulTable[iCodes] = ( ulTable[iCodes] << 1 ) ^ ( ulTable[iCodes] & (1 << 31) ? CRC32_POLYNOMIAL : 0 );
+			ulTable[0][iCodes] = ( ulTable[0][iCodes] << 1 ) ^ ( ulTable[0][iCodes] & (1 << 31) ? CRC32_POLYNOMIAL : 0 );
+
+		ulTable[0][iCodes] = Reflect( ulTable[0][iCodes], 32 );
+	}
+
+	// the slice-by-16 tables
+	// ulTable[n][i] is the crc of byte i followed by n zero bytes
 
-		ulTable[iCodes] = Reflect( ulTable[iCodes], 32 );
+	for( int iSlice = 1; iSlice < 16; ++iSlice )
+	{
+	        for( int iCodes = 0; iCodes <= 0xFF; ++iCodes )
+			ulTable[iSlice][iCodes] = ( ulTable[iSlice - 1][iCodes] >> 8 ) ^ ulTable[0][ulTable[iSlice - 1][iCodes] & 0xFF];
 	}
+
+	// the powers of x used to combine crcs, ulX2NTable[n] is x^(2^n) mod P(x)
+
+	uint32_t ulPower = 1 << 30;		// x^1
+	ulX2NTable[0] = ulPower;
+
+	for( int n = 1; n < 32; ++n )
+		ulX2NTable[n] = ulPower = MultModP( ulPower, ulPower );
+
+	// pick the fastest engine this CPU supports
+
+	m_Engine = CRC32_ENGINE_SLICE16;
+
+#ifdef CRC32_X86
+	if( CPUHasPCLMUL( ) )
+		m_Engine = CRC32_ENGINE_PCLMUL;
+#endif
+
+#ifdef CRC32_ARMV8
+	if( CPUHasARMv8CRC( ) )
+		m_Engine = CRC32_ENGINE_ARMV8;
+#endif
 }
 
 uint32_t CCRC32 :: Reflect( uint32_t ulReflect, char cChar )
 {
 	uint32_t ulValue = 0;
 
-        for( int iPos = 1; iPos < ( cChar + 1 ); ++iPos )
+	for( int iPos = 1; iPos < ( cChar + 1 ); ++iPos )
 	{
 		if( ulReflect & 1 )
 			ulValue |= 1 << ( cChar - iPos );
@@ -38,6 +241,108 @@ uint32_t CCRC32 :: FullCRC( unsigned char *sData, uint32_t ulLength )
 
 void CCRC32 :: PartialCRC( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength )
 {
+#ifdef CRC32_X86
+	if( m_Engine == CRC32_ENGINE_PCLMUL && ulLength >= 64 )
+	{
+		// the PCLMULQDQ engine works on multiples of 16 bytes, the rest is handled by the slice-by-16 engine
+
+		uint32_t ulBlocks = ulLength & ~15;
+		*ulInCRC = PartialCRCPCLMUL( *ulInCRC, sData, ulBlocks );
+		sData += ulBlocks;
+		ulLength -= ulBlocks;
+	}
+#endif
+
+#ifdef CRC32_ARMV8
+	if( m_Engine == CRC32_ENGINE_ARMV8 )
+	{
+		*ulInCRC = PartialCRCARMv8( *ulInCRC, sData, ulLength );
+		return;
+	}
+#endif
+
+	PartialCRCSlice16( ulInCRC, sData, ulLength );
+}
+
+void CCRC32 :: PartialCRCSlice16( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength )
+{
+	uint32_t ulCRC = *ulInCRC;
+
+	// process 16 bytes at a time
+	// the bytes are assembled in little endian order so this works on big endian machines too
+
+	while( ulLength >= 16 )
+	{
+		uint32_t ulOne = ulCRC ^ ( sData[0] | ( sData[1] << 8 ) | ( sData[2] << 16 ) | ( (uint32_t)sData[3] << 24 ) );
+		uint32_t ulTwo = sData[4] | ( sData[5] << 8 ) | ( sData[6] << 16 ) | ( (uint32_t)sData[7] << 24 );
+		uint32_t ulThree = sData[8] | ( sData[9] << 8 ) | ( sData[10] << 16 ) | ( (uint32_t)sData[11] << 24 );
+		uint32_t ulFour = sData[12] | ( sData[13] << 8 ) | ( sData[14] << 16 ) | ( (uint32_t)sData[15] << 24 );
+
+		ulCRC = ulTable[15][ulOne & 0xFF] ^ ulTable[14][( ulOne >> 8 ) & 0xFF] ^ ulTable[13][( ulOne >> 16 ) & 0xFF] ^ ulTable[12][ulOne >> 24] ^
+				ulTable[11][ulTwo & 0xFF] ^ ulTable[10][( ulTwo >> 8 ) & 0xFF] ^ ulTable[9][( ulTwo >> 16 ) & 0xFF] ^ ulTable[8][ulTwo >> 24] ^
+				ulTable[7][ulThree & 0xFF] ^ ulTable[6][( ulThree >> 8 ) & 0xFF] ^ ulTable[5][( ulThree >> 16 ) & 0xFF] ^ ulTable[4][ulThree >> 24] ^
+				ulTable[3][ulFour & 0xFF] ^ ulTable[2][( ulFour >> 8 ) & 0xFF] ^ ulTable[1][( ulFour >> 16 ) & 0xFF] ^ ulTable[0][ulFour >> 24];
+
+		sData += 16;
+		ulLength -= 16;
+	}
+
 	while( ulLength-- )
-		*ulInCRC = ( *ulInCRC >> 8 ) ^ ulTable[( *ulInCRC & 0xFF ) ^ *sData++];
+		ulCRC = ( ulCRC >> 8 ) ^ ulTable[0][( ulCRC & 0xFF ) ^ *sData++];
+
+	*ulInCRC = ulCRC;
+}
+
+uint32_t CCRC32 :: MultModP( uint32_t a, uint32_t b )
+{
+	// multiply a and b modulo P(x) (both are bit reflected polynomials)
+
+	uint32_t m = (uint32_t)1 << 31;
+	uint32_t p = 0;
+
+	for( ; ; )
+	{
+		if( a & m )
+		{
+			p ^= b;
+
+			if( ( a & ( m - 1 ) ) == 0 )
+				break;
+		}
+
+		m >>= 1;
+		b = b & 1 ? ( b >> 1 ) ^ 0xEDB88320 : b >> 1;
+	}
+
+	return p;
+}
+
+uint32_t CCRC32 :: CombineCRC( uint32_t ulCRC1, uint32_t ulCRC2, uint32_t ulLength2 )
+{
+	// return the crc of two blocks of data given the crc of each block and the length of the second block
+	// this allows us to calculate the crc of a whole file from the crcs of its parts without going over the data again
+
+	uint32_t ulPower = (uint32_t)1 << 31;		// x^0
+	uint32_t k = 3;								// ulLength2 is in bytes, x^(8 * ulLength2) = x^(2^3 * ulLength2)
+
+	while( ulLength2 )
+	{
+		if( ulLength2 & 1 )
+			ulPower = MultModP( ulX2NTable[k & 31], ulPower );
+
+		ulLength2 >>= 1;
+		++k;
+	}
+
+	return MultModP( ulPower, ulCRC1 ) ^ ulCRC2;
+}
+
+string CCRC32 :: GetEngineName( )
+{
+	if( m_Engine == CRC32_ENGINE_PCLMUL )
+		return "PCLMULQDQ";
+	else if( m_Engine == CRC32_ENGINE_ARMV8 )
+		return "ARMv8 CRC32";
+	else
+		return "slice-by-16";
 }
@@ -3,16 +3,33 @@
 
 #define CRC32_POLYNOMIAL 0x04c11db7
 
+// the CRC is calculated with one of several engines which all produce the same output
+// the fastest engine supported by the CPU is selected in Initialize
+//  slice-by-16 (portable) -> processes 16 bytes per step using 16 lookup tables
+//  PCLMULQDQ (x86 with SSE4.1 and PCLMULQDQ) -> folds 64 bytes per step using carry-less multiplication
+//  ARMv8 CRC32 (aarch64 Linux with the CRC extension) -> uses the CRC32 instructions which implement this polynomial directly
+
+#define CRC32_ENGINE_SLICE16	0
+#define CRC32_ENGINE_PCLMUL		1
+#define CRC32_ENGINE_ARMV8		2
+
 class CCRC32
 {
 public:
 	void Initialize( );
 	uint32_t FullCRC( unsigned char *sData, uint32_t ulLength );
 	void PartialCRC( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength );
+	uint32_t CombineCRC( uint32_t ulCRC1, uint32_t ulCRC2, uint32_t ulLength2 );
+	int GetEngine( )								{ return m_Engine; }
+	string GetEngineName( );
 
 private:
 	uint32_t Reflect( uint32_t ulReflect, char cChar );
-	uint32_t ulTable[256];
+	void PartialCRCSlice16( uint32_t *ulInCRC, unsigned char *sData, uint32_t ulLength );
+	uint32_t MultModP( uint32_t a, uint32_t b );
+	uint32_t ulTable[16][256];
+	uint32_t ulX2NTable[32];						// x^(2^n) mod P(x) for combining CRCs
+	int m_Engine;
 };
 
 #endif
@@ -32,6 +32,7 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include "gameprotocol.h"
 #include "game_base.h"
 #include "game.h"
+#include "iptocountry.h"
 #include "stats.h"
 #include "statsdota.h"
 #include "statsw3mmd.h"
@@ -82,20 +83,17 @@ CGame :: ~CGame( )
 	{
 		if( m_CallableGameAdd->GetResult( ) > 0 )
 		{
-			CONSOLE_Print( "[GAME: " + m_GameName + "] saving player/stats data to database" );
+			CONSOLE_Print( "[GAME: " + m_GameName + "] saved game data to database in " + UTIL_ToString( m_CallableGameAdd->GetElapsed( ) ) + "ms" );
 
-			// store the CDBGamePlayers in the database
+			// if the database rated the game we already know the players' new scores so the next lobby doesn't have to look them up
 
-			for( vector<CDBGamePlayer *> :: iterator i = m_DBGamePlayers.begin( ); i != m_DBGamePlayers.end( ); ++i )
-				m_GHost->m_Callables.push_back( m_GHost->m_DB->ThreadedGamePlayerAdd( m_CallableGameAdd->GetResult( ), (*i)->GetName( ), (*i)->GetIP( ), (*i)->GetSpoofed( ), (*i)->GetSpoofedRealm( ), (*i)->GetReserved( ), (*i)->GetLoadingTime( ), (*i)->GetLeft( ), (*i)->GetLeftReason( ), (*i)->GetTeam( ), (*i)->GetColour( ) ) );
+			CDBGameData *GameData = m_CallableGameAdd->GetGameData( );
 
-			// store the stats in the database
-
-			if( m_Stats )
-				m_Stats->Save( m_GHost, m_GHost->m_DB, m_CallableGameAdd->GetResult( ) );
+			for( unsigned int i = 0; i < GameData->m_Scores.size( ); ++i )
+				m_GHost->m_ScoreCache->Put( GameData->m_ScoreCategory, GameData->m_ScoreNames[i], GameData->m_ScoreServers[i], GameData->m_Scores[i] );
 		}
 		else
-			CONSOLE_Print( "[GAME: " + m_GameName + "] unable to save player/stats data to database" );
+			CONSOLE_Print( "[GAME: " + m_GameName + "] unable to save game data to database" );
 
 		m_GHost->m_DB->RecoverCallable( m_CallableGameAdd );
 		delete m_CallableGameAdd;
@@ -124,22 +122,18 @@ CGame :: ~CGame( )
 
 	delete m_Stats;
 
-	// it's a "bad thing" if m_CallableGameAdd is non NULL here
-	// it means the game is being deleted after m_CallableGameAdd was created (the first step to saving the game data) but before the associated thread terminated
-	// rather than failing horribly we choose to allow the thread to complete in the orphaned callables list but step 2 will never be completed
-	// so this will create a game entry in the database without any gameplayers and/or DotA stats
+	// if m_CallableGameAdd is non NULL here the game is being deleted before the associated thread terminated
+	// the callable owns a copy of all the game data so we just let the thread complete in the orphaned callables list
 
 	if( m_CallableGameAdd )
 	{
-		CONSOLE_Print( "[GAME: " + m_GameName + "] game is being deleted before all game data was saved, game data has been lost" );
+		CONSOLE_Print( "[GAME: " + m_GameName + "] game is being deleted before the game data was saved, it will be saved in the background" );
 		m_GHost->m_Callables.push_back( m_CallableGameAdd );
 	}
 }
 
-bool CGame :: Update( void *fd, void *send_fd )
+void CGame :: UpdateCallables( )
 {
-	// update callables
-
 	for( vector<PairedBanCheck> :: iterator i = m_PairedBanChecks.begin( ); i != m_PairedBanChecks.end( ); )
 	{
 		if( i->second->GetReady( ) )
@@ -168,7 +162,7 @@ bool CGame :: Update( void *fd, void *send_fd )
 				for( vector<CBNET *> :: iterator j = m_GHost->m_BNETs.begin( ); j != m_GHost->m_BNETs.end( ); ++j )
 				{
 					if( (*j)->GetServer( ) == i->second->GetServer( ) )
-						(*j)->AddBan( i->second->GetUser( ), i->second->GetIP( ), i->second->GetGameName( ), i->second->GetAdmin( ), i->second->GetReason( ) );
+						AddBNETBan( *j, i->second->GetUser( ), i->second->GetIP( ), i->second->GetGameName( ), i->second->GetAdmin( ), i->second->GetReason( ) );
 				}
 
 				SendAllChat( m_GHost->m_Language->PlayerWasBannedByPlayer( i->second->GetServer( ), i->second->GetUser( ), i->first ) );
@@ -283,7 +277,7 @@ bool CGame :: Update( void *fd, void *send_fd )
 			++i;
 	}
 
-	return CBaseGame :: Update( fd, send_fd );
+	CBaseGame :: UpdateCallables( );
 }
 
 void CGame :: EventPlayerDeleted( CGamePlayer *player )
@@ -333,6 +327,7 @@ bool CGame :: EventPlayerAction( CGamePlayer *player, CIncomingAction *action )
 		CONSOLE_Print( "[GAME: " + m_GameName + "] gameover timer started (stats class reported game over)" );
 		SendEndMessage( );
 		m_GameOverTime = GetTime( );
+		SetTimer( &m_GameOverTimer, 60000 );
 	}
 	
 	return success;
@@ -597,13 +592,13 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 							}
 						}
 
-						SendAllChat( m_GHost->m_Language->CheckedPlayer( LastMatch->GetName( ), LastMatch->GetNumPings( ) > 0 ? UTIL_ToString( LastMatch->GetPing( m_GHost->m_LCPings ) ) + "ms" : "N/A", m_GHost->m_DBLocal->FromCheck( UTIL_ByteArrayToUInt32( LastMatch->GetExternalIP( ), true ) ), LastMatchAdminCheck || LastMatchRootAdminCheck ? "Yes" : "No", IsOwner( LastMatch->GetName( ) ) ? "Yes" : "No", LastMatch->GetSpoofed( ) ? "Yes" : "No", LastMatch->GetSpoofedRealm( ).empty( ) ? "N/A" : LastMatch->GetSpoofedRealm( ), LastMatch->GetReserved( ) ? "Yes" : "No" ) );
+						SendAllChat( m_GHost->m_Language->CheckedPlayer( LastMatch->GetName( ), LastMatch->GetNumPings( ) > 0 ? UTIL_ToString( LastMatch->GetPing( m_GHost->m_LCPings ) ) + "ms" : "N/A", m_GHost->m_IPToCountry->Lookup( UTIL_ByteArrayToUInt32( LastMatch->GetExternalIP( ), true ) ), LastMatchAdminCheck || LastMatchRootAdminCheck ? "Yes" : "No", IsOwner( LastMatch->GetName( ) ) ? "Yes" : "No", LastMatch->GetSpoofed( ) ? "Yes" : "No", LastMatch->GetSpoofedRealm( ).empty( ) ? "N/A" : LastMatch->GetSpoofedRealm( ), LastMatch->GetReserved( ) ? "Yes" : "No" ) );
 					}
 					else
 						SendAllChat( m_GHost->m_Language->UnableToCheckPlayerFoundMoreThanOneMatch( Payload ) );
 				}
 				else
-					SendAllChat( m_GHost->m_Language->CheckedPlayer( User, player->GetNumPings( ) > 0 ? UTIL_ToString( player->GetPing( m_GHost->m_LCPings ) ) + "ms" : "N/A", m_GHost->m_DBLocal->FromCheck( UTIL_ByteArrayToUInt32( player->GetExternalIP( ), true ) ), AdminCheck || RootAdminCheck ? "Yes" : "No", IsOwner( User ) ? "Yes" : "No", player->GetSpoofed( ) ? "Yes" : "No", player->GetSpoofedRealm( ).empty( ) ? "N/A" : player->GetSpoofedRealm( ), player->GetReserved( ) ? "Yes" : "No" ) );
+					SendAllChat( m_GHost->m_Language->CheckedPlayer( User, player->GetNumPings( ) > 0 ? UTIL_ToString( player->GetPing( m_GHost->m_LCPings ) ) + "ms" : "N/A", m_GHost->m_IPToCountry->Lookup( UTIL_ByteArrayToUInt32( player->GetExternalIP( ), true ) ), AdminCheck || RootAdminCheck ? "Yes" : "No", IsOwner( User ) ? "Yes" : "No", player->GetSpoofed( ) ? "Yes" : "No", player->GetSpoofedRealm( ).empty( ) ? "N/A" : player->GetSpoofedRealm( ), player->GetReserved( ) ? "Yes" : "No" ) );
 			}
 
 			//
@@ -920,6 +915,9 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 							LastMatch->SetDownloadAllowed( true );
 							LastMatch->SetDownloadStarted( true );
 							LastMatch->SetStartedDownloadingTicks( GetTicks( ) );
+
+							if( !m_DownloadTimer.GetPending( ) && !m_DownloadTimer.GetExpired( ) )
+								SetTimer( &m_DownloadTimer, 0 );
 						}
 					}
 				}
@@ -994,7 +992,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 
 					Froms += (*i)->GetNameTerminated( );
 					Froms += ": (";
-					Froms += m_GHost->m_DBLocal->FromCheck( UTIL_ByteArrayToUInt32( (*i)->GetExternalIP( ), true ) );
+					Froms += m_GHost->m_IPToCountry->Lookup( UTIL_ByteArrayToUInt32( (*i)->GetExternalIP( ), true ) );
 					Froms += ")";
 
 					if( i != m_Players.end( ) - 1 )
@@ -1337,7 +1335,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 					}
 
 					m_CreationTime = GetTime( );
-					m_LastRefreshTime = GetTime( );
+					SetTimer( &m_RefreshTimer, 3000 );
 				}
 				else
 					SendAllChat( m_GHost->m_Language->UnableToCreateGameNameTooLong( Payload ) );
@@ -1374,7 +1372,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 					}
 
 					m_CreationTime = GetTime( );
-					m_LastRefreshTime = GetTime( );
+					SetTimer( &m_RefreshTimer, 3000 );
 				}
 				else
 					SendAllChat( m_GHost->m_Language->UnableToCreateGameNameTooLong( Payload ) );
@@ -1404,7 +1402,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 			else if( Command == "say" && !Payload.empty( ) )
 			{
 				for( vector<CBNET *> :: iterator i = m_GHost->m_BNETs.begin( ); i != m_GHost->m_BNETs.end( ); ++i )
-					(*i)->QueueChatCommand( Payload );
+					QueueBNETChatCommand( *i, Payload );
 
 				HideCommand = true;
 			}
@@ -1625,7 +1623,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 			{
 				SendAllChat( m_GHost->m_Language->VoteKickCancelled( m_KickVotePlayer ) );
 				m_KickVotePlayer.clear( );
-				m_StartedKickVoteTime = 0;
+				m_KickVoteTimer.Cancel( );
 			}
 
 			//
@@ -1647,7 +1645,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 					Message = Payload.substr( MessageStart + 1 );
 
 					for( vector<CBNET *> :: iterator i = m_GHost->m_BNETs.begin( ); i != m_GHost->m_BNETs.end( ); ++i )
-						(*i)->QueueChatCommand( Message, Name, true );
+						QueueBNETChatCommand( *i, Message, Name, true );
 				}
 
 				HideCommand = true;
@@ -1676,7 +1674,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 	//
 
 	if( Command == "checkme" )
-		SendChat( player, m_GHost->m_Language->CheckedPlayer( User, player->GetNumPings( ) > 0 ? UTIL_ToString( player->GetPing( m_GHost->m_LCPings ) ) + "ms" : "N/A", m_GHost->m_DBLocal->FromCheck( UTIL_ByteArrayToUInt32( player->GetExternalIP( ), true ) ), AdminCheck || RootAdminCheck ? "Yes" : "No", IsOwner( User ) ? "Yes" : "No", player->GetSpoofed( ) ? "Yes" : "No", player->GetSpoofedRealm( ).empty( ) ? "N/A" : player->GetSpoofedRealm( ), player->GetReserved( ) ? "Yes" : "No" ) );
+		SendChat( player, m_GHost->m_Language->CheckedPlayer( User, player->GetNumPings( ) > 0 ? UTIL_ToString( player->GetPing( m_GHost->m_LCPings ) ) + "ms" : "N/A", m_GHost->m_IPToCountry->Lookup( UTIL_ByteArrayToUInt32( player->GetExternalIP( ), true ) ), AdminCheck || RootAdminCheck ? "Yes" : "No", IsOwner( User ) ? "Yes" : "No", player->GetSpoofed( ) ? "Yes" : "No", player->GetSpoofedRealm( ).empty( ) ? "N/A" : player->GetSpoofedRealm( ), player->GetReserved( ) ? "Yes" : "No" ) );
 
 	//
 	// !STATS
@@ -1753,7 +1751,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 				else
 				{
 					m_KickVotePlayer = LastMatch->GetName( );
-					m_StartedKickVoteTime = GetTime( );
+					SetTimer( &m_KickVoteTimer, 60000 );
 
 					for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 						(*i)->SetKickVote( false );
@@ -1809,7 +1807,7 @@ bool CGame :: EventPlayerBotCommand( CGamePlayer *player, string command, string
 				SendAllChat( m_GHost->m_Language->ErrorVoteKickingPlayer( m_KickVotePlayer ) );
 
 			m_KickVotePlayer.clear( );
-			m_StartedKickVoteTime = 0;
+			m_KickVoteTimer.Cancel( );
 		}
 		else
 			SendAllChat( m_GHost->m_Language->VoteKickAcceptedNeedMoreVotes( m_KickVotePlayer, User, UTIL_ToString( VotesNeeded - Votes ) ) );
@@ -1838,6 +1836,24 @@ bool CGame :: IsGameDataSaved( )
 
 void CGame :: SaveGameData( )
 {
+	// collect the game, the players and the stats and save them all at once
+	// the database writes the whole game in a single transaction (with multi row inserts where supported) rather than one query and one callable per row
+
 	CONSOLE_Print( "[GAME: " + m_GameName + "] saving game data to database" );
-	m_CallableGameAdd = m_GHost->m_DB->ThreadedGameAdd( m_GHost->m_BNETs.size( ) == 1 ? m_GHost->m_BNETs[0]->GetServer( ) : string( ), m_DBGame->GetMap( ), m_GameName, m_OwnerName, m_GameTicks / 1000, m_GameState, m_CreatorName, m_CreatorServer );
+	CDBGameData *GameData = new CDBGameData( m_GHost->m_BNETs.size( ) == 1 ? m_GHost->m_BNETs[0]->GetServer( ) : string( ), m_DBGame->GetMap( ), m_GameName, m_OwnerName, m_GameTicks / 1000, m_GameState, m_CreatorName, m_CreatorServer );
+
+	for( vector<CDBGamePlayer *> :: iterator i = m_DBGamePlayers.begin( ); i != m_DBGamePlayers.end( ); ++i )
+	{
+		GameData->m_Players.push_back( **i );
+
+		// the players' scores will change once this game has been rated so don't keep using the old ones
+
+		if( !m_Map->GetMapMatchMakingCategory( ).empty( ) )
+			m_GHost->m_ScoreCache->Invalidate( m_Map->GetMapMatchMakingCategory( ), (*i)->GetName( ), (*i)->GetSpoofedRealm( ) );
+	}
+
+	if( m_Stats )
+		m_Stats->Save( GameData );
+
+	m_CallableGameAdd = m_GHost->m_DB->ThreadedGameDataAdd( GameData );
 }
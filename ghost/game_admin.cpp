@@ -77,12 +77,8 @@ CAdminGame :: ~CAdminGame( )
 		m_GHost->m_Callables.push_back( i->second );
 }
 
-bool CAdminGame :: Update( void *fd, void *send_fd )
+void CAdminGame :: UpdateCallables( )
 {
-	//
-	// update callables
-	//
-
 	for( vector<PairedAdminCount> :: iterator i = m_PairedAdminCounts.begin( ); i != m_PairedAdminCounts.end( ); )
 	{
 		if( i->second->GetReady( ) )
@@ -263,6 +259,11 @@ bool CAdminGame :: Update( void *fd, void *send_fd )
                         ++i;
 	}
 
+	CBaseGame :: UpdateCallables( );
+}
+
+bool CAdminGame :: Update( void *fd, void *send_fd )
+{
 	// reset the last reserved seen timer since the admin game should never be considered abandoned
 
 	m_LastReservedSeen = GetTime( );
@@ -805,6 +806,8 @@ bool CAdminGame :: EventPlayerBotCommand( CGamePlayer *player, string command, s
 
 			uint32_t GameNumber = UTIL_ToUInt32( Payload ) - 1;
 
+			m_GHost->LockGames( );
+
 			if( GameNumber < m_GHost->m_Games.size( ) )
 			{
 				SendChat( player, m_GHost->m_Language->EndingGame( m_GHost->m_Games[GameNumber]->GetDescription( ) ) );
@@ -813,6 +816,8 @@ bool CAdminGame :: EventPlayerBotCommand( CGamePlayer *player, string command, s
 			}
 			else
 				SendChat( player, m_GHost->m_Language->GameNumberDoesntExist( Payload ) );
+
+			m_GHost->UnlockGames( );
 		}
 
 		//
@@ -833,8 +838,7 @@ bool CAdminGame :: EventPlayerBotCommand( CGamePlayer *player, string command, s
 				{
 					SendChat( player, m_GHost->m_Language->LoadingReplay( File ) );
 					CReplay *Replay = new CReplay( );
-					Replay->Load( File, false );
-					Replay->ParseReplay( false );
+					Replay->LoadHeader( File );
 					m_GHost->m_EnforcePlayers = Replay->GetPlayers( );
 					delete Replay;
 				}
@@ -871,10 +875,14 @@ bool CAdminGame :: EventPlayerBotCommand( CGamePlayer *player, string command, s
 		{
 			uint32_t GameNumber = UTIL_ToUInt32( Payload ) - 1;
 
+			m_GHost->LockGames( );
+
 			if( GameNumber < m_GHost->m_Games.size( ) )
 				SendChat( player, m_GHost->m_Language->GameNumberIs( Payload, m_GHost->m_Games[GameNumber]->GetDescription( ) ) );
 			else
 				SendChat( player, m_GHost->m_Language->GameNumberDoesntExist( Payload ) );
+
+			m_GHost->UnlockGames( );
 		}
 
 		//
@@ -1194,10 +1202,14 @@ bool CAdminGame :: EventPlayerBotCommand( CGamePlayer *player, string command, s
 					if( Start != string :: npos )
 						Message = Message.substr( Start );
 
+					m_GHost->LockGames( );
+
 					if( GameNumber - 1 < m_GHost->m_Games.size( ) )
 						m_GHost->m_Games[GameNumber - 1]->SendAllChat( "ADMIN: " + Message );
 					else
 						SendChat( player, m_GHost->m_Language->GameNumberDoesntExist( UTIL_ToString( GameNumber ) ) );
+
+					m_GHost->UnlockGames( );
 				}
 			}
 		}
@@ -1211,8 +1223,12 @@ bool CAdminGame :: EventPlayerBotCommand( CGamePlayer *player, string command, s
 			if( m_GHost->m_CurrentGame )
 				m_GHost->m_CurrentGame->SendAllChat( Payload );
 
+			m_GHost->LockGames( );
+
                         for( vector<CBaseGame *> :: iterator i = m_GHost->m_Games.begin( ); i != m_GHost->m_Games.end( ); ++i )
 				(*i)->SendAllChat( "ADMIN: " + Payload );
+
+			m_GHost->UnlockGames( );
 		}
 
 		//
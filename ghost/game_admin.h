@@ -57,6 +57,7 @@ public:
 	CAdminGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16_t nHostPort, unsigned char nGameState, string nGameName, string nPassword );
 	virtual ~CAdminGame( );
 
+	virtual void UpdateCallables( );
 	virtual bool Update( void *fd, void *send_fd );
 	virtual void SendAdminChat( string message );
 	virtual void SendWelcomeMessage( CGamePlayer *player );
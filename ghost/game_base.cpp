@@ -32,19 +32,21 @@
 #include "gameplayer.h"
 #include "gameprotocol.h"
 #include "game_base.h"
+#include "gameworker.h"
+#include "accesscontrol.h"
+#include "teambalancer.h"
 
 #include <cmath>
 #include <string.h>
 #include <time.h>
 
-#include "next_combination.h"
-
 //
 // CBaseGame
 //
 
-CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16_t nHostPort, unsigned char nGameState, string nGameName, string nOwnerName, string nCreatorName, string nCreatorServer ) : m_GHost( nGHost ), m_SaveGame( nSaveGame ), m_Replay( NULL ), m_Exiting( false ), m_Saving( false ), m_HostPort( nHostPort ), m_GameState( nGameState ), m_VirtualHostPID( 255 ), m_FakePlayerPID( 255 ), m_GProxyEmptyActions( 0 ), m_GameName( nGameName ), m_LastGameName( nGameName ), m_VirtualHostName( m_GHost->m_VirtualHostName ), m_OwnerName( nOwnerName ), m_CreatorName( nCreatorName ), m_CreatorServer( nCreatorServer ), m_HCLCommandString( nMap->GetMapDefaultHCL( ) ), m_RandomSeed( GetTicks( ) ), m_HostCounter( m_GHost->m_HostCounter++ ), m_EntryKey( rand( ) ), m_Latency( m_GHost->m_Latency ), m_SyncLimit( m_GHost->m_SyncLimit ), m_SyncCounter( 0 ), m_GameTicks( 0 ), m_CreationTime( GetTime( ) ), m_LastPingTime( GetTime( ) ), m_LastRefreshTime( GetTime( ) ), m_LastDownloadTicks( GetTime( ) ), m_DownloadCounter( 0 ), m_LastDownloadCounterResetTicks( GetTime( ) ), m_LastAnnounceTime( 0 ), m_AnnounceInterval( 0 ), m_LastAutoStartTime( GetTime( ) ), m_AutoStartPlayers( 0 ), m_LastCountDownTicks( 0 ), m_CountDownCounter( 0 ), m_StartedLoadingTicks( 0 ), m_StartPlayers( 0 ), m_LastLagScreenResetTime( 0 ), m_LastActionSentTicks( 0 ), m_LastActionLateBy( 0 ), m_StartedLaggingTime( 0 ), m_LastLagScreenTime( 0 ), m_LastReservedSeen( GetTime( ) ), m_StartedKickVoteTime( 0 ), m_GameOverTime( 0 ), m_LastPlayerLeaveTicks( 0 ), m_MinimumScore( 0. ), m_MaximumScore( 0. ), m_SlotInfoChanged( false ), m_Locked( false ), m_RefreshMessages( m_GHost->m_RefreshMessages ), m_RefreshError( false ), m_RefreshRehosted( false ), m_MuteAll( false ), m_MuteLobby( false ), m_CountDownStarted( false ), m_GameLoading( false ), m_GameLoaded( false ), m_LoadInGame( nMap->GetMapLoadInGame( ) ), m_Lagging( false ), m_AutoSave( m_GHost->m_AutoSave ), m_MatchMaking( false ), m_LocalAdminMessages( m_GHost->m_LocalAdminMessages )
+CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16_t nHostPort, unsigned char nGameState, string nGameName, string nOwnerName, string nCreatorName, string nCreatorServer ) : m_GHost( nGHost ), m_Worker( NULL ), m_Reactor( gSocketReactor ), m_TimerWheel( nGHost->m_TimerWheel ), m_SaveGame( nSaveGame ), m_Replay( NULL ), m_Exiting( false ), m_Saving( false ), m_HostPort( nHostPort ), m_GameState( nGameState ), m_VirtualHostPID( 255 ), m_FakePlayerPID( 255 ), m_GProxyEmptyActions( 0 ), m_GameName( nGameName ), m_LastGameName( nGameName ), m_VirtualHostName( m_GHost->m_VirtualHostName ), m_OwnerName( nOwnerName ), m_CreatorName( nCreatorName ), m_CreatorServer( nCreatorServer ), m_HCLCommandString( nMap->GetMapDefaultHCL( ) ), m_RandomSeed( GetTicks( ) ), m_HostCounter( m_GHost->m_HostCounter++ ), m_EntryKey( rand( ) ), m_Latency( m_GHost->m_Latency ), m_SyncLimit( m_GHost->m_SyncLimit ), m_SyncCounter( 0 ), m_GameTicks( 0 ), m_CreationTime( GetTime( ) ), m_DownloadCounter( 0 ), m_AnnounceInterval( 0 ), m_AutoStartPlayers( 0 ), m_CountDownCounter( 0 ), m_StartedLoadingTicks( 0 ), m_StartPlayers( 0 ), m_LastActionSentTicks( 0 ), m_LastActionLateBy( 0 ), m_StartedLaggingTime( 0 ), m_LastLagScreenTime( 0 ), m_LastReservedSeen( GetTime( ) ), m_GameOverTime( 0 ), m_LastPlayerLeaveTicks( 0 ), m_MinimumScore( 0. ), m_MaximumScore( 0. ), m_SlotInfoChanged( false ), m_Locked( false ), m_RefreshMessages( m_GHost->m_RefreshMessages ), m_RefreshError( false ), m_RefreshRehosted( false ), m_MuteAll( false ), m_MuteLobby( false ), m_CountDownStarted( false ), m_GameLoading( false ), m_GameLoaded( false ), m_LoadInGame( nMap->GetMapLoadInGame( ) ), m_Lagging( false ), m_AutoSave( m_GHost->m_AutoSave ), m_MatchMaking( false ), m_LocalAdminMessages( m_GHost->m_LocalAdminMessages )
 {
+	m_Mailbox = CCallableMailboxPtr( new CCallableMailbox( m_GHost->m_Wakeup ) );
 	m_Socket = new CTCPServer( );
 	m_Protocol = new CGameProtocol( m_GHost );
 	m_Map = new CMap( *nMap );
@@ -52,6 +54,26 @@ CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16
 	if( m_GHost->m_SaveReplays && !m_SaveGame )
 		m_Replay = new CReplay( );	
 
+	// start the lobby timers
+
+	m_Timers.push_back( &m_PingTimer );
+	m_Timers.push_back( &m_RefreshTimer );
+	m_Timers.push_back( &m_DownloadCounterTimer );
+	m_Timers.push_back( &m_DownloadTimer );
+	m_Timers.push_back( &m_AnnounceTimer );
+	m_Timers.push_back( &m_AutoStartTimer );
+	m_Timers.push_back( &m_CountDownTimer );
+	m_Timers.push_back( &m_LobbyTimer );
+	m_Timers.push_back( &m_LagScreenResetTimer );
+	m_Timers.push_back( &m_ActionTimer );
+	m_Timers.push_back( &m_KickVoteTimer );
+	m_Timers.push_back( &m_GameOverTimer );
+	SetTimer( &m_PingTimer, 5000 );
+	SetTimer( &m_RefreshTimer, 3000 );
+	SetTimer( &m_DownloadCounterTimer, 1000 );
+	SetTimer( &m_AutoStartTimer, 10000 );
+	SetTimer( &m_LobbyTimer, 1000 );
+
 	// wait time of 1 minute  = 0 empty actions required
 	// wait time of 2 minutes = 1 empty action required
 	// etc...
@@ -88,46 +110,9 @@ CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16
 	else
 		m_Slots = m_Map->GetSlots( );
 
-	if( !m_GHost->m_IPBlackListFile.empty( ) )
-	{
-		ifstream in;
-		in.open( m_GHost->m_IPBlackListFile.c_str( ) );
-
-		if( in.fail( ) )
-			CONSOLE_Print( "[GAME: " + m_GameName + "] error loading IP blacklist file [" + m_GHost->m_IPBlackListFile + "]" );
-		else
-		{
-			CONSOLE_Print( "[GAME: " + m_GameName + "] loading IP blacklist file [" + m_GHost->m_IPBlackListFile + "]" );
-			string Line;
-
-			while( !in.eof( ) )
-			{
-				getline( in, Line );
-
-				// ignore blank lines and comments
-
-				if( Line.empty( ) || Line[0] == '#' )
-					continue;
-
-				// remove newlines and partial newlines to help fix issues with Windows formatted files on Linux systems
-
-				Line.erase( remove( Line.begin( ), Line.end( ), ' ' ), Line.end( ) );
-				Line.erase( remove( Line.begin( ), Line.end( ), '\r' ), Line.end( ) );
-				Line.erase( remove( Line.begin( ), Line.end( ), '\n' ), Line.end( ) );
-
-				// ignore lines that don't look like IP addresses
+	// the IP blacklist is shared by every game and is only read again if the file has been modified since it was last loaded
 
-				if( Line.find_first_not_of( "1234567890." ) != string :: npos )
-					continue;
-
-				m_IPBlackList.insert( Line );
-			}
-
-			in.close( );
-
-			CONSOLE_Print( "[GAME: " + m_GameName + "] loaded " + UTIL_ToString( m_IPBlackList.size( ) ) + " lines from IP blacklist file" );
-		}
-	}
+	m_GHost->m_IPBlackList->Load( m_GHost->m_IPBlackListFile );
 
 	// start listening for connections
 
@@ -147,8 +132,12 @@ CBaseGame :: CBaseGame( CGHost *nGHost, CMap *nMap, CSaveGame *nSaveGame, uint16
 
 CBaseGame :: ~CBaseGame( )
 {
+	// our callables are orphaned by the derived classes and might outlive the wakeup of the thread which updated us
+
+	m_Mailbox->SetWakeup( NULL );
+
 	// save replay
-	// todotodo: put this in a thread
+	// once the game has loaded the replay is streamed to a temporary file so we only have to write the last block and the header here
 
 	if( m_Replay && ( m_GameLoading || m_GameLoaded ) )
 	{
@@ -165,8 +154,16 @@ CBaseGame :: ~CBaseGame( )
 		if( SecString.size( ) == 1 )
 			SecString.insert( 0, "0" );
 
-		m_Replay->BuildReplay( m_GameName, m_StatString, m_GHost->m_ReplayWar3Version, m_GHost->m_ReplayBuildNumber );
-		m_Replay->Save( m_GHost->m_TFT, m_GHost->m_ReplayPath + UTIL_FileSafeName( "GHost++ " + string( Time ) + " " + m_GameName + " (" + MinString + "m" + SecString + "s).w3g" ) );
+		string FileName = m_GHost->m_ReplayPath + UTIL_FileSafeName( "GHost++ " + string( Time ) + " " + m_GameName + " (" + MinString + "m" + SecString + "s).w3g" );
+
+		if( m_Replay->GetStreaming( ) )
+			m_Replay->FinishStreaming( m_GameName, m_StatString, m_GHost->m_TFT, m_GHost->m_ReplayWar3Version, m_GHost->m_ReplayBuildNumber, FileName );
+		else
+		{
+			m_Replay->BuildReplay( m_GameName, m_StatString, m_GHost->m_ReplayWar3Version, m_GHost->m_ReplayBuildNumber );
+			m_Replay->SetCompressionLevel( m_GHost->m_ReplayCompressionLevel );
+			m_Replay->Save( m_GHost->m_TFT, FileName );
+		}
 	}
 
 	delete m_Socket;
@@ -190,24 +187,6 @@ CBaseGame :: ~CBaseGame( )
 	}
 }
 
-uint32_t CBaseGame :: GetNextTimedActionTicks( )
-{
-	// return the number of ticks (ms) until the next "timed action", which for our purposes is the next game update
-	// the main GHost++ loop will make sure the next loop update happens at or before this value
-	// note: there's no reason this function couldn't take into account the game's other timers too but they're far less critical
-	// warning: this function must take into account when actions are not being sent (e.g. during loading or lagging)
-
-	if( !m_GameLoaded || m_Lagging )
-		return 50;
-
-	uint32_t TicksSinceLastUpdate = GetTicks( ) - m_LastActionSentTicks;
-
-	if( TicksSinceLastUpdate > m_Latency - m_LastActionLateBy )
-		return 0;
-	else
-		return m_Latency - m_LastActionLateBy - TicksSinceLastUpdate;
-}
-
 uint32_t CBaseGame :: GetSlotsOccupied( )
 {
 	uint32_t NumSlotsOccupied = 0;
@@ -273,7 +252,7 @@ void CBaseGame :: SetAnnounce( uint32_t interval, string message )
 {
 	m_AnnounceInterval = interval;
 	m_AnnounceMessage = message;
-	m_LastAnnounceTime = GetTime( );
+	SetTimer( &m_AnnounceTimer, m_AnnounceInterval * 1000 );
 }
 
 unsigned int CBaseGame :: SetFD( void *fd, void *send_fd, int *nfds )
@@ -307,20 +286,76 @@ unsigned int CBaseGame :: SetFD( void *fd, void *send_fd, int *nfds )
 	return NumFDs;
 }
 
-bool CBaseGame :: Update( void *fd, void *send_fd )
+void CBaseGame :: SetReactor( CSocketReactor *nReactor )
 {
-	// update callables
+	// move all our sockets to another reactor
+	// this is used when handing the game over to or from a worker thread
+
+	m_Reactor = nReactor;
+
+	if( m_Socket )
+		m_Socket->SetReactor( m_Reactor );
+
+	for( vector<CPotentialPlayer *> :: iterator i = m_Potentials.begin( ); i != m_Potentials.end( ); ++i )
+	{
+		if( (*i)->GetSocket( ) )
+			(*i)->GetSocket( )->SetReactor( m_Reactor );
+	}
+
+	for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
+	{
+		if( (*i)->GetSocket( ) )
+			(*i)->GetSocket( )->SetReactor( m_Reactor );
+	}
+}
+
+void CBaseGame :: SetTimerWheel( CTimerWheel *nTimerWheel )
+{
+	// move all our timers to another timer wheel
+	// this is used when handing the game over to or from a worker thread, the timers keep their original expiry times
+
+	for( vector<CTimer *> :: iterator i = m_Timers.begin( ); i != m_Timers.end( ); ++i )
+	{
+		if( m_TimerWheel )
+			m_TimerWheel->Remove( *i );
 
+		if( nTimerWheel )
+			nTimerWheel->Add( *i );
+	}
+
+	m_TimerWheel = nTimerWheel;
+}
+
+void CBaseGame :: SetTimer( CTimer *timer, uint32_t ticks )
+{
+	if( m_TimerWheel )
+		m_TimerWheel->Schedule( timer, ticks );
+	else
+		timer->Schedule( ticks );
+}
+
+void CBaseGame :: UpdateCallables( )
+{
 	for( vector<CCallableScoreCheck *> :: iterator i = m_ScoreChecks.begin( ); i != m_ScoreChecks.end( ); )
 	{
 		if( (*i)->GetReady( ) )
 		{
-			double Score = (*i)->GetResult( );
+			vector<string> Names = (*i)->GetNames( );
+			vector<string> Servers = (*i)->GetServers( );
+			vector<double> Scores = (*i)->GetResult( );
 
-                        for( vector<CPotentialPlayer *> :: iterator j = m_Potentials.begin( ); j != m_Potentials.end( ); ++j )
+			for( unsigned int k = 0; k < Names.size( ); ++k )
 			{
-				if( (*j)->GetJoinPlayer( ) && (*j)->GetJoinPlayer( )->GetName( ) == (*i)->GetName( ) )
-					EventPlayerJoinedWithScore( *j, (*j)->GetJoinPlayer( ), Score );
+				// don't cache the default score if the query failed or the player would be treated as unrated until the score expires
+
+				if( (*i)->GetError( ).empty( ) )
+					m_GHost->m_ScoreCache->Put( (*i)->GetCategory( ), Names[k], Servers[k], Scores[k] );
+
+                                for( vector<CPotentialPlayer *> :: iterator j = m_Potentials.begin( ); j != m_Potentials.end( ); ++j )
+				{
+					if( (*j)->GetJoinPlayer( ) && (*j)->GetJoinPlayer( )->GetName( ) == Names[k] )
+						EventPlayerJoinedWithScore( *j, (*j)->GetJoinPlayer( ), Scores[k] );
+				}
 			}
 
 			m_GHost->m_DB->RecoverCallable( *i );
@@ -330,6 +365,19 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		else
                         ++i;
 	}
+}
+
+bool CBaseGame :: Update( void *fd, void *send_fd )
+{
+	// any callables created while updating are ours (this also covers games updated by a worker thread)
+
+	CCallableMailboxScope MailboxScope( m_Mailbox.get( ) );
+
+	// update callables
+	// we only walk our pending callables when one of them has completed (see CCallableMailbox)
+
+	if( m_Mailbox->CheckCallables( ) )
+		UpdateCallables( );
 
 	// update players
 
@@ -361,6 +409,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
                         ++i;
 	}
 
+	// check the scores of the players who joined while updating the potential players
+
+	StartScoreChecks( );
+
 	// create the virtual host player
 
 	if( !m_GameLoading && !m_GameLoaded && GetNumPlayers( ) < 12 )
@@ -378,7 +430,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 	// changed this to ping during game loading as well to hopefully fix some problems with people disconnecting during loading
 	// changed this to ping during the game as well
 
-	if( GetTime( ) - m_LastPingTime >= 5 )
+	if( m_PingTimer.GetExpired( ) )
 	{
 		// note: we must send pings to players who are downloading the map because Warcraft III disconnects from the lobby if it doesn't receive a ping every ~90 seconds
 		// so if the player takes longer than 90 seconds to download the map they would be disconnected unless we keep sending pings
@@ -434,7 +486,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 			}
 		}
 
-		m_LastPingTime = GetTime( );
+		SetTimer( &m_PingTimer, 5000 );
 	}
 
 	// auto rehost if there was a refresh error in autohosted games
@@ -461,12 +513,12 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		}
 
 		m_CreationTime = GetTime( );
-		m_LastRefreshTime = GetTime( );
+		SetTimer( &m_RefreshTimer, 3000 );
 	}
 
 	// refresh every 3 seconds
 
-	if( !m_RefreshError && !m_CountDownStarted && m_GameState == GAME_PUBLIC && GetSlotsOpen( ) > 0 && GetTime( ) - m_LastRefreshTime >= 3 )
+	if( !m_RefreshError && !m_CountDownStarted && m_GameState == GAME_PUBLIC && GetSlotsOpen( ) > 0 && m_RefreshTimer.GetExpired( ) )
 	{
 		// send a game refresh packet to each battle.net connection
 
@@ -488,12 +540,12 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		if( m_RefreshMessages && Refreshed )
 			SendAllChat( m_GHost->m_Language->GameRefreshed( ) );
 
-		m_LastRefreshTime = GetTime( );
+		SetTimer( &m_RefreshTimer, 3000 );
 	}
 
 	// send more map data
 
-	if( !m_GameLoading && !m_GameLoaded && GetTicks( ) - m_LastDownloadCounterResetTicks >= 1000 )
+	if( !m_GameLoading && !m_GameLoaded && m_DownloadCounterTimer.GetExpired( ) )
 	{
 		// hackhack: another timer hijack is in progress here
 		// since the download counter is reset once per second it's a great place to update the slot info if necessary
@@ -502,10 +554,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 			SendAllSlotInfo( );
 
 		m_DownloadCounter = 0;
-		m_LastDownloadCounterResetTicks = GetTicks( );
+		SetTimer( &m_DownloadCounterTimer, 1000 );
 	}
 
-	if( !m_GameLoading && !m_GameLoaded && GetTicks( ) - m_LastDownloadTicks >= 100 )
+	if( !m_GameLoading && !m_GameLoaded && m_DownloadTimer.GetExpired( ) )
 	{
 		uint32_t Downloaders = 0;
 
@@ -534,7 +586,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 
 				uint32_t MapSize = UTIL_ByteArrayToUInt32( m_Map->GetMapSize( ), false );
 
-				while( (*i)->GetLastMapPartSent( ) < (*i)->GetLastMapPartAcked( ) + 1442 * 100 && (*i)->GetLastMapPartSent( ) < MapSize )
+				while( (*i)->GetLastMapPartSent( ) < (*i)->GetLastMapPartAcked( ) + MAPPART_SIZE * 100 && (*i)->GetLastMapPartSent( ) < MapSize )
 				{
 					if( (*i)->GetLastMapPartSent( ) == 0 )
 					{
@@ -551,21 +603,27 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 						break;
 
 					Send( *i, m_Protocol->SEND_W3GS_MAPPART( GetHostPID( ), (*i)->GetPID( ), (*i)->GetLastMapPartSent( ), m_Map->GetMapData( ) ) );
-					(*i)->SetLastMapPartSent( (*i)->GetLastMapPartSent( ) + 1442 );
-					m_DownloadCounter += 1442;
+					(*i)->SetLastMapPartSent( (*i)->GetLastMapPartSent( ) + MAPPART_SIZE );
+					m_DownloadCounter += MAPPART_SIZE;
 				}
 			}
 		}
 
-		m_LastDownloadTicks = GetTicks( );
+		// keep sending map data every 100ms until nobody is downloading the map anymore
+		// the timer is started again when the next player starts downloading the map (see EventPlayerMapSize)
+
+		if( Downloaders > 0 )
+			SetTimer( &m_DownloadTimer, 100 );
+		else
+			m_DownloadTimer.Cancel( );
 	}
 
 	// announce every m_AnnounceInterval seconds
 
-	if( !m_AnnounceMessage.empty( ) && !m_CountDownStarted && GetTime( ) - m_LastAnnounceTime >= m_AnnounceInterval )
+	if( !m_AnnounceMessage.empty( ) && !m_CountDownStarted && m_AnnounceTimer.GetExpired( ) )
 	{
 		SendAllChat( m_AnnounceMessage );
-		m_LastAnnounceTime = GetTime( );
+		SetTimer( &m_AnnounceTimer, m_AnnounceInterval * 1000 );
 	}
 
 	// kick players who don't spoof check within 20 seconds when spoof checks are required and the game is autohosted
@@ -586,15 +644,15 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 
 	// try to auto start every 10 seconds
 
-	if( !m_CountDownStarted && m_AutoStartPlayers != 0 && GetTime( ) - m_LastAutoStartTime >= 10 )
+	if( !m_CountDownStarted && m_AutoStartPlayers != 0 && m_AutoStartTimer.GetExpired( ) )
 	{
 		StartCountDownAuto( m_GHost->m_RequireSpoofChecks );
-		m_LastAutoStartTime = GetTime( );
+		SetTimer( &m_AutoStartTimer, 10000 );
 	}
 
 	// countdown every 500 ms
 
-	if( m_CountDownStarted && GetTicks( ) - m_LastCountDownTicks >= 500 )
+	if( m_CountDownStarted && m_CountDownTimer.GetExpired( ) )
 	{
 		if( m_CountDownCounter > 0 )
 		{
@@ -604,17 +662,25 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 
 			SendAllChat( UTIL_ToString( m_CountDownCounter ) + ". . ." );
 			--m_CountDownCounter;
+			SetTimer( &m_CountDownTimer, 500 );
 		}
-		else if( !m_GameLoading && !m_GameLoaded )
-			EventGameStarted( );
+		else
+		{
+			// the countdown is over so there's no need to keep the timer running
+
+			if( !m_GameLoading && !m_GameLoaded )
+				EventGameStarted( );
 
-		m_LastCountDownTicks = GetTicks( );
+			m_CountDownTimer.Cancel( );
+		}
 	}
 
 	// check if the lobby is "abandoned" and needs to be closed since it will never start
 
-	if( !m_GameLoading && !m_GameLoaded && m_AutoStartPlayers == 0 && m_GHost->m_LobbyTimeLimit > 0 )
+	if( !m_GameLoading && !m_GameLoaded && m_AutoStartPlayers == 0 && m_GHost->m_LobbyTimeLimit > 0 && m_LobbyTimer.GetExpired( ) )
 	{
+		SetTimer( &m_LobbyTimer, 1000 );
+
 		// check if there's a player with reserved status in the game
 
                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
@@ -649,6 +715,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		if( FinishedLoading )
 		{
 			m_LastActionSentTicks = GetTicks( );
+			SetTimer( &m_ActionTimer, m_Latency );
 			m_GameLoading = false;
 			m_GameLoaded = true;
 			EventGameLoaded( );
@@ -657,7 +724,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		{
 			// reset the "lag" screen (the load-in-game screen) every 30 seconds
 
-			if( m_LoadInGame && GetTime( ) - m_LastLagScreenResetTime >= 30 )
+			if( m_LoadInGame && m_LagScreenResetTimer.GetExpired( ) )
 			{
 				bool UsingGProxy = false;
 
@@ -667,6 +734,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 						UsingGProxy = true;
 				}
 
+				// the empty update is the same for every player so we only build it once
+
+				PACKETBUFFER EmptyAction = m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 );
+
                                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 				{
 					if( (*i)->GetFinishedLoading( ) )
@@ -692,10 +763,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 							// empty actions are used to extend the time a player can use when reconnecting
 
                                                         for( unsigned char j = 0; j < m_GProxyEmptyActions; ++j )
-								Send( *i, m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+								Send( *i, EmptyAction );
 						}
 
-						Send( *i, m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+						Send( *i, EmptyAction );
 
 						// start the lag screen
 
@@ -712,10 +783,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 							// empty actions are used to extend the time a player can use when reconnecting
 
                                                         for( unsigned char j = 0; j < m_GProxyEmptyActions; ++j )
-								(*i)->AddLoadInGameData( m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+								(*i)->AddLoadInGameData( EmptyAction );
 						}
 
-						(*i)->AddLoadInGameData( m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+						(*i)->AddLoadInGameData( EmptyAction );
 					}
 				}
 
@@ -738,7 +809,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 					m_SyncCounter += m_GProxyEmptyActions;
 
 				m_SyncCounter++; */
-				m_LastLagScreenResetTime = GetTime( );
+				SetTimer( &m_LagScreenResetTimer, 30000 );
 			}
 		}
 	}
@@ -783,7 +854,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
                                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 					(*i)->SetDropVote( false );
 
-				m_LastLagScreenResetTime = GetTime( );
+				SetTimer( &m_LagScreenResetTimer, 60000 );
 			}
 		}
 
@@ -810,8 +881,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 			// another solution is to reset the lag screen the same way we reset it when using load-in-game
 			// this is required in order to give GProxy++ clients more time to reconnect
 
-			if( GetTime( ) - m_LastLagScreenResetTime >= 60 )
+			if( m_LagScreenResetTimer.GetExpired( ) )
 			{
+				PACKETBUFFER EmptyAction = m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 );
+
                                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 				{
 					// stop the lag screen
@@ -832,10 +905,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 						// empty actions are used to extend the time a player can use when reconnecting
 
                                                 for( unsigned char j = 0; j < m_GProxyEmptyActions; ++j )
-							Send( *i, m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+							Send( *i, EmptyAction );
 					}
 
-					Send( *i, m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+					Send( *i, EmptyAction );
 
 					// start the lag screen
 
@@ -861,7 +934,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 					m_SyncCounter += m_GProxyEmptyActions;
 
 				m_SyncCounter++; */
-				m_LastLagScreenResetTime = GetTime( );
+				SetTimer( &m_LagScreenResetTimer, 60000 );
 			}
 
 			// check if anyone has stopped lagging normally
@@ -893,8 +966,10 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 			m_Lagging = Lagging;
 
 			// reset m_LastActionSentTicks because we want the game to stop running while the lag screen is up
+			// we also restart the action timer so the main loop keeps waking up to check the laggers while the lag screen is up
 
 			m_LastActionSentTicks = GetTicks( );
+			SetTimer( &m_ActionTimer, m_Latency );
 
 			// keep track of the last lag screen time so we can avoid timing out players
 
@@ -906,17 +981,17 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 	// actions are at the heart of every Warcraft 3 game but luckily we don't need to know their contents to relay them
 	// we queue player actions in EventPlayerAction then just resend them in batches to all players here
 
-	if( m_GameLoaded && !m_Lagging && GetTicks( ) - m_LastActionSentTicks >= m_Latency - m_LastActionLateBy )
+	if( m_GameLoaded && !m_Lagging && m_ActionTimer.GetExpired( ) )
 		SendAllActions( );
 
 	// expire the votekick
 
-	if( !m_KickVotePlayer.empty( ) && GetTime( ) - m_StartedKickVoteTime >= 60 )
+	if( !m_KickVotePlayer.empty( ) && m_KickVoteTimer.GetExpired( ) )
 	{
 		CONSOLE_Print( "[GAME: " + m_GameName + "] votekick against player [" + m_KickVotePlayer + "] expired" );
 		SendAllChat( m_GHost->m_Language->VoteKickExpired( m_KickVotePlayer ) );
 		m_KickVotePlayer.clear( );
-		m_StartedKickVoteTime = 0;
+		m_KickVoteTimer.Cancel( );
 	}
 
 	// start the gameover timer if there's only one player left
@@ -925,11 +1000,12 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 	{
 		CONSOLE_Print( "[GAME: " + m_GameName + "] gameover timer started (one player left)" );
 		m_GameOverTime = GetTime( );
+		SetTimer( &m_GameOverTimer, 60000 );
 	}
 
 	// finish the gameover timer
 
-	if( m_GameOverTime != 0 && GetTime( ) - m_GameOverTime >= 60 )
+	if( m_GameOverTime != 0 && m_GameOverTimer.GetExpired( ) )
 	{
 		bool AlreadyStopped = true;
 
@@ -973,7 +1049,7 @@ bool CBaseGame :: Update( void *fd, void *send_fd )
 		{
 			// check the IP blacklist
 
-			if( m_IPBlackList.find( NewSocket->GetIPString( ) ) == m_IPBlackList.end( ) )
+			if( !m_GHost->m_IPBlackList->IsBlackListed( NewSocket->GetIPString( ) ) )
 			{
 				if( m_GHost->m_TCPNoDelay )
 					NewSocket->SetNoDelay( true );
@@ -1019,6 +1095,12 @@ void CBaseGame :: Send( CGamePlayer *player, BYTEARRAY data )
 		player->Send( data );
 }
 
+void CBaseGame :: Send( CGamePlayer *player, PACKETBUFFER packet )
+{
+	if( player )
+		player->Send( packet );
+}
+
 void CBaseGame :: Send( unsigned char PID, BYTEARRAY data )
 {
 	Send( GetPlayerFromPID( PID ), data );
@@ -1026,14 +1108,29 @@ void CBaseGame :: Send( unsigned char PID, BYTEARRAY data )
 
 void CBaseGame :: Send( BYTEARRAY PIDs, BYTEARRAY data )
 {
+	// build the packet buffer once and share it between the players
+
+	PACKETBUFFER Packet = CPacketBuffer :: Swap( data );
+
         for( unsigned int i = 0; i < PIDs.size( ); ++i )
-		Send( PIDs[i], data );
+		Send( GetPlayerFromPID( PIDs[i] ), Packet );
+
+	CPacketBuffer :: AddReferences( PIDs.size( ), Packet->GetSize( ) );
 }
 
 void CBaseGame :: SendAll( BYTEARRAY data )
 {
+	SendAll( CPacketBuffer :: Swap( data ) );
+}
+
+void CBaseGame :: SendAll( PACKETBUFFER packet )
+{
+	// every player's socket (and GProxy++ buffer) references the same packet buffer so this doesn't copy the packet at all
+
         for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
-		(*i)->Send( data );
+		(*i)->Send( packet );
+
+	CPacketBuffer :: AddReferences( m_Players.size( ), packet->GetSize( ) );
 }
 
 void CBaseGame :: SendChat( unsigned char fromPID, CGamePlayer *player, string message )
@@ -1194,12 +1291,14 @@ void CBaseGame :: SendAllActions( )
 		// GProxy++ will insert these itself so we don't need to send them to GProxy++ players
 		// empty actions are used to extend the time a player can use when reconnecting
 
+		PACKETBUFFER EmptyAction = m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 );
+
                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		{
 			if( !(*i)->GetGProxy( ) )
 			{
                                 for( unsigned char j = 0; j < m_GProxyEmptyActions; ++j )
-					Send( *i, m_Protocol->SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *>( ), 0 ) );
+					Send( *i, EmptyAction );
 			}
 		}
 
@@ -1295,6 +1394,7 @@ void CBaseGame :: SendAllActions( )
 	}
 
 	m_LastActionSentTicks = GetTicks( );
+	SetTimer( &m_ActionTimer, m_Latency - m_LastActionLateBy );
 }
 
 void CBaseGame :: SendWelcomeMessage( CGamePlayer *player )
@@ -1381,6 +1481,63 @@ void CBaseGame :: SendEndMessage( )
 	}
 }
 
+void CBaseGame :: QueueBNETChatCommand( CBNET *bnet, string chatCommand )
+{
+	if( m_Worker )
+	{
+		CWorkerMessage Message( CWorkerMessage :: BNET_CHATCOMMAND );
+		Message.m_BNET = bnet;
+		Message.m_Message = chatCommand;
+		m_Worker->QueueMessage( Message );
+	}
+	else
+		bnet->QueueChatCommand( chatCommand );
+}
+
+void CBaseGame :: QueueBNETChatCommand( CBNET *bnet, string chatCommand, string user, bool whisper )
+{
+	if( m_Worker )
+	{
+		CWorkerMessage Message( whisper ? CWorkerMessage :: BNET_WHISPER : CWorkerMessage :: BNET_CHATCOMMAND );
+		Message.m_BNET = bnet;
+		Message.m_Message = chatCommand;
+		Message.m_User = user;
+		m_Worker->QueueMessage( Message );
+	}
+	else
+		bnet->QueueChatCommand( chatCommand, user, whisper );
+}
+
+void CBaseGame :: AddBNETBan( CBNET *bnet, string name, string ip, string gamename, string admin, string reason )
+{
+	if( m_Worker )
+	{
+		CWorkerMessage Message( CWorkerMessage :: BNET_ADDBAN );
+		Message.m_BNET = bnet;
+		Message.m_User = name;
+		Message.m_IP = ip;
+		Message.m_GameName = gamename;
+		Message.m_Admin = admin;
+		Message.m_Reason = reason;
+		m_Worker->QueueMessage( Message );
+	}
+	else
+		bnet->AddBan( name, ip, gamename, admin, reason );
+}
+
+void CBaseGame :: UnqueueBNETChatCommand( CBNET *bnet, string chatCommand )
+{
+	if( m_Worker )
+	{
+		CWorkerMessage Message( CWorkerMessage :: BNET_UNQUEUECHATCOMMAND );
+		Message.m_BNET = bnet;
+		Message.m_Message = chatCommand;
+		m_Worker->QueueMessage( Message );
+	}
+	else
+		bnet->UnqueueChatCommand( chatCommand );
+}
+
 void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 {
 	CONSOLE_Print( "[GAME: " + m_GameName + "] deleting player [" + player->GetName( ) + "]: " + player->GetLeftReason( ) );
@@ -1396,11 +1553,11 @@ void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 				// hackhack: there must be a better way to do this
 
 				if( (*i)->GetPasswordHashType( ) == "pvpgn" )
-					(*i)->UnqueueChatCommand( "/whereis " + player->GetName( ) );
+					UnqueueBNETChatCommand( *i, "/whereis " + player->GetName( ) );
 				else
-					(*i)->UnqueueChatCommand( "/whois " + player->GetName( ) );
+					UnqueueBNETChatCommand( *i, "/whois " + player->GetName( ) );
 
-				(*i)->UnqueueChatCommand( "/w " + player->GetName( ) + " " + m_GHost->m_Language->SpoofCheckByReplying( ) );
+				UnqueueBNETChatCommand( *i, "/w " + player->GetName( ) + " " + m_GHost->m_Language->SpoofCheckByReplying( ) );
 			}
 		}
 	}
@@ -1440,6 +1597,8 @@ void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 		// we must buffer player leave messages when using "load in game" to prevent desyncs
 		// this ensures the player leave messages are correctly interleaved with the empty updates sent to each player
 
+		PACKETBUFFER PlayerLeave = CPacketBuffer :: Create( m_Protocol->SEND_W3GS_PLAYERLEAVE_OTHERS( player->GetPID( ), player->GetLeftCode( ) ) );
+
                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		{
 			if( (*i)->GetFinishedLoading( ) )
@@ -1447,10 +1606,10 @@ void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 				if( !player->GetFinishedLoading( ) )
 					Send( *i, m_Protocol->SEND_W3GS_STOP_LAG( player ) );
 
-				Send( *i, m_Protocol->SEND_W3GS_PLAYERLEAVE_OTHERS( player->GetPID( ), player->GetLeftCode( ) ) );
+				Send( *i, PlayerLeave );
 			}
 			else
-				(*i)->AddLoadInGameData( m_Protocol->SEND_W3GS_PLAYERLEAVE_OTHERS( player->GetPID( ), player->GetLeftCode( ) ) );
+				(*i)->AddLoadInGameData( PlayerLeave );
 		}
 	}
 	else
@@ -1490,7 +1649,7 @@ void CBaseGame :: EventPlayerDeleted( CGamePlayer *player )
 		SendAllChat( m_GHost->m_Language->VoteKickCancelled( m_KickVotePlayer ) );
 
 	m_KickVotePlayer.clear( );
-	m_StartedKickVoteTime = 0;
+	m_KickVoteTimer.Cancel( );
 }
 
 void CBaseGame :: EventPlayerDisconnectTimedOut( CGamePlayer *player )
@@ -1744,10 +1903,20 @@ void CBaseGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncomingJoinP
 	if( m_MatchMaking && m_AutoStartPlayers != 0 && !m_Map->GetMapMatchMakingCategory( ).empty( ) && m_Map->GetMapOptions( ) & MAPOPT_FIXEDPLAYERSETTINGS )
 	{
 		// matchmaking is enabled
-		// start a database query to determine the player's score
+		// if we've seen the player recently their score is already cached and they can join right away
+		// otherwise queue a database query to determine the player's score, the queued players are checked together in StartScoreChecks
 		// when the query is complete we will call EventPlayerJoinedWithScore
 
-		m_ScoreChecks.push_back( m_GHost->m_DB->ThreadedScoreCheck( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm ) );
+		double Score;
+
+		if( m_GHost->m_ScoreCache->Get( m_Map->GetMapMatchMakingCategory( ), joinPlayer->GetName( ), JoinedRealm, &Score ) )
+			EventPlayerJoinedWithScore( potential, joinPlayer, Score );
+		else
+		{
+			m_ScoreCheckNames.push_back( joinPlayer->GetName( ) );
+			m_ScoreCheckServers.push_back( JoinedRealm );
+		}
+
 		return;
 	}
 
@@ -2081,6 +2250,20 @@ void CBaseGame :: EventPlayerJoined( CPotentialPlayer *potential, CIncomingJoinP
 	Player->SetSpoofedRealm( JoinedRealm );
 }
 
+void CBaseGame :: StartScoreChecks( )
+{
+	if( m_ScoreCheckNames.empty( ) )
+		return;
+
+	CCallableScoreCheck *ScoreCheck = m_GHost->m_DB->ThreadedScoreCheck( m_Map->GetMapMatchMakingCategory( ), m_ScoreCheckNames, m_ScoreCheckServers );
+
+	if( ScoreCheck )
+		m_ScoreChecks.push_back( ScoreCheck );
+
+	m_ScoreCheckNames.clear( );
+	m_ScoreCheckServers.clear( );
+}
+
 void CBaseGame :: EventPlayerJoinedWithScore( CPotentialPlayer *potential, CIncomingJoinPlayer *joinPlayer, double score )
 {
 	// this function is only called when matchmaking is enabled
@@ -2540,13 +2723,14 @@ void CBaseGame :: EventPlayerLoaded( CGamePlayer *player )
 		// see the Update function for more information about why we do this
 		// this includes player loaded messages, game updates, and player leave messages
 
-		queue<BYTEARRAY> *LoadInGameData = player->GetLoadInGameData( );
+		CPacketLog *LoadInGameLog = GetLoadInGameLog( );
+		uint32_t Position = LoadInGameLog->GetCursor( player->GetPID( ) );
+		PACKETBUFFER Packet;
 
-		while( !LoadInGameData->empty( ) )
-		{
-			Send( player, LoadInGameData->front( ) );
-			LoadInGameData->pop( );
-		}
+		while( LoadInGameLog->GetNext( player->GetPID( ), Position, Packet ) )
+			Send( player, Packet );
+
+		LoadInGameLog->Close( player->GetPID( ) );
 
 		// start the lag screen for the new player
 
@@ -3055,9 +3239,9 @@ void CBaseGame :: EventPlayerMapSize( CGamePlayer *player, CIncomingMapSize *map
 
 		if( m_GHost->m_AllowDownloads != 0 )
 		{
-			string *MapData = m_Map->GetMapData( );
+			CMapData *MapData = m_Map->GetMapData( );
 
-			if( !MapData->empty( ) )
+			if( MapData )
 			{
 				if( m_GHost->m_AllowDownloads == 1 || ( m_GHost->m_AllowDownloads == 2 && player->GetDownloadAllowed( ) ) )
 				{
@@ -3069,6 +3253,9 @@ void CBaseGame :: EventPlayerMapSize( CGamePlayer *player, CIncomingMapSize *map
 						Send( player, m_Protocol->SEND_W3GS_STARTDOWNLOAD( GetHostPID( ) ) );
 						player->SetDownloadStarted( true );
 						player->SetStartedDownloadingTicks( GetTicks( ) );
+
+						if( !m_DownloadTimer.GetPending( ) && !m_DownloadTimer.GetExpired( ) )
+							SetTimer( &m_DownloadTimer, 0 );
 					}
 					else
 						player->SetLastMapPartAcked( mapSize->GetMapSize( ) );
@@ -3235,7 +3422,7 @@ void CBaseGame :: EventGameStarted( )
 		SendAllSlotInfo( );
 
 	m_StartedLoadingTicks = GetTicks( );
-	m_LastLagScreenResetTime = GetTime( );
+	SetTimer( &m_LagScreenResetTimer, 30000 );
 	m_GameLoading = true;
 
 	// since we use a fake countdown to deal with leavers during countdown the COUNTDOWN_START and COUNTDOWN_END packets are sent in quick succession
@@ -3345,8 +3532,10 @@ void CBaseGame :: EventGameStarted( )
 
                 for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		{
+			PACKETBUFFER GameLoaded = CPacketBuffer :: Create( m_Protocol->SEND_W3GS_GAMELOADED_OTHERS( (*i)->GetPID( ) ) );
+
                         for( vector<CGamePlayer *> :: iterator j = m_Players.begin( ); j != m_Players.end( ); ++j )
-				(*j)->AddLoadInGameData( m_Protocol->SEND_W3GS_GAMELOADED_OTHERS( (*i)->GetPID( ) ) );
+				(*j)->AddLoadInGameData( GameLoaded );
 		}
 	}
 
@@ -3391,6 +3580,11 @@ void CBaseGame :: EventGameLoaded( )
         for( vector<CGamePlayer *> :: iterator i = m_Players.begin( ); i != m_Players.end( ); ++i )
 		SendChat( *i, m_GHost->m_Language->YourLoadingTimeWas( UTIL_ToString( (float)( (*i)->GetFinishedLoadingTicks( ) - m_StartedLoadingTicks ) / 1000, 2 ) ) );
 
+	// the replay header is complete now (apart from the host which is set to the last player to leave) so start streaming the replay to disk
+
+	if( m_Replay )
+		m_Replay->StartStreaming( m_GHost->m_ReplayCompressor, m_GHost->m_ReplayPath + UTIL_FileSafeName( "GHost++ " + m_GameName + " " + UTIL_ToString( m_HostCounter ) + ".w3g.tmp" ), m_GameName, m_StatString );
+
 	// read from gameloaded.txt if available
 
 	ifstream in;
@@ -4013,93 +4207,6 @@ void CBaseGame :: ShuffleSlots( )
 	SendAllSlotInfo( );
 }
 
-vector<unsigned char> CBaseGame :: BalanceSlotsRecursive( vector<unsigned char> PlayerIDs, unsigned char *TeamSizes, double *PlayerScores, unsigned char StartTeam )
-{
-	// take a brute force approach to finding the best balance by iterating through every possible combination of players
-	// 1.) since the number of teams is arbitrary this algorithm must be recursive
-	// 2.) on the first recursion step every possible combination of players into two "teams" is checked, where the first team is the correct size and the second team contains everyone else
-	// 3.) on the next recursion step every possible combination of the remaining players into two more "teams" is checked, continuing until all the actual teams are accounted for
-	// 4.) for every possible combination, check the largest difference in total scores between any two actual teams
-	// 5.) minimize this value by choosing the combination of players with the smallest difference
-
-	vector<unsigned char> BestOrdering = PlayerIDs;
-	double BestDifference = -1.0;
-
-        for( unsigned char i = StartTeam; i < 12; ++i )
-	{
-		if( TeamSizes[i] > 0 )
-		{
-			unsigned char Mid = TeamSizes[i];
-
-			// the base case where only one actual team worth of players was passed to this function is handled by the behaviour of next_combination
-			// in this case PlayerIDs.begin( ) + Mid will actually be equal to PlayerIDs.end( ) and next_combination will return false
-
-			while( next_combination( PlayerIDs.begin( ), PlayerIDs.begin( ) + Mid, PlayerIDs.end( ) ) )
-			{
-				// we're splitting the players into every possible combination of two "teams" based on the midpoint Mid
-				// the first (left) team contains the correct number of players but the second (right) "team" might or might not
-				// for example, it could contain one, two, or more actual teams worth of players
-				// so recurse using the second "team" as the full set of players to perform the balancing on
-
-				vector<unsigned char> BestSubOrdering = BalanceSlotsRecursive( vector<unsigned char>( PlayerIDs.begin( ) + Mid, PlayerIDs.end( ) ), TeamSizes, PlayerScores, i + 1 );
-
-				// BestSubOrdering now contains the best ordering of all the remaining players (the "right team") given this particular combination of players into two "teams"
-				// in order to calculate the largest difference in total scores we need to recombine the subordering with the first team
-
-				vector<unsigned char> TestOrdering = vector<unsigned char>( PlayerIDs.begin( ), PlayerIDs.begin( ) + Mid );
-				TestOrdering.insert( TestOrdering.end( ), BestSubOrdering.begin( ), BestSubOrdering.end( ) );
-
-				// now calculate the team scores for all the teams that we know about (e.g. on subsequent recursion steps this will NOT be every possible team)
-
-				vector<unsigned char> :: iterator CurrentPID = TestOrdering.begin( );
-				double TeamScores[12];
-
-                                for( unsigned char j = StartTeam; j < 12; ++j )
-				{
-					TeamScores[j] = 0.0;
-
-                                        for( unsigned char k = 0; k < TeamSizes[j]; ++k )
-					{
-						TeamScores[j] += PlayerScores[*CurrentPID];
-                                                ++CurrentPID;
-					}
-				}
-
-				// find the largest difference in total scores between any two teams
-
-				double LargestDifference = 0.0;
-
-                                for( unsigned char j = StartTeam; j < 12; ++j )
-				{
-					if( TeamSizes[j] > 0 )
-					{
-                                                for( unsigned char k = j + 1; k < 12; ++k )
-						{
-							if( TeamSizes[k] > 0 )
-							{
-								double Difference = abs( TeamScores[j] - TeamScores[k] );
-
-								if( Difference > LargestDifference )
-									LargestDifference = Difference;
-							}
-						}
-					}
-				}
-
-				// and minimize it
-
-				if( BestDifference < 0.0 || LargestDifference < BestDifference )
-				{
-					BestOrdering = TestOrdering;
-					BestDifference = LargestDifference;
-				}
-			}
-		}
-	}
-
-	return BestOrdering;
-}
-
 void CBaseGame :: BalanceSlots( )
 {
 	if( !( m_Map->GetMapOptions( ) & MAPOPT_FIXEDPLAYERSETTINGS ) )
@@ -4145,50 +4252,12 @@ void CBaseGame :: BalanceSlots( )
 		}
 	}
 
-	sort( PlayerIDs.begin( ), PlayerIDs.end( ) );
-
-	// balancing the teams is a variation of the bin packing problem which is NP
-	// we can have up to 12 players and/or teams so the scope of the problem is sometimes small enough to process quickly
-	// let's try to figure out roughly how much work this is going to take
-	// examples:
-	//  2 teams of 4 =     70 ~    5ms *** ok
-	//  2 teams of 5 =    252 ~    5ms *** ok
-	//  2 teams of 6 =    924 ~   20ms *** ok
-	//  3 teams of 2 =     90 ~    5ms *** ok
-	//  3 teams of 3 =   1680 ~   25ms *** ok
-	//  3 teams of 4 =  34650 ~  250ms *** will cause a lag spike
-	//  4 teams of 2 =   2520 ~   30ms *** ok
-	//  4 teams of 3 = 369600 ~ 3500ms *** unacceptable
-
-	uint32_t AlgorithmCost = 0;
-	uint32_t PlayersLeft = PlayerIDs.size( );
-
-        for( unsigned char i = 0; i < 12; ++i )
-	{
-		if( TeamSizes[i] > 0 )
-		{
-			if( AlgorithmCost == 0 )
-				AlgorithmCost = nCr( PlayersLeft, TeamSizes[i] );
-			else
-				AlgorithmCost *= nCr( PlayersLeft, TeamSizes[i] );
-
-			PlayersLeft -= TeamSizes[i];
-		}
-	}
-
-	if( AlgorithmCost > 40000 )
-	{
-		// the cost is too high, don't run the algorithm
-		// a possible alternative: stop after enough iterations and/or time has passed
-
-		CONSOLE_Print( "[GAME: " + m_GameName + "] shuffling slots instead of balancing - the algorithm is too slow (with a cost of " + UTIL_ToString( AlgorithmCost ) + ") for this team configuration" );
-		SendAllChat( m_GHost->m_Language->ShufflingPlayers( ) );
-		ShuffleSlots( );
-		return;
-	}
+	// find the best balance with an exact search (see CTeamBalancer)
+	// it takes well under a millisecond for every team layout so it runs right here in the game's update
 
+	CTeamBalancer Balancer;
 	uint32_t StartTicks = GetTicks( );
-	vector<unsigned char> BestOrdering = BalanceSlotsRecursive( PlayerIDs, TeamSizes, PlayerScores, 0 );
+	vector<unsigned char> BestOrdering = Balancer.Balance( PlayerIDs, TeamSizes, PlayerScores );
 	uint32_t EndTicks = GetTicks( );
 
 	// the BestOrdering assumes the teams are in slot order although this may not be the case
@@ -4230,7 +4299,7 @@ void CBaseGame :: BalanceSlots( )
 		}
 	}
 
-	CONSOLE_Print( "[GAME: " + m_GameName + "] balancing slots completed in " + UTIL_ToString( EndTicks - StartTicks ) + "ms (with a cost of " + UTIL_ToString( AlgorithmCost ) + ")" );
+	CONSOLE_Print( "[GAME: " + m_GameName + "] balancing slots completed in " + UTIL_ToString( EndTicks - StartTicks ) + "ms (checked " + UTIL_ToString( Balancer.GetNumNodes( ) ) + " combinations)" );
 	SendAllChat( m_GHost->m_Language->BalancingSlotsCompleted( ) );
 	SendAllSlotInfo( );
 
@@ -4352,6 +4421,7 @@ void CBaseGame :: StartCountDown( bool force )
 		{
 			m_CountDownStarted = true;
 			m_CountDownCounter = 10;
+			SetTimer( &m_CountDownTimer, 0 );
 		}
 		else
 		{
@@ -4432,6 +4502,7 @@ void CBaseGame :: StartCountDown( bool force )
 			{
 				m_CountDownStarted = true;
 				m_CountDownCounter = 10;
+				SetTimer( &m_CountDownTimer, 0 );
 			}
 		}
 	}
@@ -4524,6 +4595,7 @@ void CBaseGame :: StartCountDownAuto( bool requireSpoofChecks )
 		{
 			m_CountDownStarted = true;
 			m_CountDownCounter = 10;
+			SetTimer( &m_CountDownTimer, 0 );
 		}
 	}
 }
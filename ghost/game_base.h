@@ -22,6 +22,10 @@
 #define GAME_BASE_H
 
 #include "gameslot.h"
+#include "packetbuffer.h"
+#include "timerwheel.h"
+
+#include <boost/shared_ptr.hpp>
 
 //
 // CBaseGame
@@ -38,7 +42,11 @@ class CIncomingJoinPlayer;
 class CIncomingAction;
 class CIncomingChatPlayer;
 class CIncomingMapSize;
+class CCallableMailbox;
 class CCallableScoreCheck;
+class CBNET;
+class CGameWorker;
+class CSocketReactor;
 
 class CBaseGame
 {
@@ -46,21 +54,28 @@ public:
 	CGHost *m_GHost;
 
 protected:
+	CGameWorker *m_Worker;							// the worker thread which owns this game (NULL if the game is owned by the main thread)
+	CSocketReactor *m_Reactor;						// the reactor this game's sockets are registered with (NULL when using select)
+	CTimerWheel *m_TimerWheel;						// the timer wheel this game's timers are scheduled on (NULL while the game is being handed over to another thread)
 	CTCPServer *m_Socket;							// listening socket
 	CGameProtocol *m_Protocol;						// game protocol
 	vector<CGameSlot> m_Slots;						// vector of slots
 	vector<CPotentialPlayer *> m_Potentials;		// vector of potential players (connections that haven't sent a W3GS_REQJOIN packet yet)
 	vector<CGamePlayer *> m_Players;				// vector of players
 	vector<CCallableScoreCheck *> m_ScoreChecks;
+	vector<string> m_ScoreCheckNames;				// the players who joined since the last score check was started, they're checked together in one query
+	vector<string> m_ScoreCheckServers;				// the realm of each player in m_ScoreCheckNames
+	boost :: shared_ptr<CCallableMailbox> m_Mailbox;	// the mailbox our callables post to when they complete
 	queue<CIncomingAction *> m_Actions;				// queue of actions to be sent
 	vector<string> m_Reserved;						// vector of player names with reserved slots (from the !hold command)
 	set<string> m_IgnoredNames;						// set of player names to NOT print ban messages for when joining because they've already been printed
-	set<string> m_IPBlackList;						// set of IP addresses to blacklist from joining (todotodo: convert to uint32's for efficiency)
 	vector<CGameSlot> m_EnforceSlots;				// vector of slots to force players to use (used with saved games)
 	vector<PIDPlayer> m_EnforcePlayers;				// vector of pids to force players to use (used with saved games)
 	CMap *m_Map;									// map data
 	CSaveGame *m_SaveGame;							// savegame data (this is a pointer to global data)
 	CReplay *m_Replay;								// replay
+	CPacketLog m_GProxyLog;							// the packets sent to GProxy++ players since the game loaded which they haven't acknowledged yet (for resending when they reconnect)
+	CPacketLog m_LoadInGameLog;						// the packets to be sent to each player when it finishes loading when using "load in game"
 	bool m_Exiting;									// set to true and this class will be deleted next update
 	bool m_Saving;									// if we're currently saving game data to the database
 	uint16_t m_HostPort;							// the port to host games on
@@ -86,28 +101,32 @@ protected:
 	uint32_t m_SyncCounter;							// the number of actions sent so far (for determining if anyone is lagging)
 	uint32_t m_GameTicks;							// ingame ticks
 	uint32_t m_CreationTime;						// GetTime when the game was created
-	uint32_t m_LastPingTime;						// GetTime when the last ping was sent
-	uint32_t m_LastRefreshTime;						// GetTime when the last game refresh was sent
-	uint32_t m_LastDownloadTicks;					// GetTicks when the last map download cycle was performed
 	uint32_t m_DownloadCounter;						// # of map bytes downloaded in the last second
-	uint32_t m_LastDownloadCounterResetTicks;		// GetTicks when the download counter was last reset
-	uint32_t m_LastAnnounceTime;					// GetTime when the last announce message was sent
 	uint32_t m_AnnounceInterval;					// how many seconds to wait between sending the m_AnnounceMessage
-	uint32_t m_LastAutoStartTime;					// the last time we tried to auto start the game
 	uint32_t m_AutoStartPlayers;					// auto start the game when there are this many players or more
-	uint32_t m_LastCountDownTicks;					// GetTicks when the last countdown message was sent
 	uint32_t m_CountDownCounter;					// the countdown is finished when this reaches zero
 	uint32_t m_StartedLoadingTicks;					// GetTicks when the game started loading
 	uint32_t m_StartPlayers;						// number of players when the game started
-	uint32_t m_LastLagScreenResetTime;				// GetTime when the "lag" screen was last reset
 	uint32_t m_LastActionSentTicks;					// GetTicks when the last action packet was sent
 	uint32_t m_LastActionLateBy;					// the number of ticks we were late sending the last action packet by
 	uint32_t m_StartedLaggingTime;					// GetTime when the last lag screen started
 	uint32_t m_LastLagScreenTime;					// GetTime when the last lag screen was active (continuously updated)
 	uint32_t m_LastReservedSeen;					// GetTime when the last reserved player was seen in the lobby
-	uint32_t m_StartedKickVoteTime;					// GetTime when the kick vote was started
 	uint32_t m_GameOverTime;						// GetTime when the game was over
 	uint32_t m_LastPlayerLeaveTicks;				// GetTicks when the most recent player left the game
+	CTimer m_PingTimer;								// expires when it's time to send the next ping (every 5 seconds)
+	CTimer m_RefreshTimer;							// expires when it's time to send the next game refresh (every 3 seconds)
+	CTimer m_DownloadCounterTimer;					// expires when it's time to reset the download counter (every second)
+	CTimer m_DownloadTimer;							// expires when it's time to send more map data (every 100ms but only while someone is downloading the map)
+	CTimer m_AnnounceTimer;							// expires when it's time to send the announce message (every m_AnnounceInterval seconds)
+	CTimer m_AutoStartTimer;						// expires when it's time to try to auto start the game (every 10 seconds)
+	CTimer m_CountDownTimer;						// expires when it's time to send the next countdown message (every 500ms)
+	CTimer m_LobbyTimer;							// expires when it's time to check the lobby time limit (every second)
+	CTimer m_LagScreenResetTimer;					// expires when it's time to reset the "lag" screen (every 30 seconds while loading or 60 seconds while lagging)
+	CTimer m_ActionTimer;							// expires when it's time to send the next action packet (every m_Latency ms)
+	CTimer m_KickVoteTimer;							// expires when the kick vote expires (60 seconds after it was started)
+	CTimer m_GameOverTimer;							// expires when the gameover timer finishes (60 seconds after it was started)
+	vector<CTimer *> m_Timers;						// all of the above (for moving them to another timer wheel)
 	double m_MinimumScore;							// the minimum allowed score for matchmaking mode
 	double m_MaximumScore;							// the maximum allowed score for matchmaking mode
 	bool m_SlotInfoChanged;							// if the slot info has changed and hasn't been sent to the players yet (optimization)
@@ -133,6 +152,8 @@ public:
 	virtual vector<CGameSlot> GetEnforceSlots( )	{ return m_EnforceSlots; }
 	virtual vector<PIDPlayer> GetEnforcePlayers( )	{ return m_EnforcePlayers; }
 	virtual CSaveGame *GetSaveGame( )				{ return m_SaveGame; }
+	virtual CPacketLog *GetGProxyLog( )				{ return &m_GProxyLog; }
+	virtual CPacketLog *GetLoadInGameLog( )			{ return &m_LoadInGameLog; }
 	virtual uint16_t GetHostPort( )					{ return m_HostPort; }
 	virtual unsigned char GetGameState( )			{ return m_GameState; }
 	virtual unsigned char GetGProxyEmptyActions( )	{ return m_GProxyEmptyActions; }
@@ -150,6 +171,8 @@ public:
 	virtual bool GetGameLoading( )					{ return m_GameLoading; }
 	virtual bool GetGameLoaded( )					{ return m_GameLoaded; }
 	virtual bool GetLagging( )						{ return m_Lagging; }
+	virtual CGameWorker *GetWorker( )				{ return m_Worker; }
+	virtual CCallableMailbox *GetMailbox( )			{ return m_Mailbox.get( ); }
 
 	virtual void SetEnforceSlots( vector<CGameSlot> nEnforceSlots )		{ m_EnforceSlots = nEnforceSlots; }
 	virtual void SetEnforcePlayers( vector<PIDPlayer> nEnforcePlayers )	{ m_EnforcePlayers = nEnforcePlayers; }
@@ -159,8 +182,11 @@ public:
 	virtual void SetMaximumScore( double nMaximumScore )				{ m_MaximumScore = nMaximumScore; }
 	virtual void SetRefreshError( bool nRefreshError )					{ m_RefreshError = nRefreshError; }
 	virtual void SetMatchMaking( bool nMatchMaking )					{ m_MatchMaking = nMatchMaking; }
+	virtual void SetWorker( CGameWorker *nWorker )						{ m_Worker = nWorker; }
+	virtual void SetReactor( CSocketReactor *nReactor );
+	virtual void SetTimerWheel( CTimerWheel *nTimerWheel );
+	virtual void SetTimer( CTimer *timer, uint32_t ticks );
 
-	virtual uint32_t GetNextTimedActionTicks( );
 	virtual uint32_t GetSlotsOccupied( );
 	virtual uint32_t GetSlotsOpen( );
 	virtual uint32_t GetNumPlayers( );
@@ -172,15 +198,18 @@ public:
 	// processing functions
 
 	virtual unsigned int SetFD( void *fd, void *send_fd, int *nfds );
+	virtual void UpdateCallables( );
 	virtual bool Update( void *fd, void *send_fd );
 	virtual void UpdatePost( void *send_fd );
 
 	// generic functions to send packets to players
 
 	virtual void Send( CGamePlayer *player, BYTEARRAY data );
+	virtual void Send( CGamePlayer *player, PACKETBUFFER packet );
 	virtual void Send( unsigned char PID, BYTEARRAY data );
 	virtual void Send( BYTEARRAY PIDs, BYTEARRAY data );
 	virtual void SendAll( BYTEARRAY data );
+	virtual void SendAll( PACKETBUFFER packet );
 
 	// functions to send packets to players
 
@@ -198,6 +227,14 @@ public:
 	virtual void SendWelcomeMessage( CGamePlayer *player );
 	virtual void SendEndMessage( );
 
+	// functions to talk to battle.net
+	// when the game is owned by a worker thread these are queued and performed by the main thread later
+
+	virtual void QueueBNETChatCommand( CBNET *bnet, string chatCommand );
+	virtual void QueueBNETChatCommand( CBNET *bnet, string chatCommand, string user, bool whisper );
+	virtual void AddBNETBan( CBNET *bnet, string name, string ip, string gamename, string admin, string reason );
+	virtual void UnqueueBNETChatCommand( CBNET *bnet, string chatCommand );
+
 	// events
 	// note: these are only called while iterating through the m_Potentials or m_Players vectors
 	// therefore you can't modify those vectors and must use the player's m_DeleteMe member to flag for deletion
@@ -208,6 +245,7 @@ public:
 	virtual void EventPlayerDisconnectSocketError( CGamePlayer *player );
 	virtual void EventPlayerDisconnectConnectionClosed( CGamePlayer *player );
 	virtual void EventPlayerJoined( CPotentialPlayer *potential, CIncomingJoinPlayer *joinPlayer );
+	virtual void StartScoreChecks( );
 	virtual void EventPlayerJoinedWithScore( CPotentialPlayer *potential, CIncomingJoinPlayer *joinPlayer, double score );
 	virtual void EventPlayerLeft( CGamePlayer *player, uint32_t reason );
 	virtual void EventPlayerLoaded( CGamePlayer *player );
@@ -252,7 +290,6 @@ public:
 	virtual void OpenAllSlots( );
 	virtual void CloseAllSlots( );
 	virtual void ShuffleSlots( );
-	virtual vector<unsigned char> BalanceSlotsRecursive( vector<unsigned char> PlayerIDs, unsigned char *TeamSizes, double *PlayerScores, unsigned char StartTeam );
 	virtual void BalanceSlots( );
 	virtual void AddToSpoofed( string server, string name, bool sendMessage );
 	virtual void AddToReserved( string name );
@@ -96,30 +96,28 @@ void CPotentialPlayer :: ExtractPackets( )
 
 	// extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
 
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
 
 	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
+	// the packets are framed in place and each packet is copied exactly once (into its CCommandPacket)
 
-	while( Bytes.size( ) >= 4 )
+	while( RecvBuffer->GetSize( ) >= 4 )
 	{
+		const unsigned char *Bytes = RecvBuffer->GetData( );
+
 		if( Bytes[0] == W3GS_HEADER_CONSTANT || Bytes[0] == GPS_HEADER_CONSTANT )
 		{
 			// bytes 2 and 3 contain the length of the packet
 
-			uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
+			int32_t Length = RecvBuffer->FramePacket( 2, 4 );
 
-			if( Length >= 4 )
+			if( Length > 0 )
 			{
-				if( Bytes.size( ) >= Length )
-				{
-					m_Packets.push( new CCommandPacket( Bytes[0], Bytes[1], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
-					*RecvBuffer = RecvBuffer->substr( Length );
-					Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
-				}
-				else
-					return;
+				m_Packets.push( new CCommandPacket( Bytes[0], Bytes[1], BYTEARRAY( Bytes, Bytes + Length ) ) );
+				RecvBuffer->Consume( Length );
 			}
+			else if( Length == 0 )
+				return;
 			else
 			{
 				m_Error = true;
@@ -180,6 +178,12 @@ void CPotentialPlayer :: Send( BYTEARRAY data )
 		m_Socket->PutBytes( data );
 }
 
+void CPotentialPlayer :: Send( PACKETBUFFER packet )
+{
+	if( m_Socket )
+		m_Socket->PutBytes( packet );
+}
+
 //
 // CGamePlayer
 //
@@ -212,7 +216,10 @@ m_DropVote( false ), m_KickVote( false ), m_Muted( false ), m_LeftMessageSent( f
 
 CGamePlayer :: ~CGamePlayer( )
 {
+	// the game's packet logs keep this player's packets until it's closed
 
+	m_Game->GetGProxyLog( )->Close( m_PID );
+	m_Game->GetLoadInGameLog( )->Close( m_PID );
 }
 
 string CGamePlayer :: GetNameTerminated( )
@@ -267,12 +274,12 @@ bool CGamePlayer :: Update( void *fd )
 				if( m_Game->GetGameState( ) == GAME_PUBLIC )
 				{
 					if( (*i)->GetPasswordHashType( ) == "pvpgn" )
-						(*i)->QueueChatCommand( "/whereis " + m_Name );
+						m_Game->QueueBNETChatCommand( *i, "/whereis " + m_Name );
 					else
-						(*i)->QueueChatCommand( "/whois " + m_Name );
+						m_Game->QueueBNETChatCommand( *i, "/whois " + m_Name );
 				}
 				else if( m_Game->GetGameState( ) == GAME_PRIVATE )
-					(*i)->QueueChatCommand( m_Game->m_GHost->m_Language->SpoofCheckByReplying( ), m_Name, true );
+					m_Game->QueueBNETChatCommand( *i, m_Game->m_GHost->m_Language->SpoofCheckByReplying( ), m_Name, true );
 			}
 		}
 
@@ -341,34 +348,32 @@ void CGamePlayer :: ExtractPackets( )
 
 	// extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
 
-	string *RecvBuffer = m_Socket->GetBytes( );
-	BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+	CRecvBuffer *RecvBuffer = m_Socket->GetBytes( );
 
 	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
+	// the packets are framed in place and each packet is copied exactly once (into its CCommandPacket)
 
-	while( Bytes.size( ) >= 4 )
+	while( RecvBuffer->GetSize( ) >= 4 )
 	{
+		const unsigned char *Bytes = RecvBuffer->GetData( );
+
 		if( Bytes[0] == W3GS_HEADER_CONSTANT || Bytes[0] == GPS_HEADER_CONSTANT )
 		{
 			// bytes 2 and 3 contain the length of the packet
 
-			uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
+			int32_t Length = RecvBuffer->FramePacket( 2, 4 );
 
-			if( Length >= 4 )
+			if( Length > 0 )
 			{
-				if( Bytes.size( ) >= Length )
-				{
-					m_Packets.push( new CCommandPacket( Bytes[0], Bytes[1], BYTEARRAY( Bytes.begin( ), Bytes.begin( ) + Length ) ) );
+				m_Packets.push( new CCommandPacket( Bytes[0], Bytes[1], BYTEARRAY( Bytes, Bytes + Length ) ) );
 
-					if( Bytes[0] == W3GS_HEADER_CONSTANT )
-                                                ++m_TotalPacketsReceived;
+				if( Bytes[0] == W3GS_HEADER_CONSTANT )
+                                        ++m_TotalPacketsReceived;
 
-					*RecvBuffer = RecvBuffer->substr( Length );
-					Bytes = BYTEARRAY( Bytes.begin( ) + Length, Bytes.end( ) );
-				}
-				else
-					return;
+				RecvBuffer->Consume( Length );
 			}
+			else if( Length == 0 )
+				return;
 			else
 			{
 				m_Error = true;
@@ -533,21 +538,11 @@ void CGamePlayer :: ProcessPackets( )
 			else if( Packet->GetID( ) == CGPSProtocol :: GPS_ACK && Data.size( ) == 8 )
 			{
 				uint32_t LastPacket = UTIL_ByteArrayToUInt32( Data, false, 4 );
-				uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - m_GProxyBuffer.size( );
+				CPacketLog *GProxyLog = m_Game->GetGProxyLog( );
+				uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - GProxyLog->GetNumPending( m_PID );
 
 				if( LastPacket > PacketsAlreadyUnqueued )
-				{
-					uint32_t PacketsToUnqueue = LastPacket - PacketsAlreadyUnqueued;
-
-					if( PacketsToUnqueue > m_GProxyBuffer.size( ) )
-						PacketsToUnqueue = m_GProxyBuffer.size( );
-
-					while( PacketsToUnqueue > 0 )
-					{
-						m_GProxyBuffer.pop( );
-                                                --PacketsToUnqueue;
-					}
-				}
+					GProxyLog->Skip( m_PID, LastPacket - PacketsAlreadyUnqueued );
 			}
 		}
 
@@ -557,6 +552,12 @@ void CGamePlayer :: ProcessPackets( )
 
 void CGamePlayer :: Send( BYTEARRAY data )
 {
+	Send( CPacketBuffer :: Swap( data ) );
+}
+
+void CGamePlayer :: Send( PACKETBUFFER packet )
+{
+	// the game's GProxy++ log and the socket's send queue both reference the same packet buffer
 	// must start counting packet total from beginning of connection
 	// but we can avoid buffering packets until we know the client is using GProxy++ since that'll be determined before the game starts
 	// this prevents us from buffering packets for non-GProxy++ clients
@@ -564,9 +565,14 @@ void CGamePlayer :: Send( BYTEARRAY data )
         ++m_TotalPacketsSent;
 
 	if( m_GProxy && m_Game->GetGameLoaded( ) )
-		m_GProxyBuffer.push( data );
+		m_Game->GetGProxyLog( )->Add( m_PID, packet );
+
+	CPotentialPlayer :: Send( packet );
+}
 
-	CPotentialPlayer :: Send( data );
+void CGamePlayer :: AddLoadInGameData( PACKETBUFFER nLoadInGameData )
+{
+	m_Game->GetLoadInGameLog( )->Add( m_PID, nLoadInGameData );
 }
 
 void CGamePlayer :: EventGProxyReconnect( CTCPSocket *NewSocket, uint32_t LastPacket )
@@ -575,34 +581,20 @@ void CGamePlayer :: EventGProxyReconnect( CTCPSocket *NewSocket, uint32_t LastPa
 	m_Socket = NewSocket;
 	m_Socket->PutBytes( m_Game->m_GHost->m_GPSProtocol->SEND_GPSS_RECONNECT( m_TotalPacketsReceived ) );
 
-	uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - m_GProxyBuffer.size( );
+	CPacketLog *GProxyLog = m_Game->GetGProxyLog( );
+	uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - GProxyLog->GetNumPending( m_PID );
 
 	if( LastPacket > PacketsAlreadyUnqueued )
-	{
-		uint32_t PacketsToUnqueue = LastPacket - PacketsAlreadyUnqueued;
-
-		if( PacketsToUnqueue > m_GProxyBuffer.size( ) )
-			PacketsToUnqueue = m_GProxyBuffer.size( );
-
-		while( PacketsToUnqueue > 0 )
-		{
-			m_GProxyBuffer.pop( );
-                        --PacketsToUnqueue;
-		}
-	}
+		GProxyLog->Skip( m_PID, LastPacket - PacketsAlreadyUnqueued );
 
-	// send remaining packets from buffer, preserve buffer
+	// send remaining packets from the log, they stay in the log until they're acknowledged
 
-	queue<BYTEARRAY> TempBuffer;
+	uint32_t Position = GProxyLog->GetCursor( m_PID );
+	PACKETBUFFER Packet;
 
-	while( !m_GProxyBuffer.empty( ) )
-	{
-		m_Socket->PutBytes( m_GProxyBuffer.front( ) );
-		TempBuffer.push( m_GProxyBuffer.front( ) );
-		m_GProxyBuffer.pop( );
-	}
+	while( GProxyLog->GetNext( m_PID, Position, Packet ) )
+		m_Socket->PutBytes( Packet );
 
-	m_GProxyBuffer = TempBuffer;
 	m_GProxyDisconnectNoticeSent = false;
 	m_Game->SendAllChat( m_Game->m_GHost->m_Language->PlayerReconnectedWithGProxy( m_Name ) );
 }
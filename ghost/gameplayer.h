@@ -21,6 +21,8 @@
 #ifndef GAMEPLAYER_H
 #define GAMEPLAYER_H
 
+#include "packetbuffer.h"
+
 class CTCPSocket;
 class CCommandPacket;
 class CGameProtocol;
@@ -73,6 +75,7 @@ public:
 	// other functions
 
 	virtual void Send( BYTEARRAY data );
+	virtual void Send( PACKETBUFFER packet );
 };
 
 //
@@ -105,7 +108,6 @@ private:
 	uint32_t m_StatsSentTime;					// GetTime when we sent this player's stats to the chat (to prevent players from spamming !stats)
 	uint32_t m_StatsDotASentTime;				// GetTime when we sent this player's dota stats to the chat (to prevent players from spamming !statsdota)
 	uint32_t m_LastGProxyWaitNoticeSentTime;
-	queue<BYTEARRAY> m_LoadInGameData;			// queued data to be sent when the player finishes loading when using "load in game"
 	double m_Score;								// the player's generic "score" for the matchmaking algorithm
 	bool m_LoggedIn;							// if the player has logged in or not (used with CAdminGame only)
 	bool m_Spoofed;								// if the player has spoof checked or not
@@ -123,7 +125,6 @@ private:
 	bool m_LeftMessageSent;						// if the playerleave message has been sent or not
 	bool m_GProxy;								// if the player is using GProxy++
 	bool m_GProxyDisconnectNoticeSent;			// if a disconnection notice has been sent or not when using GProxy++
-	queue<BYTEARRAY> m_GProxyBuffer;
 	uint32_t m_GProxyReconnectKey;
 	uint32_t m_LastGProxyAckTime;
 
@@ -154,7 +155,6 @@ public:
 	uint32_t GetStatsSentTime( )				{ return m_StatsSentTime; }
 	uint32_t GetStatsDotASentTime( )			{ return m_StatsDotASentTime; }
 	uint32_t GetLastGProxyWaitNoticeSentTime( )	{ return m_LastGProxyWaitNoticeSentTime; }
-	queue<BYTEARRAY> *GetLoadInGameData( )		{ return &m_LoadInGameData; }
 	double GetScore( )							{ return m_Score; }
 	bool GetLoggedIn( )							{ return m_LoggedIn; }
 	bool GetSpoofed( )							{ return m_Spoofed; }
@@ -205,7 +205,8 @@ public:
 	string GetNameTerminated( );
 	uint32_t GetPing( bool LCPing );
 
-	void AddLoadInGameData( BYTEARRAY nLoadInGameData )								{ m_LoadInGameData.push( nLoadInGameData ); }
+	void AddLoadInGameData( BYTEARRAY nLoadInGameData )								{ AddLoadInGameData( CPacketBuffer :: Swap( nLoadInGameData ) ); }
+	void AddLoadInGameData( PACKETBUFFER nLoadInGameData );
 
 	// processing functions
 
@@ -216,6 +217,7 @@ public:
 	// other functions
 
 	virtual void Send( BYTEARRAY data );
+	virtual void Send( PACKETBUFFER packet );
 	virtual void EventGProxyReconnect( CTCPSocket *NewSocket, uint32_t LastPacket );
 };
 
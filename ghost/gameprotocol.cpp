@@ -21,6 +21,7 @@
 #include "ghost.h"
 #include "util.h"
 #include "crc32.h"
+#include "map.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
 #include "game_base.h"
@@ -482,7 +483,7 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_COUNTDOWN_END( )
 	return packet;
 }
 
-BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *> actions, uint16_t sendInterval )
+PACKETBUFFER CGameProtocol :: SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *> actions, uint16_t sendInterval )
 {
 	BYTEARRAY packet;
 	packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
@@ -508,7 +509,7 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *> a
 
 		// calculate crc (we only care about the first 2 bytes though)
 
-		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( (unsigned char *)string( subpacket.begin( ), subpacket.end( ) ).c_str( ), subpacket.size( ) ), false );
+		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( &subpacket[0], subpacket.size( ) ), false );
 		crc32.resize( 2 );
 
 		// finish subpacket
@@ -520,7 +521,10 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION( queue<CIncomingAction *> a
 	AssignLength( packet );
 	// DEBUG_Print( "SENT W3GS_INCOMING_ACTION" );
 	// DEBUG_Print( packet );
-	return packet;
+
+	// the action packet is sent to every player (and buffered for GProxy++ and load-in-game) so return it as a shared packet buffer
+
+	return CPacketBuffer :: Swap( packet );
 }
 
 BYTEARRAY CGameProtocol :: SEND_W3GS_CHAT_FROM_HOST( unsigned char fromPID, BYTEARRAY toPIDs, unsigned char flag, BYTEARRAY flagExtra, string message )
@@ -817,14 +821,22 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_STARTDOWNLOAD( unsigned char fromPID )
 	return packet;
 }
 
-BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned char toPID, uint32_t start, string *mapData )
+BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned char toPID, uint32_t start, CMapData *mapData )
 {
 	unsigned char Unknown[] = { 1, 0, 0, 0 };
 
 	BYTEARRAY packet;
 
-	if( start < mapData->size( ) )
+	if( mapData && start < mapData->GetSize( ) )
 	{
+		// calculate end position (don't send more than MAPPART_SIZE map bytes in one packet)
+
+		uint32_t End = start + MAPPART_SIZE;
+
+		if( End > mapData->GetSize( ) )
+			End = mapData->GetSize( );
+
+		packet.reserve( 18 + End - start );
 		packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
 		packet.push_back( W3GS_MAPPART );						// W3GS_MAPPART
 		packet.push_back( 0 );									// packet length will be assigned later
@@ -834,22 +846,14 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned ch
 		UTIL_AppendByteArray( packet, Unknown, 4 );				// ???
 		UTIL_AppendByteArray( packet, start, false );			// start position
 
-		// calculate end position (don't send more than 1442 map bytes in one packet)
+		// the bot always sends whole map parts so the crc has already been calculated
 
-		uint32_t End = start + 1442;
-
-		if( End > mapData->size( ) )
-			End = mapData->size( );
-
-		// calculate crc
-
-		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( (unsigned char *)mapData->c_str( ) + start, End - start ), false );
-		UTIL_AppendByteArrayFast( packet, crc32 );
-
-		// map data
+		if( start % MAPPART_SIZE == 0 )
+			UTIL_AppendByteArray( packet, mapData->GetPartCRC( start / MAPPART_SIZE ), false );
+		else
+			UTIL_AppendByteArray( packet, m_GHost->m_CRC->FullCRC( (unsigned char *)mapData->GetData( ) + start, End - start ), false );
 
-		BYTEARRAY Data = UTIL_CreateByteArray( (unsigned char *)mapData->c_str( ) + start, End - start );
-		UTIL_AppendByteArrayFast( packet, Data );
+		packet.insert( packet.end( ), mapData->GetData( ) + start, mapData->GetData( ) + End );
 		AssignLength( packet );
 	}
 	else
@@ -860,7 +864,7 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_MAPPART( unsigned char fromPID, unsigned ch
 	return packet;
 }
 
-BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION2( queue<CIncomingAction *> actions )
+PACKETBUFFER CGameProtocol :: SEND_W3GS_INCOMING_ACTION2( queue<CIncomingAction *> actions )
 {
 	BYTEARRAY packet;
 	packet.push_back( W3GS_HEADER_CONSTANT );				// W3GS header constant
@@ -887,7 +891,7 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION2( queue<CIncomingAction *>
 
 		// calculate crc (we only care about the first 2 bytes though)
 
-		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( (unsigned char *)string( subpacket.begin( ), subpacket.end( ) ).c_str( ), subpacket.size( ) ), false );
+		BYTEARRAY crc32 = UTIL_CreateByteArray( m_GHost->m_CRC->FullCRC( &subpacket[0], subpacket.size( ) ), false );
 		crc32.resize( 2 );
 
 		// finish subpacket
@@ -899,7 +903,7 @@ BYTEARRAY CGameProtocol :: SEND_W3GS_INCOMING_ACTION2( queue<CIncomingAction *>
 	AssignLength( packet );
 	// DEBUG_Print( "SENT W3GS_INCOMING_ACTION2" );
 	// DEBUG_Print( packet );
-	return packet;
+	return CPacketBuffer :: Swap( packet );
 }
 
 /////////////////////
@@ -0,0 +1,338 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "language.h"
+#include "socket.h"
+#include "ghostdb.h"
+#include "bnet.h"
+#include "gameplayer.h"
+#include "gpsprotocol.h"
+#include "game_base.h"
+#include "gameworker.h"
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+//
+// CGameWorker
+//
+
+CGameWorker :: CGameWorker( CGHost *nGHost, uint32_t nWorkerID ) : m_GHost( nGHost ), m_WorkerID( nWorkerID ), m_Reactor( NULL ), m_Wakeup( NULL ), m_TimerWheel( NULL ), m_Thread( NULL ), m_NumGames( 0 ), m_Exiting( false )
+{
+	m_TimerWheel = new CTimerWheel( );
+	m_Wakeup = new CWakeup( );
+
+#ifdef GHOST_EPOLL
+	// each worker waits on its own reactor so the main thread's reactor is only ever touched by the main thread
+
+	if( gSocketReactor )
+	{
+		m_Reactor = new CSocketReactor( );
+
+		if( !m_Reactor->GetValid( ) )
+		{
+			CONSOLE_Print( "[WORKER " + UTIL_ToString( m_WorkerID ) + "] unable to create epoll socket reactor, falling back to select" );
+			delete m_Reactor;
+			m_Reactor = NULL;
+		}
+		else
+			m_Reactor->RegisterWakeup( m_Wakeup );
+	}
+#endif
+
+	try
+	{
+		m_Thread = new boost :: thread( boost :: bind( &CGameWorker :: Run, this ) );
+	}
+	catch( boost :: thread_resource_error tre )
+	{
+		CONSOLE_Print( "[WORKER " + UTIL_ToString( m_WorkerID ) + "] error - unable to create thread" );
+		m_Thread = NULL;
+	}
+}
+
+CGameWorker :: ~CGameWorker( )
+{
+	Stop( );
+
+	// the games themselves are deleted by the main thread (they're still in CGHost :: m_Games)
+	// however, any reconnecting sockets which haven't been picked up yet belong to us
+
+	for( vector<CWorkerReconnect> :: iterator i = m_Reconnects.begin( ); i != m_Reconnects.end( ); ++i )
+		delete i->m_Socket;
+
+	delete m_Reactor;
+	delete m_Wakeup;
+	delete m_TimerWheel;
+}
+
+void CGameWorker :: AddGame( CBaseGame *game )
+{
+	// the game's sockets must have been removed from the main thread's reactor before handing it over
+	// the worker thread registers them with its own reactor when it picks the game up
+
+	// the game's callables must wake up the worker thread from now on
+	// note: the game is deleted (which detaches the wakeup again) before the worker is deleted
+
+	game->SetWorker( this );
+	game->GetMailbox( )->SetWakeup( m_Wakeup );
+	++m_NumGames;
+
+	boost :: mutex :: scoped_lock QueueLock( m_QueueMutex );
+	m_NewGames.push_back( game );
+	m_Wakeup->Signal( );
+}
+
+void CGameWorker :: AddReconnect( CTCPSocket *socket, unsigned char PID, uint32_t reconnectKey, uint32_t lastPacket )
+{
+	boost :: mutex :: scoped_lock QueueLock( m_QueueMutex );
+	m_Reconnects.push_back( CWorkerReconnect( socket, PID, reconnectKey, lastPacket ) );
+}
+
+void CGameWorker :: ProcessMessages( )
+{
+	vector<CWorkerMessage> Messages;
+
+	{
+		boost :: mutex :: scoped_lock QueueLock( m_QueueMutex );
+		Messages.swap( m_Messages );
+	}
+
+	for( vector<CWorkerMessage> :: iterator i = Messages.begin( ); i != Messages.end( ); ++i )
+	{
+		if( i->m_Type == CWorkerMessage :: GAME_DELETED )
+		{
+			CONSOLE_Print( "[GHOST] deleting game [" + i->m_Game->GetGameName( ) + "]" );
+			m_GHost->EventGameDeleted( i->m_Game );
+			m_GHost->m_Games.erase( remove( m_GHost->m_Games.begin( ), m_GHost->m_Games.end( ), i->m_Game ), m_GHost->m_Games.end( ) );
+			delete i->m_Game;
+			--m_NumGames;
+			continue;
+		}
+
+		// the battle.net connection might have been deleted since the message was queued (e.g. when exiting nicely)
+
+		if( find( m_GHost->m_BNETs.begin( ), m_GHost->m_BNETs.end( ), i->m_BNET ) == m_GHost->m_BNETs.end( ) )
+			continue;
+
+		if( i->m_Type == CWorkerMessage :: BNET_CHATCOMMAND )
+			i->m_BNET->QueueChatCommand( i->m_Message );
+		else if( i->m_Type == CWorkerMessage :: BNET_WHISPER )
+			i->m_BNET->QueueChatCommand( i->m_Message, i->m_User, true );
+		else if( i->m_Type == CWorkerMessage :: BNET_ADDBAN )
+			i->m_BNET->AddBan( i->m_User, i->m_IP, i->m_GameName, i->m_Admin, i->m_Reason );
+		else if( i->m_Type == CWorkerMessage :: BNET_UNQUEUECHATCOMMAND )
+			i->m_BNET->UnqueueChatCommand( i->m_Message );
+	}
+}
+
+void CGameWorker :: Stop( )
+{
+	if( !m_Thread )
+		return;
+
+	{
+		boost :: mutex :: scoped_lock QueueLock( m_QueueMutex );
+		m_Exiting = true;
+	}
+
+	m_Thread->join( );
+	delete m_Thread;
+	m_Thread = NULL;
+}
+
+void CGameWorker :: QueueMessage( const CWorkerMessage &message )
+{
+	boost :: mutex :: scoped_lock QueueLock( m_QueueMutex );
+	m_Messages.push_back( message );
+}
+
+void CGameWorker :: Run( )
+{
+	CONSOLE_Print( "[WORKER " + UTIL_ToString( m_WorkerID ) + "] started" );
+
+	while( Update( ) )
+		;
+
+	CONSOLE_Print( "[WORKER " + UTIL_ToString( m_WorkerID ) + "] stopped" );
+}
+
+bool CGameWorker :: Update( )
+{
+	// pick up any games and reconnects handed over by the main thread
+
+	vector<CBaseGame *> NewGames;
+	vector<CWorkerReconnect> Reconnects;
+
+	{
+		boost :: mutex :: scoped_lock QueueLock( m_QueueMutex );
+
+		if( m_Exiting )
+			return false;
+
+		NewGames.swap( m_NewGames );
+		Reconnects.swap( m_Reconnects );
+	}
+
+	unsigned int NumFDs = 0;
+	int nfds = 0;
+	fd_set fd;
+	fd_set send_fd;
+	FD_ZERO( &fd );
+	FD_ZERO( &send_fd );
+
+	// block for at most 50ms
+	// new games handed over by the main thread and completed callables signal our wakeup so they're picked up right away where wakeups are supported
+
+	long usecBlock = 50000;
+
+	{
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+		for( vector<CBaseGame *> :: iterator i = NewGames.begin( ); i != NewGames.end( ); ++i )
+		{
+			CONSOLE_Print( "[WORKER " + UTIL_ToString( m_WorkerID ) + "] now updating game [" + (*i)->GetGameName( ) + "]" );
+			(*i)->SetReactor( m_Reactor );
+			(*i)->SetTimerWheel( m_TimerWheel );
+			m_Games.push_back( *i );
+		}
+
+		for( vector<CWorkerReconnect> :: iterator i = Reconnects.begin( ); i != Reconnects.end( ); ++i )
+		{
+			// the player might have left or the game might have ended since the main thread matched the reconnect so look for the player again
+
+			CGamePlayer *Match = NULL;
+
+			for( vector<CBaseGame *> :: iterator j = m_Games.begin( ); j != m_Games.end( ); ++j )
+			{
+				if( (*j)->GetGameLoaded( ) )
+				{
+					CGamePlayer *Player = (*j)->GetPlayerFromPID( i->m_PID );
+
+					if( Player && Player->GetGProxy( ) && Player->GetGProxyReconnectKey( ) == i->m_ReconnectKey )
+					{
+						Match = Player;
+						break;
+					}
+				}
+			}
+
+			if( Match )
+			{
+				Match->EventGProxyReconnect( i->m_Socket, i->m_LastPacket );
+				i->m_Socket->SetReactor( m_Reactor );
+			}
+			else
+			{
+				// the socket isn't registered with any reactor here so it's treated as writable if it's in the fd set
+
+				fd_set reject_fd;
+				FD_ZERO( &reject_fd );
+				FD_SET( i->m_Socket->GetSocket( ), &reject_fd );
+				i->m_Socket->PutBytes( m_GHost->m_GPSProtocol->SEND_GPSS_REJECT( REJECTGPS_NOTFOUND ) );
+				i->m_Socket->DoSend( &reject_fd );
+				delete i->m_Socket;
+			}
+		}
+
+		usecBlock = m_TimerWheel->GetNextExpiryTicks( usecBlock / 1000 ) * 1000;
+
+		if( !m_Reactor )
+		{
+			for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
+				NumFDs += (*i)->SetFD( &fd, &send_fd, &nfds );
+
+			if( m_Wakeup->SetFD( &fd, &nfds ) )
+				++NumFDs;
+		}
+	}
+
+	// always block for at least 1ms (see CGHost :: Update)
+
+	if( usecBlock < 1000 )
+		usecBlock = 1000;
+
+	// wait for something to happen
+	// note: we don't hold the worker's mutex here so the main thread can access our games while we're blocked
+
+	if( m_Reactor )
+	{
+#ifdef GHOST_EPOLL
+		m_Reactor->Wait( usecBlock );
+#endif
+	}
+	else if( NumFDs == 0 )
+	{
+		// select fails immediately on some platforms if there aren't any sockets
+
+		MILLISLEEP( usecBlock / 1000 );
+	}
+	else
+	{
+		struct timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = usecBlock;
+
+		struct timeval send_tv;
+		send_tv.tv_sec = 0;
+		send_tv.tv_usec = 0;
+
+#ifdef WIN32
+		select( 1, &fd, NULL, NULL, &tv );
+		select( 1, NULL, &send_fd, NULL, &send_tv );
+#else
+		select( nfds + 1, &fd, NULL, NULL, &tv );
+		select( nfds + 1, NULL, &send_fd, NULL, &send_tv );
+#endif
+
+		if( m_Wakeup->GetValid( ) && FD_ISSET( m_Wakeup->GetFD( ), &fd ) )
+			m_Wakeup->Clear( );
+	}
+
+	// update our games
+
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	m_TimerWheel->Update( );
+
+	for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); )
+	{
+		if( (*i)->Update( &fd, &send_fd ) )
+		{
+			// hand the game back to the main thread to be deleted
+			// the game's sockets and timers must be removed from our reactor and timer wheel first since they'll be deleted by the main thread
+
+			(*i)->SetReactor( NULL );
+			(*i)->SetTimerWheel( NULL );
+			CWorkerMessage Message( CWorkerMessage :: GAME_DELETED );
+			Message.m_Game = *i;
+			QueueMessage( Message );
+			i = m_Games.erase( i );
+		}
+		else
+		{
+			(*i)->UpdatePost( &send_fd );
+			++i;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,126 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#ifndef GAMEWORKER_H
+#define GAMEWORKER_H
+
+#include <boost/thread/mutex.hpp>
+
+//
+// CGameWorker
+//
+
+// a game worker is a thread with its own event loop which updates a subset of the running games
+// games are handed to a worker by the main thread when they start and handed back to the main thread to be deleted when they finish
+// while a game is owned by a worker it must only be accessed by the main thread after locking the worker (see CGHost :: LockGames)
+// anything a game needs to do on the main thread (e.g. queueing battle.net chat messages) is queued on the worker's message queue and processed by the main thread later
+
+class CTCPSocket;
+class CSocketReactor;
+class CWakeup;
+class CTimerWheel;
+class CBNET;
+class CBaseGame;
+
+namespace boost { class thread; }
+
+class CWorkerMessage
+{
+public:
+	enum MessageType {
+		BNET_CHATCOMMAND,			// queue a chat command on a battle.net connection
+		BNET_WHISPER,				// queue a whisper on a battle.net connection
+		BNET_ADDBAN,				// add a ban to a battle.net connection's ban list
+		BNET_UNQUEUECHATCOMMAND,	// remove a queued chat command from a battle.net connection
+		GAME_DELETED				// a game has finished and must be deleted by the main thread
+	};
+
+	MessageType m_Type;
+	CBNET *m_BNET;
+	CBaseGame *m_Game;
+	string m_Message;
+	string m_User;
+	string m_IP;
+	string m_GameName;
+	string m_Admin;
+	string m_Reason;
+
+	CWorkerMessage( MessageType nType ) : m_Type( nType ), m_BNET( NULL ), m_Game( NULL ) { }
+};
+
+class CWorkerReconnect
+{
+public:
+	CTCPSocket *m_Socket;		// the GProxy++ socket attempting to reconnect
+	unsigned char m_PID;
+	uint32_t m_ReconnectKey;
+	uint32_t m_LastPacket;
+
+	CWorkerReconnect( CTCPSocket *nSocket, unsigned char nPID, uint32_t nReconnectKey, uint32_t nLastPacket ) : m_Socket( nSocket ), m_PID( nPID ), m_ReconnectKey( nReconnectKey ), m_LastPacket( nLastPacket ) { }
+};
+
+class CGameWorker
+{
+public:
+	CGHost *m_GHost;
+
+private:
+	uint32_t m_WorkerID;						// the worker number (for display purposes)
+	CSocketReactor *m_Reactor;					// the reactor this worker's sockets are registered with (NULL when using select)
+	CWakeup *m_Wakeup;							// signalled when one of this worker's games has a callable complete or when a game is handed over
+	CTimerWheel *m_TimerWheel;					// the timer wheel this worker's games schedule their timers on
+	boost :: thread *m_Thread;					// the worker thread
+	boost :: mutex m_Mutex;						// held by the worker thread while updating its games
+	boost :: mutex m_QueueMutex;				// protects the queues below (never held while blocking so it can be locked by any thread at any time)
+	vector<CBaseGame *> m_Games;				// the games owned by this worker (only accessed by the worker thread or while holding m_Mutex)
+	vector<CBaseGame *> m_NewGames;				// games handed over by the main thread which haven't been picked up by the worker yet
+	vector<CWorkerReconnect> m_Reconnects;		// GProxy++ reconnects handed over by the main thread which haven't been picked up by the worker yet
+	vector<CWorkerMessage> m_Messages;			// messages queued by the worker for the main thread
+	uint32_t m_NumGames;						// the number of games handed to this worker which haven't been deleted yet (only accessed by the main thread)
+	bool m_Exiting;								// set to true to stop the worker thread (protected by m_QueueMutex)
+
+public:
+	CGameWorker( CGHost *nGHost, uint32_t nWorkerID );
+	~CGameWorker( );
+
+	uint32_t GetWorkerID( )			{ return m_WorkerID; }
+	CSocketReactor *GetReactor( )	{ return m_Reactor; }
+	uint32_t GetNumGames( )			{ return m_NumGames; }
+	bool GetRunning( )				{ return m_Thread != NULL; }
+
+	// functions called by the main thread
+
+	void Lock( )					{ m_Mutex.lock( ); }
+	void Unlock( )					{ m_Mutex.unlock( ); }
+	void AddGame( CBaseGame *game );
+	void AddReconnect( CTCPSocket *socket, unsigned char PID, uint32_t reconnectKey, uint32_t lastPacket );
+	void ProcessMessages( );
+	void Stop( );
+
+	// functions called by the worker thread
+
+	void QueueMessage( const CWorkerMessage &message );
+	void Run( );
+
+private:
+	bool Update( );
+};
+
+#endif
@@ -22,13 +22,13 @@
 #include "util.h"
 #include "crc32.h"
 #include "sha1.h"
-#include "csvparser.h"
 #include "config.h"
 #include "language.h"
 #include "socket.h"
 #include "ghostdb.h"
 #include "ghostdbsqlite.h"
 #include "ghostdbmysql.h"
+#include "ghostdbjournal.h"
 #include "bnet.h"
 #include "map.h"
 #include "packed.h"
@@ -39,6 +39,9 @@
 #include "game_base.h"
 #include "game.h"
 #include "game_admin.h"
+#include "gameworker.h"
+#include "accesscontrol.h"
+#include "iptocountry.h"
 
 #include <signal.h>
 #include <stdlib.h>
@@ -106,6 +109,7 @@ string gCFGFile;
 string gLogFile;
 uint32_t gLogMethod;
 ofstream *gLog = NULL;
+boost :: mutex gOutputMutex;		// serializes console and log output (game worker threads print too)
 CGHost *gGHost = NULL;
 
 uint32_t GetTime( )
@@ -170,6 +174,7 @@ void SignalCatcher( int s )
 
 void CONSOLE_Print( string message )
 {
+	boost :: mutex :: scoped_lock Lock( gOutputMutex );
 	cout << message << endl;
 
 	// logging
@@ -212,11 +217,13 @@ void CONSOLE_Print( string message )
 
 void DEBUG_Print( string message )
 {
+	boost :: mutex :: scoped_lock Lock( gOutputMutex );
 	cout << message << endl;
 }
 
 void DEBUG_Print( BYTEARRAY b )
 {
+	boost :: mutex :: scoped_lock Lock( gOutputMutex );
 	cout << "{ ";
 
         for( unsigned int i = 0; i < b.size( ); ++i )
@@ -364,6 +371,7 @@ int main( int argc, char **argv )
 	CONSOLE_Print( "[GHOST] shutting down" );
 	delete gGHost;
 	gGHost = NULL;
+	CONSOLE_Print( "[GHOST] " + CPacketBuffer :: GetStats( ) );
 
 #ifdef WIN32
 	// shutdown winsock
@@ -393,6 +401,38 @@ int main( int argc, char **argv )
 
 CGHost :: CGHost( CConfig *CFG )
 {
+#ifdef GHOST_EPOLL
+	// the socket reactor must be created before any sockets so they can register with it
+
+	gSocketReactor = new CSocketReactor( );
+
+	if( gSocketReactor->GetValid( ) )
+		CONSOLE_Print( "[GHOST] using epoll socket reactor" );
+	else
+	{
+		CONSOLE_Print( "[GHOST] unable to create epoll socket reactor, falling back to select" );
+		delete gSocketReactor;
+		gSocketReactor = NULL;
+	}
+#endif
+
+	// the timer wheel must be created before any games so they can schedule their timers on it
+
+	m_TimerWheel = new CTimerWheel( );
+
+	// the wakeup and our mailbox must be created before any battle.net connections or games so they can create their own mailboxes
+
+	m_Wakeup = new CWakeup( );
+	m_Mailbox = CCallableMailboxPtr( new CCallableMailbox( m_Wakeup ) );
+
+#ifdef GHOST_EPOLL
+	if( gSocketReactor )
+		gSocketReactor->RegisterWakeup( m_Wakeup );
+#endif
+
+	m_IPBlackList = new CIPBlackList( );
+	m_ScoreCache = new CScoreCache( );
+	m_ReplayCompressor = new CPackedCompressor( );
 	m_UDPSocket = new CUDPSocket( );
 	m_UDPSocket->SetBroadcastTarget( CFG->GetString( "udp_broadcasttarget", string( ) ) );
 	m_UDPSocket->SetDontRoute( CFG->GetInt( "udp_dontroute", 0 ) == 0 ? false : true );
@@ -400,6 +440,7 @@ CGHost :: CGHost( CConfig *CFG )
 	m_GPSProtocol = new CGPSProtocol( );
 	m_CRC = new CCRC32( );
 	m_CRC->Initialize( );
+	CONSOLE_Print( "[GHOST] using the " + m_CRC->GetEngineName( ) + " CRC32 engine" );
 	m_SHA = new CSHA1( );
 	m_CurrentGame = NULL;
 	string DBType = CFG->GetString( "db_type", "sqlite3" );
@@ -417,8 +458,10 @@ CGHost :: CGHost( CConfig *CFG )
 	else
 		m_DB = new CGHostDBSQLite( CFG );
 
-	CONSOLE_Print( "[GHOST] opening secondary (local) database" );
-	m_DBLocal = new CGHostDBSQLite( CFG );
+	// journal the database writes so they aren't lost if the database can't save them right away
+
+	if( !CFG->GetString( "db_journalpath", string( ) ).empty( ) )
+		m_DB = new CGHostDBJournal( CFG, m_DB, m_ScoreCache );
 
 	// get a list of local IP addresses
 	// this list is used elsewhere to determine if a player connecting to the bot is local or not
@@ -664,8 +707,10 @@ CGHost :: CGHost( CConfig *CFG )
 	m_SaveGame = new CSaveGame( );
 
 	// load the iptocountry data
+	// the ranges are kept in memory and cached in a binary file so we only have to parse the CSV file when it changes
 
-	LoadIPToCountryData( );
+	m_IPToCountry = new CIPToCountry( );
+	m_IPToCountry->Load( "ip-to-country.csv", "ip-to-country.bin" );
 
 	// create the admin game
 
@@ -683,6 +728,24 @@ CGHost :: CGHost( CConfig *CFG )
 	if( m_BNETs.empty( ) && !m_AdminGame )
 		CONSOLE_Print( "[GHOST] warning - no battle.net connections found and no admin game created" );
 
+	// create the game workers
+	// running games are handed to a worker thread when they start so the main thread only has to deal with battle.net and the lobby
+
+	uint32_t NumGameWorkers = CFG->GetInt( "bot_gameworkers", 0 );
+
+	for( uint32_t i = 1; i <= NumGameWorkers; ++i )
+	{
+		CGameWorker *Worker = new CGameWorker( this, i );
+
+		if( Worker->GetRunning( ) )
+			m_GameWorkers.push_back( Worker );
+		else
+			delete Worker;
+	}
+
+	if( !m_GameWorkers.empty( ) )
+		CONSOLE_Print( "[GHOST] updating running games with " + UTIL_ToString( m_GameWorkers.size( ) ) + " worker threads" );
+
 #ifdef GHOST_MYSQL
 	CONSOLE_Print( "[GHOST] GHost++ Version " + m_Version + " (with MySQL support)" );
 #else
@@ -692,6 +755,11 @@ CGHost :: CGHost( CConfig *CFG )
 
 CGHost :: ~CGHost( )
 {
+	// stop the game workers first since their games still reference our battle.net connections
+
+	for( vector<CGameWorker *> :: iterator i = m_GameWorkers.begin( ); i != m_GameWorkers.end( ); ++i )
+		(*i)->Stop( );
+
 	delete m_UDPSocket;
 	delete m_ReconnectSocket;
 
@@ -711,8 +779,15 @@ CGHost :: ~CGHost( )
         for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
 		delete *i;
 
+	// the games have been deleted (which also removed their sockets from the workers' reactors) so it's safe to delete the workers now
+
+	for( vector<CGameWorker *> :: iterator i = m_GameWorkers.begin( ); i != m_GameWorkers.end( ); ++i )
+		delete *i;
+
+	delete m_ReplayCompressor;
+
 	delete m_DB;
-	delete m_DBLocal;
+	delete m_IPToCountry;
 
 	// warning: we don't delete any entries of m_Callables here because we can't be guaranteed that the associated threads have terminated
 	// this is fine if the program is currently exiting because the OS will clean up after us
@@ -726,10 +801,29 @@ CGHost :: ~CGHost( )
 	delete m_AdminMap;
 	delete m_AutoHostMap;
 	delete m_SaveGame;
+	delete m_TimerWheel;
+	delete m_IPBlackList;
+	delete m_ScoreCache;
+
+#ifdef GHOST_EPOLL
+	// all the sockets have been closed by now so it's safe to delete the reactor
+
+	delete gSocketReactor;
+	gSocketReactor = NULL;
+#endif
+
+	// the orphaned callables might still complete and post to our mailbox so detach the wakeup before deleting it
+
+	m_Mailbox->SetWakeup( NULL );
+	delete m_Wakeup;
 }
 
 bool CGHost :: Update( long usecBlock )
 {
+	// any callables created while updating (other than by a battle.net connection or a game) are ours
+
+	CCallableMailboxScope MailboxScope( m_Mailbox.get( ) );
+
 	// todotodo: do we really want to shutdown if there's a database error? is there any way to recover from this?
 
 	if( m_DB->HasError( ) )
@@ -738,12 +832,6 @@ bool CGHost :: Update( long usecBlock )
 		return true;
 	}
 
-	if( m_DBLocal->HasError( ) )
-	{
-		CONSOLE_Print( "[GHOST] local database error - " + m_DBLocal->GetError( ) );
-		return true;
-	}
-
 	// try to exit nicely if requested to do so
 
 	if( m_ExitingNice )
@@ -752,10 +840,15 @@ bool CGHost :: Update( long usecBlock )
 		{
 			CONSOLE_Print( "[GHOST] deleting all battle.net connections in preparation for exiting nicely" );
 
+			// the games owned by the workers iterate over the battle.net connections so they must be locked while we delete them
+
+			LockGames( );
+
                         for( vector<CBNET *> :: iterator i = m_BNETs.begin( ); i != m_BNETs.end( ); ++i )
 				delete *i;
 
 			m_BNETs.clear( );
+			UnlockGames( );
 		}
 
 		if( m_CurrentGame )
@@ -799,17 +892,21 @@ bool CGHost :: Update( long usecBlock )
 	}
 
 	// update callables
+	// most orphaned callables were created by a battle.net connection or a game and still post to its mailbox so they're only guaranteed to be noticed by the once per second check
 
-	for( vector<CBaseCallable *> :: iterator i = m_Callables.begin( ); i != m_Callables.end( ); )
+	if( m_Mailbox->CheckCallables( ) )
 	{
-		if( (*i)->GetReady( ) )
+		for( vector<CBaseCallable *> :: iterator i = m_Callables.begin( ); i != m_Callables.end( ); )
 		{
-			m_DB->RecoverCallable( *i );
-			delete *i;
-			i = m_Callables.erase( i );
+			if( (*i)->GetReady( ) )
+			{
+				m_DB->RecoverCallable( *i );
+				delete *i;
+				i = m_Callables.erase( i );
+			}
+			else
+				++i;
 		}
-		else
-                        ++i;
 	}
 
 	// create the GProxy++ reconnect listener
@@ -839,96 +936,123 @@ bool CGHost :: Update( long usecBlock )
 		}
 	}
 
-	unsigned int NumFDs = 0;
+	// before we call select (or wait on the reactor) we need to determine how long to block for
+	// previously we just blocked for a maximum of the passed usecBlock microseconds
+	// however, in an effort to make game updates happen closer to the desired latency setting we now use a dynamic block interval
+	// every game schedules its timers (including the action timer) on our timer wheel so we simply block until the next timer expires
+	// note: games owned by a worker schedule their timers on the worker's timer wheel so they don't affect how long we block for
+	// note: we still use the passed usecBlock as a hard maximum
+
+	usecBlock = m_TimerWheel->GetNextExpiryTicks( usecBlock / 1000 ) * 1000;
+
+	// always block for at least 1ms just in case something goes wrong
+	// this prevents the bot from sucking up all the available CPU if a game keeps asking for immediate updates
+	// it's a bit ridiculous to include this check since, in theory, the bot is programmed well enough to never make this mistake
+	// however, considering who programmed it, it's worthwhile to do it anyway
 
-	// take every socket we own and throw it in one giant select statement so we can block on all sockets
+	if( usecBlock < 1000 )
+		usecBlock = 1000;
 
-	int nfds = 0;
 	fd_set fd;
 	fd_set send_fd;
 	FD_ZERO( &fd );
 	FD_ZERO( &send_fd );
 
-	// 1. all battle.net sockets
+#ifdef GHOST_EPOLL
+	if( gSocketReactor )
+	{
+		// every socket is registered with the reactor when it's created so there's no need to walk every object and build the fd sets
+		// the reactor marks the sockets as readable or writable and the normal update functions below take care of the rest
+		// note: the fd sets are still passed to the update functions below but they're ignored by sockets which are registered with the reactor
 
-        for( vector<CBNET *> :: iterator i = m_BNETs.begin( ); i != m_BNETs.end( ); ++i )
-		NumFDs += (*i)->SetFD( &fd, &send_fd, &nfds );
+		gSocketReactor->Wait( usecBlock );
+	}
+	else
+#endif
+	{
+		unsigned int NumFDs = 0;
 
-	// 2. the current game's server and player sockets
+		// take every socket we own and throw it in one giant select statement so we can block on all sockets
 
-	if( m_CurrentGame )
-		NumFDs += m_CurrentGame->SetFD( &fd, &send_fd, &nfds );
+		int nfds = 0;
 
-	// 3. the admin game's server and player sockets
+		// 1. all battle.net sockets
 
-	if( m_AdminGame )
-		NumFDs += m_AdminGame->SetFD( &fd, &send_fd, &nfds );
+		for( vector<CBNET *> :: iterator i = m_BNETs.begin( ); i != m_BNETs.end( ); ++i )
+			NumFDs += (*i)->SetFD( &fd, &send_fd, &nfds );
 
-	// 4. all running games' player sockets
+		// 2. the current game's server and player sockets
 
-        for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
-		NumFDs += (*i)->SetFD( &fd, &send_fd, &nfds );
+		if( m_CurrentGame )
+			NumFDs += m_CurrentGame->SetFD( &fd, &send_fd, &nfds );
 
-	// 5. the GProxy++ reconnect socket(s)
+		// 3. the admin game's server and player sockets
 
-	if( m_Reconnect && m_ReconnectSocket )
-	{
-		m_ReconnectSocket->SetFD( &fd, &send_fd, &nfds );
-                ++NumFDs;
-	}
+		if( m_AdminGame )
+			NumFDs += m_AdminGame->SetFD( &fd, &send_fd, &nfds );
 
-        for( vector<CTCPSocket *> :: iterator i = m_ReconnectSockets.begin( ); i != m_ReconnectSockets.end( ); ++i )
-	{
-		(*i)->SetFD( &fd, &send_fd, &nfds );
-                ++NumFDs;
-	}
+		// 4. all running games' player sockets (except for the games owned by a worker)
 
-	// before we call select we need to determine how long to block for
-	// previously we just blocked for a maximum of the passed usecBlock microseconds
-	// however, in an effort to make game updates happen closer to the desired latency setting we now use a dynamic block interval
-	// note: we still use the passed usecBlock as a hard maximum
+		for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
+		{
+			if( !(*i)->GetWorker( ) )
+				NumFDs += (*i)->SetFD( &fd, &send_fd, &nfds );
+		}
 
-        for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
-	{
-		if( (*i)->GetNextTimedActionTicks( ) * 1000 < usecBlock )
-			usecBlock = (*i)->GetNextTimedActionTicks( ) * 1000;
-	}
+		// 5. the GProxy++ reconnect socket(s)
 
-	// always block for at least 1ms just in case something goes wrong
-	// this prevents the bot from sucking up all the available CPU if a game keeps asking for immediate updates
-	// it's a bit ridiculous to include this check since, in theory, the bot is programmed well enough to never make this mistake
-	// however, considering who programmed it, it's worthwhile to do it anyway
+		if( m_Reconnect && m_ReconnectSocket )
+		{
+			m_ReconnectSocket->SetFD( &fd, &send_fd, &nfds );
+			++NumFDs;
+		}
 
-	if( usecBlock < 1000 )
-		usecBlock = 1000;
+		for( vector<CTCPSocket *> :: iterator i = m_ReconnectSockets.begin( ); i != m_ReconnectSockets.end( ); ++i )
+		{
+			(*i)->SetFD( &fd, &send_fd, &nfds );
+			++NumFDs;
+		}
+
+		// 6. the wakeup which is signalled when a callable completes
+
+		if( m_Wakeup->SetFD( &fd, &nfds ) )
+			++NumFDs;
 
-	struct timeval tv;
-	tv.tv_sec = 0;
-	tv.tv_usec = usecBlock;
+		struct timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = usecBlock;
 
-	struct timeval send_tv;
-	send_tv.tv_sec = 0;
-	send_tv.tv_usec = 0;
+		struct timeval send_tv;
+		send_tv.tv_sec = 0;
+		send_tv.tv_usec = 0;
 
 #ifdef WIN32
-	select( 1, &fd, NULL, NULL, &tv );
-	select( 1, NULL, &send_fd, NULL, &send_tv );
+		select( 1, &fd, NULL, NULL, &tv );
+		select( 1, NULL, &send_fd, NULL, &send_tv );
 #else
-	select( nfds + 1, &fd, NULL, NULL, &tv );
-	select( nfds + 1, NULL, &send_fd, NULL, &send_tv );
+		select( nfds + 1, &fd, NULL, NULL, &tv );
+		select( nfds + 1, NULL, &send_fd, NULL, &send_tv );
 #endif
 
-	if( NumFDs == 0 )
-	{
-		// we don't have any sockets (i.e. we aren't connected to battle.net maybe due to a lost connection and there aren't any games running)
-		// select will return immediately and we'll chew up the CPU if we let it loop so just sleep for 50ms to kill some time
+		if( m_Wakeup->GetValid( ) && FD_ISSET( m_Wakeup->GetFD( ), &fd ) )
+			m_Wakeup->Clear( );
+
+		if( NumFDs == 0 )
+		{
+			// we don't have any sockets (i.e. we aren't connected to battle.net maybe due to a lost connection and there aren't any games running)
+			// select will return immediately and we'll chew up the CPU if we let it loop so just sleep for 50ms to kill some time
 
-		MILLISLEEP( 50 );
+			MILLISLEEP( 50 );
+		}
 	}
 
 	bool AdminExit = false;
 	bool BNETExit = false;
 
+	// expire any timers which are due before updating the games
+
+	m_TimerWheel->Update( );
+
 	// update current game
 
 	if( m_CurrentGame )
@@ -965,9 +1089,40 @@ bool CGHost :: Update( long usecBlock )
 	}
 
 	// update running games
+	// games owned by a worker are updated by the worker so we only have to process the messages it queued for us (this is also where finished games are deleted)
+
+	for( vector<CGameWorker *> :: iterator i = m_GameWorkers.begin( ); i != m_GameWorkers.end( ); ++i )
+		(*i)->ProcessMessages( );
 
 	for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); )
 	{
+		if( (*i)->GetWorker( ) )
+		{
+			++i;
+			continue;
+		}
+
+		if( !m_GameWorkers.empty( ) )
+		{
+			// hand the game over to the worker with the fewest games
+			// the game's sockets and timers must be removed from our reactor and timer wheel before the worker adds them to its own
+
+			CGameWorker *Worker = m_GameWorkers[0];
+
+			for( vector<CGameWorker *> :: iterator j = m_GameWorkers.begin( ); j != m_GameWorkers.end( ); ++j )
+			{
+				if( (*j)->GetNumGames( ) < Worker->GetNumGames( ) )
+					Worker = *j;
+			}
+
+			CONSOLE_Print( "[GHOST] handing game [" + (*i)->GetGameName( ) + "] over to worker " + UTIL_ToString( Worker->GetWorkerID( ) ) );
+			(*i)->SetReactor( NULL );
+			(*i)->SetTimerWheel( NULL );
+			Worker->AddGame( *i );
+			++i;
+			continue;
+		}
+
 		if( (*i)->Update( &fd, &send_fd ) )
 		{
 			CONSOLE_Print( "[GHOST] deleting game [" + (*i)->GetGameName( ) + "]" );
@@ -1010,32 +1165,37 @@ bool CGHost :: Update( long usecBlock )
 		}
 
 		(*i)->DoRecv( &fd );
-		string *RecvBuffer = (*i)->GetBytes( );
-		BYTEARRAY Bytes = UTIL_CreateByteArray( (unsigned char *)RecvBuffer->c_str( ), RecvBuffer->size( ) );
+		CRecvBuffer *RecvBuffer = (*i)->GetBytes( );
 
 		// a packet is at least 4 bytes
 
-		if( Bytes.size( ) >= 4 )
+		if( RecvBuffer->GetSize( ) >= 4 )
 		{
+			const unsigned char *Bytes = RecvBuffer->GetData( );
+
 			if( Bytes[0] == GPS_HEADER_CONSTANT )
 			{
-				// bytes 2 and 3 contain the length of the packet
+				// bytes 2 and 3 contain the length of the packet, a length of 0 means we haven't received the whole packet yet
 
-				uint16_t Length = UTIL_ByteArrayToUInt16( Bytes, false, 2 );
+				int32_t Length = RecvBuffer->FramePacket( 2, 4 );
 
-				if( Length >= 4 )
+				if( Length >= 0 )
 				{
-					if( Bytes.size( ) >= Length )
+					if( Length > 0 )
 					{
 						if( Bytes[1] == CGPSProtocol :: GPS_RECONNECT && Length == 13 )
 						{
-							unsigned char PID = Bytes[4];
-							uint32_t ReconnectKey = UTIL_ByteArrayToUInt32( Bytes, false, 5 );
-							uint32_t LastPacket = UTIL_ByteArrayToUInt32( Bytes, false, 9 );
+							BYTEARRAY Packet = BYTEARRAY( Bytes, Bytes + Length );
+							unsigned char PID = Packet[4];
+							uint32_t ReconnectKey = UTIL_ByteArrayToUInt32( Packet, false, 5 );
+							uint32_t LastPacket = UTIL_ByteArrayToUInt32( Packet, false, 9 );
 
 							// look for a matching player in a running game
 
 							CGamePlayer *Match = NULL;
+							CGameWorker *MatchWorker = NULL;
+
+							LockGames( );
 
                                                         for( vector<CBaseGame *> :: iterator j = m_Games.begin( ); j != m_Games.end( ); ++j )
 							{
@@ -1046,16 +1206,30 @@ bool CGHost :: Update( long usecBlock )
 									if( Player && Player->GetGProxy( ) && Player->GetGProxyReconnectKey( ) == ReconnectKey )
 									{
 										Match = Player;
+										MatchWorker = (*j)->GetWorker( );
 										break;
 									}
 								}
 							}
 
-							if( Match )
+							UnlockGames( );
+
+							if( Match && MatchWorker )
+							{
+								// the game is owned by a worker so hand the socket over to the worker to complete the reconnect
+								// the worker looks for the player again since the player might leave before the worker gets to it
+
+								RecvBuffer->Consume( Length );
+								(*i)->SetReactor( NULL );
+								MatchWorker->AddReconnect( *i, PID, ReconnectKey, LastPacket );
+								i = m_ReconnectSockets.erase( i );
+								continue;
+							}
+							else if( Match )
 							{
 								// reconnect successful!
 
-								*RecvBuffer = RecvBuffer->substr( Length );
+								RecvBuffer->Consume( Length );
 								Match->EventGProxyReconnect( *i, LastPacket );
 								i = m_ReconnectSockets.erase( i );
 								continue;
@@ -1267,8 +1441,12 @@ void CGHost :: EventBNETWhisper( CBNET *bnet, string user, string message )
 		if( m_CurrentGame )
 			m_CurrentGame->SendLocalAdminChat( "[W: " + bnet->GetServerAlias( ) + "] [" + user + "] " + message );
 
+		LockGames( );
+
                 for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
 			(*i)->SendLocalAdminChat( "[W: " + bnet->GetServerAlias( ) + "] [" + user + "] " + message );
+
+		UnlockGames( );
 	}
 }
 
@@ -1281,8 +1459,12 @@ void CGHost :: EventBNETChat( CBNET *bnet, string user, string message )
 		if( m_CurrentGame )
 			m_CurrentGame->SendLocalAdminChat( "[L: " + bnet->GetServerAlias( ) + "] [" + user + "] " + message );
 
+		LockGames( );
+
                 for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
 			(*i)->SendLocalAdminChat( "[L: " + bnet->GetServerAlias( ) + "] [" + user + "] " + message );
+
+		UnlockGames( );
 	}
 }
 
@@ -1295,8 +1477,12 @@ void CGHost :: EventBNETEmote( CBNET *bnet, string user, string message )
 		if( m_CurrentGame )
 			m_CurrentGame->SendLocalAdminChat( "[E: " + bnet->GetServerAlias( ) + "] [" + user + "] " + message );
 
+		LockGames( );
+
                 for( vector<CBaseGame *> :: iterator i = m_Games.begin( ); i != m_Games.end( ); ++i )
 			(*i)->SendLocalAdminChat( "[E: " + bnet->GetServerAlias( ) + "] [" + user + "] " + message );
+
+		UnlockGames( );
 	}
 }
 
@@ -1316,7 +1502,12 @@ void CGHost :: ReloadConfigs( )
 	CConfig CFG;
 	CFG.Read( "default.cfg" );
 	CFG.Read( gCFGFile );
+
+	// the games owned by the workers read the config values while updating so they must be locked while we change them
+
+	LockGames( );
 	SetConfigs( &CFG );
+	UnlockGames( );
 }
 
 void CGHost :: SetConfigs( CConfig *CFG )
@@ -1342,6 +1533,15 @@ void CGHost :: SetConfigs( CConfig *CFG )
 	m_MapPath = UTIL_AddPathSeperator( CFG->GetString( "bot_mappath", string( ) ) );
 	m_SaveReplays = CFG->GetInt( "bot_savereplays", 0 ) == 0 ? false : true;
 	m_ReplayPath = UTIL_AddPathSeperator( CFG->GetString( "bot_replaypath", string( ) ) );
+	m_ReplayCompressionLevel = CFG->GetInt( "bot_replaycompressionlevel", 6 );
+
+	if( m_ReplayCompressionLevel < 1 || m_ReplayCompressionLevel > 9 )
+	{
+		m_ReplayCompressionLevel = 6;
+		CONSOLE_Print( "[GHOST] warning - bot_replaycompressionlevel is not between 1 and 9, using default compression level" );
+	}
+
+	m_ReplayCompressor->SetCompressionLevel( m_ReplayCompressionLevel );
 	m_VirtualHostName = CFG->GetString( "bot_virtualhostname", "|cFF4080C0GHost" );
 	m_HideIPAddresses = CFG->GetInt( "bot_hideipaddresses", 0 ) == 0 ? false : true;
 	m_CheckMultipleIPUsage = CFG->GetInt( "bot_checkmultipleipusage", 1 ) == 0 ? false : true;
@@ -1384,6 +1584,9 @@ void CGHost :: SetConfigs( CConfig *CFG )
 	m_LocalAdminMessages = CFG->GetInt( "bot_localadminmessages", 1 ) == 0 ? false : true;
 	m_TCPNoDelay = CFG->GetInt( "tcp_nodelay", 0 ) == 0 ? false : true;
 	m_MatchMakingMethod = CFG->GetInt( "bot_matchmakingmethod", 1 );
+	m_MatchMakingCacheSize = CFG->GetInt( "bot_matchmakingcachesize", 5000 );
+	m_MatchMakingCacheTime = CFG->GetInt( "bot_matchmakingcachetime", 600 );
+	m_ScoreCache->SetLimits( m_MatchMakingCacheSize, m_MatchMakingCacheTime );
 	m_MapGameType = CFG->GetUInt( "bot_mapgametype", 0 );
 }
 
@@ -1457,73 +1660,6 @@ void CGHost :: ExtractScripts( )
 		CONSOLE_Print( "[GHOST] warning - unable to load MPQ file [" + PatchMPQFileName + "] - error code " + UTIL_ToString( GetLastError( ) ) );
 }
 
-void CGHost :: LoadIPToCountryData( )
-{
-	ifstream in;
-	in.open( "ip-to-country.csv" );
-
-	if( in.fail( ) )
-		CONSOLE_Print( "[GHOST] warning - unable to read file [ip-to-country.csv], iptocountry data not loaded" );
-	else
-	{
-		CONSOLE_Print( "[GHOST] started loading [ip-to-country.csv]" );
-
-		// the begin and commit statements are optimizations
-		// we're about to insert ~4 MB of data into the database so if we allow the database to treat each insert as a transaction it will take a LONG time
-		// todotodo: handle begin/commit failures a bit more gracefully
-
-		if( !m_DBLocal->Begin( ) )
-			CONSOLE_Print( "[GHOST] warning - failed to begin local database transaction, iptocountry data not loaded" );
-		else
-		{
-			unsigned char Percent = 0;
-			string Line;
-			string IP1;
-			string IP2;
-			string Country;
-			CSVParser parser;
-
-			// get length of file for the progress meter
-
-			in.seekg( 0, ios :: end );
-			uint32_t FileLength = in.tellg( );
-			in.seekg( 0, ios :: beg );
-
-			while( !in.eof( ) )
-			{
-				getline( in, Line );
-
-				if( Line.empty( ) )
-					continue;
-
-				parser << Line;
-				parser >> IP1;
-				parser >> IP2;
-				parser >> Country;
-				m_DBLocal->FromAdd( UTIL_ToUInt32( IP1 ), UTIL_ToUInt32( IP2 ), Country );
-
-				// it's probably going to take awhile to load the iptocountry data (~10 seconds on my 3.2 GHz P4 when using SQLite3)
-				// so let's print a progress meter just to keep the user from getting worried
-
-				unsigned char NewPercent = (unsigned char)( (float)in.tellg( ) / FileLength * 100 );
-
-				if( NewPercent != Percent && NewPercent % 10 == 0 )
-				{
-					Percent = NewPercent;
-					CONSOLE_Print( "[GHOST] iptocountry data: " + UTIL_ToString( Percent ) + "% loaded" );
-				}
-			}
-
-			if( !m_DBLocal->Commit( ) )
-				CONSOLE_Print( "[GHOST] warning - failed to commit local database transaction, iptocountry data not loaded" );
-			else
-				CONSOLE_Print( "[GHOST] finished loading [ip-to-country.csv]" );
-		}
-
-		in.close( );
-	}
-}
-
 void CGHost :: CreateGame( CMap *map, unsigned char gameState, bool saveGame, string gameName, string ownerName, string creatorName, string creatorServer, bool whisper )
 {
 	if( !m_Enabled )
@@ -1722,3 +1858,18 @@ void CGHost :: CreateGame( CMap *map, unsigned char gameState, bool saveGame, st
 			(*i)->HoldClan( m_CurrentGame );
 	}
 }
+
+void CGHost :: LockGames( )
+{
+	// lock every game worker so the games in progress can be safely accessed by the main thread
+	// the workers are always locked in the same order and they never lock each other so this can't deadlock
+
+	for( vector<CGameWorker *> :: iterator i = m_GameWorkers.begin( ); i != m_GameWorkers.end( ); ++i )
+		(*i)->Lock( );
+}
+
+void CGHost :: UnlockGames( )
+{
+	for( vector<CGameWorker *> :: reverse_iterator i = m_GameWorkers.rbegin( ); i != m_GameWorkers.rend( ); ++i )
+		(*i)->Unlock( );
+}
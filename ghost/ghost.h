@@ -23,6 +23,8 @@
 
 #include "includes.h"
 
+#include <boost/shared_ptr.hpp>
+
 //
 // CGHost
 //
@@ -38,10 +40,18 @@ class CBaseGame;
 class CAdminGame;
 class CGHostDB;
 class CBaseCallable;
+class CCallableMailbox;
 class CLanguage;
 class CMap;
 class CSaveGame;
 class CConfig;
+class CGameWorker;
+class CTimerWheel;
+class CWakeup;
+class CIPBlackList;
+class CIPToCountry;
+class CScoreCache;
+class CPackedCompressor;
 
 class CGHost
 {
@@ -56,9 +66,16 @@ public:
 	CBaseGame *m_CurrentGame;				// this game is still in the lobby state
 	CAdminGame *m_AdminGame;				// this "fake game" allows an admin who knows the password to control the bot from the local network
 	vector<CBaseGame *> m_Games;			// these games are in progress
+	vector<CGameWorker *> m_GameWorkers;	// worker threads which update the games in progress (empty if they're updated by the main thread)
+	CTimerWheel *m_TimerWheel;				// the timers of the games updated by the main thread
 	CGHostDB *m_DB;							// database
-	CGHostDB *m_DBLocal;					// local database (for temporary data)
+	CIPToCountry *m_IPToCountry;			// the iptocountry data
+	CScoreCache *m_ScoreCache;				// the matchmaking scores of the players who joined recently
+	CPackedCompressor *m_ReplayCompressor;	// compresses the replays of the games in progress in the background
 	vector<CBaseCallable *> m_Callables;	// vector of orphaned callables waiting to die
+	CWakeup *m_Wakeup;						// signalled when a callable owned by the main thread completes
+	CIPBlackList *m_IPBlackList;			// the IP blacklist shared by every game (loaded from m_IPBlackListFile)
+	boost :: shared_ptr<CCallableMailbox> m_Mailbox;	// the mailbox of the callables created by the main thread outside of a battle.net connection or game
 	vector<BYTEARRAY> m_LocalAddresses;		// vector of local IP addresses
 	CLanguage *m_Language;					// language
 	CMap *m_Map;							// the currently loaded map
@@ -97,6 +114,7 @@ public:
 	string m_MapPath;						// config value: map path
 	bool m_SaveReplays;						// config value: save replays
 	string m_ReplayPath;					// config value: replay path
+	int m_ReplayCompressionLevel;			// config value: the zlib compression level to save replays with
 	string m_VirtualHostName;				// config value: virtual host name
 	bool m_HideIPAddresses;					// config value: hide IP addresses from players
 	bool m_CheckMultipleIPUsage;			// config value: check for multiple IP address usage
@@ -133,6 +151,8 @@ public:
 	uint32_t m_ReplayBuildNumber;			// config value: replay build number (for saving replays)
 	bool m_TCPNoDelay;						// config value: use Nagle's algorithm or not
 	uint32_t m_MatchMakingMethod;			// config value: the matchmaking method
+	uint32_t m_MatchMakingCacheSize;		// config value: the maximum number of cached matchmaking scores
+	uint32_t m_MatchMakingCacheTime;		// config value: the number of seconds to cache a matchmaking score for
 	uint32_t m_MapGameType;                 // config value: the MapGameType overwrite (aka: refresh hack)
 
 	CGHost( CConfig *CFG );
@@ -161,8 +181,9 @@ public:
 	void ReloadConfigs( );
 	void SetConfigs( CConfig *CFG );
 	void ExtractScripts( );
-	void LoadIPToCountryData( );
 	void CreateGame( CMap *map, unsigned char gameState, bool saveGame, string gameName, string ownerName, string creatorName, string creatorServer, bool whisper );
+	void LockGames( );
+	void UnlockGames( );
 };
 
 #endif
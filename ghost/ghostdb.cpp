@@ -21,8 +21,11 @@
 #include "ghost.h"
 #include "util.h"
 #include "config.h"
+#include "socket.h"
 #include "ghostdb.h"
 
+#include <boost/thread/tss.hpp>
+
 //
 // CGHostDB
 //
@@ -147,16 +150,6 @@ CDBDotAPlayerSummary *CGHostDB :: DotAPlayerSummaryCheck( string name )
 	return NULL;
 }
 
-string CGHostDB :: FromCheck( uint32_t ip )
-{
-	return "??";
-}
-
-bool CGHostDB :: FromAdd( uint32_t ip1, uint32_t ip2, string country )
-{
-	return false;
-}
-
 bool CGHostDB :: DownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
 {
 	return false;
@@ -182,6 +175,11 @@ bool CGHostDB :: W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings )
 	return false;
 }
 
+uint32_t CGHostDB :: GameDataAdd( CDBGameData *gamedata )
+{
+	return 0;
+}
+
 void CGHostDB :: CreateThread( CBaseCallable *callable )
 {
 	callable->SetReady( true );
@@ -277,7 +275,7 @@ CCallableDownloadAdd *CGHostDB :: ThreadedDownloadAdd( string map, uint32_t maps
 	return NULL;
 }
 
-CCallableScoreCheck *CGHostDB :: ThreadedScoreCheck( string category, string name, string server )
+CCallableScoreCheck *CGHostDB :: ThreadedScoreCheck( string category, vector<string> names, vector<string> servers )
 {
 	return NULL;
 }
@@ -302,10 +300,225 @@ CCallableW3MMDVarAdd *CGHostDB :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP
 	return NULL;
 }
 
+CCallableGameDataAdd *CGHostDB :: ThreadedGameDataAdd( CDBGameData *gamedata )
+{
+	return NULL;
+}
+
+//
+// CScoreCache
+//
+
+CScoreCache :: CScoreCache( ) : m_MaxSize( 0 ), m_MaxAge( 0 ), m_Hits( 0 ), m_Misses( 0 )
+{
+
+}
+
+CScoreCache :: ~CScoreCache( )
+{
+
+}
+
+uint32_t CScoreCache :: GetNumScores( )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	return m_Index.size( );
+}
+
+void CScoreCache :: SetLimits( uint32_t maxSize, uint32_t maxAge )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	m_MaxSize = maxSize;
+	m_MaxAge = maxAge;
+	Trim( );
+}
+
+bool CScoreCache :: Get( string category, string name, string server, double *score )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+	if( m_MaxSize == 0 )
+		return false;
+
+	boost :: unordered_map<string, ScoreCacheList :: iterator> :: iterator i = m_Index.find( GetKey( category, name, server ) );
+
+	if( i == m_Index.end( ) )
+	{
+		++m_Misses;
+		return false;
+	}
+
+	if( GetTime( ) - i->second->m_Time >= m_MaxAge )
+	{
+		m_Entries.erase( i->second );
+		m_Index.erase( i );
+		++m_Misses;
+		return false;
+	}
+
+	// move the score to the front of the list since it's now the most recently used
+
+	m_Entries.splice( m_Entries.begin( ), m_Entries, i->second );
+	*score = i->second->m_Score;
+	++m_Hits;
+	return true;
+}
+
+void CScoreCache :: Put( string category, string name, string server, double score )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+	if( m_MaxSize == 0 )
+		return;
+
+	string Key = GetKey( category, name, server );
+	boost :: unordered_map<string, ScoreCacheList :: iterator> :: iterator i = m_Index.find( Key );
+
+	if( i != m_Index.end( ) )
+	{
+		i->second->m_Score = score;
+		i->second->m_Time = GetTime( );
+		m_Entries.splice( m_Entries.begin( ), m_Entries, i->second );
+		return;
+	}
+
+	CScoreCacheEntry Entry;
+	Entry.m_Key = Key;
+	Entry.m_Score = score;
+	Entry.m_Time = GetTime( );
+	m_Entries.push_front( Entry );
+	m_Index[Key] = m_Entries.begin( );
+	Trim( );
+}
+
+void CScoreCache :: Invalidate( string category, string name, string server )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	boost :: unordered_map<string, ScoreCacheList :: iterator> :: iterator i = m_Index.find( GetKey( category, name, server ) );
+
+	if( i != m_Index.end( ) )
+	{
+		m_Entries.erase( i->second );
+		m_Index.erase( i );
+	}
+}
+
+void CScoreCache :: Clear( )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	m_Entries.clear( );
+	m_Index.clear( );
+}
+
+string CScoreCache :: GetKey( string category, string name, string server )
+{
+	// the database compares names and servers case insensitively so we do the same
+
+	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
+	transform( server.begin( ), server.end( ), server.begin( ), (int(*)(int))tolower );
+	return category + '\n' + name + '\n' + server;
+}
+
+void CScoreCache :: Trim( )
+{
+	// the caller must hold the mutex
+
+	while( m_Index.size( ) > m_MaxSize )
+	{
+		m_Index.erase( m_Entries.back( ).m_Key );
+		m_Entries.pop_back( );
+	}
+}
+
+//
+// CCallableMailbox
+//
+
+// the current mailbox is only borrowed by the thread (the owner keeps it alive) so there's nothing to clean up when the thread exits
+
+static void NoCleanup( CCallableMailbox *mailbox )
+{
+
+}
+
+static boost :: thread_specific_ptr<CCallableMailbox> gCurrentMailbox( NoCleanup );
+
+CCallableMailbox :: CCallableMailbox( CWakeup *nWakeup ) : m_Wakeup( nWakeup ), m_NumPosted( 0 ), m_LastCheckTicks( GetTicks( ) )
+{
+
+}
+
+CCallableMailbox :: ~CCallableMailbox( )
+{
+
+}
+
+void CCallableMailbox :: SetWakeup( CWakeup *nWakeup )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	m_Wakeup = nWakeup;
+}
+
+void CCallableMailbox :: Post( )
+{
+	// this is called by the database threads
+
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	++m_NumPosted;
+
+	if( m_Wakeup )
+		m_Wakeup->Signal( );
+}
+
+bool CCallableMailbox :: CheckCallables( )
+{
+	// returns true if the owner should walk its pending callables
+	// that's whenever one of its callables has completed and also once per second just in case a callable was created while another mailbox was current
+
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+	if( m_NumPosted == 0 && GetTicks( ) - m_LastCheckTicks < 1000 )
+		return false;
+
+	m_NumPosted = 0;
+	m_LastCheckTicks = GetTicks( );
+	return true;
+}
+
+CCallableMailbox *CCallableMailbox :: GetCurrent( )
+{
+	return gCurrentMailbox.get( );
+}
+
+void CCallableMailbox :: SetCurrent( CCallableMailbox *mailbox )
+{
+	gCurrentMailbox.reset( mailbox );
+}
+
+CCallableMailboxScope :: CCallableMailboxScope( CCallableMailbox *mailbox ) : m_Previous( CCallableMailbox :: GetCurrent( ) )
+{
+	CCallableMailbox :: SetCurrent( mailbox );
+}
+
+CCallableMailboxScope :: ~CCallableMailboxScope( )
+{
+	CCallableMailbox :: SetCurrent( m_Previous );
+}
+
 //
 // Callables
 //
 
+CBaseCallable :: CBaseCallable( ) : m_Error( ), m_Ready( false ), m_StartTicks( 0 ), m_EndTicks( 0 )
+{
+	// callables are always created by the thread which waits on them so we post to whichever mailbox is current on this thread
+
+	CCallableMailbox *Mailbox = CCallableMailbox :: GetCurrent( );
+
+	if( Mailbox )
+		m_Mailbox = Mailbox->shared_from_this( );
+}
+
 void CBaseCallable :: Init( )
 {
 	m_StartTicks = GetTicks( );
@@ -314,7 +527,18 @@ void CBaseCallable :: Init( )
 void CBaseCallable :: Close( )
 {
 	m_EndTicks = GetTicks( );
-	m_Ready = true;
+	SetReady( true );
+}
+
+void CBaseCallable :: SetReady( bool nReady )
+{
+	// the owner may delete us as soon as m_Ready is set so we take our own reference to the mailbox first
+
+	CCallableMailboxPtr Mailbox = m_Mailbox;
+	m_Ready = nReady;
+
+	if( nReady && Mailbox )
+		Mailbox->Post( );
 }
 
 CCallableAdminCount :: ~CCallableAdminCount( )
@@ -417,6 +641,11 @@ CCallableW3MMDVarAdd :: ~CCallableW3MMDVarAdd( )
 
 }
 
+CCallableGameDataAdd :: ~CCallableGameDataAdd( )
+{
+	delete m_GameData;
+}
+
 //
 // CDBBan
 //
@@ -541,3 +770,31 @@ CDBDotAPlayerSummary :: ~CDBDotAPlayerSummary( )
 {
 
 }
+
+//
+// CDBW3MMDPlayer
+//
+
+CDBW3MMDPlayer :: CDBW3MMDPlayer( uint32_t nPID, string nName, string nFlag, uint32_t nLeaver, uint32_t nPracticing ) : m_PID( nPID ), m_Name( nName ), m_Flag( nFlag ), m_Leaver( nLeaver ), m_Practicing( nPracticing )
+{
+
+}
+
+CDBW3MMDPlayer :: ~CDBW3MMDPlayer( )
+{
+
+}
+
+//
+// CDBGameData
+//
+
+CDBGameData :: CDBGameData( string nServer, string nMap, string nGameName, string nOwnerName, uint32_t nDuration, uint32_t nGameState, string nCreatorName, string nCreatorServer ) : m_Server( nServer ), m_Map( nMap ), m_GameName( nGameName ), m_OwnerName( nOwnerName ), m_Duration( nDuration ), m_GameState( nGameState ), m_CreatorName( nCreatorName ), m_CreatorServer( nCreatorServer ), m_DotA( false ), m_DotAWinner( 0 ), m_DotAMin( 0 ), m_DotASec( 0 )
+{
+
+}
+
+CDBGameData :: ~CDBGameData( )
+{
+
+}
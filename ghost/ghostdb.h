@@ -21,10 +21,17 @@
 #ifndef GHOSTDB_H
 #define GHOSTDB_H
 
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
 //
 // CGHostDB
 //
 
+class CWakeup;
+class CCallableMailbox;
 class CBaseCallable;
 class CCallableAdminCount;
 class CCallableAdminCheck;
@@ -46,11 +53,13 @@ class CCallableDownloadAdd;
 class CCallableScoreCheck;
 class CCallableW3MMDPlayerAdd;
 class CCallableW3MMDVarAdd;
+class CCallableGameDataAdd;
 class CDBBan;
 class CDBGame;
 class CDBGamePlayer;
 class CDBGamePlayerSummary;
 class CDBDotAPlayerSummary;
+class CDBGameData;
 
 typedef pair<uint32_t,string> VarP;
 
@@ -93,13 +102,12 @@ public:
 	virtual uint32_t DotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills );
 	virtual uint32_t DotAPlayerCount( string name );
 	virtual CDBDotAPlayerSummary *DotAPlayerSummaryCheck( string name );
-	virtual string FromCheck( uint32_t ip );
-	virtual bool FromAdd( uint32_t ip1, uint32_t ip2, string country );
 	virtual bool DownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime );
 	virtual uint32_t W3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing );
 	virtual bool W3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints );
 	virtual bool W3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals );
 	virtual bool W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings );
+	virtual uint32_t GameDataAdd( CDBGameData *gamedata );
 
 	// threaded database functions
 
@@ -122,11 +130,60 @@ public:
 	virtual CCallableDotAPlayerAdd *ThreadedDotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills );
 	virtual CCallableDotAPlayerSummaryCheck *ThreadedDotAPlayerSummaryCheck( string name );
 	virtual CCallableDownloadAdd *ThreadedDownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime );
-	virtual CCallableScoreCheck *ThreadedScoreCheck( string category, string name, string server );
+	virtual CCallableScoreCheck *ThreadedScoreCheck( string category, vector<string> names, vector<string> servers );
 	virtual CCallableW3MMDPlayerAdd *ThreadedW3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing );
 	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints );
 	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals );
 	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings );
+	virtual CCallableGameDataAdd *ThreadedGameDataAdd( CDBGameData *gamedata );
+};
+
+//
+// CScoreCache
+//
+
+// the matchmaking scores of the players who joined recently, shared by every game so autohosted lobbies don't look up the same players over and over
+// the least recently used score is dropped when the cache is full and scores older than the maximum age are looked up again
+// the maximum age is needed because the scores are usually updated by another program (e.g. update_dota_elo) which can't tell us when it's done
+// when the database rates each game as it's saved (db_mysql_updatescores) the games put the new scores in the cache themselves
+
+class CScoreCache
+{
+private:
+	struct CScoreCacheEntry
+	{
+		string m_Key;
+		double m_Score;
+		uint32_t m_Time;
+	};
+
+	typedef list<CScoreCacheEntry> ScoreCacheList;
+
+	boost :: mutex m_Mutex;											// the cache is used by the games on every game worker thread
+	ScoreCacheList m_Entries;										// the cached scores, the most recently used first
+	boost :: unordered_map<string, ScoreCacheList :: iterator> m_Index;	// the cached scores keyed by category, name and server
+	uint32_t m_MaxSize;												// the maximum number of cached scores (zero disables the cache)
+	uint32_t m_MaxAge;												// the number of seconds a score is cached for
+	uint32_t m_Hits;
+	uint32_t m_Misses;
+
+public:
+	CScoreCache( );
+	~CScoreCache( );
+
+	uint32_t GetNumScores( );
+	uint32_t GetHits( )		{ return m_Hits; }
+	uint32_t GetMisses( )	{ return m_Misses; }
+
+	void SetLimits( uint32_t maxSize, uint32_t maxAge );
+	bool Get( string category, string name, string server, double *score );
+	void Put( string category, string name, string server, double score );
+	void Invalidate( string category, string name, string server );
+	void Clear( );
+
+private:
+	static string GetKey( string category, string name, string server );
+	void Trim( );
 };
 
 //
@@ -152,6 +209,53 @@ public:
 //  - you should deliver any to-be-orphaned callables to the main vector in CGHost so they can be properly deleted when ready even if you don't care about the result anymore
 //  - e.g. if a player does a stats check immediately before a game is deleted you can't just delete the callable on game deletion unless it's ready
 
+//
+// CCallableMailbox
+//
+
+// every object which waits on callables (the bot itself, each battle.net connection and each game) owns a mailbox
+// a callable remembers the mailbox which was current on the thread that created it (see CCallableMailboxScope) and posts to it when it completes
+// posting signals the owner's wakeup so the owner's thread stops blocking right away, the owner only walks its pending callables after something was posted
+// the mailbox is reference counted because a callable can outlive its owner (e.g. when it's orphaned in CGHost :: m_Callables)
+
+class CCallableMailbox : public boost :: enable_shared_from_this<CCallableMailbox>
+{
+private:
+	boost :: mutex m_Mutex;			// protects the members below (held while signalling so the wakeup can't be deleted underneath us)
+	CWakeup *m_Wakeup;				// the wakeup of the thread which updates the owner (NULL if nobody needs waking up)
+	uint32_t m_NumPosted;			// the number of callables completed since the owner last checked
+	uint32_t m_LastCheckTicks;		// GetTicks when the owner last walked its pending callables
+
+public:
+	CCallableMailbox( CWakeup *nWakeup );
+	~CCallableMailbox( );
+
+	void SetWakeup( CWakeup *nWakeup );
+	void Post( );
+	bool CheckCallables( );
+
+	static CCallableMailbox *GetCurrent( );
+	static void SetCurrent( CCallableMailbox *mailbox );
+};
+
+typedef boost :: shared_ptr<CCallableMailbox> CCallableMailboxPtr;
+
+// makes a mailbox current on this thread for the lifetime of the scope, any callables created in the meantime post to it
+
+class CCallableMailboxScope
+{
+private:
+	CCallableMailbox *m_Previous;
+
+public:
+	CCallableMailboxScope( CCallableMailbox *mailbox );
+	~CCallableMailboxScope( );
+};
+
+//
+// Callables
+//
+
 class CBaseCallable
 {
 protected:
@@ -159,9 +263,10 @@ protected:
 	volatile bool m_Ready;
 	uint32_t m_StartTicks;
 	uint32_t m_EndTicks;
+	CCallableMailboxPtr m_Mailbox;			// the mailbox to post to when we're ready (may be empty)
 
 public:
-	CBaseCallable( ) : m_Error( ), m_Ready( false ), m_StartTicks( 0 ), m_EndTicks( 0 ) { }
+	CBaseCallable( );
 	virtual ~CBaseCallable( ) { }
 
 	virtual void operator( )( ) { }
@@ -171,7 +276,7 @@ public:
 
 	virtual string GetError( )				{ return m_Error; }
 	virtual bool GetReady( )				{ return m_Ready; }
-	virtual void SetReady( bool nReady )	{ m_Ready = nReady; }
+	virtual void SetReady( bool nReady );
 	virtual uint32_t GetElapsed( )			{ return m_Ready ? m_EndTicks - m_StartTicks : 0; }
 };
 
@@ -490,21 +595,26 @@ public:
 	virtual void SetResult( bool nResult )	{ m_Result = nResult; }
 };
 
+// checks the scores of several players at once, the score of each name is checked on the server with the same index
+// the result holds one score for each name (-100000.0 if the player doesn't have a score yet)
+
 class CCallableScoreCheck : virtual public CBaseCallable
 {
 protected:
 	string m_Category;
-	string m_Name;
-	string m_Server;
-	double m_Result;
+	vector<string> m_Names;
+	vector<string> m_Servers;
+	vector<double> m_Result;
 
 public:
-	CCallableScoreCheck( string nCategory, string nName, string nServer ) : CBaseCallable( ), m_Category( nCategory ), m_Name( nName ), m_Server( nServer ), m_Result( 0.0 ) { }
+	CCallableScoreCheck( string nCategory, vector<string> nNames, vector<string> nServers ) : CBaseCallable( ), m_Category( nCategory ), m_Names( nNames ), m_Servers( nServers ), m_Result( nNames.size( ), -100000.0 ) { }
 	virtual ~CCallableScoreCheck( );
 
-	virtual string GetName( )					{ return m_Name; }
-	virtual double GetResult( )					{ return m_Result; }
-	virtual void SetResult( double nResult )	{ m_Result = nResult; }
+	virtual string GetCategory( )						{ return m_Category; }
+	virtual vector<string> GetNames( )					{ return m_Names; }
+	virtual vector<string> GetServers( )				{ return m_Servers; }
+	virtual vector<double> GetResult( )					{ return m_Result; }
+	virtual void SetResult( vector<double> nResult )	{ m_Result = nResult; }
 };
 
 class CCallableW3MMDPlayerAdd : virtual public CBaseCallable
@@ -554,6 +664,21 @@ public:
 	virtual void SetResult( bool nResult )	{ m_Result = nResult; }
 };
 
+class CCallableGameDataAdd : virtual public CBaseCallable
+{
+protected:
+	CDBGameData *m_GameData;
+	uint32_t m_Result;
+
+public:
+	CCallableGameDataAdd( CDBGameData *nGameData ) : CBaseCallable( ), m_GameData( nGameData ), m_Result( 0 ) { }
+	virtual ~CCallableGameDataAdd( );
+
+	virtual CDBGameData *GetGameData( )			{ return m_GameData; }
+	virtual uint32_t GetResult( )				{ return m_Result; }
+	virtual void SetResult( uint32_t nResult )	{ m_Result = nResult; }
+};
+
 //
 // CDBBan
 //
@@ -834,4 +959,72 @@ public:
 	float GetAvgCourierKills( )			{ return m_TotalGames > 0 ? (float)m_TotalCourierKills / m_TotalGames : 0; }
 };
 
+//
+// CDBW3MMDPlayer
+//
+
+class CDBW3MMDPlayer
+{
+private:
+	uint32_t m_PID;
+	string m_Name;
+	string m_Flag;
+	uint32_t m_Leaver;
+	uint32_t m_Practicing;
+
+public:
+	CDBW3MMDPlayer( uint32_t nPID, string nName, string nFlag, uint32_t nLeaver, uint32_t nPracticing );
+	~CDBW3MMDPlayer( );
+
+	uint32_t GetPID( )			{ return m_PID; }
+	string GetName( )			{ return m_Name; }
+	string GetFlag( )			{ return m_Flag; }
+	uint32_t GetLeaver( )		{ return m_Leaver; }
+	uint32_t GetPracticing( )	{ return m_Practicing; }
+};
+
+//
+// CDBGameData
+//
+
+// everything which is saved to the database when a game ends: the game itself, the players and any DotA or W3MMD stats
+// it's saved as one unit of work (see ThreadedGameDataAdd) so the database can write all of it inside one transaction with as few queries as possible
+// the stats classes fill in the stats in their Save function
+
+class CDBGameData
+{
+public:
+	string m_Server;
+	string m_Map;
+	string m_GameName;
+	string m_OwnerName;
+	uint32_t m_Duration;
+	uint32_t m_GameState;
+	string m_CreatorName;
+	string m_CreatorServer;
+	vector<CDBGamePlayer> m_Players;
+
+	bool m_DotA;								// if the DotA stats should be saved
+	uint32_t m_DotAWinner;
+	uint32_t m_DotAMin;
+	uint32_t m_DotASec;
+	vector<CDBDotAPlayer> m_DotAPlayers;
+
+	string m_W3MMDCategory;
+	vector<CDBW3MMDPlayer> m_W3MMDPlayers;
+	map<VarP,int32_t> m_W3MMDVarInts;
+	map<VarP,double> m_W3MMDVarReals;
+	map<VarP,string> m_W3MMDVarStrings;
+
+	string m_ScoreCategory;						// the players' new scores if the database rated the game when it was saved
+	vector<string> m_ScoreNames;
+	vector<string> m_ScoreServers;
+	vector<double> m_Scores;
+
+	string m_JournalKey;						// set by the journal when replaying the game so the database can tell if it was already saved (not saved in the journal itself)
+
+	CDBGameData( string nServer, string nMap, string nGameName, string nOwnerName, uint32_t nDuration, uint32_t nGameState, string nCreatorName, string nCreatorServer );
+	~CDBGameData( );
+};
+
 #endif
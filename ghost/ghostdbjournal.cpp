@@ -0,0 +1,1148 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "config.h"
+#include "crc32.h"
+#include "ghostdb.h"
+#include "ghostdbjournal.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+
+#ifdef WIN32
+ #include <windows.h>
+ #include <io.h>
+#else
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+// the journal is only ever read by the bot which wrote it so numbers are written in the machine's byte order
+
+void JournalAppend( string &data, uint32_t i )
+{
+	data.append( (char *)&i, 4 );
+}
+
+void JournalAppend( string &data, double d )
+{
+	data.append( (char *)&d, 8 );
+}
+
+void JournalAppend( string &data, const string &s )
+{
+	JournalAppend( data, (uint32_t)s.size( ) );
+	data += s;
+}
+
+// flush a file we've written to all the way to the disk
+
+bool JournalSyncFile( FILE *file )
+{
+	if( fflush( file ) != 0 )
+		return false;
+
+#ifdef WIN32
+	return _commit( _fileno( file ) ) == 0;
+#else
+	return fsync( fileno( file ) ) == 0;
+#endif
+}
+
+// replace a small file (the checkpoint or the journal ID) so that after a crash it holds either its old or its new contents and is never missing
+// the data is written to a temporary file and synced to disk first, then the temporary file is renamed over the old file in one step
+
+bool JournalReplaceFile( const string &path, const string &fileName, const string &data )
+{
+	string File = path + fileName;
+	string TempFile = File + ".tmp";
+	FILE *Temp = fopen( TempFile.c_str( ), "wb" );
+
+	if( !Temp )
+		return false;
+
+	bool Success = fwrite( data.data( ), 1, data.size( ), Temp ) == data.size( ) && JournalSyncFile( Temp );
+
+	if( fclose( Temp ) != 0 )
+		Success = false;
+
+	if( !Success )
+	{
+		remove( TempFile.c_str( ) );
+		return false;
+	}
+
+#ifdef WIN32
+	return MoveFileExA( TempFile.c_str( ), File.c_str( ), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0;
+#else
+	if( rename( TempFile.c_str( ), File.c_str( ) ) != 0 )
+		return false;
+
+	// sync the directory as well so the rename itself survives a crash
+
+	int FD = open( path.c_str( ), O_RDONLY );
+
+	if( FD != -1 )
+	{
+		fsync( FD );
+		close( FD );
+	}
+
+	return true;
+#endif
+}
+
+class CJournalReader
+{
+private:
+	const string &m_Data;
+	string :: size_type m_Position;
+	bool m_Valid;						// set to false when we try to read past the end of the data
+
+public:
+	CJournalReader( const string &nData ) : m_Data( nData ), m_Position( 0 ), m_Valid( true ) { }
+
+	bool GetValid( )	{ return m_Valid; }
+
+	uint32_t ReadUInt32( )
+	{
+		uint32_t i = 0;
+
+		if( m_Data.size( ) - m_Position >= 4 )
+			memcpy( &i, m_Data.data( ) + m_Position, 4 );
+		else
+			m_Valid = false;
+
+		m_Position += 4;
+		return i;
+	}
+
+	double ReadDouble( )
+	{
+		double d = 0.0;
+
+		if( m_Data.size( ) - m_Position >= 8 )
+			memcpy( &d, m_Data.data( ) + m_Position, 8 );
+		else
+			m_Valid = false;
+
+		m_Position += 8;
+		return d;
+	}
+
+	string ReadString( )
+	{
+		uint32_t Length = ReadUInt32( );
+
+		if( !m_Valid || m_Data.size( ) - m_Position < Length )
+		{
+			m_Valid = false;
+			return string( );
+		}
+
+		m_Position += Length;
+		return m_Data.substr( m_Position - Length, Length );
+	}
+};
+
+//
+// CGHostDBJournal
+//
+
+CGHostDBJournal :: CGHostDBJournal( CConfig *CFG, CGHostDB *nDB, CScoreCache *nScoreCache ) : CGHostDB( CFG ), m_DB( nDB ), m_ScoreCache( nScoreCache ), m_Enabled( true ), m_Thread( NULL ), m_File( NULL ), m_Segment( 0 ), m_FileSize( 0 ), m_NextSequence( 1 ), m_Unsynced( false ), m_LastSegment( 0 ), m_Checkpoint( 0 ), m_LastFailTicks( 0 ), m_RetryDelay( 0 ), m_NumSaved( 0 ), m_NumFailures( 0 ), m_NumMoved( 0 ), m_Exiting( false )
+{
+	m_HasError = m_DB->HasError( );
+	m_Error = m_DB->GetError( );
+	m_CRC = new CCRC32( );
+	m_CRC->Initialize( );
+	m_Path = UTIL_AddPathSeperator( CFG->GetString( "db_journalpath", string( ) ) );
+	m_SegmentSize = CFG->GetInt( "db_journalsegmentsize", 4194304 );
+	m_SyncInterval = CFG->GetInt( "db_journalsyncinterval", 1000 );
+	m_BatchSize = CFG->GetInt( "db_journalbatchsize", 16 );
+	m_MaxAttempts = CFG->GetInt( "db_journalmaxattempts", 10 );
+
+	if( m_SyncInterval == 0 )
+		m_SyncInterval = 1;
+
+	if( m_BatchSize == 0 )
+		m_BatchSize = 1;
+
+	try
+	{
+		boost :: filesystem :: create_directories( boost :: filesystem :: path( m_Path ) );
+	}
+	catch( boost :: filesystem :: filesystem_error &ex )
+	{
+		CONSOLE_Print( "[JOURNAL] error creating journal directory [" + m_Path + "] - " + ex.what( ) );
+		CONSOLE_Print( "[JOURNAL] warning - the journal is disabled, writing straight to the database instead" );
+		m_Enabled = false;
+		return;
+	}
+
+	if( !LoadJournalID( ) )
+	{
+		CONSOLE_Print( "[JOURNAL] warning - the journal is disabled, writing straight to the database instead" );
+		m_Enabled = false;
+		return;
+	}
+
+	Recover( );
+
+	try
+	{
+		m_Thread = new boost :: thread( boost :: bind( &CGHostDBJournal :: ReplayerThread, this ) );
+	}
+	catch( boost :: thread_resource_error tre )
+	{
+		// we can still append to the journal, the records will be saved the next time the bot starts
+
+		CONSOLE_Print( "[JOURNAL] error spawning replayer thread [" + string( tre.what( ) ) + "]" );
+		m_Thread = NULL;
+	}
+}
+
+CGHostDBJournal :: ~CGHostDBJournal( )
+{
+	// the replayer finishes the records it's saving and exits, the rest of the records are saved the next time the bot starts
+
+	if( m_Thread )
+	{
+		{
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+			m_Exiting = true;
+		}
+
+		m_Changed.notify_all( );
+		m_Thread->join( );
+		delete m_Thread;
+	}
+
+	if( m_File )
+	{
+		Sync( true );
+		fclose( m_File );
+	}
+
+	if( !m_Records.empty( ) )
+		CONSOLE_Print( "[JOURNAL] " + UTIL_ToString( m_Records.size( ) ) + " records haven't been saved to the database yet, they'll be saved the next time the bot starts" );
+
+	delete m_CRC;
+	delete m_DB;
+}
+
+string CGHostDBJournal :: GetStatus( )
+{
+	if( !m_Enabled )
+		return m_DB->GetStatus( );
+
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	return m_DB->GetStatus( ) + " Journal: " + UTIL_ToString( m_Records.size( ) ) + " unsaved records in " + UTIL_ToString( m_Segments.size( ) ) + " segments, " + UTIL_ToString( m_NumSaved ) + " saved, " + UTIL_ToString( m_NumFailures ) + " failed attempts, " + UTIL_ToString( m_NumMoved ) + " moved to failed.dat.";
+}
+
+void CGHostDBJournal :: RecoverCallable( CBaseCallable *callable )
+{
+	// our own callables don't hold anything to recover
+
+	if( !dynamic_cast<CJournalCallable *>( callable ) )
+		m_DB->RecoverCallable( callable );
+}
+
+CCallableBanAdd *CGHostDBJournal :: ThreadedBanAdd( string server, string user, string ip, string gamename, string admin, string reason )
+{
+	string Data;
+	JournalAppend( Data, server );
+	JournalAppend( Data, user );
+	JournalAppend( Data, ip );
+	JournalAppend( Data, gamename );
+	JournalAppend( Data, admin );
+	JournalAppend( Data, reason );
+
+	if( !m_Enabled || Append( JOURNAL_BAN, Data ) == 0 )
+		return m_DB->ThreadedBanAdd( server, user, ip, gamename, admin, reason );
+
+	CJournalCallableBanAdd *Callable = new CJournalCallableBanAdd( server, user, ip, gamename, admin, reason );
+	Callable->Init( );
+	Callable->SetResult( true );
+	Callable->Close( );
+	return Callable;
+}
+
+CCallableBanRemove *CGHostDBJournal :: ThreadedBanRemove( string server, string user )
+{
+	return BanRemove( server, user, false );
+}
+
+CCallableBanRemove *CGHostDBJournal :: ThreadedBanRemove( string user )
+{
+	return BanRemove( string( ), user, true );
+}
+
+CCallableDownloadAdd *CGHostDBJournal :: ThreadedDownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
+{
+	string Data;
+	JournalAppend( Data, map );
+	JournalAppend( Data, mapsize );
+	JournalAppend( Data, name );
+	JournalAppend( Data, ip );
+	JournalAppend( Data, spoofed );
+	JournalAppend( Data, spoofedrealm );
+	JournalAppend( Data, downloadtime );
+
+	if( !m_Enabled || Append( JOURNAL_DOWNLOAD, Data ) == 0 )
+		return m_DB->ThreadedDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime );
+
+	CJournalCallableDownloadAdd *Callable = new CJournalCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime );
+	Callable->Init( );
+	Callable->SetResult( true );
+	Callable->Close( );
+	return Callable;
+}
+
+CCallableGameDataAdd *CGHostDBJournal :: ThreadedGameDataAdd( CDBGameData *gamedata )
+{
+	uint32_t Sequence = m_Enabled ? Append( JOURNAL_GAMEDATA, SerializeGameData( gamedata ) ) : 0;
+
+	if( Sequence == 0 )
+		return m_DB->ThreadedGameDataAdd( gamedata );
+
+	CJournalCallableGameDataAdd *Callable = new CJournalCallableGameDataAdd( gamedata );
+	Callable->Init( );
+	Callable->SetResult( Sequence );
+	Callable->Close( );
+	return Callable;
+}
+
+CCallableBanRemove *CGHostDBJournal :: BanRemove( string server, string user, bool allServers )
+{
+	string Data;
+	JournalAppend( Data, server );
+	JournalAppend( Data, user );
+	JournalAppend( Data, (uint32_t)( allServers ? 1 : 0 ) );
+
+	if( !m_Enabled || Append( JOURNAL_BANREMOVE, Data ) == 0 )
+		return allServers ? m_DB->ThreadedBanRemove( user ) : m_DB->ThreadedBanRemove( server, user );
+
+	CJournalCallableBanRemove *Callable = new CJournalCallableBanRemove( server, user );
+	Callable->Init( );
+	Callable->SetResult( true );
+	Callable->Close( );
+	return Callable;
+}
+
+uint32_t CGHostDBJournal :: Append( unsigned char type, const string &data )
+{
+	// append a record to the journal and return its sequence number (or 0 if it couldn't be written)
+	// the record is flushed to the operating system before we return but it isn't fsynced until the replayer thread next syncs the journal
+
+	boost :: mutex :: scoped_lock FileLock( m_FileMutex );
+
+	if( m_File && m_FileSize >= m_SegmentSize )
+	{
+		Sync( true );
+		fclose( m_File );
+		m_File = NULL;
+		++m_Segment;
+		m_FileSize = 0;
+	}
+
+	if( !m_File )
+	{
+		m_File = fopen( GetSegmentFileName( m_Segment ).c_str( ), "ab" );
+
+		if( !m_File )
+		{
+			CONSOLE_Print( "[JOURNAL] error opening journal segment [" + GetSegmentFileName( m_Segment ) + "], writing straight to the database instead" );
+			return 0;
+		}
+	}
+
+	string Record;
+	JournalAppend( Record, m_NextSequence );
+	Record.push_back( type );
+	Record += data;
+	string Header;
+	JournalAppend( Header, (uint32_t)Record.size( ) );
+	JournalAppend( Header, m_CRC->FullCRC( (unsigned char *)Record.data( ), Record.size( ) ) );
+
+	if( fwrite( Header.data( ), 1, Header.size( ), m_File ) != Header.size( ) || fwrite( Record.data( ), 1, Record.size( ), m_File ) != Record.size( ) || fflush( m_File ) != 0 )
+	{
+		// we don't know how much of the record was written so we never append to this segment again, the partial record is ignored when the segment is read
+
+		CONSOLE_Print( "[JOURNAL] error writing to journal segment [" + GetSegmentFileName( m_Segment ) + "], writing straight to the database instead" );
+		fclose( m_File );
+		m_File = NULL;
+		++m_Segment;
+		m_FileSize = 0;
+		return 0;
+	}
+
+	uint32_t Sequence = m_NextSequence++;
+	m_FileSize += Header.size( ) + Record.size( );
+	m_Unsynced = true;
+
+	{
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
+		CJournalRecord JournalRecord;
+		JournalRecord.m_Sequence = Sequence;
+		JournalRecord.m_Segment = m_Segment;
+		JournalRecord.m_Type = type;
+		JournalRecord.m_Data = data;
+		m_Records.push_back( JournalRecord );
+		++m_Segments[m_Segment];
+		m_LastSegment = m_Segment;
+	}
+
+	m_Changed.notify_one( );
+	return Sequence;
+}
+
+bool CGHostDBJournal :: LoadJournalID( )
+{
+	// the journal ID is written when the journal directory is first used along with an empty checkpoint
+	// the sequence numbers are only known from the checkpoint once the saved segments have been deleted, if it's missing we could hand out sequence numbers which were used before
+	// so we start a new journal ID whenever the checkpoint is missing, this way a new record can never get the journal key of a game which was saved before
+
+	string JournalIDFile = m_Path + "journalid.txt";
+	bool HasCheckpoint = UTIL_FileExists( m_Path + "checkpoint.txt" );
+	m_JournalID = UTIL_FileExists( JournalIDFile ) ? UTIL_FileRead( JournalIDFile ) : string( );
+
+	if( !m_JournalID.empty( ) && HasCheckpoint )
+		return true;
+
+	if( !m_JournalID.empty( ) )
+		CONSOLE_Print( "[JOURNAL] warning - the checkpoint file is missing, starting a new journal ID (unsaved records might be saved twice)" );
+
+	m_JournalID = UTIL_ToString( (uint32_t)time( NULL ) ) + "-" + UTIL_ToString( (uint32_t)rand( ) ) + "-" + UTIL_ToString( GetTicks( ) );
+
+	if( !JournalReplaceFile( m_Path, "journalid.txt", m_JournalID ) )
+	{
+		CONSOLE_Print( "[JOURNAL] error writing journal ID file [" + JournalIDFile + "]" );
+		return false;
+	}
+
+	if( !HasCheckpoint && !JournalReplaceFile( m_Path, "checkpoint.txt", "0" ) )
+	{
+		CONSOLE_Print( "[JOURNAL] error writing checkpoint file [" + m_Path + "checkpoint.txt]" );
+		return false;
+	}
+
+	CONSOLE_Print( "[JOURNAL] created journal ID [" + m_JournalID + "]" );
+	return true;
+}
+
+void CGHostDBJournal :: Recover( )
+{
+	// read the records which weren't saved before the bot last exited
+	// the checkpoint file holds the oldest unsaved sequence number followed by the sequence numbers of any newer records which have already been saved
+
+	uint32_t Checkpoint = 0;
+	set<uint32_t> Saved;
+	istringstream SS( UTIL_FileRead( m_Path + "checkpoint.txt" ) );
+	uint32_t Sequence;
+
+	if( SS >> Checkpoint )
+	{
+		while( SS >> Sequence )
+			Saved.insert( Sequence );
+	}
+
+	// find the segments, they're named after their segment number so sorting the names puts them in order
+
+	vector<string> Files;
+
+	try
+	{
+		for( boost :: filesystem :: directory_iterator i( m_Path ); i != boost :: filesystem :: directory_iterator( ); ++i )
+		{
+			string FileName = i->path( ).filename( ).string( );
+
+			if( FileName.size( ) == 19 && FileName.substr( 0, 7 ) == "journal" && FileName.substr( 15 ) == ".dat" )
+				Files.push_back( FileName );
+		}
+	}
+	catch( boost :: filesystem :: filesystem_error &ex )
+	{
+		CONSOLE_Print( "[JOURNAL] error reading journal directory [" + m_Path + "] - " + ex.what( ) );
+	}
+
+	sort( Files.begin( ), Files.end( ) );
+	uint32_t NumSegments = 0;
+
+	for( vector<string> :: iterator i = Files.begin( ); i != Files.end( ); ++i )
+	{
+		string Number = (*i).substr( 7, 8 );
+		uint32_t Segment = UTIL_ToUInt32( Number );
+		string Data = UTIL_FileRead( m_Path + *i );
+		string :: size_type Position = 0;
+		uint32_t NumUnsaved = 0;
+
+		while( Data.size( ) - Position >= 8 )
+		{
+			uint32_t Length;
+			uint32_t CRC;
+			memcpy( &Length, Data.data( ) + Position, 4 );
+			memcpy( &CRC, Data.data( ) + Position + 4, 4 );
+
+			if( Length < 5 || Data.size( ) - Position - 8 < Length || m_CRC->FullCRC( (unsigned char *)Data.data( ) + Position + 8, Length ) != CRC )
+			{
+				// this happens when the bot or the machine crashed while appending a record, the record was never acknowledged so we just skip it
+
+				CONSOLE_Print( "[JOURNAL] warning - ignoring partially written record at the end of journal segment [" + *i + "]" );
+				break;
+			}
+
+			CJournalRecord Record;
+			memcpy( &Record.m_Sequence, Data.data( ) + Position + 8, 4 );
+			Record.m_Segment = Segment;
+			Record.m_Type = Data[Position + 12];
+			Record.m_Data = Data.substr( Position + 13, Length - 5 );
+			Position += 8 + Length;
+
+			if( Record.m_Sequence >= m_NextSequence )
+				m_NextSequence = Record.m_Sequence + 1;
+
+			if( Record.m_Sequence >= Checkpoint && Saved.find( Record.m_Sequence ) == Saved.end( ) )
+			{
+				m_Records.push_back( Record );
+				++NumUnsaved;
+			}
+		}
+
+		if( NumUnsaved > 0 )
+			m_Segments[Segment] = NumUnsaved;
+		else
+			remove( ( m_Path + *i ).c_str( ) );
+
+		if( Segment >= m_Segment )
+			m_Segment = Segment + 1;
+
+		++NumSegments;
+	}
+
+	// we never append to an old segment in case it ends with a partially written record
+
+	m_LastSegment = m_Segment;
+
+	if( Checkpoint > m_NextSequence )
+		m_NextSequence = Checkpoint;
+
+	m_Checkpoint = m_Records.empty( ) ? m_NextSequence : m_Records.front( ).m_Sequence;
+
+	for( set<uint32_t> :: iterator i = Saved.begin( ); i != Saved.end( ); ++i )
+	{
+		if( *i > m_Checkpoint )
+			m_Saved.insert( *i );
+	}
+
+	CONSOLE_Print( "[JOURNAL] using journal directory [" + m_Path + "], found " + UTIL_ToString( m_Records.size( ) ) + " unsaved records in " + UTIL_ToString( NumSegments ) + " segments" );
+}
+
+void CGHostDBJournal :: Sync( bool force )
+{
+	// fsync the segment being appended to without holding m_FileMutex while we wait for the disk
+	// we sync a duplicate of the file descriptor so the segment can be closed while we're syncing it
+	// when force is true the caller holds m_FileMutex and wants to wait for the sync (e.g. before closing the segment)
+
+	int FD = -1;
+
+	{
+		boost :: mutex :: scoped_lock FileLock( m_FileMutex, boost :: defer_lock );
+
+		if( !force )
+			FileLock.lock( );
+
+		if( !m_File || !m_Unsynced )
+			return;
+
+#ifdef WIN32
+		FD = _dup( _fileno( m_File ) );
+#else
+		FD = dup( fileno( m_File ) );
+#endif
+
+		m_Unsynced = false;
+	}
+
+	if( FD == -1 )
+		return;
+
+#ifdef WIN32
+	_commit( FD );
+	_close( FD );
+#else
+	fsync( FD );
+	close( FD );
+#endif
+}
+
+CBaseCallable *CGHostDBJournal :: StartSave( CJournalRecord &record )
+{
+	// start saving one record to the real database, this is only called by the replayer thread
+	// returns NULL if the record can't be read (it can never be saved so it shouldn't be retried)
+
+	CJournalReader Reader( record.m_Data );
+
+	if( record.m_Type == JOURNAL_GAMEDATA )
+	{
+		CDBGameData *GameData = DeserializeGameData( record.m_Data );
+
+		if( GameData )
+		{
+			GameData->m_JournalKey = m_JournalID + ":" + UTIL_ToString( record.m_Sequence );
+			return m_DB->ThreadedGameDataAdd( GameData );
+		}
+	}
+	else if( record.m_Type == JOURNAL_DOWNLOAD )
+	{
+		string Map = Reader.ReadString( );
+		uint32_t MapSize = Reader.ReadUInt32( );
+		string Name = Reader.ReadString( );
+		string IP = Reader.ReadString( );
+		uint32_t Spoofed = Reader.ReadUInt32( );
+		string SpoofedRealm = Reader.ReadString( );
+		uint32_t DownloadTime = Reader.ReadUInt32( );
+
+		if( Reader.GetValid( ) )
+			return m_DB->ThreadedDownloadAdd( Map, MapSize, Name, IP, Spoofed, SpoofedRealm, DownloadTime );
+	}
+	else if( record.m_Type == JOURNAL_BAN )
+	{
+		string Server = Reader.ReadString( );
+		string User = Reader.ReadString( );
+		string IP = Reader.ReadString( );
+		string GameName = Reader.ReadString( );
+		string Admin = Reader.ReadString( );
+		string Reason = Reader.ReadString( );
+
+		if( Reader.GetValid( ) )
+			return m_DB->ThreadedBanAdd( Server, User, IP, GameName, Admin, Reason );
+	}
+	else if( record.m_Type == JOURNAL_BANREMOVE )
+	{
+		string Server = Reader.ReadString( );
+		string User = Reader.ReadString( );
+		bool AllServers = Reader.ReadUInt32( ) == 1;
+
+		if( Reader.GetValid( ) )
+			return AllServers ? m_DB->ThreadedBanRemove( User ) : m_DB->ThreadedBanRemove( Server, User );
+	}
+
+	return NULL;
+}
+
+bool CGHostDBJournal :: GetSaved( CBaseCallable *callable )
+{
+	CCallableGameDataAdd *GameDataAdd = dynamic_cast<CCallableGameDataAdd *>( callable );
+	CCallableDownloadAdd *DownloadAdd = dynamic_cast<CCallableDownloadAdd *>( callable );
+	CCallableBanAdd *BanAdd = dynamic_cast<CCallableBanAdd *>( callable );
+	CCallableBanRemove *BanRemove = dynamic_cast<CCallableBanRemove *>( callable );
+
+	if( GameDataAdd )
+		return GameDataAdd->GetResult( ) > 0;
+	else if( DownloadAdd )
+		return DownloadAdd->GetResult( );
+	else if( BanAdd )
+		return BanAdd->GetResult( );
+	else if( BanRemove )
+		return BanRemove->GetResult( );
+
+	return false;
+}
+
+string CGHostDBJournal :: GetSegmentFileName( uint32_t segment )
+{
+	string Number = UTIL_ToString( segment );
+
+	if( Number.size( ) < 8 )
+		Number.insert( 0, 8 - Number.size( ), '0' );
+
+	return m_Path + "journal" + Number + ".dat";
+}
+
+void CGHostDBJournal :: MoveFailed( const CJournalRecord &record, const string &error )
+{
+	// append the record to failed.dat in the same format as the journal segments so it can be looked at (or saved by hand) later
+	// this is only called by the replayer thread
+
+	string FailedFile = m_Path + "failed.dat";
+	string Record;
+	JournalAppend( Record, record.m_Sequence );
+	Record.push_back( record.m_Type );
+	Record += record.m_Data;
+	string Header;
+	JournalAppend( Header, (uint32_t)Record.size( ) );
+	JournalAppend( Header, m_CRC->FullCRC( (unsigned char *)Record.data( ), Record.size( ) ) );
+	FILE *File = fopen( FailedFile.c_str( ), "ab" );
+	bool Success = false;
+
+	if( File )
+	{
+		Success = fwrite( Header.data( ), 1, Header.size( ), File ) == Header.size( ) && fwrite( Record.data( ), 1, Record.size( ), File ) == Record.size( ) && JournalSyncFile( File );
+
+		if( fclose( File ) != 0 )
+			Success = false;
+	}
+
+	if( Success )
+		CONSOLE_Print( "[JOURNAL] giving up on journal record " + UTIL_ToString( record.m_Sequence ) + " of type " + UTIL_ToString( record.m_Type ) + " after " + UTIL_ToString( record.m_Attempts ) + " failed attempts, moved it to [" + FailedFile + "] - " + error );
+	else
+		CONSOLE_Print( "[JOURNAL] giving up on journal record " + UTIL_ToString( record.m_Sequence ) + " of type " + UTIL_ToString( record.m_Type ) + " after " + UTIL_ToString( record.m_Attempts ) + " failed attempts, error writing it to [" + FailedFile + "] so it's lost - " + error );
+}
+
+void CGHostDBJournal :: ReplayerThread( )
+{
+	while( true )
+	{
+		// fsync the journal at most every m_SyncInterval milliseconds so a burst of records only costs one fsync
+
+		Sync( false );
+
+		vector<CJournalRecord> Batch;
+
+		{
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+			if( m_Exiting )
+				break;
+
+			uint32_t Ticks = GetTicks( );
+
+			if( Ticks - m_LastFailTicks >= m_RetryDelay )
+			{
+				// the records in a batch are saved in parallel so a ban remove is always saved in a batch of its own after every earlier record has been saved
+				// this makes sure an earlier ban of the same user can't be saved after it was removed
+				// records waiting to be tried again after failing are skipped so they don't hold up the records behind them, except that nothing is saved past a ban remove which is waiting
+
+				bool Skipped = false;
+
+				for( deque<CJournalRecord> :: iterator i = m_Records.begin( ); i != m_Records.end( ) && Batch.size( ) < m_BatchSize; ++i )
+				{
+					if( (*i).m_Type == JOURNAL_BANREMOVE && ( Skipped || !Batch.empty( ) ) )
+						break;
+
+					if( !Batch.empty( ) && Batch.back( ).m_Type == JOURNAL_BANREMOVE )
+						break;
+
+					if( Ticks - (*i).m_LastFailTicks < (*i).m_RetryDelay )
+					{
+						if( (*i).m_Type == JOURNAL_BANREMOVE )
+							break;
+
+						Skipped = true;
+						continue;
+					}
+
+					Batch.push_back( *i );
+				}
+			}
+
+			if( Batch.empty( ) )
+			{
+				m_Changed.timed_wait( Lock, boost :: posix_time :: milliseconds( m_SyncInterval ) );
+				continue;
+			}
+		}
+
+		// start saving the whole batch at once so the real database can save the records in parallel (e.g. on several MySQL workers)
+
+		vector<CBaseCallable *> Callables;
+
+		for( vector<CJournalRecord> :: iterator i = Batch.begin( ); i != Batch.end( ); ++i )
+			Callables.push_back( StartSave( *i ) );
+
+		vector<uint32_t> Saved;
+		map<uint32_t, string> Failed;
+		bool DatabaseSaved = false;
+
+		for( uint32_t i = 0; i < Batch.size( ); ++i )
+		{
+			if( !Callables[i] )
+			{
+				CONSOLE_Print( "[JOURNAL] error reading journal record " + UTIL_ToString( Batch[i].m_Sequence ) + " of type " + UTIL_ToString( Batch[i].m_Type ) + ", discarding it" );
+				Saved.push_back( Batch[i].m_Sequence );
+				continue;
+			}
+
+			while( !Callables[i]->GetReady( ) )
+				MILLISLEEP( 10 );
+
+			if( GetSaved( Callables[i] ) )
+			{
+				Saved.push_back( Batch[i].m_Sequence );
+				DatabaseSaved = true;
+
+				// the game's own callable was ready before the game was saved so the game can't put the new scores in the score cache, we do it instead
+
+				CCallableGameDataAdd *GameDataAdd = dynamic_cast<CCallableGameDataAdd *>( Callables[i] );
+
+				if( GameDataAdd && m_ScoreCache )
+				{
+					CDBGameData *GameData = GameDataAdd->GetGameData( );
+
+					for( unsigned int j = 0; j < GameData->m_Scores.size( ); ++j )
+						m_ScoreCache->Put( GameData->m_ScoreCategory, GameData->m_ScoreNames[j], GameData->m_ScoreServers[j], GameData->m_Scores[j] );
+				}
+			}
+			else
+				Failed[Batch[i].m_Sequence] = Callables[i]->GetError( );
+
+			m_DB->RecoverCallable( Callables[i] );
+			delete Callables[i];
+		}
+
+		// remove the saved records from the journal
+		// the checkpoint and the segments are written and deleted after releasing the mutex so appending records never waits for the disk
+
+		string Checkpoint;
+		vector<string> DeleteSegments;
+		vector< pair<CJournalRecord, string> > Moved;
+
+		{
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+			for( vector<uint32_t> :: iterator i = Saved.begin( ); i != Saved.end( ); ++i )
+			{
+				for( deque<CJournalRecord> :: iterator j = m_Records.begin( ); j != m_Records.end( ); ++j )
+				{
+					if( (*j).m_Sequence == *i )
+					{
+						--m_Segments[(*j).m_Segment];
+						m_Records.erase( j );
+						break;
+					}
+				}
+
+				m_Saved.insert( *i );
+			}
+
+			uint32_t NumFailed = Failed.size( );
+			m_NumSaved += Saved.size( );
+			m_NumFailures += NumFailed;
+
+			// a failure only counts towards m_MaxAttempts if the database saved another record in this batch or since the record last failed
+			// otherwise the database is probably down and the record will be saved once it's back up so we keep trying forever
+
+			for( deque<CJournalRecord> :: iterator i = m_Records.begin( ); i != m_Records.end( ) && !Failed.empty( ); )
+			{
+				map<uint32_t, string> :: iterator j = Failed.find( (*i).m_Sequence );
+
+				if( j == Failed.end( ) )
+				{
+					++i;
+					continue;
+				}
+
+				if( DatabaseSaved || ( (*i).m_FailedSaved != 0xFFFFFFFF && m_NumSaved > (*i).m_FailedSaved ) )
+					++(*i).m_Attempts;
+
+				(*i).m_FailedSaved = m_NumSaved;
+
+				if( m_MaxAttempts > 0 && (*i).m_Attempts >= m_MaxAttempts )
+				{
+					Moved.push_back( make_pair( *i, j->second ) );
+					--m_Segments[(*i).m_Segment];
+					m_Saved.insert( (*i).m_Sequence );
+					++m_NumMoved;
+					i = m_Records.erase( i );
+				}
+				else
+				{
+					(*i).m_LastFailTicks = GetTicks( );
+					(*i).m_RetryDelay = (*i).m_RetryDelay == 0 ? 1000 : min( (*i).m_RetryDelay * 2, (uint32_t)60000 );
+
+					if( DatabaseSaved )
+						CONSOLE_Print( "[JOURNAL] unable to save journal record " + UTIL_ToString( (*i).m_Sequence ) + " of type " + UTIL_ToString( (*i).m_Type ) + ", trying again in " + UTIL_ToString( (*i).m_RetryDelay / 1000 ) + " seconds - " + j->second );
+					++i;
+				}
+
+				Failed.erase( j );
+			}
+
+			// every record before the oldest unsaved record has been saved so we only need to remember the saved records after it
+
+			if( !m_Records.empty( ) )
+				m_Checkpoint = m_Records.front( ).m_Sequence;
+			else if( !m_Saved.empty( ) )
+				m_Checkpoint = *m_Saved.rbegin( ) + 1;
+
+			m_Saved.erase( m_Saved.begin( ), m_Saved.lower_bound( m_Checkpoint ) );
+			Checkpoint = UTIL_ToString( m_Checkpoint );
+
+			for( set<uint32_t> :: iterator i = m_Saved.begin( ); i != m_Saved.end( ); ++i )
+				Checkpoint += " " + UTIL_ToString( *i );
+
+			for( map<uint32_t, uint32_t> :: iterator i = m_Segments.begin( ); i != m_Segments.end( ); )
+			{
+				if( i->second == 0 && i->first < m_LastSegment )
+				{
+					DeleteSegments.push_back( GetSegmentFileName( i->first ) );
+					m_Segments.erase( i++ );
+				}
+				else
+					++i;
+			}
+
+			// if nothing in the batch was saved the database is probably down so we wait before trying any records again
+
+			if( !DatabaseSaved && NumFailed > Moved.size( ) )
+			{
+				m_LastFailTicks = GetTicks( );
+				m_RetryDelay = m_RetryDelay == 0 ? 1000 : min( m_RetryDelay * 2, (uint32_t)60000 );
+				CONSOLE_Print( "[JOURNAL] unable to save " + UTIL_ToString( NumFailed - Moved.size( ) ) + " records to the database, trying again in " + UTIL_ToString( m_RetryDelay / 1000 ) + " seconds (" + UTIL_ToString( m_Records.size( ) ) + " unsaved records)" );
+			}
+			else
+				m_RetryDelay = 0;
+		}
+
+		// the records we gave up on are written to failed.dat before the checkpoint so they're never lost
+
+		for( vector< pair<CJournalRecord, string> > :: iterator i = Moved.begin( ); i != Moved.end( ); ++i )
+			MoveFailed( i->first, i->second );
+
+		// the segments are only deleted once the new checkpoint is safely on disk, otherwise we'd lose track of their sequence numbers
+
+		if( !JournalReplaceFile( m_Path, "checkpoint.txt", Checkpoint ) )
+		{
+			CONSOLE_Print( "[JOURNAL] error writing checkpoint file [" + m_Path + "checkpoint.txt]" );
+			DeleteSegments.clear( );
+		}
+
+		for( vector<string> :: iterator i = DeleteSegments.begin( ); i != DeleteSegments.end( ); ++i )
+			remove( (*i).c_str( ) );
+	}
+
+	Sync( false );
+}
+
+string CGHostDBJournal :: SerializeGameData( CDBGameData *gamedata )
+{
+	string Data;
+	JournalAppend( Data, gamedata->m_Server );
+	JournalAppend( Data, gamedata->m_Map );
+	JournalAppend( Data, gamedata->m_GameName );
+	JournalAppend( Data, gamedata->m_OwnerName );
+	JournalAppend( Data, gamedata->m_Duration );
+	JournalAppend( Data, gamedata->m_GameState );
+	JournalAppend( Data, gamedata->m_CreatorName );
+	JournalAppend( Data, gamedata->m_CreatorServer );
+	JournalAppend( Data, (uint32_t)gamedata->m_Players.size( ) );
+
+	for( vector<CDBGamePlayer> :: iterator i = gamedata->m_Players.begin( ); i != gamedata->m_Players.end( ); ++i )
+	{
+		JournalAppend( Data, (*i).GetID( ) );
+		JournalAppend( Data, (*i).GetGameID( ) );
+		JournalAppend( Data, (*i).GetName( ) );
+		JournalAppend( Data, (*i).GetIP( ) );
+		JournalAppend( Data, (*i).GetSpoofed( ) );
+		JournalAppend( Data, (*i).GetSpoofedRealm( ) );
+		JournalAppend( Data, (*i).GetReserved( ) );
+		JournalAppend( Data, (*i).GetLoadingTime( ) );
+		JournalAppend( Data, (*i).GetLeft( ) );
+		JournalAppend( Data, (*i).GetLeftReason( ) );
+		JournalAppend( Data, (*i).GetTeam( ) );
+		JournalAppend( Data, (*i).GetColour( ) );
+	}
+
+	JournalAppend( Data, (uint32_t)( gamedata->m_DotA ? 1 : 0 ) );
+	JournalAppend( Data, gamedata->m_DotAWinner );
+	JournalAppend( Data, gamedata->m_DotAMin );
+	JournalAppend( Data, gamedata->m_DotASec );
+	JournalAppend( Data, (uint32_t)gamedata->m_DotAPlayers.size( ) );
+
+	for( vector<CDBDotAPlayer> :: iterator i = gamedata->m_DotAPlayers.begin( ); i != gamedata->m_DotAPlayers.end( ); ++i )
+	{
+		JournalAppend( Data, (*i).GetID( ) );
+		JournalAppend( Data, (*i).GetGameID( ) );
+		JournalAppend( Data, (*i).GetColour( ) );
+		JournalAppend( Data, (*i).GetKills( ) );
+		JournalAppend( Data, (*i).GetDeaths( ) );
+		JournalAppend( Data, (*i).GetCreepKills( ) );
+		JournalAppend( Data, (*i).GetCreepDenies( ) );
+		JournalAppend( Data, (*i).GetAssists( ) );
+		JournalAppend( Data, (*i).GetGold( ) );
+		JournalAppend( Data, (*i).GetNeutralKills( ) );
+
+		for( unsigned int j = 0; j < 6; ++j )
+			JournalAppend( Data, (*i).GetItem( j ) );
+
+		JournalAppend( Data, (*i).GetHero( ) );
+		JournalAppend( Data, (*i).GetNewColour( ) );
+		JournalAppend( Data, (*i).GetTowerKills( ) );
+		JournalAppend( Data, (*i).GetRaxKills( ) );
+		JournalAppend( Data, (*i).GetCourierKills( ) );
+	}
+
+	JournalAppend( Data, gamedata->m_W3MMDCategory );
+	JournalAppend( Data, (uint32_t)gamedata->m_W3MMDPlayers.size( ) );
+
+	for( vector<CDBW3MMDPlayer> :: iterator i = gamedata->m_W3MMDPlayers.begin( ); i != gamedata->m_W3MMDPlayers.end( ); ++i )
+	{
+		JournalAppend( Data, (*i).GetPID( ) );
+		JournalAppend( Data, (*i).GetName( ) );
+		JournalAppend( Data, (*i).GetFlag( ) );
+		JournalAppend( Data, (*i).GetLeaver( ) );
+		JournalAppend( Data, (*i).GetPracticing( ) );
+	}
+
+	JournalAppend( Data, (uint32_t)gamedata->m_W3MMDVarInts.size( ) );
+
+	for( map<VarP,int32_t> :: iterator i = gamedata->m_W3MMDVarInts.begin( ); i != gamedata->m_W3MMDVarInts.end( ); ++i )
+	{
+		JournalAppend( Data, i->first.first );
+		JournalAppend( Data, i->first.second );
+		JournalAppend( Data, (uint32_t)i->second );
+	}
+
+	JournalAppend( Data, (uint32_t)gamedata->m_W3MMDVarReals.size( ) );
+
+	for( map<VarP,double> :: iterator i = gamedata->m_W3MMDVarReals.begin( ); i != gamedata->m_W3MMDVarReals.end( ); ++i )
+	{
+		JournalAppend( Data, i->first.first );
+		JournalAppend( Data, i->first.second );
+		JournalAppend( Data, i->second );
+	}
+
+	JournalAppend( Data, (uint32_t)gamedata->m_W3MMDVarStrings.size( ) );
+
+	for( map<VarP,string> :: iterator i = gamedata->m_W3MMDVarStrings.begin( ); i != gamedata->m_W3MMDVarStrings.end( ); ++i )
+	{
+		JournalAppend( Data, i->first.first );
+		JournalAppend( Data, i->first.second );
+		JournalAppend( Data, i->second );
+	}
+
+	return Data;
+}
+
+CDBGameData *CGHostDBJournal :: DeserializeGameData( const string &data )
+{
+	// returns NULL if the data is corrupt
+
+	CJournalReader Reader( data );
+	string Server = Reader.ReadString( );
+	string Map = Reader.ReadString( );
+	string GameName = Reader.ReadString( );
+	string OwnerName = Reader.ReadString( );
+	uint32_t Duration = Reader.ReadUInt32( );
+	uint32_t GameState = Reader.ReadUInt32( );
+	string CreatorName = Reader.ReadString( );
+	string CreatorServer = Reader.ReadString( );
+	CDBGameData *GameData = new CDBGameData( Server, Map, GameName, OwnerName, Duration, GameState, CreatorName, CreatorServer );
+	uint32_t NumPlayers = Reader.ReadUInt32( );
+
+	for( uint32_t i = 0; i < NumPlayers && Reader.GetValid( ); ++i )
+	{
+		uint32_t ID = Reader.ReadUInt32( );
+		uint32_t GameID = Reader.ReadUInt32( );
+		string Name = Reader.ReadString( );
+		string IP = Reader.ReadString( );
+		uint32_t Spoofed = Reader.ReadUInt32( );
+		string SpoofedRealm = Reader.ReadString( );
+		uint32_t Reserved = Reader.ReadUInt32( );
+		uint32_t LoadingTime = Reader.ReadUInt32( );
+		uint32_t Left = Reader.ReadUInt32( );
+		string LeftReason = Reader.ReadString( );
+		uint32_t Team = Reader.ReadUInt32( );
+		uint32_t Colour = Reader.ReadUInt32( );
+		GameData->m_Players.push_back( CDBGamePlayer( ID, GameID, Name, IP, Spoofed, SpoofedRealm, Reserved, LoadingTime, Left, LeftReason, Team, Colour ) );
+	}
+
+	GameData->m_DotA = Reader.ReadUInt32( ) != 0;
+	GameData->m_DotAWinner = Reader.ReadUInt32( );
+	GameData->m_DotAMin = Reader.ReadUInt32( );
+	GameData->m_DotASec = Reader.ReadUInt32( );
+	uint32_t NumDotAPlayers = Reader.ReadUInt32( );
+
+	for( uint32_t i = 0; i < NumDotAPlayers && Reader.GetValid( ); ++i )
+	{
+		uint32_t ID = Reader.ReadUInt32( );
+		uint32_t GameID = Reader.ReadUInt32( );
+		uint32_t Colour = Reader.ReadUInt32( );
+		uint32_t Kills = Reader.ReadUInt32( );
+		uint32_t Deaths = Reader.ReadUInt32( );
+		uint32_t CreepKills = Reader.ReadUInt32( );
+		uint32_t CreepDenies = Reader.ReadUInt32( );
+		uint32_t Assists = Reader.ReadUInt32( );
+		uint32_t Gold = Reader.ReadUInt32( );
+		uint32_t NeutralKills = Reader.ReadUInt32( );
+		string Items[6];
+
+		for( unsigned int j = 0; j < 6; ++j )
+			Items[j] = Reader.ReadString( );
+
+		string Hero = Reader.ReadString( );
+		uint32_t NewColour = Reader.ReadUInt32( );
+		uint32_t TowerKills = Reader.ReadUInt32( );
+		uint32_t RaxKills = Reader.ReadUInt32( );
+		uint32_t CourierKills = Reader.ReadUInt32( );
+		GameData->m_DotAPlayers.push_back( CDBDotAPlayer( ID, GameID, Colour, Kills, Deaths, CreepKills, CreepDenies, Assists, Gold, NeutralKills, Items[0], Items[1], Items[2], Items[3], Items[4], Items[5], Hero, NewColour, TowerKills, RaxKills, CourierKills ) );
+	}
+
+	GameData->m_W3MMDCategory = Reader.ReadString( );
+	uint32_t NumW3MMDPlayers = Reader.ReadUInt32( );
+
+	for( uint32_t i = 0; i < NumW3MMDPlayers && Reader.GetValid( ); ++i )
+	{
+		uint32_t PID = Reader.ReadUInt32( );
+		string Name = Reader.ReadString( );
+		string Flag = Reader.ReadString( );
+		uint32_t Leaver = Reader.ReadUInt32( );
+		uint32_t Practicing = Reader.ReadUInt32( );
+		GameData->m_W3MMDPlayers.push_back( CDBW3MMDPlayer( PID, Name, Flag, Leaver, Practicing ) );
+	}
+
+	uint32_t NumVarInts = Reader.ReadUInt32( );
+
+	for( uint32_t i = 0; i < NumVarInts && Reader.GetValid( ); ++i )
+	{
+		uint32_t PID = Reader.ReadUInt32( );
+		string Name = Reader.ReadString( );
+		GameData->m_W3MMDVarInts[VarP( PID, Name )] = (int32_t)Reader.ReadUInt32( );
+	}
+
+	uint32_t NumVarReals = Reader.ReadUInt32( );
+
+	for( uint32_t i = 0; i < NumVarReals && Reader.GetValid( ); ++i )
+	{
+		uint32_t PID = Reader.ReadUInt32( );
+		string Name = Reader.ReadString( );
+		GameData->m_W3MMDVarReals[VarP( PID, Name )] = Reader.ReadDouble( );
+	}
+
+	uint32_t NumVarStrings = Reader.ReadUInt32( );
+
+	for( uint32_t i = 0; i < NumVarStrings && Reader.GetValid( ); ++i )
+	{
+		uint32_t PID = Reader.ReadUInt32( );
+		string Name = Reader.ReadString( );
+		GameData->m_W3MMDVarStrings[VarP( PID, Name )] = Reader.ReadString( );
+	}
+
+	if( !Reader.GetValid( ) )
+	{
+		delete GameData;
+		return NULL;
+	}
+
+	return GameData;
+}
@@ -0,0 +1,201 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#ifndef GHOSTDBJOURNAL_H
+#define GHOSTDBJOURNAL_H
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+//
+// CGHostDBJournal
+//
+
+// puts a local journal in front of the real database so a slow or unreachable database server can't stall the bot or lose the data it writes
+// the game data, map downloads, bans and ban removes are appended to the journal and their callables are ready straight away, a replayer thread saves them to the real database afterwards
+// ban removes go through the journal too so they're saved after any earlier ban of the same user, otherwise the ban could be saved after it was removed and come back
+// if the real database fails to save something the replayer tries again later (waiting longer each time) so nothing is lost while the database server is down
+// a record which keeps failing while other records are being saved can never be saved (e.g. the database rejects it), after db_journalmaxattempts such failures it's moved to failed.dat so it doesn't hold up the records behind it
+// a record can be saved twice if the bot exits after saving it but before writing the checkpoint, the game data is saved with a journal key (the journal ID and the sequence number) so the database only saves each game once
+// the journal ID is chosen randomly when the journal directory is created (and again if the checkpoint is missing) so sequence numbers starting over don't match games saved before
+// map downloads, bans and ban removes don't have a journal key so they can be saved twice in this case
+// everything else is passed straight through to the real database
+
+// the journal is a series of append only segment files in the journal directory, each record is [length][CRC32][sequence number][type][data]
+// records are flushed to the operating system as soon as they're appended so they survive the bot crashing, the replayer thread fsyncs them at most every db_journalsyncinterval milliseconds
+// the checkpoint file holds the sequence numbers of the records which have been saved so a record isn't saved twice when the bot restarts, it's synced and replaced in one step so it's never lost
+// a segment is deleted once all its records have been saved, when the bot starts it picks up the unsaved records from the segments which are left
+
+class CCRC32;
+class CScoreCache;
+
+class CGHostDBJournal : public CGHostDB
+{
+public:
+	enum RecordType {
+		JOURNAL_GAMEDATA	= 1,
+		JOURNAL_DOWNLOAD	= 2,
+		JOURNAL_BAN			= 3,
+		JOURNAL_BANREMOVE	= 4
+	};
+
+private:
+	struct CJournalRecord
+	{
+		uint32_t m_Sequence;
+		uint32_t m_Segment;							// the segment the record was written to
+		unsigned char m_Type;
+		string m_Data;
+		uint32_t m_Attempts;						// the number of times the record failed to save while the database was saving other records
+		uint32_t m_LastFailTicks;					// GetTicks when the record last failed to save
+		uint32_t m_RetryDelay;						// how long the replayer waits after m_LastFailTicks before trying the record again (zero if it hasn't failed)
+		uint32_t m_FailedSaved;						// m_NumSaved when the record last failed to save
+
+		CJournalRecord( ) : m_Sequence( 0 ), m_Segment( 0 ), m_Type( 0 ), m_Attempts( 0 ), m_LastFailTicks( 0 ), m_RetryDelay( 0 ), m_FailedSaved( 0xFFFFFFFF ) { }
+	};
+
+	CGHostDB *m_DB;									// the real database
+	CScoreCache *m_ScoreCache;						// the scores of the games rated by the real database are put in the score cache when they're saved
+	CCRC32 *m_CRC;
+	bool m_Enabled;									// false if the journal directory couldn't be used (everything is passed straight through)
+	string m_Path;									// config value: the journal directory
+	string m_JournalID;								// identifies this journal directory in the journal keys
+	uint32_t m_SegmentSize;							// config value: start a new segment once the current one is this large
+	uint32_t m_SyncInterval;						// config value: the maximum number of milliseconds between fsyncs
+	uint32_t m_BatchSize;							// config value: the maximum number of records the replayer saves at once
+	uint32_t m_MaxAttempts;							// config value: move a record to failed.dat after it fails this many times while other records are being saved (0 = never)
+	boost :: thread *m_Thread;						// the replayer thread
+
+	FILE *m_File;									// the segment being appended to (NULL until the first append after starting a new segment)
+	uint32_t m_Segment;								// the number of the segment being appended to
+	uint32_t m_FileSize;							// the size of the segment being appended to
+	uint32_t m_NextSequence;						// the sequence number of the next record
+	bool m_Unsynced;								// set when records have been appended since the last fsync
+	boost :: mutex m_FileMutex;						// protects the members above (records can be appended by any thread), locked before m_Mutex when both are needed
+
+	deque<CJournalRecord> m_Records;				// the records which haven't been saved yet in sequence order
+	map<uint32_t, uint32_t> m_Segments;				// the number of unsaved records in each segment
+	uint32_t m_LastSegment;							// the newest segment (older segments are never appended to again)
+	uint32_t m_Checkpoint;							// every record before this sequence number has been saved
+	set<uint32_t> m_Saved;							// the records after m_Checkpoint which have been saved
+	uint32_t m_LastFailTicks;						// GetTicks when the replayer last failed to save a whole batch
+	uint32_t m_RetryDelay;							// how long the replayer waits after m_LastFailTicks before trying again (zero if the last batch didn't fail)
+	uint32_t m_NumSaved;							// the number of records saved since the bot started
+	uint32_t m_NumFailures;							// the number of times a record failed to save since the bot started
+	uint32_t m_NumMoved;							// the number of records moved to failed.dat since the bot started
+	bool m_Exiting;									// set when the replayer thread should exit
+	boost :: mutex m_Mutex;							// protects the members above
+	boost :: condition_variable m_Changed;			// signalled when a record is appended and when exiting
+
+public:
+	CGHostDBJournal( CConfig *CFG, CGHostDB *nDB, CScoreCache *nScoreCache );
+	virtual ~CGHostDBJournal( );
+
+	virtual string GetStatus( );
+
+	virtual void RecoverCallable( CBaseCallable *callable );
+
+	// threaded database functions
+
+	virtual void CreateThread( CBaseCallable *callable )	{ m_DB->CreateThread( callable ); }
+	virtual CCallableAdminCount *ThreadedAdminCount( string server )								{ return m_DB->ThreadedAdminCount( server ); }
+	virtual CCallableAdminCheck *ThreadedAdminCheck( string server, string user )					{ return m_DB->ThreadedAdminCheck( server, user ); }
+	virtual CCallableAdminAdd *ThreadedAdminAdd( string server, string user )						{ return m_DB->ThreadedAdminAdd( server, user ); }
+	virtual CCallableAdminRemove *ThreadedAdminRemove( string server, string user )					{ return m_DB->ThreadedAdminRemove( server, user ); }
+	virtual CCallableAdminList *ThreadedAdminList( string server )									{ return m_DB->ThreadedAdminList( server ); }
+	virtual CCallableBanCount *ThreadedBanCount( string server )									{ return m_DB->ThreadedBanCount( server ); }
+	virtual CCallableBanCheck *ThreadedBanCheck( string server, string user, string ip )			{ return m_DB->ThreadedBanCheck( server, user, ip ); }
+	virtual CCallableBanAdd *ThreadedBanAdd( string server, string user, string ip, string gamename, string admin, string reason );
+	virtual CCallableBanRemove *ThreadedBanRemove( string server, string user );
+	virtual CCallableBanRemove *ThreadedBanRemove( string user );
+	virtual CCallableBanList *ThreadedBanList( string server )										{ return m_DB->ThreadedBanList( server ); }
+	virtual CCallableGameAdd *ThreadedGameAdd( string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver )	{ return m_DB->ThreadedGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver ); }
+	virtual CCallableGamePlayerAdd *ThreadedGamePlayerAdd( uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour )	{ return m_DB->ThreadedGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour ); }
+	virtual CCallableGamePlayerSummaryCheck *ThreadedGamePlayerSummaryCheck( string name )			{ return m_DB->ThreadedGamePlayerSummaryCheck( name ); }
+	virtual CCallableDotAGameAdd *ThreadedDotAGameAdd( uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec )	{ return m_DB->ThreadedDotAGameAdd( gameid, winner, min, sec ); }
+	virtual CCallableDotAPlayerAdd *ThreadedDotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills )	{ return m_DB->ThreadedDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ); }
+	virtual CCallableDotAPlayerSummaryCheck *ThreadedDotAPlayerSummaryCheck( string name )			{ return m_DB->ThreadedDotAPlayerSummaryCheck( name ); }
+	virtual CCallableDownloadAdd *ThreadedDownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime );
+	virtual CCallableScoreCheck *ThreadedScoreCheck( string category, vector<string> names, vector<string> servers )	{ return m_DB->ThreadedScoreCheck( category, names, servers ); }
+	virtual CCallableW3MMDPlayerAdd *ThreadedW3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing )	{ return m_DB->ThreadedW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing ); }
+	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints )	{ return m_DB->ThreadedW3MMDVarAdd( gameid, var_ints ); }
+	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals )	{ return m_DB->ThreadedW3MMDVarAdd( gameid, var_reals ); }
+	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings )	{ return m_DB->ThreadedW3MMDVarAdd( gameid, var_strings ); }
+	virtual CCallableGameDataAdd *ThreadedGameDataAdd( CDBGameData *gamedata );
+
+private:
+	CCallableBanRemove *BanRemove( string server, string user, bool allServers );
+	uint32_t Append( unsigned char type, const string &data );
+	bool LoadJournalID( );
+	void Recover( );
+	void Sync( bool force );
+	CBaseCallable *StartSave( CJournalRecord &record );
+	bool GetSaved( CBaseCallable *callable );
+	string GetSegmentFileName( uint32_t segment );
+	void MoveFailed( const CJournalRecord &record, const string &error );
+	void ReplayerThread( );
+
+	static string SerializeGameData( CDBGameData *gamedata );
+	static CDBGameData *DeserializeGameData( const string &data );
+};
+
+//
+// journal callables
+//
+
+// the callables returned for the records added to the journal, they're ready as soon as they're created
+// their result is the record's sequence number for the game data and true otherwise since the real result isn't known until the record is saved
+
+class CJournalCallable : virtual public CBaseCallable
+{
+public:
+	CJournalCallable( ) : CBaseCallable( ) { }
+	virtual ~CJournalCallable( ) { }
+};
+
+class CJournalCallableBanAdd : public CCallableBanAdd, public CJournalCallable
+{
+public:
+	CJournalCallableBanAdd( string nServer, string nUser, string nIP, string nGameName, string nAdmin, string nReason ) : CBaseCallable( ), CCallableBanAdd( nServer, nUser, nIP, nGameName, nAdmin, nReason ), CJournalCallable( ) { }
+	virtual ~CJournalCallableBanAdd( ) { }
+};
+
+class CJournalCallableBanRemove : public CCallableBanRemove, public CJournalCallable
+{
+public:
+	CJournalCallableBanRemove( string nServer, string nUser ) : CBaseCallable( ), CCallableBanRemove( nServer, nUser ), CJournalCallable( ) { }
+	virtual ~CJournalCallableBanRemove( ) { }
+};
+
+class CJournalCallableDownloadAdd : public CCallableDownloadAdd, public CJournalCallable
+{
+public:
+	CJournalCallableDownloadAdd( string nMap, uint32_t nMapSize, string nName, string nIP, uint32_t nSpoofed, string nSpoofedRealm, uint32_t nDownloadTime ) : CBaseCallable( ), CCallableDownloadAdd( nMap, nMapSize, nName, nIP, nSpoofed, nSpoofedRealm, nDownloadTime ), CJournalCallable( ) { }
+	virtual ~CJournalCallableDownloadAdd( ) { }
+};
+
+class CJournalCallableGameDataAdd : public CCallableGameDataAdd, public CJournalCallable
+{
+public:
+	CJournalCallableGameDataAdd( CDBGameData *nGameData ) : CBaseCallable( ), CCallableGameDataAdd( nGameData ), CJournalCallable( ) { }
+	virtual ~CJournalCallableGameDataAdd( ) { }
+};
+
+#endif
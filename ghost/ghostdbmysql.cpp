@@ -25,6 +25,7 @@
 #include "config.h"
 #include "ghostdb.h"
 #include "ghostdbmysql.h"
+#include "elo.h"
 
 #include <signal.h>
 
@@ -33,7 +34,10 @@
 #endif
 
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
 #include <boost/thread.hpp>
+#include <boost/bind.hpp>
 
 //
 // CGHostDBMySQL
@@ -47,46 +51,138 @@ CGHostDBMySQL :: CGHostDBMySQL( CConfig *CFG ) : CGHostDB( CFG )
 	m_Password = CFG->GetString( "db_mysql_password", string( ) );
 	m_Port = CFG->GetInt( "db_mysql_port", 0 );
 	m_BotID = CFG->GetInt( "db_mysql_botid", 0 );
-	m_NumConnections = 1;
+	m_MaxQueued = CFG->GetInt( "db_mysql_maxqueued", 1000 );
+	m_UpdateSummaries = true;
+	m_UpdateScores = CFG->GetInt( "db_mysql_updatescores", 0 ) == 0 ? false : true;
+	m_JournalGames = false;
+	m_NumConnections = 0;
+	m_NumBusy = 0;
 	m_OutstandingCallables = 0;
+	m_MaxQueueDepth = 0;
+	m_NumWaits = 0;
+	m_NumPrepares = 0;
+	m_NumExecutes = 0;
+	m_NextLatency = 0;
+	m_Exiting = false;
+	uint32_t NumWorkers = CFG->GetInt( "db_mysql_workers", 4 );
+
+	if( NumWorkers == 0 )
+		NumWorkers = 1;
+
+	if( m_MaxQueued == 0 )
+		m_MaxQueued = 1;
 
 	mysql_library_init( 0, NULL, NULL );
 
 	// create the first connection
 
 	CONSOLE_Print( "[MYSQL] connecting to database server" );
-	MYSQL *Connection = NULL;
+	CMySQLConnection *Connection = Connect( );
 
-	if( !( Connection = mysql_init( NULL ) ) )
+	if( !Connection )
 	{
-		CONSOLE_Print( string( "[MYSQL] " ) + mysql_error( Connection ) );
 		m_HasError = true;
-		m_Error = "error initializing MySQL connection";
+		m_Error = "error connecting to MySQL server";
 		return;
 	}
 
-	my_bool Reconnect = true;
-	mysql_options( Connection, MYSQL_OPT_RECONNECT, &Reconnect );
+	// the player summary tables are created by mysql_upgrade_v2-v3.sql, if it hasn't been run yet we save games without updating the summaries rather than failing to save every game
 
-	if( !( mysql_real_connect( Connection, m_Server.c_str( ), m_User.c_str( ), m_Password.c_str( ), m_Database.c_str( ), m_Port, NULL, 0 ) ) )
+	string SchemaError;
+	CMySQLParams SchemaParams;
+	vector< vector<string> > SchemaRows;
+
+	if( Connection->Execute( &SchemaError, "SELECT COUNT(*) FROM information_schema.tables WHERE table_schema=DATABASE() AND table_name IN ( 'gameplayersummaries', 'dotaplayersummaries' )", &SchemaParams, &SchemaRows ) && !SchemaRows.empty( ) && !SchemaRows[0].empty( ) && UTIL_ToUInt32( SchemaRows[0][0] ) < 2 )
 	{
-		CONSOLE_Print( string( "[MYSQL] " ) + mysql_error( Connection ) );
-		m_HasError = true;
-		m_Error = "error connecting to MySQL server";
-		return;
+		CONSOLE_Print( "[MYSQL] warning - the gameplayersummaries and dotaplayersummaries tables don't exist, please run mysql_upgrade_v2-v3.sql" );
+		CONSOLE_Print( "[MYSQL] warning - games will be saved without updating the player summaries and !stats and !statsdota won't work until the tables are created" );
+		m_UpdateSummaries = false;
+	}
+	else if( !SchemaError.empty( ) )
+		CONSOLE_Print( "[MYSQL] error checking for the player summary tables - " + SchemaError );
+
+	// the ELO tables are normally created by update_dota_elo and update_w3mmd_elo so they might not exist yet
+	// they're created here because MySQL would implicitly commit the game's transaction if they were created when rating a game
+	// each player has one score per server (and category) so the tables are keyed on that, tables created by older versions get the key added here
+
+	if( m_UpdateScores )
+	{
+		string Error;
+		CMySQLParams NoParams;
+
+		if( !Connection->Execute( &Error, "CREATE TABLE IF NOT EXISTS dota_elo_scores ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, name VARCHAR(15) NOT NULL, server VARCHAR(100) NOT NULL, score REAL NOT NULL, UNIQUE KEY name_server ( name, server ) )", &NoParams ) ||
+			!Connection->Execute( &Error, "CREATE TABLE IF NOT EXISTS dota_elo_games_scored ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, gameid INT NOT NULL )", &NoParams ) ||
+			!Connection->Execute( &Error, "CREATE TABLE IF NOT EXISTS w3mmd_elo_scores ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, category VARCHAR(25) NOT NULL, name VARCHAR(15) NOT NULL, server VARCHAR(100) NOT NULL, score REAL NOT NULL, UNIQUE KEY category_name_server ( category, name, server ) )", &NoParams ) ||
+			!Connection->Execute( &Error, "CREATE TABLE IF NOT EXISTS w3mmd_elo_games_scored ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, category VARCHAR(25), gameid INT NOT NULL )", &NoParams ) ||
+			!MySQLEloUniqueKeyAdd( Connection, &Error, "dota_elo_scores", "name_server", "name, server", "a.name=b.name AND a.server=b.server" ) ||
+			!MySQLEloUniqueKeyAdd( Connection, &Error, "w3mmd_elo_scores", "category_name_server", "category, name, server", "a.category=b.category AND a.name=b.name AND a.server=b.server" ) )
+		{
+			CONSOLE_Print( "[MYSQL] error creating ELO tables, games won't be rated when they're saved - " + Error );
+			m_UpdateScores = false;
+		}
+		else
+			CONSOLE_Print( "[MYSQL] games will be rated when they're saved" );
 	}
 
-	m_IdleConnections.push( Connection );
+	// the journalgames table remembers which journal records have been saved so a game replayed from the journal twice is only saved once
+	// it's only needed when the journal is enabled (see CGHostDBJournal)
+
+	if( !CFG->GetString( "db_journalpath", string( ) ).empty( ) )
+	{
+		string Error;
+		CMySQLParams NoParams;
+
+		if( Connection->Execute( &Error, "CREATE TABLE IF NOT EXISTS journalgames ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, journalkey VARCHAR(64) NOT NULL UNIQUE, gameid INT NOT NULL )", &NoParams ) )
+			m_JournalGames = true;
+		else
+			CONSOLE_Print( "[MYSQL] error creating journalgames table, games replayed from the journal might be saved twice - " + Error );
+	}
+
+	// start the worker threads, the first worker takes over the first connection and the others connect by themselves
+
+	CONSOLE_Print( "[MYSQL] starting " + UTIL_ToString( NumWorkers ) + " database worker threads" );
+
+	for( uint32_t i = 0; i < NumWorkers; ++i )
+	{
+		try
+		{
+			m_Workers.push_back( new boost :: thread( boost :: bind( &CGHostDBMySQL :: WorkerThread, this, m_Workers.empty( ) ? Connection : NULL ) ) );
+		}
+		catch( boost :: thread_resource_error tre )
+		{
+			CONSOLE_Print( "[MYSQL] error spawning worker thread [" + string( tre.what( ) ) + "]" );
+		}
+	}
+
+	if( m_Workers.empty( ) )
+	{
+		delete Connection;
+		m_HasError = true;
+		m_Error = "error spawning MySQL worker threads";
+	}
 }
 
 CGHostDBMySQL :: ~CGHostDBMySQL( )
 {
-	CONSOLE_Print( "[MYSQL] closing " + UTIL_ToString( m_IdleConnections.size( ) ) + "/" + UTIL_ToString( m_NumConnections ) + " idle MySQL connections" );
+	// callables which haven't been started yet are discarded, the workers finish the callables they're running and exit
+
+	{
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
 
-	while( !m_IdleConnections.empty( ) )
+		if( !m_Queue.empty( ) )
+			CONSOLE_Print( "[MYSQL] discarding " + UTIL_ToString( m_Queue.size( ) ) + " queued callables" );
+
+		m_Queue.clear( );
+		m_Exiting = true;
+	}
+
+	m_QueueNotEmpty.notify_all( );
+	CONSOLE_Print( "[MYSQL] waiting for " + UTIL_ToString( m_Workers.size( ) ) + " database worker threads to finish" );
+
+	for( vector<boost :: thread *> :: iterator i = m_Workers.begin( ); i != m_Workers.end( ); ++i )
 	{
-		mysql_close( (MYSQL *)m_IdleConnections.front( ) );
-		m_IdleConnections.pop( );
+		(*i)->join( );
+		delete *i;
 	}
 
 	if( m_OutstandingCallables > 0 )
@@ -97,27 +193,33 @@ CGHostDBMySQL :: ~CGHostDBMySQL( )
 
 string CGHostDBMySQL :: GetStatus( )
 {
-	return "DB STATUS --- Connections: " + UTIL_ToString( m_IdleConnections.size( ) ) + "/" + UTIL_ToString( m_NumConnections ) + " idle. Outstanding callables: " + UTIL_ToString( m_OutstandingCallables ) + ".";
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	string Status = "DB STATUS --- Connections: " + UTIL_ToString( m_NumConnections ) + "/" + UTIL_ToString( m_Workers.size( ) ) + " workers connected, " + UTIL_ToString( m_NumBusy ) + " busy. Queue: " + UTIL_ToString( m_Queue.size( ) ) + "/" + UTIL_ToString( m_MaxQueued ) + " (max " + UTIL_ToString( m_MaxQueueDepth ) + ", waited " + UTIL_ToString( m_NumWaits ) + " times). Outstanding callables: " + UTIL_ToString( m_OutstandingCallables ) + ". Statements: " + UTIL_ToString( m_NumExecutes ) + " executed, " + UTIL_ToString( m_NumPrepares ) + " prepared.";
+
+	if( !m_Latencies.empty( ) )
+	{
+		vector<uint32_t> Latencies = m_Latencies;
+		sort( Latencies.begin( ), Latencies.end( ) );
+		Status += " Latency: " + UTIL_ToString( Latencies[Latencies.size( ) / 2] ) + "/" + UTIL_ToString( Latencies[Latencies.size( ) * 95 / 100] ) + "/" + UTIL_ToString( Latencies[Latencies.size( ) * 99 / 100] ) + "/" + UTIL_ToString( Latencies.back( ) ) + "ms (50/95/99/100%).";
+	}
+
+	return Status;
 }
 
 void CGHostDBMySQL :: RecoverCallable( CBaseCallable *callable )
 {
+	// the connection belongs to the worker thread which ran the callable so there's nothing to recover except the callable count
+
 	CMySQLCallable *MySQLCallable = dynamic_cast<CMySQLCallable *>( callable );
 
 	if( MySQLCallable )
 	{
-		if( m_IdleConnections.size( ) > 30 )
-		{
-			mysql_close( (MYSQL *)MySQLCallable->GetConnection( ) );
-                        --m_NumConnections;
-		}
-		else
-			m_IdleConnections.push( MySQLCallable->GetConnection( ) );
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
 
 		if( m_OutstandingCallables == 0 )
 			CONSOLE_Print( "[MYSQL] recovered a mysql callable with zero outstanding" );
 		else
-                        --m_OutstandingCallables;
+			--m_OutstandingCallables;
 
 		if( !MySQLCallable->GetError( ).empty( ) )
 			CONSOLE_Print( "[MYSQL] error --- " + MySQLCallable->GetError( ) );
@@ -128,937 +230,966 @@ void CGHostDBMySQL :: RecoverCallable( CBaseCallable *callable )
 
 void CGHostDBMySQL :: CreateThread( CBaseCallable *callable )
 {
-	try
+	// queue the callable for the next idle worker thread
+	// if the queue is full we wait until a worker takes a callable from the queue, this stops a burst of callables from piling up without limit
+
+	CMySQLCallable *MySQLCallable = dynamic_cast<CMySQLCallable *>( callable );
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	++m_OutstandingCallables;
+
+	if( !MySQLCallable || m_Workers.empty( ) )
 	{
-		boost :: thread Thread( boost :: ref( *callable ) );
+		CONSOLE_Print( "[MYSQL] error queueing callable, no worker threads are available" );
+		callable->SetReady( true );
+		return;
 	}
-	catch( boost :: thread_resource_error tre )
+
+	if( m_Queue.size( ) >= m_MaxQueued )
 	{
-		CONSOLE_Print( "[MYSQL] error spawning thread on attempt #1 [" + string( tre.what( ) ) + "], pausing execution and trying again in 50ms" );
-		MILLISLEEP( 50 );
+		++m_NumWaits;
 
-		try
-		{
-			boost :: thread Thread( boost :: ref( *callable ) );
-		}
-		catch( boost :: thread_resource_error tre2 )
-		{
-			CONSOLE_Print( "[MYSQL] error spawning thread on attempt #2 [" + string( tre2.what( ) ) + "], giving up" );
-			callable->SetReady( true );
-		}
+		while( m_Queue.size( ) >= m_MaxQueued )
+			m_QueueNotFull.wait( Lock );
 	}
+
+	m_Queue.push_back( make_pair( MySQLCallable, GetTicks( ) ) );
+
+	if( m_Queue.size( ) > m_MaxQueueDepth )
+		m_MaxQueueDepth = m_Queue.size( );
+
+	Lock.unlock( );
+	m_QueueNotEmpty.notify_one( );
 }
 
 CCallableAdminCount *CGHostDBMySQL :: ThreadedAdminCount( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminCount *Callable = new CMySQLCallableAdminCount( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableAdminCount *Callable = new CMySQLCallableAdminCount( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableAdminCheck *CGHostDBMySQL :: ThreadedAdminCheck( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminCheck *Callable = new CMySQLCallableAdminCheck( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableAdminCheck *Callable = new CMySQLCallableAdminCheck( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableAdminAdd *CGHostDBMySQL :: ThreadedAdminAdd( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminAdd *Callable = new CMySQLCallableAdminAdd( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableAdminAdd *Callable = new CMySQLCallableAdminAdd( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableAdminRemove *CGHostDBMySQL :: ThreadedAdminRemove( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminRemove *Callable = new CMySQLCallableAdminRemove( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableAdminRemove *Callable = new CMySQLCallableAdminRemove( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableAdminList *CGHostDBMySQL :: ThreadedAdminList( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableAdminList *Callable = new CMySQLCallableAdminList( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableAdminList *Callable = new CMySQLCallableAdminList( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableBanCount *CGHostDBMySQL :: ThreadedBanCount( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanCount *Callable = new CMySQLCallableBanCount( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableBanCount *Callable = new CMySQLCallableBanCount( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableBanCheck *CGHostDBMySQL :: ThreadedBanCheck( string server, string user, string ip )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanCheck *Callable = new CMySQLCallableBanCheck( server, user, ip, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableBanCheck *Callable = new CMySQLCallableBanCheck( server, user, ip, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableBanAdd *CGHostDBMySQL :: ThreadedBanAdd( string server, string user, string ip, string gamename, string admin, string reason )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanAdd *Callable = new CMySQLCallableBanAdd( server, user, ip, gamename, admin, reason, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableBanAdd *Callable = new CMySQLCallableBanAdd( server, user, ip, gamename, admin, reason, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableBanRemove *CGHostDBMySQL :: ThreadedBanRemove( string server, string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( server, user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( server, user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableBanRemove *CGHostDBMySQL :: ThreadedBanRemove( string user )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( string( ), user, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableBanRemove *Callable = new CMySQLCallableBanRemove( string( ), user, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableBanList *CGHostDBMySQL :: ThreadedBanList( string server )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableBanList *Callable = new CMySQLCallableBanList( server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableBanList *Callable = new CMySQLCallableBanList( server, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableGameAdd *CGHostDBMySQL :: ThreadedGameAdd( string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGameAdd *Callable = new CMySQLCallableGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableGameAdd *Callable = new CMySQLCallableGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableGamePlayerAdd *CGHostDBMySQL :: ThreadedGamePlayerAdd( uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGamePlayerAdd *Callable = new CMySQLCallableGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableGamePlayerAdd *Callable = new CMySQLCallableGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableGamePlayerSummaryCheck *CGHostDBMySQL :: ThreadedGamePlayerSummaryCheck( string name )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableGamePlayerSummaryCheck *Callable = new CMySQLCallableGamePlayerSummaryCheck( name, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableGamePlayerSummaryCheck *Callable = new CMySQLCallableGamePlayerSummaryCheck( name, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableDotAGameAdd *CGHostDBMySQL :: ThreadedDotAGameAdd( uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDotAGameAdd *Callable = new CMySQLCallableDotAGameAdd( gameid, winner, min, sec, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableDotAGameAdd *Callable = new CMySQLCallableDotAGameAdd( gameid, winner, min, sec, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableDotAPlayerAdd *CGHostDBMySQL :: ThreadedDotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDotAPlayerAdd *Callable = new CMySQLCallableDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableDotAPlayerAdd *Callable = new CMySQLCallableDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableDotAPlayerSummaryCheck *CGHostDBMySQL :: ThreadedDotAPlayerSummaryCheck( string name )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDotAPlayerSummaryCheck *Callable = new CMySQLCallableDotAPlayerSummaryCheck( name, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableDotAPlayerSummaryCheck *Callable = new CMySQLCallableDotAPlayerSummaryCheck( name, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableDownloadAdd *CGHostDBMySQL :: ThreadedDownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableDownloadAdd *Callable = new CMySQLCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableDownloadAdd *Callable = new CMySQLCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
-CCallableScoreCheck *CGHostDBMySQL :: ThreadedScoreCheck( string category, string name, string server )
+CCallableScoreCheck *CGHostDBMySQL :: ThreadedScoreCheck( string category, vector<string> names, vector<string> servers )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableScoreCheck *Callable = new CMySQLCallableScoreCheck( category, name, server, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableScoreCheck *Callable = new CMySQLCallableScoreCheck( category, names, servers, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableW3MMDPlayerAdd *CGHostDBMySQL :: ThreadedW3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDPlayerAdd *Callable = new CMySQLCallableW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableW3MMDPlayerAdd *Callable = new CMySQLCallableW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBMySQL :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_ints, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_ints, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBMySQL :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals )
 {
-	void *Connection = GetIdleConnection( );
-
-	if( !Connection )
-                ++m_NumConnections;
-
-	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_reals, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_reals, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBMySQL :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings )
 {
-	void *Connection = GetIdleConnection( );
+	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_strings, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CreateThread( Callable );
+	return Callable;
+}
 
-	if( !Connection )
-                ++m_NumConnections;
+CCallableGameDataAdd *CGHostDBMySQL :: ThreadedGameDataAdd( CDBGameData *gamedata )
+{
+	if( !m_JournalGames )
+		gamedata->m_JournalKey.clear( );
 
-	CCallableW3MMDVarAdd *Callable = new CMySQLCallableW3MMDVarAdd( gameid, var_strings, Connection, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
+	CCallableGameDataAdd *Callable = new CMySQLCallableGameDataAdd( gamedata, m_UpdateSummaries, m_UpdateScores, NULL, m_BotID, m_Server, m_Database, m_User, m_Password, m_Port );
 	CreateThread( Callable );
-        ++m_OutstandingCallables;
 	return Callable;
 }
 
-void *CGHostDBMySQL :: GetIdleConnection( )
+CMySQLConnection *CGHostDBMySQL :: Connect( )
 {
-	void *Connection = NULL;
+	// open a new connection to the database server
+	// this is called by the constructor and by the worker threads so the worker threads must have called mysql_thread_init already
+
+	MYSQL *Connection = NULL;
 
-	if( !m_IdleConnections.empty( ) )
+	if( !( Connection = mysql_init( NULL ) ) )
 	{
-		Connection = m_IdleConnections.front( );
-		m_IdleConnections.pop( );
+		CONSOLE_Print( "[MYSQL] error initializing MySQL connection" );
+		return NULL;
 	}
 
-	return Connection;
-}
+	my_bool Reconnect = true;
+	mysql_options( Connection, MYSQL_OPT_RECONNECT, &Reconnect );
 
-//
-// unprototyped global helper functions
-//
+	if( !( mysql_real_connect( Connection, m_Server.c_str( ), m_User.c_str( ), m_Password.c_str( ), m_Database.c_str( ), m_Port, NULL, 0 ) ) )
+	{
+		CONSOLE_Print( string( "[MYSQL] " ) + mysql_error( Connection ) );
+		mysql_close( Connection );
+		return NULL;
+	}
 
-string MySQLEscapeString( void *conn, string str )
-{
-	char *to = new char[str.size( ) * 2 + 1];
-	unsigned long size = mysql_real_escape_string( (MYSQL *)conn, to, str.c_str( ), str.size( ) );
-	string result( to, size );
-	delete [] to;
-	return result;
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	++m_NumConnections;
+	return new CMySQLConnection( Connection );
 }
 
-vector<string> MySQLFetchRow( MYSQL_RES *res )
+void CGHostDBMySQL :: WorkerThread( CMySQLConnection *connection )
 {
-	vector<string> Result;
+#ifndef WIN32
+	// disable SIGPIPE since this is a new thread and it doesn't inherit the spawning thread's signal handlers
+	// MySQL should automatically disable SIGPIPE when we initialize it but we do so anyway here
 
-	MYSQL_ROW Row = mysql_fetch_row( res );
+	signal( SIGPIPE, SIG_IGN );
+#endif
 
-	if( Row )
+	mysql_thread_init( );
+
+	if( !connection )
+		connection = Connect( );
+
+	while( true )
 	{
-		unsigned long *Lengths;
-		Lengths = mysql_fetch_lengths( res );
+		CMySQLCallable *Callable = NULL;
+		uint32_t QueuedTicks = 0;
 
-                for( unsigned int i = 0; i < mysql_num_fields( res ); ++i )
 		{
-			if( Row[i] )
-				Result.push_back( string( Row[i], Lengths[i] ) );
-			else
-				Result.push_back( string( ) );
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+			while( m_Queue.empty( ) && !m_Exiting )
+				m_QueueNotEmpty.wait( Lock );
+
+			if( m_Exiting )
+				break;
+
+			Callable = m_Queue.front( ).first;
+			QueuedTicks = m_Queue.front( ).second;
+			m_Queue.pop_front( );
+			++m_NumBusy;
 		}
+
+		m_QueueNotFull.notify_one( );
+
+		// try to reconnect if we lost (or never had) our connection, the callable reports an error if we still don't have one
+
+		if( !connection )
+			connection = Connect( );
+
+		uint32_t NumPrepares = connection ? connection->GetNumPrepares( ) : 0;
+		uint32_t NumExecutes = connection ? connection->GetNumExecutes( ) : 0;
+		Callable->SetConnection( connection );
+		( *Callable )( );
+
+		// the callable can be deleted as soon as it's ready so we can't touch it any more
+
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
+		--m_NumBusy;
+
+		if( connection )
+		{
+			m_NumPrepares += connection->GetNumPrepares( ) - NumPrepares;
+			m_NumExecutes += connection->GetNumExecutes( ) - NumExecutes;
+		}
+
+		if( m_Latencies.size( ) < MYSQL_LATENCY_SAMPLES )
+			m_Latencies.push_back( GetTicks( ) - QueuedTicks );
+		else
+			m_Latencies[m_NextLatency] = GetTicks( ) - QueuedTicks;
+
+		m_NextLatency = ( m_NextLatency + 1 ) % MYSQL_LATENCY_SAMPLES;
+	}
+
+	if( connection )
+	{
+		delete connection;
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
+		--m_NumConnections;
 	}
 
-	return Result;
+	mysql_thread_end( );
 }
 
 //
-// global helper functions
+// CMySQLConnection
 //
 
-uint32_t MySQLAdminCount( void *conn, string *error, uint32_t botid, string server )
+CMySQLConnection :: CMySQLConnection( void *nMySQL ) : m_MySQL( nMySQL ), m_InsertID( 0 ), m_NumPrepares( 0 ), m_NumExecutes( 0 ), m_InTransaction( false )
 {
-	string EscServer = MySQLEscapeString( conn, server );
-	uint32_t Count = 0;
-	string Query = "SELECT COUNT(*) FROM admins WHERE server='" + EscServer + "'";
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
+}
 
-		if( Result )
-		{
-			vector<string> Row = MySQLFetchRow( Result );
+CMySQLConnection :: ~CMySQLConnection( )
+{
+	for( map<string, void *> :: iterator i = m_Statements.begin( ); i != m_Statements.end( ); ++i )
+		mysql_stmt_close( (MYSQL_STMT *)i->second );
 
-			if( Row.size( ) == 1 )
-				Count = UTIL_ToUInt32( Row[0] );
-			else
-				*error = "error counting admins [" + server + "] - row doesn't have 1 column";
+	mysql_close( (MYSQL *)m_MySQL );
+}
 
-			mysql_free_result( Result );
-		}
-		else
-			*error = mysql_error( (MYSQL *)conn );
-	}
+void CMySQLConnection :: SetInTransaction( bool nInTransaction )
+{
+	// a reconnected session is in autocommit mode so if the connection was reconnected inside a transaction the rest of the transaction would be committed statement by statement
+	// instead we turn off automatically reconnecting while the transaction is open, if the connection is lost every statement after that fails and the server throws away the transaction
+	// the connection is reconnected by mysql_ping when the next callable starts (see CMySQLCallable :: Init)
 
-	return Count;
+	m_InTransaction = nInTransaction;
+	my_bool Reconnect = !m_InTransaction;
+	mysql_options( (MYSQL *)m_MySQL, MYSQL_OPT_RECONNECT, &Reconnect );
 }
 
-bool MySQLAdminCheck( void *conn, string *error, uint32_t botid, string server, string user )
+bool CMySQLConnection :: Execute( string *error, string query, CMySQLParams *params, vector< vector<string> > *rows )
 {
-	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscUser = MySQLEscapeString( conn, user );
-	bool IsAdmin = false;
-	string Query = "SELECT * FROM admins WHERE server='" + EscServer + "' AND name='" + EscUser + "'";
+	// run the query using this connection's prepared statement for it, the statement is prepared the first time the query is seen
+	// if the connection was lost and automatically reconnected the server has forgotten our statements so we prepare it again and retry once
+	// this never happens inside a transaction because the statements before it would have been lost with the connection
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	for( uint32_t Attempt = 0; Attempt < 2; ++Attempt )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
+		MYSQL_STMT *Statement = (MYSQL_STMT *)GetStatement( error, query );
+
+		if( !Statement )
+			return false;
+
+		// the binds point straight at the values in params so params must not change until the statement has been executed
 
-		if( Result )
+		vector<MYSQL_BIND> Binds( params->m_Types.size( ) );
+		uint32_t NextString = 0;
+		uint32_t NextInt = 0;
+
+		for( uint32_t i = 0; i < params->m_Types.size( ); ++i )
 		{
-			vector<string> Row = MySQLFetchRow( Result );
+			memset( &Binds[i], 0, sizeof( MYSQL_BIND ) );
 
-			if( !Row.empty( ) )
-				IsAdmin = true;
+			if( params->m_Types[i] == 's' )
+			{
+				string &Value = params->m_Strings[NextString++];
+				Binds[i].buffer_type = MYSQL_TYPE_STRING;
+				Binds[i].buffer = (void *)Value.data( );
+				Binds[i].buffer_length = Value.size( );
+			}
+			else
+			{
+				Binds[i].buffer_type = MYSQL_TYPE_LONG;
+				Binds[i].buffer = &params->m_Ints[NextInt++];
+				Binds[i].is_unsigned = 1;
+			}
+		}
 
-			mysql_free_result( Result );
+		++m_NumExecutes;
+
+		if( ( Binds.empty( ) || mysql_stmt_bind_param( Statement, &Binds[0] ) == 0 ) && mysql_stmt_execute( Statement ) == 0 )
+		{
+			m_InsertID = (uint32_t)mysql_stmt_insert_id( Statement );
+			bool Success = true;
+
+			if( rows )
+				Success = FetchRows( error, Statement, rows );
+
+			mysql_stmt_free_result( Statement );
+			return Success;
 		}
-		else
-			*error = mysql_error( (MYSQL *)conn );
+
+		unsigned int Error = mysql_stmt_errno( Statement );
+		*error = mysql_stmt_error( Statement );
+		CloseStatement( query );
+
+		if( m_InTransaction || ( Error != CR_SERVER_LOST && Error != CR_SERVER_GONE_ERROR && Error != ER_UNKNOWN_STMT_HANDLER ) )
+			return false;
 	}
 
-	return IsAdmin;
+	return false;
 }
 
-bool MySQLAdminAdd( void *conn, string *error, uint32_t botid, string server, string user )
+void *CMySQLConnection :: GetStatement( string *error, string query )
 {
-	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscUser = MySQLEscapeString( conn, user );
-	bool Success = false;
-	string Query = "INSERT INTO admins ( botid, server, name ) VALUES ( " + UTIL_ToString( botid ) + ", '" + EscServer + "', '" + EscUser + "' )";
+	map<string, void *> :: iterator i = m_Statements.find( query );
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		Success = true;
+	if( i != m_Statements.end( ) )
+		return i->second;
 
-	return Success;
+	MYSQL_STMT *Statement = mysql_stmt_init( (MYSQL *)m_MySQL );
+
+	if( !Statement )
+	{
+		*error = mysql_error( (MYSQL *)m_MySQL );
+		return NULL;
+	}
+
+	if( mysql_stmt_prepare( Statement, query.c_str( ), query.size( ) ) != 0 )
+	{
+		*error = mysql_stmt_error( Statement );
+		mysql_stmt_close( Statement );
+		return NULL;
+	}
+
+	++m_NumPrepares;
+	m_Statements[query] = Statement;
+	return Statement;
 }
 
-bool MySQLAdminRemove( void *conn, string *error, uint32_t botid, string server, string user )
+void CMySQLConnection :: CloseStatement( string query )
 {
-	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscUser = MySQLEscapeString( conn, user );
-	bool Success = false;
-	string Query = "DELETE FROM admins WHERE server='" + EscServer + "' AND name='" + EscUser + "'";
+	map<string, void *> :: iterator i = m_Statements.find( query );
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		Success = true;
-
-	return Success;
+	if( i != m_Statements.end( ) )
+	{
+		mysql_stmt_close( (MYSQL_STMT *)i->second );
+		m_Statements.erase( i );
+	}
 }
 
-vector<string> MySQLAdminList( void *conn, string *error, uint32_t botid, string server )
+bool CMySQLConnection :: FetchRows( string *error, void *statement, vector< vector<string> > *rows )
 {
-	string EscServer = MySQLEscapeString( conn, server );
-	vector<string> AdminList;
-	string Query = "SELECT name FROM admins WHERE server='" + EscServer + "'";
+	// every column is fetched as a string (the server converts numbers for us) so the callers can treat the rows just like mysql_fetch_row
+	// we don't know how long each value is until we've fetched the row so we bind empty buffers and fetch each column separately once we know its length
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	MYSQL_STMT *Statement = (MYSQL_STMT *)statement;
+
+	if( mysql_stmt_store_result( Statement ) != 0 )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
+		*error = mysql_stmt_error( Statement );
+		return false;
+	}
 
-		if( Result )
-		{
-			vector<string> Row = MySQLFetchRow( Result );
+	MYSQL_RES *Metadata = mysql_stmt_result_metadata( Statement );
+
+	if( !Metadata )
+		return true;
+
+	unsigned int NumFields = mysql_num_fields( Metadata );
+	mysql_free_result( Metadata );
 
-			while( !Row.empty( ) )
+	vector<MYSQL_BIND> Binds( NumFields );
+	vector<unsigned long> Lengths( NumFields );
+	vector<my_bool> Nulls( NumFields );
+
+	for( unsigned int i = 0; i < NumFields; ++i )
+	{
+		memset( &Binds[i], 0, sizeof( MYSQL_BIND ) );
+		Binds[i].buffer_type = MYSQL_TYPE_STRING;
+		Binds[i].length = &Lengths[i];
+		Binds[i].is_null = &Nulls[i];
+	}
+
+	if( NumFields > 0 && mysql_stmt_bind_result( Statement, &Binds[0] ) != 0 )
+	{
+		*error = mysql_stmt_error( Statement );
+		return false;
+	}
+
+	int RC;
+
+	while( ( RC = mysql_stmt_fetch( Statement ) ) == 0 || RC == MYSQL_DATA_TRUNCATED )
+	{
+		vector<string> Row;
+
+		for( unsigned int i = 0; i < NumFields; ++i )
+		{
+			if( Nulls[i] || Lengths[i] == 0 )
+				Row.push_back( string( ) );
+			else
 			{
-				AdminList.push_back( Row[0] );
-				Row = MySQLFetchRow( Result );
+				string Value( Lengths[i], 0 );
+				MYSQL_BIND Column;
+				memset( &Column, 0, sizeof( MYSQL_BIND ) );
+				Column.buffer_type = MYSQL_TYPE_STRING;
+				Column.buffer = &Value[0];
+				Column.buffer_length = Lengths[i];
+				mysql_stmt_fetch_column( Statement, &Column, i, 0 );
+				Row.push_back( Value );
 			}
-
-			mysql_free_result( Result );
 		}
-		else
-			*error = mysql_error( (MYSQL *)conn );
+
+		rows->push_back( Row );
 	}
 
-	return AdminList;
+	if( RC == 1 )
+	{
+		*error = mysql_stmt_error( Statement );
+		return false;
+	}
+
+	return true;
 }
 
-uint32_t MySQLBanCount( void *conn, string *error, uint32_t botid, string server )
+//
+// unprototyped global helper functions
+//
+
+string MySQLEscapeString( CMySQLConnection *conn, string str )
 {
-	string EscServer = MySQLEscapeString( conn, server );
-	uint32_t Count = 0;
-	string Query = "SELECT COUNT(*) FROM bans WHERE server='" + EscServer + "'";
+	char *to = new char[str.size( ) * 2 + 1];
+	unsigned long size = mysql_real_escape_string( (MYSQL *)conn->GetMySQL( ), to, str.c_str( ), str.size( ) );
+	string result( to, size );
+	delete [] to;
+	return result;
+}
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+bool MySQLExecute( CMySQLConnection *conn, string *error, string query )
+{
+	if( mysql_real_query( (MYSQL *)conn->GetMySQL( ), query.c_str( ), query.size( ) ) != 0 )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
+		*error = mysql_error( (MYSQL *)conn->GetMySQL( ) );
+		return false;
+	}
 
-		if( Result )
-		{
-			vector<string> Row = MySQLFetchRow( Result );
+	return true;
+}
 
-			if( Row.size( ) == 1 )
-				Count = UTIL_ToUInt32( Row[0] );
-			else
-				*error = "error counting bans [" + server + "] - row doesn't have 1 column";
+//
+// global helper functions
+//
 
-			mysql_free_result( Result );
-		}
+uint32_t MySQLAdminCount( CMySQLConnection *conn, string *error, uint32_t botid, string server )
+{
+	uint32_t Count = 0;
+	CMySQLParams Params;
+	Params.AddString( server );
+	vector< vector<string> > Rows;
+
+	if( conn->Execute( error, "SELECT COUNT(*) FROM admins WHERE server=?", &Params, &Rows ) )
+	{
+		if( !Rows.empty( ) && Rows[0].size( ) == 1 )
+			Count = UTIL_ToUInt32( Rows[0][0] );
 		else
-			*error = mysql_error( (MYSQL *)conn );
+			*error = "error counting admins [" + server + "] - row doesn't have 1 column";
 	}
 
 	return Count;
 }
 
-CDBBan *MySQLBanCheck( void *conn, string *error, uint32_t botid, string server, string user, string ip )
+bool MySQLAdminCheck( CMySQLConnection *conn, string *error, uint32_t botid, string server, string user )
 {
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscUser = MySQLEscapeString( conn, user );
-	string EscIP = MySQLEscapeString( conn, ip );
-	CDBBan *Ban = NULL;
-	string Query;
-
-	if( ip.empty( ) )
-		Query = "SELECT name, ip, DATE(date), gamename, admin, reason FROM bans WHERE server='" + EscServer + "' AND name='" + EscUser + "'";
-	else
-		Query = "SELECT name, ip, DATE(date), gamename, admin, reason FROM bans WHERE (server='" + EscServer + "' AND name='" + EscUser + "') OR ip='" + EscIP + "'";
+	bool IsAdmin = false;
+	CMySQLParams Params;
+	Params.AddString( server );
+	Params.AddString( user );
+	vector< vector<string> > Rows;
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	if( conn->Execute( error, "SELECT * FROM admins WHERE server=? AND name=?", &Params, &Rows ) )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
+		if( !Rows.empty( ) )
+			IsAdmin = true;
+	}
 
-		if( Result )
-		{
-			vector<string> Row = MySQLFetchRow( Result );
+	return IsAdmin;
+}
 
-			if( Row.size( ) == 6 )
-				Ban = new CDBBan( server, Row[0], Row[1], Row[2], Row[3], Row[4], Row[5] );
-			/* else
-				*error = "error checking ban [" + server + " : " + user + "] - row doesn't have 6 columns"; */
+bool MySQLAdminAdd( CMySQLConnection *conn, string *error, uint32_t botid, string server, string user )
+{
+	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddString( server );
+	Params.AddString( user );
+	return conn->Execute( error, "INSERT INTO admins ( botid, server, name ) VALUES ( ?, ?, ? )", &Params );
+}
 
-			mysql_free_result( Result );
+bool MySQLAdminRemove( CMySQLConnection *conn, string *error, uint32_t botid, string server, string user )
+{
+	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
+	CMySQLParams Params;
+	Params.AddString( server );
+	Params.AddString( user );
+	return conn->Execute( error, "DELETE FROM admins WHERE server=? AND name=?", &Params );
+}
+
+vector<string> MySQLAdminList( CMySQLConnection *conn, string *error, uint32_t botid, string server )
+{
+	vector<string> AdminList;
+	CMySQLParams Params;
+	Params.AddString( server );
+	vector< vector<string> > Rows;
+
+	if( conn->Execute( error, "SELECT name FROM admins WHERE server=?", &Params, &Rows ) )
+	{
+		for( vector< vector<string> > :: iterator i = Rows.begin( ); i != Rows.end( ); ++i )
+		{
+			if( (*i).size( ) == 1 )
+				AdminList.push_back( (*i)[0] );
 		}
-		else
-			*error = mysql_error( (MYSQL *)conn );
 	}
 
-	return Ban;
+	return AdminList;
 }
 
-bool MySQLBanAdd( void *conn, string *error, uint32_t botid, string server, string user, string ip, string gamename, string admin, string reason )
+uint32_t MySQLBanCount( CMySQLConnection *conn, string *error, uint32_t botid, string server )
 {
-	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscUser = MySQLEscapeString( conn, user );
-	string EscIP = MySQLEscapeString( conn, ip );
-	string EscGameName = MySQLEscapeString( conn, gamename );
-	string EscAdmin = MySQLEscapeString( conn, admin );
-	string EscReason = MySQLEscapeString( conn, reason );
-	bool Success = false;
-	string Query = "INSERT INTO bans ( botid, server, name, ip, date, gamename, admin, reason ) VALUES ( " + UTIL_ToString( botid ) + ", '" + EscServer + "', '" + EscUser + "', '" + EscIP + "', CURDATE( ), '" + EscGameName + "', '" + EscAdmin + "', '" + EscReason + "' )";
+	uint32_t Count = 0;
+	CMySQLParams Params;
+	Params.AddString( server );
+	vector< vector<string> > Rows;
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		Success = true;
+	if( conn->Execute( error, "SELECT COUNT(*) FROM bans WHERE server=?", &Params, &Rows ) )
+	{
+		if( !Rows.empty( ) && Rows[0].size( ) == 1 )
+			Count = UTIL_ToUInt32( Rows[0][0] );
+		else
+			*error = "error counting bans [" + server + "] - row doesn't have 1 column";
+	}
 
-	return Success;
+	return Count;
 }
 
-bool MySQLBanRemove( void *conn, string *error, uint32_t botid, string server, string user )
+CDBBan *MySQLBanCheck( CMySQLConnection *conn, string *error, uint32_t botid, string server, string user, string ip )
 {
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscUser = MySQLEscapeString( conn, user );
-	bool Success = false;
-	string Query = "DELETE FROM bans WHERE server='" + EscServer + "' AND name='" + EscUser + "'";
+	CDBBan *Ban = NULL;
+	CMySQLParams Params;
+	Params.AddString( server );
+	Params.AddString( user );
+	vector< vector<string> > Rows;
+	bool Success;
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
+	if( ip.empty( ) )
+		Success = conn->Execute( error, "SELECT name, ip, DATE(date), gamename, admin, reason FROM bans WHERE server=? AND name=?", &Params, &Rows );
 	else
-		Success = true;
+	{
+		Params.AddString( ip );
+		Success = conn->Execute( error, "SELECT name, ip, DATE(date), gamename, admin, reason FROM bans WHERE (server=? AND name=?) OR ip=?", &Params, &Rows );
+	}
 
-	return Success;
+	if( Success && !Rows.empty( ) && Rows[0].size( ) == 6 )
+		Ban = new CDBBan( server, Rows[0][0], Rows[0][1], Rows[0][2], Rows[0][3], Rows[0][4], Rows[0][5] );
+
+	return Ban;
 }
 
-bool MySQLBanRemove( void *conn, string *error, uint32_t botid, string user )
+bool MySQLBanAdd( CMySQLConnection *conn, string *error, uint32_t botid, string server, string user, string ip, string gamename, string admin, string reason )
 {
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
-	string EscUser = MySQLEscapeString( conn, user );
-	bool Success = false;
-	string Query = "DELETE FROM bans WHERE name='" + EscUser + "'";
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddString( server );
+	Params.AddString( user );
+	Params.AddString( ip );
+	Params.AddString( gamename );
+	Params.AddString( admin );
+	Params.AddString( reason );
+	return conn->Execute( error, "INSERT INTO bans ( botid, server, name, ip, date, gamename, admin, reason ) VALUES ( ?, ?, ?, ?, CURDATE( ), ?, ?, ? )", &Params );
+}
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		Success = true;
+bool MySQLBanRemove( CMySQLConnection *conn, string *error, uint32_t botid, string server, string user )
+{
+	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
+	CMySQLParams Params;
+	Params.AddString( server );
+	Params.AddString( user );
+	return conn->Execute( error, "DELETE FROM bans WHERE server=? AND name=?", &Params );
+}
 
-	return Success;
+bool MySQLBanRemove( CMySQLConnection *conn, string *error, uint32_t botid, string user )
+{
+	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
+	CMySQLParams Params;
+	Params.AddString( user );
+	return conn->Execute( error, "DELETE FROM bans WHERE name=?", &Params );
 }
 
-vector<CDBBan *> MySQLBanList( void *conn, string *error, uint32_t botid, string server )
+vector<CDBBan *> MySQLBanList( CMySQLConnection *conn, string *error, uint32_t botid, string server )
 {
-	string EscServer = MySQLEscapeString( conn, server );
 	vector<CDBBan *> BanList;
-	string Query = "SELECT name, ip, DATE(date), gamename, admin, reason FROM bans WHERE server='" + EscServer + "'";
+	CMySQLParams Params;
+	Params.AddString( server );
+	vector< vector<string> > Rows;
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	if( conn->Execute( error, "SELECT name, ip, DATE(date), gamename, admin, reason FROM bans WHERE server=?", &Params, &Rows ) )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
-
-		if( Result )
+		for( vector< vector<string> > :: iterator i = Rows.begin( ); i != Rows.end( ); ++i )
 		{
-			vector<string> Row = MySQLFetchRow( Result );
-
-			while( Row.size( ) == 6 )
-			{
-				BanList.push_back( new CDBBan( server, Row[0], Row[1], Row[2], Row[3], Row[4], Row[5] ) );
-				Row = MySQLFetchRow( Result );
-			}
-
-			mysql_free_result( Result );
+			if( (*i).size( ) == 6 )
+				BanList.push_back( new CDBBan( server, (*i)[0], (*i)[1], (*i)[2], (*i)[3], (*i)[4], (*i)[5] ) );
 		}
-		else
-			*error = mysql_error( (MYSQL *)conn );
 	}
 
 	return BanList;
 }
 
-uint32_t MySQLGameAdd( void *conn, string *error, uint32_t botid, string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver )
+uint32_t MySQLGameAdd( CMySQLConnection *conn, string *error, uint32_t botid, string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver )
 {
 	uint32_t RowID = 0;
-	string EscServer = MySQLEscapeString( conn, server );
-	string EscMap = MySQLEscapeString( conn, map );
-	string EscGameName = MySQLEscapeString( conn, gamename );
-	string EscOwnerName = MySQLEscapeString( conn, ownername );
-	string EscCreatorName = MySQLEscapeString( conn, creatorname );
-	string EscCreatorServer = MySQLEscapeString( conn, creatorserver );
-	string Query = "INSERT INTO games ( botid, server, map, datetime, gamename, ownername, duration, gamestate, creatorname, creatorserver ) VALUES ( " + UTIL_ToString( botid ) + ", '" + EscServer + "', '" + EscMap + "', NOW( ), '" + EscGameName + "', '" + EscOwnerName + "', " + UTIL_ToString( duration ) + ", " + UTIL_ToString( gamestate ) + ", '" + EscCreatorName + "', '" + EscCreatorServer + "' )";
-
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		RowID = mysql_insert_id( (MYSQL *)conn );
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddString( server );
+	Params.AddString( map );
+	Params.AddString( gamename );
+	Params.AddString( ownername );
+	Params.AddInt( duration );
+	Params.AddInt( gamestate );
+	Params.AddString( creatorname );
+	Params.AddString( creatorserver );
+
+	if( conn->Execute( error, "INSERT INTO games ( botid, server, map, datetime, gamename, ownername, duration, gamestate, creatorname, creatorserver ) VALUES ( ?, ?, ?, NOW( ), ?, ?, ?, ?, ?, ? )", &Params ) )
+		RowID = conn->GetInsertID( );
 
 	return RowID;
 }
 
-uint32_t MySQLGamePlayerAdd( void *conn, string *error, uint32_t botid, uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour )
+uint32_t MySQLGamePlayerAdd( CMySQLConnection *conn, string *error, uint32_t botid, uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour )
 {
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	uint32_t RowID = 0;
-	string EscName = MySQLEscapeString( conn, name );
-	string EscIP = MySQLEscapeString( conn, ip );
-	string EscSpoofedRealm = MySQLEscapeString( conn, spoofedrealm );
-	string EscLeftReason = MySQLEscapeString( conn, leftreason );
-	string Query = "INSERT INTO gameplayers ( botid, gameid, name, ip, spoofed, reserved, loadingtime, `left`, leftreason, team, colour, spoofedrealm ) VALUES ( " + UTIL_ToString( botid ) + ", " + UTIL_ToString( gameid ) + ", '" + EscName + "', '" + EscIP + "', " + UTIL_ToString( spoofed ) + ", " + UTIL_ToString( reserved ) + ", " + UTIL_ToString( loadingtime ) + ", " + UTIL_ToString( left ) + ", '" + EscLeftReason + "', " + UTIL_ToString( team ) + ", " + UTIL_ToString( colour ) + ", '" + EscSpoofedRealm + "' )";
-
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		RowID = mysql_insert_id( (MYSQL *)conn );
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddInt( gameid );
+	Params.AddString( name );
+	Params.AddString( ip );
+	Params.AddInt( spoofed );
+	Params.AddInt( reserved );
+	Params.AddInt( loadingtime );
+	Params.AddInt( left );
+	Params.AddString( leftreason );
+	Params.AddInt( team );
+	Params.AddInt( colour );
+	Params.AddString( spoofedrealm );
+
+	if( conn->Execute( error, "INSERT INTO gameplayers ( botid, gameid, name, ip, spoofed, reserved, loadingtime, `left`, leftreason, team, colour, spoofedrealm ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )", &Params ) )
+		RowID = conn->GetInsertID( );
 
 	return RowID;
 }
 
-CDBGamePlayerSummary *MySQLGamePlayerSummaryCheck( void *conn, string *error, uint32_t botid, string name )
+CDBGamePlayerSummary *MySQLGamePlayerSummaryCheck( CMySQLConnection *conn, string *error, uint32_t botid, string name )
 {
+	// the totals are kept up to date by MySQLSummariesUpdate each time a game is saved so this only has to read the player's row for each realm
+
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-	string EscName = MySQLEscapeString( conn, name );
 	CDBGamePlayerSummary *GamePlayerSummary = NULL;
-	string Query = "SELECT MIN(DATE(datetime)), MAX(DATE(datetime)), COUNT(*), MIN(loadingtime), AVG(loadingtime), MAX(loadingtime), MIN(`left`/duration)*100, AVG(`left`/duration)*100, MAX(`left`/duration)*100, MIN(duration), AVG(duration), MAX(duration) FROM gameplayers LEFT JOIN games ON games.id=gameid WHERE name LIKE '" + EscName + "'";
+	CMySQLParams Params;
+	Params.AddString( name );
+	vector< vector<string> > Rows;
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	if( conn->Execute( error, "SELECT MIN(firstgame), MAX(lastgame), SUM(games), MIN(minloadingtime), SUM(totalloadingtime)/SUM(games), MAX(maxloadingtime), MIN(minleftpercent), SUM(totalleftpercent)/SUM(leftpercentgames), MAX(maxleftpercent), MIN(minduration), SUM(totalduration)/SUM(games), MAX(maxduration) FROM gameplayersummaries WHERE name=?", &Params, &Rows ) )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
-
-		if( Result )
+		if( !Rows.empty( ) && Rows[0].size( ) == 12 )
 		{
-			vector<string> Row = MySQLFetchRow( Result );
-
-			if( Row.size( ) == 12 )
-			{
-				string FirstGameDateTime = Row[0];
-				string LastGameDateTime = Row[1];
-				uint32_t TotalGames = UTIL_ToUInt32( Row[2] );
-				uint32_t MinLoadingTime = UTIL_ToUInt32( Row[3] );
-				uint32_t AvgLoadingTime = UTIL_ToUInt32( Row[4] );
-				uint32_t MaxLoadingTime = UTIL_ToUInt32( Row[5] );
-				uint32_t MinLeftPercent = UTIL_ToUInt32( Row[6] );
-				uint32_t AvgLeftPercent = UTIL_ToUInt32( Row[7] );
-				uint32_t MaxLeftPercent = UTIL_ToUInt32( Row[8] );
-				uint32_t MinDuration = UTIL_ToUInt32( Row[9] );
-				uint32_t AvgDuration = UTIL_ToUInt32( Row[10] );
-				uint32_t MaxDuration = UTIL_ToUInt32( Row[11] );
-				GamePlayerSummary = new CDBGamePlayerSummary( string( ), name, FirstGameDateTime, LastGameDateTime, TotalGames, MinLoadingTime, AvgLoadingTime, MaxLoadingTime, MinLeftPercent, AvgLeftPercent, MaxLeftPercent, MinDuration, AvgDuration, MaxDuration );
-			}
-			else
-				*error = "error checking gameplayersummary [" + name + "] - row doesn't have 12 columns";
-
-			mysql_free_result( Result );
+			vector<string> &Row = Rows[0];
+			string FirstGameDateTime = Row[0];
+			string LastGameDateTime = Row[1];
+			uint32_t TotalGames = UTIL_ToUInt32( Row[2] );
+			uint32_t MinLoadingTime = UTIL_ToUInt32( Row[3] );
+			uint32_t AvgLoadingTime = UTIL_ToUInt32( Row[4] );
+			uint32_t MaxLoadingTime = UTIL_ToUInt32( Row[5] );
+			uint32_t MinLeftPercent = UTIL_ToUInt32( Row[6] );
+			uint32_t AvgLeftPercent = UTIL_ToUInt32( Row[7] );
+			uint32_t MaxLeftPercent = UTIL_ToUInt32( Row[8] );
+			uint32_t MinDuration = UTIL_ToUInt32( Row[9] );
+			uint32_t AvgDuration = UTIL_ToUInt32( Row[10] );
+			uint32_t MaxDuration = UTIL_ToUInt32( Row[11] );
+			GamePlayerSummary = new CDBGamePlayerSummary( string( ), name, FirstGameDateTime, LastGameDateTime, TotalGames, MinLoadingTime, AvgLoadingTime, MaxLoadingTime, MinLeftPercent, AvgLeftPercent, MaxLeftPercent, MinDuration, AvgDuration, MaxDuration );
 		}
 		else
-			*error = mysql_error( (MYSQL *)conn );
+			*error = "error checking gameplayersummary [" + name + "] - row doesn't have 12 columns";
 	}
 
 	return GamePlayerSummary;
 }
 
-uint32_t MySQLDotAGameAdd( void *conn, string *error, uint32_t botid, uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec )
+uint32_t MySQLDotAGameAdd( CMySQLConnection *conn, string *error, uint32_t botid, uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec )
 {
 	uint32_t RowID = 0;
-	string Query = "INSERT INTO dotagames ( botid, gameid, winner, min, sec ) VALUES ( " + UTIL_ToString( botid ) + ", " + UTIL_ToString( gameid ) + ", " + UTIL_ToString( winner ) + ", " + UTIL_ToString( min ) + ", " + UTIL_ToString( sec ) + " )";
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddInt( gameid );
+	Params.AddInt( winner );
+	Params.AddInt( min );
+	Params.AddInt( sec );
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		RowID = mysql_insert_id( (MYSQL *)conn );
+	if( conn->Execute( error, "INSERT INTO dotagames ( botid, gameid, winner, min, sec ) VALUES ( ?, ?, ?, ?, ? )", &Params ) )
+		RowID = conn->GetInsertID( );
 
 	return RowID;
 }
 
-uint32_t MySQLDotAPlayerAdd( void *conn, string *error, uint32_t botid, uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills )
+uint32_t MySQLDotAPlayerAdd( CMySQLConnection *conn, string *error, uint32_t botid, uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills )
 {
 	uint32_t RowID = 0;
-	string EscItem1 = MySQLEscapeString( conn, item1 );
-	string EscItem2 = MySQLEscapeString( conn, item2 );
-	string EscItem3 = MySQLEscapeString( conn, item3 );
-	string EscItem4 = MySQLEscapeString( conn, item4 );
-	string EscItem5 = MySQLEscapeString( conn, item5 );
-	string EscItem6 = MySQLEscapeString( conn, item6 );
-	string EscHero = MySQLEscapeString( conn, hero );
-	string Query = "INSERT INTO dotaplayers ( botid, gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ) VALUES ( " + UTIL_ToString( botid ) + ", " + UTIL_ToString( gameid ) + ", " + UTIL_ToString( colour ) + ", " + UTIL_ToString( kills ) + ", " + UTIL_ToString( deaths ) + ", " + UTIL_ToString( creepkills ) + ", " + UTIL_ToString( creepdenies ) + ", " + UTIL_ToString( assists ) + ", " + UTIL_ToString( gold ) + ", " + UTIL_ToString( neutralkills ) + ", '" + EscItem1 + "', '" + EscItem2 + "', '" + EscItem3 + "', '" + EscItem4 + "', '" + EscItem5 + "', '" + EscItem6 + "', '" + EscHero + "', " + UTIL_ToString( newcolour ) + ", " + UTIL_ToString( towerkills ) + ", " + UTIL_ToString( raxkills ) + ", " + UTIL_ToString( courierkills ) + " )";
-
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		RowID = mysql_insert_id( (MYSQL *)conn );
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddInt( gameid );
+	Params.AddInt( colour );
+	Params.AddInt( kills );
+	Params.AddInt( deaths );
+	Params.AddInt( creepkills );
+	Params.AddInt( creepdenies );
+	Params.AddInt( assists );
+	Params.AddInt( gold );
+	Params.AddInt( neutralkills );
+	Params.AddString( item1 );
+	Params.AddString( item2 );
+	Params.AddString( item3 );
+	Params.AddString( item4 );
+	Params.AddString( item5 );
+	Params.AddString( item6 );
+	Params.AddString( hero );
+	Params.AddInt( newcolour );
+	Params.AddInt( towerkills );
+	Params.AddInt( raxkills );
+	Params.AddInt( courierkills );
+
+	if( conn->Execute( error, "INSERT INTO dotaplayers ( botid, gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )", &Params ) )
+		RowID = conn->GetInsertID( );
 
 	return RowID;
 }
 
-CDBDotAPlayerSummary *MySQLDotAPlayerSummaryCheck( void *conn, string *error, uint32_t botid, string name )
+CDBDotAPlayerSummary *MySQLDotAPlayerSummaryCheck( CMySQLConnection *conn, string *error, uint32_t botid, string name )
 {
+	// the totals including the wins and losses are kept up to date by MySQLSummariesUpdate each time a game is saved so this only has to read the player's row for each realm
+
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-	string EscName = MySQLEscapeString( conn, name );
 	CDBDotAPlayerSummary *DotAPlayerSummary = NULL;
-	string Query = "SELECT COUNT(dotaplayers.id), SUM(kills), SUM(deaths), SUM(creepkills), SUM(creepdenies), SUM(assists), SUM(neutralkills), SUM(towerkills), SUM(raxkills), SUM(courierkills) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour WHERE name LIKE '" + EscName + "'";
+	CMySQLParams Params;
+	Params.AddString( name );
+	vector< vector<string> > Rows;
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	if( conn->Execute( error, "SELECT SUM(games), SUM(wins), SUM(losses), SUM(kills), SUM(deaths), SUM(creepkills), SUM(creepdenies), SUM(assists), SUM(neutralkills), SUM(towerkills), SUM(raxkills), SUM(courierkills) FROM dotaplayersummaries WHERE name=?", &Params, &Rows ) )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
-
-		if( Result )
+		if( !Rows.empty( ) && Rows[0].size( ) == 12 )
 		{
-			vector<string> Row = MySQLFetchRow( Result );
+			vector<string> &Row = Rows[0];
+			uint32_t TotalGames = UTIL_ToUInt32( Row[0] );
 
-			if( Row.size( ) == 10 )
+			if( TotalGames > 0 )
 			{
-				uint32_t TotalGames = UTIL_ToUInt32( Row[0] );
-
-				if( TotalGames > 0 )
-				{
-					uint32_t TotalWins = 0;
-					uint32_t TotalLosses = 0;
-					uint32_t TotalKills = UTIL_ToUInt32( Row[1] );
-					uint32_t TotalDeaths = UTIL_ToUInt32( Row[2] );
-					uint32_t TotalCreepKills = UTIL_ToUInt32( Row[3] );
-					uint32_t TotalCreepDenies = UTIL_ToUInt32( Row[4] );
-					uint32_t TotalAssists = UTIL_ToUInt32( Row[5] );
-					uint32_t TotalNeutralKills = UTIL_ToUInt32( Row[6] );
-					uint32_t TotalTowerKills = UTIL_ToUInt32( Row[7] );
-					uint32_t TotalRaxKills = UTIL_ToUInt32( Row[8] );
-					uint32_t TotalCourierKills = UTIL_ToUInt32( Row[9] );
-
-					// calculate total wins
-
-					string Query2 = "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON games.id=dotagames.gameid WHERE name='" + EscName + "' AND ((winner=1 AND dotaplayers.newcolour>=1 AND dotaplayers.newcolour<=5) OR (winner=2 AND dotaplayers.newcolour>=7 AND dotaplayers.newcolour<=11))";
-
-					if( mysql_real_query( (MYSQL *)conn, Query2.c_str( ), Query2.size( ) ) != 0 )
-						*error = mysql_error( (MYSQL *)conn );
-					else
-					{
-						MYSQL_RES *Result2 = mysql_store_result( (MYSQL *)conn );
-
-						if( Result2 )
-						{
-							vector<string> Row2 = MySQLFetchRow( Result2 );
-
-							if( Row2.size( ) == 1 )
-								TotalWins = UTIL_ToUInt32( Row2[0] );
-							else
-								*error = "error checking dotaplayersummary wins [" + name + "] - row doesn't have 1 column";
-
-							mysql_free_result( Result2 );
-						}
-						else
-							*error = mysql_error( (MYSQL *)conn );
-					}
-
-					// calculate total losses
-
-					string Query3 = "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON games.id=dotagames.gameid WHERE name='" + EscName + "' AND ((winner=2 AND dotaplayers.newcolour>=1 AND dotaplayers.newcolour<=5) OR (winner=1 AND dotaplayers.newcolour>=7 AND dotaplayers.newcolour<=11))";
-
-					if( mysql_real_query( (MYSQL *)conn, Query3.c_str( ), Query3.size( ) ) != 0 )
-						*error = mysql_error( (MYSQL *)conn );
-					else
-					{
-						MYSQL_RES *Result3 = mysql_store_result( (MYSQL *)conn );
-
-						if( Result3 )
-						{
-							vector<string> Row3 = MySQLFetchRow( Result3 );
-
-							if( Row3.size( ) == 1 )
-								TotalLosses = UTIL_ToUInt32( Row3[0] );
-							else
-								*error = "error checking dotaplayersummary losses [" + name + "] - row doesn't have 1 column";
-
-							mysql_free_result( Result3 );
-						}
-						else
-							*error = mysql_error( (MYSQL *)conn );
-					}
-
-					// done
-
-					DotAPlayerSummary = new CDBDotAPlayerSummary( string( ), name, TotalGames, TotalWins, TotalLosses, TotalKills, TotalDeaths, TotalCreepKills, TotalCreepDenies, TotalAssists, TotalNeutralKills, TotalTowerKills, TotalRaxKills, TotalCourierKills );
-				}
+				uint32_t TotalWins = UTIL_ToUInt32( Row[1] );
+				uint32_t TotalLosses = UTIL_ToUInt32( Row[2] );
+				uint32_t TotalKills = UTIL_ToUInt32( Row[3] );
+				uint32_t TotalDeaths = UTIL_ToUInt32( Row[4] );
+				uint32_t TotalCreepKills = UTIL_ToUInt32( Row[5] );
+				uint32_t TotalCreepDenies = UTIL_ToUInt32( Row[6] );
+				uint32_t TotalAssists = UTIL_ToUInt32( Row[7] );
+				uint32_t TotalNeutralKills = UTIL_ToUInt32( Row[8] );
+				uint32_t TotalTowerKills = UTIL_ToUInt32( Row[9] );
+				uint32_t TotalRaxKills = UTIL_ToUInt32( Row[10] );
+				uint32_t TotalCourierKills = UTIL_ToUInt32( Row[11] );
+				DotAPlayerSummary = new CDBDotAPlayerSummary( string( ), name, TotalGames, TotalWins, TotalLosses, TotalKills, TotalDeaths, TotalCreepKills, TotalCreepDenies, TotalAssists, TotalNeutralKills, TotalTowerKills, TotalRaxKills, TotalCourierKills );
 			}
-			else
-				*error = "error checking dotaplayersummary [" + name + "] - row doesn't have 10 columns";
-
-			mysql_free_result( Result );
 		}
 		else
-			*error = mysql_error( (MYSQL *)conn );
+			*error = "error checking dotaplayersummary [" + name + "] - row doesn't have 12 columns";
 	}
 
 	return DotAPlayerSummary;
 }
 
-bool MySQLDownloadAdd( void *conn, string *error, uint32_t botid, string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
+bool MySQLDownloadAdd( CMySQLConnection *conn, string *error, uint32_t botid, string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
 {
-	bool Success = false;
-	string EscMap = MySQLEscapeString( conn, map );
-	string EscName = MySQLEscapeString( conn, name );
-	string EscIP = MySQLEscapeString( conn, ip );
-	string EscSpoofedRealm = MySQLEscapeString( conn, spoofedrealm );
-	string Query = "INSERT INTO downloads ( botid, map, mapsize, datetime, name, ip, spoofed, spoofedrealm, downloadtime ) VALUES ( " + UTIL_ToString( botid ) + ", '" + EscMap + "', " + UTIL_ToString( mapsize ) + ", NOW( ), '" + EscName + "', '" + EscIP + "', " + UTIL_ToString( spoofed ) + ", '" + EscSpoofedRealm + "', " + UTIL_ToString( downloadtime ) + " )";
-
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		Success = true;
-
-	return Success;
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddString( map );
+	Params.AddInt( mapsize );
+	Params.AddString( name );
+	Params.AddString( ip );
+	Params.AddInt( spoofed );
+	Params.AddString( spoofedrealm );
+	Params.AddInt( downloadtime );
+	return conn->Execute( error, "INSERT INTO downloads ( botid, map, mapsize, datetime, name, ip, spoofed, spoofedrealm, downloadtime ) VALUES ( ?, ?, ?, NOW( ), ?, ?, ?, ?, ? )", &Params );
 }
 
-double MySQLScoreCheck( void *conn, string *error, uint32_t botid, string category, string name, string server )
+vector<double> MySQLScoreCheck( CMySQLConnection *conn, string *error, uint32_t botid, string category, vector<string> names, vector<string> servers )
 {
-	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
-	string EscCategory = MySQLEscapeString( conn, category );
-	string EscName = MySQLEscapeString( conn, name );
-	string EscServer = MySQLEscapeString( conn, server );
-	double Score = -100000.0;
-	string Query = "SELECT score FROM scores WHERE category='" + EscCategory + "' AND name='" + EscName + "' AND server='" + EscServer + "'";
-
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
+	// look up every player with one query, we get the player's scores on every server and pick the one we asked for
+	// the names and servers are compared in lower case because MySQL compares them case insensitively
+
+	vector<double> Scores( names.size( ), -100000.0 );
+
+	if( names.empty( ) )
+		return Scores;
+
+	string Query = "SELECT name, server, score FROM scores WHERE category=? AND name IN ( ";
+	CMySQLParams Params;
+	Params.AddString( category );
+
+	for( vector<string> :: iterator i = names.begin( ); i != names.end( ); ++i )
 	{
-		MYSQL_RES *Result = mysql_store_result( (MYSQL *)conn );
+		transform( i->begin( ), i->end( ), i->begin( ), (int(*)(int))tolower );
+
+		if( i != names.begin( ) )
+			Query += ", ";
 
-		if( Result )
+		Query += "?";
+		Params.AddString( *i );
+	}
+
+	Query += " )";
+
+	for( vector<string> :: iterator i = servers.begin( ); i != servers.end( ); ++i )
+		transform( i->begin( ), i->end( ), i->begin( ), (int(*)(int))tolower );
+
+	vector< vector<string> > Rows;
+
+	if( conn->Execute( error, Query, &Params, &Rows ) )
+	{
+		for( vector< vector<string> > :: iterator i = Rows.begin( ); i != Rows.end( ); ++i )
 		{
-			vector<string> Row = MySQLFetchRow( Result );
+			if( i->size( ) != 3 )
+				continue;
 
-			if( Row.size( ) == 1 )
-				Score = UTIL_ToDouble( Row[0] );
-			/* else
-				*error = "error checking score [" + category + " : " + name + " : " + server + "] - row doesn't have 1 column"; */
+			string Name = (*i)[0];
+			string Server = (*i)[1];
+			transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+			transform( Server.begin( ), Server.end( ), Server.begin( ), (int(*)(int))tolower );
 
-			mysql_free_result( Result );
+			for( unsigned int j = 0; j < names.size( ); ++j )
+			{
+				if( names[j] == Name && servers[j] == Server )
+					Scores[j] = UTIL_ToDouble( (*i)[2] );
+			}
 		}
-		else
-			*error = mysql_error( (MYSQL *)conn );
 	}
 
-	return Score;
+	return Scores;
 }
 
-uint32_t MySQLW3MMDPlayerAdd( void *conn, string *error, uint32_t botid, string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing )
+uint32_t MySQLW3MMDPlayerAdd( CMySQLConnection *conn, string *error, uint32_t botid, string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing )
 {
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	uint32_t RowID = 0;
-	string EscCategory = MySQLEscapeString( conn, category );
-	string EscName = MySQLEscapeString( conn, name );
-	string EscFlag = MySQLEscapeString( conn, flag );
-	string Query = "INSERT INTO w3mmdplayers ( botid, category, gameid, pid, name, flag, leaver, practicing ) VALUES ( " + UTIL_ToString( botid ) + ", '" + EscCategory + "', " + UTIL_ToString( gameid ) + ", " + UTIL_ToString( pid ) + ", '" + EscName + "', '" + EscFlag + "', " + UTIL_ToString( leaver ) + ", " + UTIL_ToString( practicing ) + " )";
-
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
-	else
-		RowID = mysql_insert_id( (MYSQL *)conn );
+	CMySQLParams Params;
+	Params.AddInt( botid );
+	Params.AddString( category );
+	Params.AddInt( gameid );
+	Params.AddInt( pid );
+	Params.AddString( name );
+	Params.AddString( flag );
+	Params.AddInt( leaver );
+	Params.AddInt( practicing );
+
+	if( conn->Execute( error, "INSERT INTO w3mmdplayers ( botid, category, gameid, pid, name, flag, leaver, practicing ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ? )", &Params ) )
+		RowID = conn->GetInsertID( );
 
 	return RowID;
 }
 
-bool MySQLW3MMDVarAdd( void *conn, string *error, uint32_t botid, uint32_t gameid, map<VarP,int32_t> var_ints )
+bool MySQLW3MMDVarAdd( CMySQLConnection *conn, string *error, uint32_t botid, uint32_t gameid, map<VarP,int32_t> var_ints )
 {
 	if( var_ints.empty( ) )
 		return false;
@@ -1076,15 +1207,15 @@ bool MySQLW3MMDVarAdd( void *conn, string *error, uint32_t botid, uint32_t gamei
 			Query += ", ( " + UTIL_ToString( botid ) + ", " + UTIL_ToString( gameid ) + ", " + UTIL_ToString( i->first.first ) + ", '" + EscVarName + "', " + UTIL_ToString( i->second ) + " )";
 	}
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
+	if( mysql_real_query( (MYSQL *)conn->GetMySQL( ), Query.c_str( ), Query.size( ) ) != 0 )
+		*error = mysql_error( (MYSQL *)conn->GetMySQL( ) );
 	else
 		Success = true;
 
 	return Success;
 }
 
-bool MySQLW3MMDVarAdd( void *conn, string *error, uint32_t botid, uint32_t gameid, map<VarP,double> var_reals )
+bool MySQLW3MMDVarAdd( CMySQLConnection *conn, string *error, uint32_t botid, uint32_t gameid, map<VarP,double> var_reals )
 {
 	if( var_reals.empty( ) )
 		return false;
@@ -1102,15 +1233,15 @@ bool MySQLW3MMDVarAdd( void *conn, string *error, uint32_t botid, uint32_t gamei
 			Query += ", ( " + UTIL_ToString( botid ) + ", " + UTIL_ToString( gameid ) + ", " + UTIL_ToString( i->first.first ) + ", '" + EscVarName + "', " + UTIL_ToString( i->second, 10 ) + " )";
 	}
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
+	if( mysql_real_query( (MYSQL *)conn->GetMySQL( ), Query.c_str( ), Query.size( ) ) != 0 )
+		*error = mysql_error( (MYSQL *)conn->GetMySQL( ) );
 	else
 		Success = true;
 
 	return Success;
 }
 
-bool MySQLW3MMDVarAdd( void *conn, string *error, uint32_t botid, uint32_t gameid, map<VarP,string> var_strings )
+bool MySQLW3MMDVarAdd( CMySQLConnection *conn, string *error, uint32_t botid, uint32_t gameid, map<VarP,string> var_strings )
 {
 	if( var_strings.empty( ) )
 		return false;
@@ -1129,50 +1260,495 @@ bool MySQLW3MMDVarAdd( void *conn, string *error, uint32_t botid, uint32_t gamei
 			Query += ", ( " + UTIL_ToString( botid ) + ", " + UTIL_ToString( gameid ) + ", " + UTIL_ToString( i->first.first ) + ", '" + EscVarName + "', '" + EscValueString + "' )";
 	}
 
-	if( mysql_real_query( (MYSQL *)conn, Query.c_str( ), Query.size( ) ) != 0 )
-		*error = mysql_error( (MYSQL *)conn );
+	if( mysql_real_query( (MYSQL *)conn->GetMySQL( ), Query.c_str( ), Query.size( ) ) != 0 )
+		*error = mysql_error( (MYSQL *)conn->GetMySQL( ) );
 	else
 		Success = true;
 
 	return Success;
 }
 
-//
-// MySQL Callables
-//
+bool MySQLSummariesUpdate( CMySQLConnection *conn, string *error, CDBGameData *gamedata )
+{
+	// add the game to the gameplayersummaries and dotaplayersummaries rows of each player (one row per name and realm)
+	// this has to run inside the same transaction as the INSERTs for the game so the summaries always match the saved games
+	// the averages are stored as totals so they can be updated without reading the player's old games
 
-void CMySQLCallable :: Init( )
+	if( gamedata->m_Players.empty( ) )
+		return true;
+
+	string Duration = UTIL_ToString( gamedata->m_Duration );
+	string Query = "INSERT INTO gameplayersummaries ( name, spoofedrealm, firstgame, lastgame, games, minloadingtime, totalloadingtime, maxloadingtime, leftpercentgames, minleftpercent, totalleftpercent, maxleftpercent, minduration, totalduration, maxduration ) VALUES ";
+	map<uint32_t, CDBGamePlayer *> Colours;
+
+	for( vector<CDBGamePlayer> :: iterator i = gamedata->m_Players.begin( ); i != gamedata->m_Players.end( ); ++i )
+	{
+		string Name = i->GetName( );
+		transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+		string LoadingTime = UTIL_ToString( i->GetLoadingTime( ) );
+		Colours[i->GetColour( )] = &*i;
+
+		if( i != gamedata->m_Players.begin( ) )
+			Query += ", ";
+
+		Query += "( '" + MySQLEscapeString( conn, Name ) + "', '" + MySQLEscapeString( conn, i->GetSpoofedRealm( ) ) + "', CURDATE( ), CURDATE( ), 1, " + LoadingTime + ", " + LoadingTime + ", " + LoadingTime;
+
+		// the left percentage is undefined for a game without a duration, it's skipped just like MIN and AVG skip the NULL from dividing by zero
+
+		if( gamedata->m_Duration > 0 )
+		{
+			string LeftPercent = UTIL_ToString( (double)i->GetLeft( ) * 100.0 / gamedata->m_Duration, 4 );
+			Query += ", 1, " + LeftPercent + ", " + LeftPercent + ", " + LeftPercent;
+		}
+		else
+			Query += ", 0, NULL, 0, NULL";
+
+		Query += ", " + Duration + ", " + Duration + ", " + Duration + " )";
+	}
+
+	Query += " ON DUPLICATE KEY UPDATE lastgame=VALUES(lastgame), games=games+1, minloadingtime=LEAST(minloadingtime, VALUES(minloadingtime)), totalloadingtime=totalloadingtime+VALUES(totalloadingtime), maxloadingtime=GREATEST(maxloadingtime, VALUES(maxloadingtime)), leftpercentgames=leftpercentgames+VALUES(leftpercentgames), minleftpercent=IFNULL(LEAST(minleftpercent, VALUES(minleftpercent)), IFNULL(minleftpercent, VALUES(minleftpercent))), totalleftpercent=totalleftpercent+VALUES(totalleftpercent), maxleftpercent=IFNULL(GREATEST(maxleftpercent, VALUES(maxleftpercent)), IFNULL(maxleftpercent, VALUES(maxleftpercent))), minduration=LEAST(minduration, VALUES(minduration)), totalduration=totalduration+VALUES(totalduration), maxduration=GREATEST(maxduration, VALUES(maxduration))";
+
+	if( !MySQLExecute( conn, error, Query ) )
+		return false;
+
+	// the DotA stats belong to the player who had the same colour in the game
+
+	Query = "INSERT INTO dotaplayersummaries ( name, spoofedrealm, games, wins, losses, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills ) VALUES ";
+	bool First = true;
+
+	for( vector<CDBDotAPlayer> :: iterator i = gamedata->m_DotAPlayers.begin( ); i != gamedata->m_DotAPlayers.end( ); ++i )
+	{
+		map<uint32_t, CDBGamePlayer *> :: iterator Player = Colours.find( i->GetColour( ) );
+
+		if( Player == Colours.end( ) )
+			continue;
+
+		string Name = Player->second->GetName( );
+		transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+		uint32_t NewColour = i->GetNewColour( );
+		bool Sentinel = NewColour >= 1 && NewColour <= 5;
+		bool Scourge = NewColour >= 7 && NewColour <= 11;
+		bool Win = gamedata->m_DotA && ( ( gamedata->m_DotAWinner == 1 && Sentinel ) || ( gamedata->m_DotAWinner == 2 && Scourge ) );
+		bool Loss = gamedata->m_DotA && ( ( gamedata->m_DotAWinner == 2 && Sentinel ) || ( gamedata->m_DotAWinner == 1 && Scourge ) );
+
+		if( !First )
+			Query += ", ";
+
+		Query += "( '" + MySQLEscapeString( conn, Name ) + "', '" + MySQLEscapeString( conn, Player->second->GetSpoofedRealm( ) ) + "', 1, " + ( Win ? "1" : "0" ) + ", " + ( Loss ? "1" : "0" ) + ", " + UTIL_ToString( i->GetKills( ) ) + ", " + UTIL_ToString( i->GetDeaths( ) ) + ", " + UTIL_ToString( i->GetCreepKills( ) ) + ", " + UTIL_ToString( i->GetCreepDenies( ) ) + ", " + UTIL_ToString( i->GetAssists( ) ) + ", " + UTIL_ToString( i->GetNeutralKills( ) ) + ", " + UTIL_ToString( i->GetTowerKills( ) ) + ", " + UTIL_ToString( i->GetRaxKills( ) ) + ", " + UTIL_ToString( i->GetCourierKills( ) ) + " )";
+		First = false;
+	}
+
+	if( First )
+		return true;
+
+	Query += " ON DUPLICATE KEY UPDATE games=games+1, wins=wins+VALUES(wins), losses=losses+VALUES(losses), kills=kills+VALUES(kills), deaths=deaths+VALUES(deaths), creepkills=creepkills+VALUES(creepkills), creepdenies=creepdenies+VALUES(creepdenies), assists=assists+VALUES(assists), neutralkills=neutralkills+VALUES(neutralkills), towerkills=towerkills+VALUES(towerkills), raxkills=raxkills+VALUES(raxkills), courierkills=courierkills+VALUES(courierkills)";
+	return MySQLExecute( conn, error, Query );
+}
+
+bool MySQLEloUniqueKeyAdd( CMySQLConnection *conn, string *error, string table, string key, string columns, string match )
 {
-	CBaseCallable :: Init( );
+	// older versions of update_dota_elo and update_w3mmd_elo created the ELO tables without a unique key so a player could end up with more than one score
+	// keep the oldest score (which is the one the update programs always used) and delete the others so the key can be added
 
-#ifndef WIN32
-	// disable SIGPIPE since this is (or should be) a new thread and it doesn't inherit the spawning thread's signal handlers
-	// MySQL should automatically disable SIGPIPE when we initialize it but we do so anyway here
+	CMySQLParams Params;
+	Params.AddString( table );
+	Params.AddString( key );
+	vector< vector<string> > Rows;
 
-	signal( SIGPIPE, SIG_IGN );
-#endif
+	if( !conn->Execute( error, "SELECT COUNT(*) FROM information_schema.statistics WHERE table_schema=DATABASE() AND table_name=? AND index_name=?", &Params, &Rows ) )
+		return false;
 
-	mysql_thread_init( );
+	if( !Rows.empty( ) && !Rows[0].empty( ) && UTIL_ToUInt32( Rows[0][0] ) > 0 )
+		return true;
 
-	if( !m_Connection )
+	CONSOLE_Print( "[MYSQL] adding unique key [" + key + "] to table [" + table + "]" );
+	return MySQLExecute( conn, error, "DELETE a FROM " + table + " a JOIN " + table + " b ON " + match + " AND a.id>b.id" ) && MySQLExecute( conn, error, "ALTER TABLE " + table + " ADD UNIQUE KEY " + key + " ( " + columns + " )" );
+}
+
+bool MySQLScoresUpdate( CMySQLConnection *conn, string *error, uint32_t gameid, CDBGameData *gamedata )
+{
+	// rate the game with the same rules as update_dota_elo and update_w3mmd_elo so the players' scores change as soon as the game is saved
+	// this has to run inside the same transaction as the INSERTs for the game, the game is marked as scored so those programs don't rate it again
+	// the new scores are stored in the game data as well so the bot can put them in its score cache
+
+	bool W3MMD = !gamedata->m_DotA;
+	string Category = W3MMD ? gamedata->m_W3MMDCategory : "dota_elo";
+	string EloTable = W3MMD ? "w3mmd_elo_scores" : "dota_elo_scores";
+	vector<string> Names;
+	vector<string> Servers;
+	vector<int> Teams;
+	vector<float> TeamWinners;
+	bool Rate = true;
+
+	if( gamedata->m_DotA )
+	{
+		// the DotA stats belong to the player who had the same colour in the game, the Sentinel is team 0 and the Scourge is team 1
+
+		map<uint32_t, CDBGamePlayer *> Colours;
+
+		for( vector<CDBGamePlayer> :: iterator i = gamedata->m_Players.begin( ); i != gamedata->m_Players.end( ); ++i )
+			Colours[i->GetColour( )] = &*i;
+
+		TeamWinners.push_back( gamedata->m_DotAWinner == 1 ? 1.0 : 0.0 );
+		TeamWinners.push_back( gamedata->m_DotAWinner == 2 ? 1.0 : 0.0 );
+		bool Sentinel = false;
+		bool Scourge = false;
+
+		for( vector<CDBDotAPlayer> :: iterator i = gamedata->m_DotAPlayers.begin( ); i != gamedata->m_DotAPlayers.end( ); ++i )
+		{
+			map<uint32_t, CDBGamePlayer *> :: iterator Player = Colours.find( i->GetColour( ) );
+
+			if( Player == Colours.end( ) )
+				continue;
+
+			uint32_t NewColour = i->GetNewColour( );
+
+			if( NewColour >= 1 && NewColour <= 5 )
+			{
+				Teams.push_back( 0 );
+				Sentinel = true;
+			}
+			else if( NewColour >= 7 && NewColour <= 11 )
+			{
+				Teams.push_back( 1 );
+				Scourge = true;
+			}
+			else
+				Rate = false;
+
+			Names.push_back( Player->second->GetName( ) );
+			Servers.push_back( Player->second->GetSpoofedRealm( ) );
+		}
+
+		if( ( gamedata->m_DotAWinner != 1 && gamedata->m_DotAWinner != 2 ) || Names.size( ) > 10 || !Sentinel || !Scourge )
+			Rate = false;
+	}
+	else if( !gamedata->m_W3MMDCategory.empty( ) )
+	{
+		// the MMD players are matched to the game's players by name and each player is rated as if it was a free for all
+		// this is because the MMD system stores win/loss flags on a per player basis (see update_w3mmd_elo)
+
+		map<string, CDBGamePlayer *> Players;
+		bool Winner = false;
+
+		for( vector<CDBGamePlayer> :: iterator i = gamedata->m_Players.begin( ); i != gamedata->m_Players.end( ); ++i )
+		{
+			string Name = i->GetName( );
+			transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+			Players[Name] = &*i;
+		}
+
+		for( vector<CDBW3MMDPlayer> :: iterator i = gamedata->m_W3MMDPlayers.begin( ); i != gamedata->m_W3MMDPlayers.end( ); ++i )
+		{
+			string Name = i->GetName( );
+			transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+			map<string, CDBGamePlayer *> :: iterator Player = Players.find( Name );
+
+			if( Player == Players.end( ) || i->GetFlag( ) == "drawer" || i->GetPracticing( ) == 1 )
+				continue;
+
+			if( i->GetFlag( ) == "winner" )
+				Winner = true;
+
+			Teams.push_back( Names.size( ) );
+			TeamWinners.push_back( i->GetFlag( ) == "winner" ? 1.0 : 0.0 );
+			Names.push_back( Player->second->GetName( ) );
+			Servers.push_back( Player->second->GetSpoofedRealm( ) );
+		}
+
+		if( Names.empty( ) || Names.size( ) > 12 || !Winner )
+			Rate = false;
+	}
+	else
+		return true;
+
+	// mark the game as scored even if it can't be rated just like the update programs do
+
+	CMySQLParams ScoredParams;
+
+	if( W3MMD )
+		ScoredParams.AddString( Category );
+
+	ScoredParams.AddInt( gameid );
+
+	if( !conn->Execute( error, W3MMD ? "INSERT INTO w3mmd_elo_games_scored ( category, gameid ) VALUES ( ?, ? )" : "INSERT INTO dota_elo_games_scored ( gameid ) VALUES ( ? )", &ScoredParams ) )
+		return false;
+
+	if( !Rate )
+		return true;
+
+	// get the players' current scores with one query, new players start at 1000
+	// the rows are locked until the transaction ends so two games which end at the same time can't both start from the same old score
+	// the query uses the table's unique key so only the players' own rows (and the gaps where new players' rows will go) are locked
+	// the names and servers are compared in lower case because MySQL compares them case insensitively
+	// the new scores are saved with the names as the players typed them though
+
+	vector<string> LowerNames( Names );
+	vector<bool> Found( Names.size( ), false );
+	vector<float> Ratings( Names.size( ), 1000.0 );
+	string Query = "SELECT name, server, score FROM " + EloTable + " WHERE ";
+	CMySQLParams Params;
+
+	if( W3MMD )
+	{
+		Query += "category=? AND ";
+		Params.AddString( Category );
+	}
+
+	Query += "name IN ( ";
+
+	for( unsigned int i = 0; i < LowerNames.size( ); ++i )
+	{
+		transform( LowerNames[i].begin( ), LowerNames[i].end( ), LowerNames[i].begin( ), (int(*)(int))tolower );
+
+		if( i > 0 )
+			Query += ", ";
+
+		Query += "?";
+		Params.AddString( LowerNames[i] );
+	}
+
+	Query += " ) FOR UPDATE";
+	vector< vector<string> > Rows;
+
+	if( !conn->Execute( error, Query, &Params, &Rows ) )
+		return false;
+
+	for( vector< vector<string> > :: iterator i = Rows.begin( ); i != Rows.end( ); ++i )
+	{
+		if( i->size( ) != 3 )
+			continue;
+
+		string Name = (*i)[0];
+		string Server = (*i)[1];
+		transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+		transform( Server.begin( ), Server.end( ), Server.begin( ), (int(*)(int))tolower );
+
+		for( unsigned int j = 0; j < Names.size( ); ++j )
+		{
+			string PlayerServer = Servers[j];
+			transform( PlayerServer.begin( ), PlayerServer.end( ), PlayerServer.begin( ), (int(*)(int))tolower );
+
+			if( !Found[j] && LowerNames[j] == Name && PlayerServer == Server )
+			{
+				Found[j] = true;
+				Ratings[j] = (float)UTIL_ToDouble( (*i)[2] );
+			}
+		}
+	}
+
+	// each team's rating is the average rating of its players
+
+	vector<float> TeamRatings( TeamWinners.size( ), 0.0 );
+	vector<int> TeamNumPlayers( TeamWinners.size( ), 0 );
+
+	for( unsigned int i = 0; i < Names.size( ); ++i )
+	{
+		TeamRatings[Teams[i]] += Ratings[i];
+		TeamNumPlayers[Teams[i]]++;
+	}
+
+	for( unsigned int i = 0; i < TeamRatings.size( ); ++i )
+	{
+		if( TeamNumPlayers[i] > 0 )
+			TeamRatings[i] /= TeamNumPlayers[i];
+	}
+
+	elo_recalculate_ratings( Names.size( ), &Ratings[0], &Teams[0], TeamWinners.size( ), &TeamRatings[0], &TeamWinners[0] );
+
+	// save the new scores to the ELO table and to the scores table (which is what the bot reads) with one multi row query each
+	// the scores are rounded to two decimal places just like the update programs store them
+	// existing scores are found by the ELO table's unique key and new players get a new row
+
+	string EscCategory = MySQLEscapeString( conn, Category );
+	string EloQuery = W3MMD ? "INSERT INTO w3mmd_elo_scores ( category, name, server, score ) VALUES " : "INSERT INTO dota_elo_scores ( name, server, score ) VALUES ";
+	string DeleteQuery = "DELETE FROM scores WHERE category='" + EscCategory + "' AND ( ";
+	string ScoresQuery = "INSERT INTO scores ( category, name, server, score ) VALUES ";
+	gamedata->m_ScoreCategory = Category;
+
+	for( unsigned int i = 0; i < Names.size( ); ++i )
 	{
-		if( !( m_Connection = mysql_init( NULL ) ) )
-			m_Error = mysql_error( (MYSQL *)m_Connection );
+		string EscName = MySQLEscapeString( conn, Names[i] );
+		string EscServer = MySQLEscapeString( conn, Servers[i] );
+		string Score = UTIL_ToString( Ratings[i], 2 );
 
-		my_bool Reconnect = true;
-		mysql_options( (MYSQL *)m_Connection, MYSQL_OPT_RECONNECT, &Reconnect );
+		if( i > 0 )
+		{
+			EloQuery += ", ";
+			DeleteQuery += " OR ";
+			ScoresQuery += ", ";
+		}
 
-		if( !( mysql_real_connect( (MYSQL *)m_Connection, m_SQLServer.c_str( ), m_SQLUser.c_str( ), m_SQLPassword.c_str( ), m_SQLDatabase.c_str( ), m_SQLPort, NULL, 0 ) ) )
-			m_Error = mysql_error( (MYSQL *)m_Connection );
+		EloQuery += "( " + ( W3MMD ? "'" + EscCategory + "', " : string( ) ) + "'" + EscName + "', '" + EscServer + "', " + Score + " )";
+		DeleteQuery += "( name='" + EscName + "' AND server='" + EscServer + "' )";
+		ScoresQuery += "( '" + EscCategory + "', '" + EscName + "', '" + EscServer + "', " + Score + " )";
+		gamedata->m_ScoreNames.push_back( Names[i] );
+		gamedata->m_ScoreServers.push_back( Servers[i] );
+		gamedata->m_Scores.push_back( UTIL_ToDouble( Score ) );
 	}
-	else if( mysql_ping( (MYSQL *)m_Connection ) != 0 )
-		m_Error = mysql_error( (MYSQL *)m_Connection );
+
+	EloQuery += " ON DUPLICATE KEY UPDATE score=VALUES(score)";
+	DeleteQuery += " )";
+	return MySQLExecute( conn, error, EloQuery ) && MySQLExecute( conn, error, DeleteQuery ) && MySQLExecute( conn, error, ScoresQuery );
 }
 
-void CMySQLCallable :: Close( )
+uint32_t MySQLGameDataAdd( CMySQLConnection *conn, string *error, uint32_t botid, CDBGameData *gamedata, bool updatesummaries, bool updatescores )
 {
-	mysql_thread_end( );
+	// save the game, the players and the stats inside one transaction with one multi row INSERT per table
+	// if anything fails the whole transaction is rolled back so we never end up with a game without its players or stats
+	// games replayed from the journal carry a journal key which is saved with the game, if it's already there the game was saved before the journal could checkpoint it and we don't save it twice
+
+	// if the connection is lost part way through the whole game fails and is retried later (see CMySQLConnection :: SetInTransaction)
+
+	if( !MySQLExecute( conn, error, "START TRANSACTION" ) )
+		return 0;
+
+	conn->SetInTransaction( true );
+
+	if( !gamedata->m_JournalKey.empty( ) )
+	{
+		CMySQLParams Params;
+		Params.AddString( gamedata->m_JournalKey );
+		vector< vector<string> > Rows;
+
+		if( !conn->Execute( error, "SELECT gameid FROM journalgames WHERE journalkey=?", &Params, &Rows ) )
+		{
+			string RollbackError;
+			MySQLExecute( conn, &RollbackError, "ROLLBACK" );
+			conn->SetInTransaction( false );
+			return 0;
+		}
+
+		if( !Rows.empty( ) && Rows[0].size( ) == 1 )
+		{
+			CONSOLE_Print( "[MYSQL] game data [" + gamedata->m_GameName + "] with journal key [" + gamedata->m_JournalKey + "] was already saved as game [" + Rows[0][0] + "]" );
+			bool Committed = MySQLExecute( conn, error, "COMMIT" );
+			conn->SetInTransaction( false );
+			return Committed ? UTIL_ToUInt32( Rows[0][0] ) : 0;
+		}
+	}
+
+	uint32_t GameID = MySQLGameAdd( conn, error, botid, gamedata->m_Server, gamedata->m_Map, gamedata->m_GameName, gamedata->m_OwnerName, gamedata->m_Duration, gamedata->m_GameState, gamedata->m_CreatorName, gamedata->m_CreatorServer );
+	bool Success = GameID > 0;
+
+	if( Success && !gamedata->m_JournalKey.empty( ) )
+	{
+		CMySQLParams Params;
+		Params.AddString( gamedata->m_JournalKey );
+		Params.AddInt( GameID );
+		Success = conn->Execute( error, "INSERT INTO journalgames ( journalkey, gameid ) VALUES ( ?, ? )", &Params );
+	}
+
+	string BotID = UTIL_ToString( botid );
+	string GameIDString = UTIL_ToString( GameID );
+
+	if( Success && !gamedata->m_Players.empty( ) )
+	{
+		string Query = "INSERT INTO gameplayers ( botid, gameid, name, ip, spoofed, reserved, loadingtime, `left`, leftreason, team, colour, spoofedrealm ) VALUES ";
+
+		for( vector<CDBGamePlayer> :: iterator i = gamedata->m_Players.begin( ); i != gamedata->m_Players.end( ); ++i )
+		{
+			string Name = i->GetName( );
+			transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+
+			if( i != gamedata->m_Players.begin( ) )
+				Query += ", ";
+
+			Query += "( " + BotID + ", " + GameIDString + ", '" + MySQLEscapeString( conn, Name ) + "', '" + MySQLEscapeString( conn, i->GetIP( ) ) + "', " + UTIL_ToString( i->GetSpoofed( ) ) + ", " + UTIL_ToString( i->GetReserved( ) ) + ", " + UTIL_ToString( i->GetLoadingTime( ) ) + ", " + UTIL_ToString( i->GetLeft( ) ) + ", '" + MySQLEscapeString( conn, i->GetLeftReason( ) ) + "', " + UTIL_ToString( i->GetTeam( ) ) + ", " + UTIL_ToString( i->GetColour( ) ) + ", '" + MySQLEscapeString( conn, i->GetSpoofedRealm( ) ) + "' )";
+		}
+
+		Success = MySQLExecute( conn, error, Query );
+	}
+
+	if( Success && gamedata->m_DotA )
+		Success = MySQLDotAGameAdd( conn, error, botid, GameID, gamedata->m_DotAWinner, gamedata->m_DotAMin, gamedata->m_DotASec ) > 0;
+
+	if( Success && !gamedata->m_DotAPlayers.empty( ) )
+	{
+		string Query = "INSERT INTO dotaplayers ( botid, gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ) VALUES ";
+
+		for( vector<CDBDotAPlayer> :: iterator i = gamedata->m_DotAPlayers.begin( ); i != gamedata->m_DotAPlayers.end( ); ++i )
+		{
+			if( i != gamedata->m_DotAPlayers.begin( ) )
+				Query += ", ";
+
+			Query += "( " + BotID + ", " + GameIDString + ", " + UTIL_ToString( i->GetColour( ) ) + ", " + UTIL_ToString( i->GetKills( ) ) + ", " + UTIL_ToString( i->GetDeaths( ) ) + ", " + UTIL_ToString( i->GetCreepKills( ) ) + ", " + UTIL_ToString( i->GetCreepDenies( ) ) + ", " + UTIL_ToString( i->GetAssists( ) ) + ", " + UTIL_ToString( i->GetGold( ) ) + ", " + UTIL_ToString( i->GetNeutralKills( ) );
+
+			for( unsigned int j = 0; j < 6; ++j )
+				Query += ", '" + MySQLEscapeString( conn, i->GetItem( j ) ) + "'";
+
+			Query += ", '" + MySQLEscapeString( conn, i->GetHero( ) ) + "', " + UTIL_ToString( i->GetNewColour( ) ) + ", " + UTIL_ToString( i->GetTowerKills( ) ) + ", " + UTIL_ToString( i->GetRaxKills( ) ) + ", " + UTIL_ToString( i->GetCourierKills( ) ) + " )";
+		}
+
+		Success = MySQLExecute( conn, error, Query );
+	}
+
+	if( Success && !gamedata->m_W3MMDPlayers.empty( ) )
+	{
+		string EscCategory = MySQLEscapeString( conn, gamedata->m_W3MMDCategory );
+		string Query = "INSERT INTO w3mmdplayers ( botid, category, gameid, pid, name, flag, leaver, practicing ) VALUES ";
+
+		for( vector<CDBW3MMDPlayer> :: iterator i = gamedata->m_W3MMDPlayers.begin( ); i != gamedata->m_W3MMDPlayers.end( ); ++i )
+		{
+			string Name = i->GetName( );
+			transform( Name.begin( ), Name.end( ), Name.begin( ), (int(*)(int))tolower );
+
+			if( i != gamedata->m_W3MMDPlayers.begin( ) )
+				Query += ", ";
+
+			Query += "( " + BotID + ", '" + EscCategory + "', " + GameIDString + ", " + UTIL_ToString( i->GetPID( ) ) + ", '" + MySQLEscapeString( conn, Name ) + "', '" + MySQLEscapeString( conn, i->GetFlag( ) ) + "', " + UTIL_ToString( i->GetLeaver( ) ) + ", " + UTIL_ToString( i->GetPracticing( ) ) + " )";
+		}
+
+		Success = MySQLExecute( conn, error, Query );
+	}
+
+	if( Success && !gamedata->m_W3MMDVarInts.empty( ) )
+		Success = MySQLW3MMDVarAdd( conn, error, botid, GameID, gamedata->m_W3MMDVarInts );
 
+	if( Success && !gamedata->m_W3MMDVarReals.empty( ) )
+		Success = MySQLW3MMDVarAdd( conn, error, botid, GameID, gamedata->m_W3MMDVarReals );
+
+	if( Success && !gamedata->m_W3MMDVarStrings.empty( ) )
+		Success = MySQLW3MMDVarAdd( conn, error, botid, GameID, gamedata->m_W3MMDVarStrings );
+
+	if( Success && updatesummaries )
+		Success = MySQLSummariesUpdate( conn, error, gamedata );
+
+	if( Success && updatescores )
+		Success = MySQLScoresUpdate( conn, error, GameID, gamedata );
+
+	if( Success && MySQLExecute( conn, error, "COMMIT" ) )
+	{
+		conn->SetInTransaction( false );
+		return GameID;
+	}
+
+	// keep the original error message, the rollback is only to clean up
+
+	string RollbackError;
+	MySQLExecute( conn, &RollbackError, "ROLLBACK" );
+	conn->SetInTransaction( false );
+	return 0;
+}
+
+//
+// MySQL Callables
+//
+
+void CMySQLCallable :: Init( )
+{
+	CBaseCallable :: Init( );
+
+	// the worker thread running this callable has already initialized MySQL for the thread and given us its connection
+
+	if( !m_Connection )
+		m_Error = "not connected to MySQL server";
+	else if( mysql_ping( (MYSQL *)m_Connection->GetMySQL( ) ) != 0 )
+		m_Error = mysql_error( (MYSQL *)m_Connection->GetMySQL( ) );
+}
+
+void CMySQLCallable :: Close( )
+{
 	CBaseCallable :: Close( );
 }
 
@@ -1356,7 +1932,7 @@ void CMySQLCallableScoreCheck :: operator( )( )
 	Init( );
 
 	if( m_Error.empty( ) )
-		m_Result = MySQLScoreCheck( m_Connection, &m_Error, m_SQLBotID, m_Category, m_Name, m_Server );
+		m_Result = MySQLScoreCheck( m_Connection, &m_Error, m_SQLBotID, m_Category, m_Names, m_Servers );
 
 	Close( );
 }
@@ -1388,4 +1964,14 @@ void CMySQLCallableW3MMDVarAdd :: operator( )( )
 	Close( );
 }
 
+void CMySQLCallableGameDataAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = MySQLGameDataAdd( m_Connection, &m_Error, m_SQLBotID, m_GameData, m_UpdateSummaries, m_UpdateScores );
+
+	Close( );
+}
+
 #endif
@@ -25,6 +25,9 @@
 #include "ghostdbsqlite.h"
 #include "sqlite3.h"
 
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
 //
 // CQSLITE3 (wrapper class)
 //
@@ -39,6 +42,9 @@ CSQLITE3 :: CSQLITE3( string filename )
 
 CSQLITE3 :: ~CSQLITE3( )
 {
+	for( map<string, void *> :: iterator i = m_Statements.begin( ); i != m_Statements.end( ); ++i )
+		sqlite3_finalize( (sqlite3_stmt *)i->second );
+
 	sqlite3_close( (sqlite3 *)m_DB );
 }
 
@@ -52,6 +58,27 @@ int CSQLITE3 :: Prepare( string query, void **Statement )
 	return sqlite3_prepare_v2( (sqlite3 *)m_DB, query.c_str( ), -1, (sqlite3_stmt **)Statement, NULL );
 }
 
+int CSQLITE3 :: PrepareCached( string query, void **Statement )
+{
+	// return the statement we prepared the last time this query was used, the query is only parsed and planned the first time
+	// the caller must Reset the statement when it's done with it instead of calling Finalize (the destructor finalizes the cached statements)
+
+	map<string, void *> :: iterator i = m_Statements.find( query );
+
+	if( i != m_Statements.end( ) )
+	{
+		*Statement = i->second;
+		return sqlite3_clear_bindings( (sqlite3_stmt *)*Statement );
+	}
+
+	int RC = Prepare( query, Statement );
+
+	if( RC == SQLITE_OK && *Statement )
+		m_Statements[query] = *Statement;
+
+	return RC;
+}
+
 int CSQLITE3 :: Step( void *Statement )
 {
 	int RC = sqlite3_step( (sqlite3_stmt *)Statement );
@@ -103,7 +130,7 @@ uint32_t CSQLITE3 :: LastRowID( )
 // CGHostDBSQLite
 //
 
-CGHostDBSQLite :: CGHostDBSQLite( CConfig *CFG ) : CGHostDB( CFG )
+CGHostDBSQLite :: CGHostDBSQLite( CConfig *CFG ) : CGHostDB( CFG ), m_Thread( NULL ), m_NumQueued( 0 ), m_Exiting( false )
 {
 	m_File = CFG->GetString( "db_sqlite3_file", "ghost.dbs" );
 	CONSOLE_Print( "[SQLITE3] version " + string( SQLITE_VERSION ) );
@@ -188,7 +215,7 @@ CGHostDBSQLite :: CGHostDBSQLite( CConfig *CFG ) : CGHostDB( CFG )
 			// note to self: update the SchemaNumber and the database structure when making a new schema
 
 			CONSOLE_Print( "[SQLITE3] couldn't find admins table, assuming database is empty" );
-			SchemaNumber = "8";
+			SchemaNumber = "9";
 
 			if( m_DB->Exec( "CREATE TABLE admins ( id INTEGER PRIMARY KEY, name TEXT NOT NULL, server TEXT NOT NULL DEFAULT \"\" )" ) != SQLITE_OK )
 				CONSOLE_Print( "[SQLITE3] error creating admins table - " + m_DB->GetError( ) );
@@ -235,6 +262,9 @@ CGHostDBSQLite :: CGHostDBSQLite( CConfig *CFG ) : CGHostDB( CFG )
 			if( m_DB->Exec( "CREATE TABLE w3mmdvars ( id INTEGER PRIMARY KEY, gameid INTEGER NOT NULL, pid INTEGER NOT NULL, varname TEXT NOT NULL, value_int INTEGER DEFAULT NULL, value_real REAL DEFAULT NULL, value_string TEXT DEFAULT NULL )" ) != SQLITE_OK )
 				CONSOLE_Print( "[SQLITE3] error creating w3mmdvars table - " + m_DB->GetError( ) );
 
+			if( m_DB->Exec( "CREATE TABLE journalgames ( id INTEGER PRIMARY KEY, journalkey TEXT NOT NULL UNIQUE, gameid INTEGER NOT NULL )" ) != SQLITE_OK )
+				CONSOLE_Print( "[SQLITE3] error creating journalgames table - " + m_DB->GetError( ) );
+
 			if( m_DB->Exec( "CREATE INDEX idx_gameid ON gameplayers ( gameid )" ) != SQLITE_OK )
 				CONSOLE_Print( "[SQLITE3] error creating idx_gameid index on gameplayers table - " + m_DB->GetError( ) );
 
@@ -287,21 +317,72 @@ CGHostDBSQLite :: CGHostDBSQLite( CConfig *CFG ) : CGHostDB( CFG )
 		SchemaNumber = "8";
 	}
 
-	if( m_DB->Exec( "CREATE TEMPORARY TABLE iptocountry ( ip1 INTEGER NOT NULL, ip2 INTEGER NOT NULL, country TEXT NOT NULL, PRIMARY KEY ( ip1, ip2 ) )" ) != SQLITE_OK )
-		CONSOLE_Print( "[SQLITE3] error creating temporary iptocountry table - " + m_DB->GetError( ) );
+	if( SchemaNumber == "8" )
+	{
+		Upgrade8_9( );
+		SchemaNumber = "9";
+	}
+
+	// start the database thread, if this fails the callables are run by the thread creating them like they used to be
 
-	FromAddStmt = NULL;
+	try
+	{
+		m_Thread = new boost :: thread( boost :: bind( &CGHostDBSQLite :: DatabaseThread, this ) );
+	}
+	catch( boost :: thread_resource_error tre )
+	{
+		CONSOLE_Print( "[SQLITE3] error spawning database thread [" + string( tre.what( ) ) + "], running queries on the main thread" );
+		m_Thread = NULL;
+	}
 }
 
 CGHostDBSQLite :: ~CGHostDBSQLite( )
 {
-	if( FromAddStmt )
-		m_DB->Finalize( FromAddStmt );
+	// let the database thread finish the queued callables first so we don't lose any data
+
+	if( m_Thread )
+	{
+		{
+			boost :: mutex :: scoped_lock Lock( m_QueueMutex );
+
+			if( m_NumQueued > 0 )
+				CONSOLE_Print( "[SQLITE3] waiting for " + UTIL_ToString( m_NumQueued ) + " queued callables to finish" );
+
+			m_Exiting = true;
+		}
+
+		m_QueueNotEmpty.notify_all( );
+		m_Thread->join( );
+		delete m_Thread;
+	}
 
 	CONSOLE_Print( "[SQLITE3] closing database [" + m_File + "]" );
 	delete m_DB;
 }
 
+string CGHostDBSQLite :: GetStatus( )
+{
+	boost :: mutex :: scoped_lock Lock( m_QueueMutex );
+	return "DB STATUS --- Queued callables: " + UTIL_ToString( m_NumQueued ) + ".";
+}
+
+void CGHostDBSQLite :: CreateThread( CBaseCallable *callable )
+{
+	if( !m_Thread )
+	{
+		( *callable )( );
+		return;
+	}
+
+	{
+		boost :: mutex :: scoped_lock Lock( m_QueueMutex );
+		m_Queue.push_back( callable );
+		++m_NumQueued;
+	}
+
+	m_QueueNotEmpty.notify_one( );
+}
+
 void CGHostDBSQLite :: Upgrade1_2( )
 {
 	CONSOLE_Print( "[SQLITE3] schema upgrade v1 to v2 started" );
@@ -545,21 +626,45 @@ void CGHostDBSQLite :: Upgrade7_8( )
 	CONSOLE_Print( "[SQLITE3] schema upgrade v7 to v8 finished" );
 }
 
+void CGHostDBSQLite :: Upgrade8_9( )
+{
+	CONSOLE_Print( "[SQLITE3] schema upgrade v8 to v9 started" );
+
+	// create new tables
+
+	if( m_DB->Exec( "CREATE TABLE journalgames ( id INTEGER PRIMARY KEY, journalkey TEXT NOT NULL UNIQUE, gameid INTEGER NOT NULL )" ) != SQLITE_OK )
+		CONSOLE_Print( "[SQLITE3] error creating journalgames table - " + m_DB->GetError( ) );
+	else
+		CONSOLE_Print( "[SQLITE3] created journalgames table" );
+
+	// update schema number
+
+	if( m_DB->Exec( "UPDATE config SET value=\"9\" where name=\"schema_number\"" ) != SQLITE_OK )
+		CONSOLE_Print( "[SQLITE3] error updating schema number [9] - " + m_DB->GetError( ) );
+	else
+		CONSOLE_Print( "[SQLITE3] updated schema number [9]" );
+
+	CONSOLE_Print( "[SQLITE3] schema upgrade v8 to v9 finished" );
+}
+
 bool CGHostDBSQLite :: Begin( )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	return m_DB->Exec( "BEGIN TRANSACTION" ) == SQLITE_OK;
 }
 
 bool CGHostDBSQLite :: Commit( )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	return m_DB->Exec( "COMMIT TRANSACTION" ) == SQLITE_OK;
 }
 
 uint32_t CGHostDBSQLite :: AdminCount( string server )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	uint32_t Count = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT COUNT(*) FROM admins WHERE server=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT COUNT(*) FROM admins WHERE server=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -571,7 +676,7 @@ uint32_t CGHostDBSQLite :: AdminCount( string server )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error counting admins [" + server + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error counting admins [" + server + "] - " + m_DB->GetError( ) );
@@ -581,10 +686,11 @@ uint32_t CGHostDBSQLite :: AdminCount( string server )
 
 bool CGHostDBSQLite :: AdminCheck( string server, string user )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	bool IsAdmin = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT * FROM admins WHERE server=? AND name=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT * FROM admins WHERE server=? AND name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -599,7 +705,7 @@ bool CGHostDBSQLite :: AdminCheck( string server, string user )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error checking admin [" + server + " : " + user + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error checking admin [" + server + " : " + user + "] - " + m_DB->GetError( ) );
@@ -609,10 +715,11 @@ bool CGHostDBSQLite :: AdminCheck( string server, string user )
 
 bool CGHostDBSQLite :: AdminAdd( string server, string user )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	bool Success = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO admins ( server, name ) VALUES ( ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO admins ( server, name ) VALUES ( ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -625,7 +732,7 @@ bool CGHostDBSQLite :: AdminAdd( string server, string user )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding admin [" + server + " : " + user + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding admin [" + server + " : " + user + "] - " + m_DB->GetError( ) );
@@ -635,10 +742,11 @@ bool CGHostDBSQLite :: AdminAdd( string server, string user )
 
 bool CGHostDBSQLite :: AdminRemove( string server, string user )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	bool Success = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "DELETE FROM admins WHERE server=? AND name=?", (void **)&Statement );
+	m_DB->PrepareCached( "DELETE FROM admins WHERE server=? AND name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -651,7 +759,7 @@ bool CGHostDBSQLite :: AdminRemove( string server, string user )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error removing admin [" + server + " : " + user + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error removing admin [" + server + " : " + user + "] - " + m_DB->GetError( ) );
@@ -661,9 +769,10 @@ bool CGHostDBSQLite :: AdminRemove( string server, string user )
 
 vector<string> CGHostDBSQLite :: AdminList( string server )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	vector<string> AdminList;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT name FROM admins WHERE server=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT name FROM admins WHERE server=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -683,7 +792,7 @@ vector<string> CGHostDBSQLite :: AdminList( string server )
 		if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error retrieving admin list [" + server + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error retrieving admin list [" + server + "] - " + m_DB->GetError( ) );
@@ -693,9 +802,10 @@ vector<string> CGHostDBSQLite :: AdminList( string server )
 
 uint32_t CGHostDBSQLite :: BanCount( string server )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	uint32_t Count = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT COUNT(*) FROM bans WHERE server=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT COUNT(*) FROM bans WHERE server=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -707,7 +817,7 @@ uint32_t CGHostDBSQLite :: BanCount( string server )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error counting bans [" + server + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error counting bans [" + server + "] - " + m_DB->GetError( ) );
@@ -717,14 +827,15 @@ uint32_t CGHostDBSQLite :: BanCount( string server )
 
 CDBBan *CGHostDBSQLite :: BanCheck( string server, string user, string ip )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	CDBBan *Ban = NULL;
 	sqlite3_stmt *Statement;
 
 	if( ip.empty( ) )
-		m_DB->Prepare( "SELECT name, ip, date, gamename, admin, reason FROM bans WHERE server=? AND name=?", (void **)&Statement );
+		m_DB->PrepareCached( "SELECT name, ip, date, gamename, admin, reason FROM bans WHERE server=? AND name=?", (void **)&Statement );
 	else
-		m_DB->Prepare( "SELECT name, ip, date, gamename, admin, reason FROM bans WHERE (server=? AND name=?) OR ip=?", (void **)&Statement );
+		m_DB->PrepareCached( "SELECT name, ip, date, gamename, admin, reason FROM bans WHERE (server=? AND name=?) OR ip=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -748,7 +859,7 @@ CDBBan *CGHostDBSQLite :: BanCheck( string server, string user, string ip )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error checking ban [" + server + " : " + user + " : " + ip + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error checking ban [" + server + " : " + user + " : " + ip + "] - " + m_DB->GetError( ) );
@@ -758,10 +869,11 @@ CDBBan *CGHostDBSQLite :: BanCheck( string server, string user, string ip )
 
 bool CGHostDBSQLite :: BanAdd( string server, string user, string ip, string gamename, string admin, string reason )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	bool Success = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO bans ( server, name, ip, date, gamename, admin, reason ) VALUES ( ?, ?, ?, date('now'), ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO bans ( server, name, ip, date, gamename, admin, reason ) VALUES ( ?, ?, ?, date('now'), ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -779,7 +891,7 @@ bool CGHostDBSQLite :: BanAdd( string server, string user, string ip, string gam
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding ban [" + server + " : " + user + " : " + ip + " : " + gamename + " : " + admin + " : " + reason + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding ban [" + server + " : " + user + " : " + ip + " : " + gamename + " : " + admin + " : " + reason + "] - " + m_DB->GetError( ) );
@@ -789,10 +901,11 @@ bool CGHostDBSQLite :: BanAdd( string server, string user, string ip, string gam
 
 bool CGHostDBSQLite :: BanRemove( string server, string user )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	bool Success = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "DELETE FROM bans WHERE server=? AND name=?", (void **)&Statement );
+	m_DB->PrepareCached( "DELETE FROM bans WHERE server=? AND name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -805,7 +918,7 @@ bool CGHostDBSQLite :: BanRemove( string server, string user )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error removing ban [" + server + " : " + user + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error removing ban [" + server + " : " + user + "] - " + m_DB->GetError( ) );
@@ -815,10 +928,11 @@ bool CGHostDBSQLite :: BanRemove( string server, string user )
 
 bool CGHostDBSQLite :: BanRemove( string user )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( user.begin( ), user.end( ), user.begin( ), (int(*)(int))tolower );
 	bool Success = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "DELETE FROM bans WHERE name=?", (void **)&Statement );
+	m_DB->PrepareCached( "DELETE FROM bans WHERE name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -830,7 +944,7 @@ bool CGHostDBSQLite :: BanRemove( string user )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error removing ban [" + user + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error removing ban [" + user + "] - " + m_DB->GetError( ) );
@@ -840,9 +954,10 @@ bool CGHostDBSQLite :: BanRemove( string user )
 
 vector<CDBBan *> CGHostDBSQLite :: BanList( string server )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	vector<CDBBan *> BanList;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT name, ip, date, gamename, admin, reason FROM bans WHERE server=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT name, ip, date, gamename, admin, reason FROM bans WHERE server=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -862,7 +977,7 @@ vector<CDBBan *> CGHostDBSQLite :: BanList( string server )
 		if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error retrieving ban list [" + server + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error retrieving ban list [" + server + "] - " + m_DB->GetError( ) );
@@ -872,9 +987,10 @@ vector<CDBBan *> CGHostDBSQLite :: BanList( string server )
 
 uint32_t CGHostDBSQLite :: GameAdd( string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	uint32_t RowID = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO games ( server, map, datetime, gamename, ownername, duration, gamestate, creatorname, creatorserver ) VALUES ( ?, ?, datetime('now'), ?, ?, ?, ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO games ( server, map, datetime, gamename, ownername, duration, gamestate, creatorname, creatorserver ) VALUES ( ?, ?, datetime('now'), ?, ?, ?, ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -894,7 +1010,7 @@ uint32_t CGHostDBSQLite :: GameAdd( string server, string map, string gamename,
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding game [" + server + " : " + map + " : " + gamename + " : " + ownername + " : " + UTIL_ToString( duration ) + " : " + UTIL_ToString( gamestate ) + " : " + creatorname + " : " + creatorserver + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding game [" + server + " : " + map + " : " + gamename + " : " + ownername + " : " + UTIL_ToString( duration ) + " : " + UTIL_ToString( gamestate ) + " : " + creatorname + " : " + creatorserver + "] - " + m_DB->GetError( ) );
@@ -904,10 +1020,11 @@ uint32_t CGHostDBSQLite :: GameAdd( string server, string map, string gamename,
 
 uint32_t CGHostDBSQLite :: GamePlayerAdd( uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	uint32_t RowID = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO gameplayers ( gameid, name, ip, spoofed, reserved, loadingtime, left, leftreason, team, colour, spoofedrealm ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO gameplayers ( gameid, name, ip, spoofed, reserved, loadingtime, left, leftreason, team, colour, spoofedrealm ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -930,7 +1047,7 @@ uint32_t CGHostDBSQLite :: GamePlayerAdd( uint32_t gameid, string name, string i
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding gameplayer [" + UTIL_ToString( gameid ) + " : " + name + " : " + ip + " : " + UTIL_ToString( spoofed ) + " : " + spoofedrealm + " : " + UTIL_ToString( reserved ) + " : " + UTIL_ToString( loadingtime ) + " : " + UTIL_ToString( left ) + " : " + leftreason + " : " + UTIL_ToString( team ) + " : " + UTIL_ToString( colour ) + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding gameplayer [" + UTIL_ToString( gameid ) + " : " + name + " : " + ip + " : " + UTIL_ToString( spoofed ) + " : " + spoofedrealm + " : " + UTIL_ToString( reserved ) + " : " + UTIL_ToString( loadingtime ) + " : " + UTIL_ToString( left ) + " : " + leftreason + " : " + UTIL_ToString( team ) + " : " + UTIL_ToString( colour ) + "] - " + m_DB->GetError( ) );
@@ -940,10 +1057,11 @@ uint32_t CGHostDBSQLite :: GamePlayerAdd( uint32_t gameid, string name, string i
 
 uint32_t CGHostDBSQLite :: GamePlayerCount( string name )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	uint32_t Count = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameid WHERE name=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameid WHERE name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -955,7 +1073,7 @@ uint32_t CGHostDBSQLite :: GamePlayerCount( string name )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error counting gameplayers [" + name + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error counting gameplayers [" + name + "] - " + m_DB->GetError( ) );
@@ -965,13 +1083,14 @@ uint32_t CGHostDBSQLite :: GamePlayerCount( string name )
 
 CDBGamePlayerSummary *CGHostDBSQLite :: GamePlayerSummaryCheck( string name )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	if( GamePlayerCount( name ) == 0 )
 		return NULL;
 
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	CDBGamePlayerSummary *GamePlayerSummary = NULL;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT MIN(datetime), MAX(datetime), COUNT(*), MIN(loadingtime), AVG(loadingtime), MAX(loadingtime), MIN(left/CAST(duration AS REAL))*100, AVG(left/CAST(duration AS REAL))*100, MAX(left/CAST(duration AS REAL))*100, MIN(duration), AVG(duration), MAX(duration) FROM gameplayers LEFT JOIN games ON games.id=gameid WHERE name=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT MIN(datetime), MAX(datetime), COUNT(*), MIN(loadingtime), AVG(loadingtime), MAX(loadingtime), MIN(left/CAST(duration AS REAL))*100, AVG(left/CAST(duration AS REAL))*100, MAX(left/CAST(duration AS REAL))*100, MIN(duration), AVG(duration), MAX(duration) FROM gameplayers LEFT JOIN games ON games.id=gameid WHERE name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1011,7 +1130,7 @@ CDBGamePlayerSummary *CGHostDBSQLite :: GamePlayerSummaryCheck( string name )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error checking gameplayersummary [" + name + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error checking gameplayersummary [" + name + "] - " + m_DB->GetError( ) );
@@ -1021,9 +1140,10 @@ CDBGamePlayerSummary *CGHostDBSQLite :: GamePlayerSummaryCheck( string name )
 
 uint32_t CGHostDBSQLite :: DotAGameAdd( uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	uint32_t RowID = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO dotagames ( gameid, winner, min, sec ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO dotagames ( gameid, winner, min, sec ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1039,7 +1159,7 @@ uint32_t CGHostDBSQLite :: DotAGameAdd( uint32_t gameid, uint32_t winner, uint32
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding dotagame [" + UTIL_ToString( gameid ) + " : " + UTIL_ToString( winner ) + " : " + UTIL_ToString( min ) + " : " + UTIL_ToString( sec ) + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding dotagame [" + UTIL_ToString( gameid ) + " : " + UTIL_ToString( winner ) + " : " + UTIL_ToString( min ) + " : " + UTIL_ToString( sec ) + "] - " + m_DB->GetError( ) );
@@ -1049,9 +1169,10 @@ uint32_t CGHostDBSQLite :: DotAGameAdd( uint32_t gameid, uint32_t winner, uint32
 
 uint32_t CGHostDBSQLite :: DotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	uint32_t RowID = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO dotaplayers ( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO dotaplayers ( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1083,7 +1204,7 @@ uint32_t CGHostDBSQLite :: DotAPlayerAdd( uint32_t gameid, uint32_t colour, uint
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding dotaplayer [" + UTIL_ToString( gameid ) + " : " + UTIL_ToString( colour ) + " : " + UTIL_ToString( kills ) + " : " + UTIL_ToString( deaths ) + " : " + UTIL_ToString( creepkills ) + " : " + UTIL_ToString( creepdenies ) + " : " + UTIL_ToString( assists ) + " : " + UTIL_ToString( gold ) + " : " + UTIL_ToString( neutralkills ) + " : " + item1 + " : " + item2 + " : " + item3 + " : " + item4 + " : " + item5 + " : " + item6 + " : " + hero + " : " + UTIL_ToString( newcolour ) + " : " + UTIL_ToString( towerkills ) + " : " + UTIL_ToString( raxkills ) + " : " + UTIL_ToString( courierkills ) + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding dotaplayer [" + UTIL_ToString( gameid ) + " : " + UTIL_ToString( colour ) + " : " + UTIL_ToString( kills ) + " : " + UTIL_ToString( deaths ) + " : " + UTIL_ToString( creepkills ) + " : " + UTIL_ToString( creepdenies ) + " : " + UTIL_ToString( assists ) + " : " + UTIL_ToString( gold ) + " : " + UTIL_ToString( neutralkills ) + " : " + item1 + " : " + item2 + " : " + item3 + " : " + item4 + " : " + item5 + " : " + item6 + " : " + hero + " : " + UTIL_ToString( newcolour ) + " : " + UTIL_ToString( towerkills ) + " : " + UTIL_ToString( raxkills ) + " : " + UTIL_ToString( courierkills ) + "] - " + m_DB->GetError( ) );
@@ -1093,10 +1214,11 @@ uint32_t CGHostDBSQLite :: DotAPlayerAdd( uint32_t gameid, uint32_t colour, uint
 
 uint32_t CGHostDBSQLite :: DotAPlayerCount( string name )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	uint32_t Count = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT COUNT(dotaplayers.id) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour WHERE name=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT COUNT(dotaplayers.id) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour WHERE name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1108,7 +1230,7 @@ uint32_t CGHostDBSQLite :: DotAPlayerCount( string name )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error counting dotaplayers [" + name + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error counting dotaplayers [" + name + "] - " + m_DB->GetError( ) );
@@ -1118,13 +1240,14 @@ uint32_t CGHostDBSQLite :: DotAPlayerCount( string name )
 
 CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	if( DotAPlayerCount( name ) == 0 )
 		return NULL;
 
 	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
 	CDBDotAPlayerSummary *DotAPlayerSummary = NULL;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT COUNT(dotaplayers.id), SUM(kills), SUM(deaths), SUM(creepkills), SUM(creepdenies), SUM(assists), SUM(neutralkills), SUM(towerkills), SUM(raxkills), SUM(courierkills) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour WHERE name=?", (void **)&Statement );
+	m_DB->PrepareCached( "SELECT COUNT(dotaplayers.id), SUM(kills), SUM(deaths), SUM(creepkills), SUM(creepdenies), SUM(assists), SUM(neutralkills), SUM(towerkills), SUM(raxkills), SUM(courierkills) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour WHERE name=?", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1151,7 +1274,7 @@ CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 				// calculate total wins
 
 				sqlite3_stmt *Statement2;
-				m_DB->Prepare( "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON games.id=dotagames.gameid WHERE name=? AND ((winner=1 AND dotaplayers.newcolour>=1 AND dotaplayers.newcolour<=5) OR (winner=2 AND dotaplayers.newcolour>=7 AND dotaplayers.newcolour<=11))", (void **)&Statement2 );
+				m_DB->PrepareCached( "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON games.id=dotagames.gameid WHERE name=? AND ((winner=1 AND dotaplayers.newcolour>=1 AND dotaplayers.newcolour<=5) OR (winner=2 AND dotaplayers.newcolour>=7 AND dotaplayers.newcolour<=11))", (void **)&Statement2 );
 
 				if( Statement2 )
 				{
@@ -1163,7 +1286,7 @@ CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 					else if( RC2 == SQLITE_ERROR )
 						CONSOLE_Print( "[SQLITE3] error counting dotaplayersummary wins [" + name + "] - " + m_DB->GetError( ) );
 
-					m_DB->Finalize( Statement2 );
+					m_DB->Reset( Statement2 );
 				}
 				else
 					CONSOLE_Print( "[SQLITE3] prepare error counting dotaplayersummary wins [" + name + "] - " + m_DB->GetError( ) );
@@ -1171,7 +1294,7 @@ CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 				// calculate total losses
 
 				sqlite3_stmt *Statement3;
-				m_DB->Prepare( "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON games.id=dotagames.gameid WHERE name=? AND ((winner=2 AND dotaplayers.newcolour>=1 AND dotaplayers.newcolour<=5) OR (winner=1 AND dotaplayers.newcolour>=7 AND dotaplayers.newcolour<=11))", (void **)&Statement3 );
+				m_DB->PrepareCached( "SELECT COUNT(*) FROM gameplayers LEFT JOIN games ON games.id=gameplayers.gameid LEFT JOIN dotaplayers ON dotaplayers.gameid=games.id AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON games.id=dotagames.gameid WHERE name=? AND ((winner=2 AND dotaplayers.newcolour>=1 AND dotaplayers.newcolour<=5) OR (winner=1 AND dotaplayers.newcolour>=7 AND dotaplayers.newcolour<=11))", (void **)&Statement3 );
 
 				if( Statement3 )
 				{
@@ -1183,7 +1306,7 @@ CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 					else if( RC3 == SQLITE_ERROR )
 						CONSOLE_Print( "[SQLITE3] error counting dotaplayersummary losses [" + name + "] - " + m_DB->GetError( ) );
 
-					m_DB->Finalize( Statement3 );
+					m_DB->Reset( Statement3 );
 				}
 				else
 					CONSOLE_Print( "[SQLITE3] prepare error counting dotaplayersummary losses [" + name + "] - " + m_DB->GetError( ) );
@@ -1198,7 +1321,7 @@ CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error checking dotaplayersummary [" + name + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error checking dotaplayersummary [" + name + "] - " + m_DB->GetError( ) );
@@ -1206,79 +1329,12 @@ CDBDotAPlayerSummary *CGHostDBSQLite :: DotAPlayerSummaryCheck( string name )
 	return DotAPlayerSummary;
 }
 
-string CGHostDBSQLite :: FromCheck( uint32_t ip )
-{
-	// a big thank you to tjado for help with the iptocountry feature
-
-	string From = "??";
-	sqlite3_stmt *Statement;
-	m_DB->Prepare( "SELECT country FROM iptocountry WHERE ip1<=? AND ip2>=?", (void **)&Statement );
-
-	if( Statement )
-	{
-		// we bind the ip as an int64 because SQLite treats it as signed
-
-		sqlite3_bind_int64( Statement, 1, ip );
-		sqlite3_bind_int64( Statement, 2, ip );
-		int RC = m_DB->Step( Statement );
-
-		if( RC == SQLITE_ROW )
-		{
-			vector<string> *Row = m_DB->GetRow( );
-
-			if( Row->size( ) == 1 )
-				From = (*Row)[0];
-			else
-				CONSOLE_Print( "[SQLITE3] error checking iptocountry [" + UTIL_ToString( ip ) + "] - row doesn't have 1 column" );
-		}
-		else if( RC == SQLITE_ERROR )
-			CONSOLE_Print( "[SQLITE3] error checking iptocountry [" + UTIL_ToString( ip ) + "] - " + m_DB->GetError( ) );
-
-		m_DB->Finalize( Statement );
-	}
-	else
-		CONSOLE_Print( "[SQLITE3] prepare error checking iptocountry [" + UTIL_ToString( ip ) + "] - " + m_DB->GetError( ) );
-
-	return From;
-}
-
-bool CGHostDBSQLite :: FromAdd( uint32_t ip1, uint32_t ip2, string country )
-{
-	// a big thank you to tjado for help with the iptocountry feature
-
-	bool Success = false;
-
-	if( !FromAddStmt )
-		m_DB->Prepare( "INSERT INTO iptocountry VALUES ( ?, ?, ? )", (void **)&FromAddStmt );
-
-	if( FromAddStmt )
-	{
-		// we bind the ip as an int64 because SQLite treats it as signed
-
-		sqlite3_bind_int64( (sqlite3_stmt *)FromAddStmt, 1, ip1 );
-		sqlite3_bind_int64( (sqlite3_stmt *)FromAddStmt, 2, ip2 );
-		sqlite3_bind_text( (sqlite3_stmt *)FromAddStmt, 3, country.c_str( ), -1, SQLITE_TRANSIENT );
-
-		int RC = m_DB->Step( FromAddStmt );
-
-		if( RC == SQLITE_DONE )
-			Success = true;
-		else if( RC == SQLITE_ERROR )
-			CONSOLE_Print( "[SQLITE3] error adding iptocountry [" + UTIL_ToString( ip1 ) + " : " + UTIL_ToString( ip2 ) + " : " + country + "] - " + m_DB->GetError( ) );
-
-		m_DB->Reset( FromAddStmt );
-	}
-	else
-		CONSOLE_Print( "[SQLITE3] prepare error adding iptocountry [" + UTIL_ToString( ip1 ) + " : " + UTIL_ToString( ip2 ) + " : " + country + "] - " + m_DB->GetError( ) );
-
-	return Success;
-}
-
 bool CGHostDBSQLite :: DownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	bool Success = false;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO downloads ( map, mapsize, datetime, name, ip, spoofed, spoofedrealm, downloadtime ) VALUES ( ?, ?, datetime('now'), ?, ?, ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO downloads ( map, mapsize, datetime, name, ip, spoofed, spoofedrealm, downloadtime ) VALUES ( ?, ?, datetime('now'), ?, ?, ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1297,7 +1353,7 @@ bool CGHostDBSQLite :: DownloadAdd( string map, uint32_t mapsize, string name, s
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding download [" + map + " : " + UTIL_ToString( mapsize ) + " : " + name + " : " + ip + " : " + UTIL_ToString( spoofed ) + " : " + spoofedrealm + " : " + UTIL_ToString( downloadtime ) + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding download [" + map + " : " + UTIL_ToString( mapsize ) + " : " + name + " : " + ip + " : " + UTIL_ToString( spoofed ) + " : " + spoofedrealm + " : " + UTIL_ToString( downloadtime ) + "] - " + m_DB->GetError( ) );
@@ -1307,9 +1363,10 @@ bool CGHostDBSQLite :: DownloadAdd( string map, uint32_t mapsize, string name, s
 
 uint32_t CGHostDBSQLite :: W3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
 	uint32_t RowID = 0;
 	sqlite3_stmt *Statement;
-	m_DB->Prepare( "INSERT INTO w3mmdplayers ( category, gameid, pid, name, flag, leaver, practicing ) VALUES ( ?, ?, ?, ?, ?, ?, ? )", (void **)&Statement );
+	m_DB->PrepareCached( "INSERT INTO w3mmdplayers ( category, gameid, pid, name, flag, leaver, practicing ) VALUES ( ?, ?, ?, ?, ?, ?, ? )", (void **)&Statement );
 
 	if( Statement )
 	{
@@ -1328,7 +1385,7 @@ uint32_t CGHostDBSQLite :: W3MMDPlayerAdd( string category, uint32_t gameid, uin
 		else if( RC == SQLITE_ERROR )
 			CONSOLE_Print( "[SQLITE3] error adding w3mmdplayer [" + category + " : " + UTIL_ToString( gameid ) + " : " + UTIL_ToString( pid ) + " : " + name + " : " + flag + " : " + UTIL_ToString( leaver ) + " : " + UTIL_ToString( practicing ) + "] - " + m_DB->GetError( ) );
 
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 	}
 	else
 		CONSOLE_Print( "[SQLITE3] prepare error adding w3mmdplayer [" + category + " : " + UTIL_ToString( gameid ) + " : " + UTIL_ToString( pid ) + " : " + name + " : " + flag + " : " + UTIL_ToString( leaver ) + " : " + UTIL_ToString( practicing ) + "] - " + m_DB->GetError( ) );
@@ -1338,6 +1395,8 @@ uint32_t CGHostDBSQLite :: W3MMDPlayerAdd( string category, uint32_t gameid, uin
 
 bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
+
 	if( var_ints.empty( ) )
 		return false;
 
@@ -1347,7 +1406,7 @@ bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints
         for( map<VarP,int32_t> :: iterator i = var_ints.begin( ); i != var_ints.end( ); ++i )
 	{
 		if( !Statement )
-			m_DB->Prepare( "INSERT INTO w3mmdvars ( gameid, pid, varname, value_int ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
+			m_DB->PrepareCached( "INSERT INTO w3mmdvars ( gameid, pid, varname, value_int ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
 
 		if( Statement )
 		{
@@ -1376,13 +1435,15 @@ bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints
 	}
 
 	if( Statement )
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 
 	return Success;
 }
 
 bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
+
 	if( var_reals.empty( ) )
 		return false;
 
@@ -1392,7 +1453,7 @@ bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals
         for( map<VarP,double> :: iterator i = var_reals.begin( ); i != var_reals.end( ); ++i )
 	{
 		if( !Statement )
-			m_DB->Prepare( "INSERT INTO w3mmdvars ( gameid, pid, varname, value_real ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
+			m_DB->PrepareCached( "INSERT INTO w3mmdvars ( gameid, pid, varname, value_real ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
 
 		if( Statement )
 		{
@@ -1421,13 +1482,15 @@ bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals
 	}
 
 	if( Statement )
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 
 	return Success;
 }
 
 bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings )
 {
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
+
 	if( var_strings.empty( ) )
 		return false;
 
@@ -1437,7 +1500,7 @@ bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_string
         for( map<VarP,string> :: iterator i = var_strings.begin( ); i != var_strings.end( ); ++i )
 	{
 		if( !Statement )
-			m_DB->Prepare( "INSERT INTO w3mmdvars ( gameid, pid, varname, value_string ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
+			m_DB->PrepareCached( "INSERT INTO w3mmdvars ( gameid, pid, varname, value_string ) VALUES ( ?, ?, ?, ? )", (void **)&Statement );
 
 		if( Statement )
 		{
@@ -1466,183 +1529,541 @@ bool CGHostDBSQLite :: W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_string
 	}
 
 	if( Statement )
-		m_DB->Finalize( Statement );
+		m_DB->Reset( Statement );
 
 	return Success;
 }
 
+uint32_t CGHostDBSQLite :: GameDataAdd( CDBGameData *gamedata )
+{
+	// save the game, the players and the stats inside one transaction
+	// unlike MySQL there's no round trip for each query so we just call the single row functions, what's expensive with sqlite is committing every row separately
+	// we hold the lock for the whole transaction so no other queries end up inside it
+	// if any row fails the whole game is rolled back (the single row functions have already printed the error) so we never save part of a game
+	// games replayed from the journal carry a journal key which is saved with the game, if it's already there the game was saved before the journal could checkpoint it and we don't save it twice
+
+	boost :: recursive_mutex :: scoped_lock Lock( m_Mutex );
+
+	if( m_DB->Exec( "BEGIN TRANSACTION" ) != SQLITE_OK )
+	{
+		CONSOLE_Print( "[SQLITE3] error beginning transaction for game data [" + gamedata->m_GameName + "] - " + m_DB->GetError( ) );
+		return 0;
+	}
+
+	uint32_t GameID = 0;
+	bool Success = true;
+
+	if( !gamedata->m_JournalKey.empty( ) )
+	{
+		sqlite3_stmt *Statement;
+		m_DB->PrepareCached( "SELECT gameid FROM journalgames WHERE journalkey=?", (void **)&Statement );
+
+		if( Statement )
+		{
+			sqlite3_bind_text( Statement, 1, gamedata->m_JournalKey.c_str( ), -1, SQLITE_TRANSIENT );
+			int RC = m_DB->Step( Statement );
+
+			if( RC == SQLITE_ROW )
+				GameID = sqlite3_column_int( Statement, 0 );
+			else if( RC == SQLITE_ERROR )
+			{
+				CONSOLE_Print( "[SQLITE3] error checking journal key [" + gamedata->m_JournalKey + "] - " + m_DB->GetError( ) );
+				Success = false;
+			}
+
+			m_DB->Reset( Statement );
+		}
+		else
+		{
+			CONSOLE_Print( "[SQLITE3] prepare error checking journal key [" + gamedata->m_JournalKey + "] - " + m_DB->GetError( ) );
+			Success = false;
+		}
+
+		if( GameID > 0 )
+		{
+			CONSOLE_Print( "[SQLITE3] game data [" + gamedata->m_GameName + "] with journal key [" + gamedata->m_JournalKey + "] was already saved as game [" + UTIL_ToString( GameID ) + "]" );
+			m_DB->Exec( "COMMIT TRANSACTION" );
+			return GameID;
+		}
+	}
+
+	if( Success )
+	{
+		GameID = GameAdd( gamedata->m_Server, gamedata->m_Map, gamedata->m_GameName, gamedata->m_OwnerName, gamedata->m_Duration, gamedata->m_GameState, gamedata->m_CreatorName, gamedata->m_CreatorServer );
+		Success = GameID > 0;
+	}
+
+	if( Success && !gamedata->m_JournalKey.empty( ) )
+	{
+		sqlite3_stmt *Statement;
+		m_DB->PrepareCached( "INSERT INTO journalgames ( journalkey, gameid ) VALUES ( ?, ? )", (void **)&Statement );
+
+		if( Statement )
+		{
+			sqlite3_bind_text( Statement, 1, gamedata->m_JournalKey.c_str( ), -1, SQLITE_TRANSIENT );
+			sqlite3_bind_int( Statement, 2, GameID );
+
+			if( m_DB->Step( Statement ) != SQLITE_DONE )
+			{
+				CONSOLE_Print( "[SQLITE3] error adding journal key [" + gamedata->m_JournalKey + "] - " + m_DB->GetError( ) );
+				Success = false;
+			}
+
+			m_DB->Reset( Statement );
+		}
+		else
+		{
+			CONSOLE_Print( "[SQLITE3] prepare error adding journal key [" + gamedata->m_JournalKey + "] - " + m_DB->GetError( ) );
+			Success = false;
+		}
+	}
+
+	for( vector<CDBGamePlayer> :: iterator i = gamedata->m_Players.begin( ); Success && i != gamedata->m_Players.end( ); ++i )
+		Success = GamePlayerAdd( GameID, i->GetName( ), i->GetIP( ), i->GetSpoofed( ), i->GetSpoofedRealm( ), i->GetReserved( ), i->GetLoadingTime( ), i->GetLeft( ), i->GetLeftReason( ), i->GetTeam( ), i->GetColour( ) ) > 0;
+
+	if( Success && gamedata->m_DotA )
+		Success = DotAGameAdd( GameID, gamedata->m_DotAWinner, gamedata->m_DotAMin, gamedata->m_DotASec ) > 0;
+
+	for( vector<CDBDotAPlayer> :: iterator i = gamedata->m_DotAPlayers.begin( ); Success && i != gamedata->m_DotAPlayers.end( ); ++i )
+		Success = DotAPlayerAdd( GameID, i->GetColour( ), i->GetKills( ), i->GetDeaths( ), i->GetCreepKills( ), i->GetCreepDenies( ), i->GetAssists( ), i->GetGold( ), i->GetNeutralKills( ), i->GetItem( 0 ), i->GetItem( 1 ), i->GetItem( 2 ), i->GetItem( 3 ), i->GetItem( 4 ), i->GetItem( 5 ), i->GetHero( ), i->GetNewColour( ), i->GetTowerKills( ), i->GetRaxKills( ), i->GetCourierKills( ) ) > 0;
+
+	for( vector<CDBW3MMDPlayer> :: iterator i = gamedata->m_W3MMDPlayers.begin( ); Success && i != gamedata->m_W3MMDPlayers.end( ); ++i )
+		Success = W3MMDPlayerAdd( gamedata->m_W3MMDCategory, GameID, i->GetPID( ), i->GetName( ), i->GetFlag( ), i->GetLeaver( ), i->GetPracticing( ) ) > 0;
+
+	if( Success && !gamedata->m_W3MMDVarInts.empty( ) )
+		Success = W3MMDVarAdd( GameID, gamedata->m_W3MMDVarInts );
+
+	if( Success && !gamedata->m_W3MMDVarReals.empty( ) )
+		Success = W3MMDVarAdd( GameID, gamedata->m_W3MMDVarReals );
+
+	if( Success && !gamedata->m_W3MMDVarStrings.empty( ) )
+		Success = W3MMDVarAdd( GameID, gamedata->m_W3MMDVarStrings );
+
+	if( Success )
+	{
+		if( m_DB->Exec( "COMMIT TRANSACTION" ) == SQLITE_OK )
+			return GameID;
+
+		CONSOLE_Print( "[SQLITE3] error committing transaction for game data [" + gamedata->m_GameName + "] - " + m_DB->GetError( ) );
+	}
+	else
+		CONSOLE_Print( "[SQLITE3] error adding game data [" + gamedata->m_GameName + "], rolling back" );
+
+	m_DB->Exec( "ROLLBACK TRANSACTION" );
+	return 0;
+}
+
 CCallableAdminCount *CGHostDBSQLite :: ThreadedAdminCount( string server )
 {
-	CCallableAdminCount *Callable = new CCallableAdminCount( server );
-	Callable->SetResult( AdminCount( server ) );
-	Callable->SetReady( true );
+	CCallableAdminCount *Callable = new CSQLiteCallableAdminCount( server, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableAdminCheck *CGHostDBSQLite :: ThreadedAdminCheck( string server, string user )
 {
-	CCallableAdminCheck *Callable = new CCallableAdminCheck( server, user );
-	Callable->SetResult( AdminCheck( server, user ) );
-	Callable->SetReady( true );
+	CCallableAdminCheck *Callable = new CSQLiteCallableAdminCheck( server, user, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableAdminAdd *CGHostDBSQLite :: ThreadedAdminAdd( string server, string user )
 {
-	CCallableAdminAdd *Callable = new CCallableAdminAdd( server, user );
-	Callable->SetResult( AdminAdd( server, user ) );
-	Callable->SetReady( true );
+	CCallableAdminAdd *Callable = new CSQLiteCallableAdminAdd( server, user, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableAdminRemove *CGHostDBSQLite :: ThreadedAdminRemove( string server, string user )
 {
-	CCallableAdminRemove *Callable = new CCallableAdminRemove( server, user );
-	Callable->SetResult( AdminRemove( server, user ) );
-	Callable->SetReady( true );
+	CCallableAdminRemove *Callable = new CSQLiteCallableAdminRemove( server, user, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableAdminList *CGHostDBSQLite :: ThreadedAdminList( string server )
 {
-	CCallableAdminList *Callable = new CCallableAdminList( server );
-	Callable->SetResult( AdminList( server ) );
-	Callable->SetReady( true );
+	CCallableAdminList *Callable = new CSQLiteCallableAdminList( server, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableBanCount *CGHostDBSQLite :: ThreadedBanCount( string server )
 {
-	CCallableBanCount *Callable = new CCallableBanCount( server );
-	Callable->SetResult( BanCount( server ) );
-	Callable->SetReady( true );
+	CCallableBanCount *Callable = new CSQLiteCallableBanCount( server, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableBanCheck *CGHostDBSQLite :: ThreadedBanCheck( string server, string user, string ip )
 {
-	CCallableBanCheck *Callable = new CCallableBanCheck( server, user, ip );
-	Callable->SetResult( BanCheck( server, user, ip ) );
-	Callable->SetReady( true );
+	CCallableBanCheck *Callable = new CSQLiteCallableBanCheck( server, user, ip, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableBanAdd *CGHostDBSQLite :: ThreadedBanAdd( string server, string user, string ip, string gamename, string admin, string reason )
 {
-	CCallableBanAdd *Callable = new CCallableBanAdd( server, user, ip, gamename, admin, reason );
-	Callable->SetResult( BanAdd( server, user, ip, gamename, admin, reason ) );
-	Callable->SetReady( true );
+	CCallableBanAdd *Callable = new CSQLiteCallableBanAdd( server, user, ip, gamename, admin, reason, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableBanRemove *CGHostDBSQLite :: ThreadedBanRemove( string server, string user )
 {
-	CCallableBanRemove *Callable = new CCallableBanRemove( server, user );
-	Callable->SetResult( BanRemove( server, user ) );
-	Callable->SetReady( true );
+	CCallableBanRemove *Callable = new CSQLiteCallableBanRemove( server, user, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableBanRemove *CGHostDBSQLite :: ThreadedBanRemove( string user )
 {
-	CCallableBanRemove *Callable = new CCallableBanRemove( string( ), user );
-	Callable->SetResult( BanRemove( user ) );
-	Callable->SetReady( true );
+	CCallableBanRemove *Callable = new CSQLiteCallableBanRemove( string( ), user, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableBanList *CGHostDBSQLite :: ThreadedBanList( string server )
 {
-	CCallableBanList *Callable = new CCallableBanList( server );
-	Callable->SetResult( BanList( server ) );
-	Callable->SetReady( true );
+	CCallableBanList *Callable = new CSQLiteCallableBanList( server, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableGameAdd *CGHostDBSQLite :: ThreadedGameAdd( string server, string map, string gamename, string ownername, uint32_t duration, uint32_t gamestate, string creatorname, string creatorserver )
 {
-	CCallableGameAdd *Callable = new CCallableGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver );
-	Callable->SetResult( GameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver ) );
-	Callable->SetReady( true );
+	CCallableGameAdd *Callable = new CSQLiteCallableGameAdd( server, map, gamename, ownername, duration, gamestate, creatorname, creatorserver, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableGamePlayerAdd *CGHostDBSQLite :: ThreadedGamePlayerAdd( uint32_t gameid, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t reserved, uint32_t loadingtime, uint32_t left, string leftreason, uint32_t team, uint32_t colour )
 {
-	CCallableGamePlayerAdd *Callable = new CCallableGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour );
-	Callable->SetResult( GamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour ) );
-	Callable->SetReady( true );
+	CCallableGamePlayerAdd *Callable = new CSQLiteCallableGamePlayerAdd( gameid, name, ip, spoofed, spoofedrealm, reserved, loadingtime, left, leftreason, team, colour, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableGamePlayerSummaryCheck *CGHostDBSQLite :: ThreadedGamePlayerSummaryCheck( string name )
 {
-	CCallableGamePlayerSummaryCheck *Callable = new CCallableGamePlayerSummaryCheck( name );
-	Callable->SetResult( GamePlayerSummaryCheck( name ) );
-	Callable->SetReady( true );
+	CCallableGamePlayerSummaryCheck *Callable = new CSQLiteCallableGamePlayerSummaryCheck( name, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableDotAGameAdd *CGHostDBSQLite :: ThreadedDotAGameAdd( uint32_t gameid, uint32_t winner, uint32_t min, uint32_t sec )
 {
-	CCallableDotAGameAdd *Callable = new CCallableDotAGameAdd( gameid, winner, min, sec );
-	Callable->SetResult( DotAGameAdd( gameid, winner, min, sec ) );
-	Callable->SetReady( true );
+	CCallableDotAGameAdd *Callable = new CSQLiteCallableDotAGameAdd( gameid, winner, min, sec, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableDotAPlayerAdd *CGHostDBSQLite :: ThreadedDotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills )
 {
-	CCallableDotAPlayerAdd *Callable = new CCallableDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills );
-	Callable->SetResult( DotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills ) );
-	Callable->SetReady( true );
+	CCallableDotAPlayerAdd *Callable = new CSQLiteCallableDotAPlayerAdd( gameid, colour, kills, deaths, creepkills, creepdenies, assists, gold, neutralkills, item1, item2, item3, item4, item5, item6, hero, newcolour, towerkills, raxkills, courierkills, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableDotAPlayerSummaryCheck *CGHostDBSQLite :: ThreadedDotAPlayerSummaryCheck( string name )
 {
-	CCallableDotAPlayerSummaryCheck *Callable = new CCallableDotAPlayerSummaryCheck( name );
-	Callable->SetResult( DotAPlayerSummaryCheck( name ) );
-	Callable->SetReady( true );
+	CCallableDotAPlayerSummaryCheck *Callable = new CSQLiteCallableDotAPlayerSummaryCheck( name, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableDownloadAdd *CGHostDBSQLite :: ThreadedDownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime )
 {
-	CCallableDownloadAdd *Callable = new CCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime );
-	Callable->SetResult( DownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime ) );
-	Callable->SetReady( true );
+	CCallableDownloadAdd *Callable = new CSQLiteCallableDownloadAdd( map, mapsize, name, ip, spoofed, spoofedrealm, downloadtime, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableW3MMDPlayerAdd *CGHostDBSQLite :: ThreadedW3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing )
 {
-	CCallableW3MMDPlayerAdd *Callable = new CCallableW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing );
-	Callable->SetResult( W3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing ) );
-	Callable->SetReady( true );
+	CCallableW3MMDPlayerAdd *Callable = new CSQLiteCallableW3MMDPlayerAdd( category, gameid, pid, name, flag, leaver, practicing, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBSQLite :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints )
 {
-	CCallableW3MMDVarAdd *Callable = new CCallableW3MMDVarAdd( gameid, var_ints );
-	Callable->SetResult( W3MMDVarAdd( gameid, var_ints ) );
-	Callable->SetReady( true );
+	CCallableW3MMDVarAdd *Callable = new CSQLiteCallableW3MMDVarAdd( gameid, var_ints, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBSQLite :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals )
 {
-	CCallableW3MMDVarAdd *Callable = new CCallableW3MMDVarAdd( gameid, var_reals );
-	Callable->SetResult( W3MMDVarAdd( gameid, var_reals ) );
-	Callable->SetReady( true );
+	CCallableW3MMDVarAdd *Callable = new CSQLiteCallableW3MMDVarAdd( gameid, var_reals, this );
+	CreateThread( Callable );
 	return Callable;
 }
 
 CCallableW3MMDVarAdd *CGHostDBSQLite :: ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings )
 {
-	CCallableW3MMDVarAdd *Callable = new CCallableW3MMDVarAdd( gameid, var_strings );
-	Callable->SetResult( W3MMDVarAdd( gameid, var_strings ) );
-	Callable->SetReady( true );
+	CCallableW3MMDVarAdd *Callable = new CSQLiteCallableW3MMDVarAdd( gameid, var_strings, this );
+	CreateThread( Callable );
+	return Callable;
+}
+
+CCallableGameDataAdd *CGHostDBSQLite :: ThreadedGameDataAdd( CDBGameData *gamedata )
+{
+	CCallableGameDataAdd *Callable = new CSQLiteCallableGameDataAdd( gamedata, this );
+	CreateThread( Callable );
 	return Callable;
 }
+
+void CGHostDBSQLite :: DatabaseThread( )
+{
+	while( true )
+	{
+		CBaseCallable *Callable = NULL;
+
+		{
+			boost :: mutex :: scoped_lock Lock( m_QueueMutex );
+
+			while( m_Queue.empty( ) && !m_Exiting )
+				m_QueueNotEmpty.wait( Lock );
+
+			if( m_Queue.empty( ) )
+				break;
+
+			Callable = m_Queue.front( );
+			m_Queue.pop_front( );
+		}
+
+		// the callable can be deleted as soon as it's ready so we can't touch it any more
+
+		( *Callable )( );
+
+		boost :: mutex :: scoped_lock Lock( m_QueueMutex );
+		--m_NumQueued;
+	}
+}
+
+//
+// SQLite Callables
+//
+
+void CSQLiteCallable :: Init( )
+{
+	CBaseCallable :: Init( );
+}
+
+void CSQLiteCallable :: Close( )
+{
+	CBaseCallable :: Close( );
+}
+
+void CSQLiteCallableAdminCount :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->AdminCount( m_Server );
+
+	Close( );
+}
+
+void CSQLiteCallableAdminCheck :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->AdminCheck( m_Server, m_User );
+
+	Close( );
+}
+
+void CSQLiteCallableAdminAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->AdminAdd( m_Server, m_User );
+
+	Close( );
+}
+
+void CSQLiteCallableAdminRemove :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->AdminRemove( m_Server, m_User );
+
+	Close( );
+}
+
+void CSQLiteCallableAdminList :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->AdminList( m_Server );
+
+	Close( );
+}
+
+void CSQLiteCallableBanCount :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->BanCount( m_Server );
+
+	Close( );
+}
+
+void CSQLiteCallableBanCheck :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->BanCheck( m_Server, m_User, m_IP );
+
+	Close( );
+}
+
+void CSQLiteCallableBanAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->BanAdd( m_Server, m_User, m_IP, m_GameName, m_Admin, m_Reason );
+
+	Close( );
+}
+
+void CSQLiteCallableBanRemove :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+	{
+		if( m_Server.empty( ) )
+			m_Result = m_DB->BanRemove( m_User );
+		else
+			m_Result = m_DB->BanRemove( m_Server, m_User );
+	}
+
+	Close( );
+}
+
+void CSQLiteCallableBanList :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->BanList( m_Server );
+
+	Close( );
+}
+
+void CSQLiteCallableGameAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->GameAdd( m_Server, m_Map, m_GameName, m_OwnerName, m_Duration, m_GameState, m_CreatorName, m_CreatorServer );
+
+	Close( );
+}
+
+void CSQLiteCallableGamePlayerAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->GamePlayerAdd( m_GameID, m_Name, m_IP, m_Spoofed, m_SpoofedRealm, m_Reserved, m_LoadingTime, m_Left, m_LeftReason, m_Team, m_Colour );
+
+	Close( );
+}
+
+void CSQLiteCallableGamePlayerSummaryCheck :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->GamePlayerSummaryCheck( m_Name );
+
+	Close( );
+}
+
+void CSQLiteCallableDotAGameAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->DotAGameAdd( m_GameID, m_Winner, m_Min, m_Sec );
+
+	Close( );
+}
+
+void CSQLiteCallableDotAPlayerAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->DotAPlayerAdd( m_GameID, m_Colour, m_Kills, m_Deaths, m_CreepKills, m_CreepDenies, m_Assists, m_Gold, m_NeutralKills, m_Item1, m_Item2, m_Item3, m_Item4, m_Item5, m_Item6, m_Hero, m_NewColour, m_TowerKills, m_RaxKills, m_CourierKills );
+
+	Close( );
+}
+
+void CSQLiteCallableDotAPlayerSummaryCheck :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->DotAPlayerSummaryCheck( m_Name );
+
+	Close( );
+}
+
+void CSQLiteCallableDownloadAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->DownloadAdd( m_Map, m_MapSize, m_Name, m_IP, m_Spoofed, m_SpoofedRealm, m_DownloadTime );
+
+	Close( );
+}
+
+void CSQLiteCallableW3MMDPlayerAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->W3MMDPlayerAdd( m_Category, m_GameID, m_PID, m_Name, m_Flag, m_Leaver, m_Practicing );
+
+	Close( );
+}
+
+void CSQLiteCallableW3MMDVarAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+	{
+		if( m_ValueType == VALUETYPE_INT )
+			m_Result = m_DB->W3MMDVarAdd( m_GameID, m_VarInts );
+		else if( m_ValueType == VALUETYPE_REAL )
+			m_Result = m_DB->W3MMDVarAdd( m_GameID, m_VarReals );
+		else
+			m_Result = m_DB->W3MMDVarAdd( m_GameID, m_VarStrings );
+	}
+
+	Close( );
+}
+
+void CSQLiteCallableGameDataAdd :: operator( )( )
+{
+	Init( );
+
+	if( m_Error.empty( ) )
+		m_Result = m_DB->GameDataAdd( m_GameData );
+
+	Close( );
+}
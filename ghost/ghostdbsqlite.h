@@ -21,6 +21,10 @@
 #ifndef GHOSTDBSQLITE_H
 #define GHOSTDBSQLITE_H
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 /**************
  *** SCHEMA ***
  **************
@@ -140,13 +144,6 @@ CREATE TABLE w3mmdvars (
 	value_string TEXT DEFAULT NULL
 )
 
-CREATE TEMPORARY TABLE iptocountry (
-	ip1 INTEGER NOT NULL,
-	ip2 INTEGER NOT NULL,
-	country TEXT NOT NULL,
-	PRIMARY KEY ( ip1, ip2 )
-)
-
 CREATE INDEX idx_gameid ON gameplayers ( gameid )
 CREATE INDEX idx_gameid_colour ON dotaplayers ( gameid, colour )
 
@@ -164,6 +161,7 @@ private:
 	void *m_DB;
 	bool m_Ready;
 	vector<string> m_Row;
+	map<string, void *> m_Statements;	// the cached prepared statements keyed by their query
 
 public:
 	CSQLITE3( string filename );
@@ -174,6 +172,7 @@ public:
 	string GetError( );
 
 	int Prepare( string query, void **Statement );
+	int PrepareCached( string query, void **Statement );
 	int Step( void *Statement );
 	int Finalize( void *Statement );
 	int Reset( void *Statement );
@@ -186,22 +185,35 @@ public:
 // CGHostDBSQLite
 //
 
+// the threaded database functions queue their callables for a single database thread instead of running the query immediately
+// the database thread uses the same connection as everything else (so the queries are still serialized by m_Mutex) but the caller doesn't have to wait for them
+// one thread is enough because sqlite only allows one writer at a time anyway and it keeps the callables in the order they were created
+
 class CGHostDBSQLite : public CGHostDB
 {
 private:
 	string m_File;
 	CSQLITE3 *m_DB;
 
-	// we keep some prepared statements in memory rather than recreating them each function call
-	// this is an optimization because preparing statements takes time
-	// however it only pays off if you're going to be using the statement extremely often
+	// the standard database functions are called directly by the threaded functions so they can be called by game worker threads too
+	// a sqlite connection can't safely be shared by multiple threads without serializing each function so they all lock this mutex
+	// it's recursive so GameDataAdd can hold it for the whole transaction while it calls the other functions
 
-	void *FromAddStmt;
+	boost :: recursive_mutex m_Mutex;
+
+	boost :: thread *m_Thread;						// the database thread which runs the callables
+	deque<CBaseCallable *> m_Queue;					// the callables waiting for the database thread
+	uint32_t m_NumQueued;							// the number of callables in m_Queue or being run by the database thread
+	bool m_Exiting;									// set when the database thread should finish the queue and exit
+	boost :: mutex m_QueueMutex;					// protects m_Queue, m_NumQueued and m_Exiting
+	boost :: condition_variable m_QueueNotEmpty;	// signalled when a callable is queued (or when exiting)
 
 public:
 	CGHostDBSQLite( CConfig *CFG );
 	virtual ~CGHostDBSQLite( );
 
+	virtual string GetStatus( );
+
 	virtual void Upgrade1_2( );
 	virtual void Upgrade2_3( );
 	virtual void Upgrade3_4( );
@@ -209,6 +221,7 @@ public:
 	virtual void Upgrade5_6( );
 	virtual void Upgrade6_7( );
 	virtual void Upgrade7_8( );
+	virtual void Upgrade8_9( );
 
 	virtual bool Begin( );
 	virtual bool Commit( );
@@ -231,18 +244,16 @@ public:
 	virtual uint32_t DotAPlayerAdd( uint32_t gameid, uint32_t colour, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t gold, uint32_t neutralkills, string item1, string item2, string item3, string item4, string item5, string item6, string hero, uint32_t newcolour, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills );
 	virtual uint32_t DotAPlayerCount( string name );
 	virtual CDBDotAPlayerSummary *DotAPlayerSummaryCheck( string name );
-	virtual string FromCheck( uint32_t ip );
-	virtual bool FromAdd( uint32_t ip1, uint32_t ip2, string country );
 	virtual bool DownloadAdd( string map, uint32_t mapsize, string name, string ip, uint32_t spoofed, string spoofedrealm, uint32_t downloadtime );
 	virtual uint32_t W3MMDPlayerAdd( string category, uint32_t gameid, uint32_t pid, string name, string flag, uint32_t leaver, uint32_t practicing );
 	virtual bool W3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints );
 	virtual bool W3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals );
 	virtual bool W3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings );
+	virtual uint32_t GameDataAdd( CDBGameData *gamedata );
 
 	// threaded database functions
-	// note: these are not actually implemented with threads at the moment, they WILL block until the query is complete
-	// todotodo: implement threads here
 
+	virtual void CreateThread( CBaseCallable *callable );
 	virtual CCallableAdminCount *ThreadedAdminCount( string server );
 	virtual CCallableAdminCheck *ThreadedAdminCheck( string server, string user );
 	virtual CCallableAdminAdd *ThreadedAdminAdd( string server, string user );
@@ -265,6 +276,249 @@ public:
 	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,int32_t> var_ints );
 	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,double> var_reals );
 	virtual CCallableW3MMDVarAdd *ThreadedW3MMDVarAdd( uint32_t gameid, map<VarP,string> var_strings );
+	virtual CCallableGameDataAdd *ThreadedGameDataAdd( CDBGameData *gamedata );
+
+private:
+	void DatabaseThread( );
+};
+
+//
+// SQLite Callables
+//
+
+class CSQLiteCallable : virtual public CBaseCallable
+{
+protected:
+	CGHostDBSQLite *m_DB;
+
+public:
+	CSQLiteCallable( CGHostDBSQLite *nDB ) : CBaseCallable( ), m_DB( nDB ) { }
+	virtual ~CSQLiteCallable( ) { }
+
+	virtual void Init( );
+	virtual void Close( );
+};
+
+class CSQLiteCallableAdminCount : public CCallableAdminCount, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableAdminCount( string nServer, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableAdminCount( nServer ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableAdminCount( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableAdminCheck : public CCallableAdminCheck, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableAdminCheck( string nServer, string nUser, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableAdminCheck( nServer, nUser ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableAdminCheck( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableAdminAdd : public CCallableAdminAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableAdminAdd( string nServer, string nUser, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableAdminAdd( nServer, nUser ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableAdminAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableAdminRemove : public CCallableAdminRemove, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableAdminRemove( string nServer, string nUser, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableAdminRemove( nServer, nUser ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableAdminRemove( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableAdminList : public CCallableAdminList, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableAdminList( string nServer, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableAdminList( nServer ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableAdminList( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableBanCount : public CCallableBanCount, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableBanCount( string nServer, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableBanCount( nServer ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableBanCount( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableBanCheck : public CCallableBanCheck, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableBanCheck( string nServer, string nUser, string nIP, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableBanCheck( nServer, nUser, nIP ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableBanCheck( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableBanAdd : public CCallableBanAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableBanAdd( string nServer, string nUser, string nIP, string nGameName, string nAdmin, string nReason, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableBanAdd( nServer, nUser, nIP, nGameName, nAdmin, nReason ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableBanAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableBanRemove : public CCallableBanRemove, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableBanRemove( string nServer, string nUser, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableBanRemove( nServer, nUser ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableBanRemove( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableBanList : public CCallableBanList, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableBanList( string nServer, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableBanList( nServer ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableBanList( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableGameAdd : public CCallableGameAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableGameAdd( string nServer, string nMap, string nGameName, string nOwnerName, uint32_t nDuration, uint32_t nGameState, string nCreatorName, string nCreatorServer, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableGameAdd( nServer, nMap, nGameName, nOwnerName, nDuration, nGameState, nCreatorName, nCreatorServer ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableGameAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableGamePlayerAdd : public CCallableGamePlayerAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableGamePlayerAdd( uint32_t nGameID, string nName, string nIP, uint32_t nSpoofed, string nSpoofedRealm, uint32_t nReserved, uint32_t nLoadingTime, uint32_t nLeft, string nLeftReason, uint32_t nTeam, uint32_t nColour, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableGamePlayerAdd( nGameID, nName, nIP, nSpoofed, nSpoofedRealm, nReserved, nLoadingTime, nLeft, nLeftReason, nTeam, nColour ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableGamePlayerAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableGamePlayerSummaryCheck : public CCallableGamePlayerSummaryCheck, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableGamePlayerSummaryCheck( string nName, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableGamePlayerSummaryCheck( nName ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableGamePlayerSummaryCheck( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableDotAGameAdd : public CCallableDotAGameAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableDotAGameAdd( uint32_t nGameID, uint32_t nWinner, uint32_t nMin, uint32_t nSec, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableDotAGameAdd( nGameID, nWinner, nMin, nSec ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableDotAGameAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableDotAPlayerAdd : public CCallableDotAPlayerAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableDotAPlayerAdd( uint32_t nGameID, uint32_t nColour, uint32_t nKills, uint32_t nDeaths, uint32_t nCreepKills, uint32_t nCreepDenies, uint32_t nAssists, uint32_t nGold, uint32_t nNeutralKills, string nItem1, string nItem2, string nItem3, string nItem4, string nItem5, string nItem6, string nHero, uint32_t nNewColour, uint32_t nTowerKills, uint32_t nRaxKills, uint32_t nCourierKills, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableDotAPlayerAdd( nGameID, nColour, nKills, nDeaths, nCreepKills, nCreepDenies, nAssists, nGold, nNeutralKills, nItem1, nItem2, nItem3, nItem4, nItem5, nItem6, nHero, nNewColour, nTowerKills, nRaxKills, nCourierKills ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableDotAPlayerAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableDotAPlayerSummaryCheck : public CCallableDotAPlayerSummaryCheck, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableDotAPlayerSummaryCheck( string nName, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableDotAPlayerSummaryCheck( nName ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableDotAPlayerSummaryCheck( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableDownloadAdd : public CCallableDownloadAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableDownloadAdd( string nMap, uint32_t nMapSize, string nName, string nIP, uint32_t nSpoofed, string nSpoofedRealm, uint32_t nDownloadTime, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableDownloadAdd( nMap, nMapSize, nName, nIP, nSpoofed, nSpoofedRealm, nDownloadTime ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableDownloadAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableW3MMDPlayerAdd : public CCallableW3MMDPlayerAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableW3MMDPlayerAdd( string nCategory, uint32_t nGameID, uint32_t nPID, string nName, string nFlag, uint32_t nLeaver, uint32_t nPracticing, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableW3MMDPlayerAdd( nCategory, nGameID, nPID, nName, nFlag, nLeaver, nPracticing ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableW3MMDPlayerAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableW3MMDVarAdd : public CCallableW3MMDVarAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableW3MMDVarAdd( uint32_t nGameID, map<VarP,int32_t> nVarInts, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableW3MMDVarAdd( nGameID, nVarInts ), CSQLiteCallable( nDB ) { }
+	CSQLiteCallableW3MMDVarAdd( uint32_t nGameID, map<VarP,double> nVarReals, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableW3MMDVarAdd( nGameID, nVarReals ), CSQLiteCallable( nDB ) { }
+	CSQLiteCallableW3MMDVarAdd( uint32_t nGameID, map<VarP,string> nVarStrings, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableW3MMDVarAdd( nGameID, nVarStrings ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableW3MMDVarAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
+};
+
+class CSQLiteCallableGameDataAdd : public CCallableGameDataAdd, public CSQLiteCallable
+{
+public:
+	CSQLiteCallableGameDataAdd( CDBGameData *nGameData, CGHostDBSQLite *nDB ) : CBaseCallable( ), CCallableGameDataAdd( nGameData ), CSQLiteCallable( nDB ) { }
+	virtual ~CSQLiteCallableGameDataAdd( ) { }
+
+	virtual void operator( )( );
+	virtual void Init( ) { CSQLiteCallable :: Init( ); }
+	virtual void Close( ) { CSQLiteCallable :: Close( ); }
 };
 
 #endif
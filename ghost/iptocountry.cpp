@@ -0,0 +1,367 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#include "ghost.h"
+#include "util.h"
+#include "csvparser.h"
+#include "iptocountry.h"
+
+#include <boost/filesystem.hpp>
+
+#ifndef WIN32
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+//
+// CIPToCountry
+//
+
+class CIPToCountryRange
+{
+public:
+	uint32_t m_Start;
+	uint32_t m_End;
+	uint16_t m_Country;
+
+	CIPToCountryRange( uint32_t nStart, uint32_t nEnd, uint16_t nCountry ) : m_Start( nStart ), m_End( nEnd ), m_Country( nCountry ) { }
+
+	bool operator<( const CIPToCountryRange &range ) const	{ return m_Start < range.m_Start; }
+};
+
+CIPToCountry :: CIPToCountry( ) : m_Mapping( NULL ), m_MappingSize( 0 ), m_NumRanges( 0 ), m_NumCountries( 0 ), m_Names( NULL ), m_Starts( NULL ), m_Ends( NULL ), m_Countries( NULL )
+{
+
+}
+
+CIPToCountry :: ~CIPToCountry( )
+{
+	Clear( );
+}
+
+void CIPToCountry :: Load( string csvFile, string cacheFile )
+{
+	uint32_t StartTicks = GetTicks( );
+	Clear( );
+
+	// the cache remembers the size and modification time of the CSV file it was built from so we can tell when it's stale
+
+	bool CSVExists = false;
+	uint32_t CSVSize = 0;
+	uint32_t CSVTime = 0;
+
+	try
+	{
+		boost :: filesystem :: path CSVPath( csvFile );
+
+		if( boost :: filesystem :: exists( CSVPath ) )
+		{
+			CSVSize = (uint32_t)boost :: filesystem :: file_size( CSVPath );
+			CSVTime = (uint32_t)boost :: filesystem :: last_write_time( CSVPath );
+			CSVExists = true;
+		}
+	}
+	catch( const exception &ex )
+	{
+		CONSOLE_Print( "[GHOST] error checking file [" + csvFile + "] - " + ex.what( ) );
+	}
+
+	if( LoadCache( cacheFile, CSVExists, CSVSize, CSVTime ) )
+		CONSOLE_Print( "[GHOST] loaded " + UTIL_ToString( m_NumRanges ) + " iptocountry ranges from [" + cacheFile + "] in " + UTIL_ToString( GetTicks( ) - StartTicks ) + "ms" );
+	else if( !CSVExists )
+		CONSOLE_Print( "[GHOST] warning - unable to read file [" + csvFile + "], iptocountry data not loaded" );
+	else if( LoadCSV( csvFile, CSVSize, CSVTime ) )
+	{
+		CONSOLE_Print( "[GHOST] loaded " + UTIL_ToString( m_NumRanges ) + " iptocountry ranges from [" + csvFile + "] in " + UTIL_ToString( GetTicks( ) - StartTicks ) + "ms" );
+
+		// write the cache file so we don't have to parse the CSV file again next time
+
+		ofstream out;
+		out.open( cacheFile.c_str( ), ios :: binary );
+
+		if( out.fail( ) )
+			CONSOLE_Print( "[GHOST] warning - unable to write iptocountry cache file [" + cacheFile + "]" );
+		else
+		{
+			out.write( m_Data.data( ), m_Data.size( ) );
+			out.close( );
+		}
+	}
+	else
+		CONSOLE_Print( "[GHOST] warning - unable to parse file [" + csvFile + "], iptocountry data not loaded" );
+}
+
+string CIPToCountry :: Lookup( uint32_t ip )
+{
+	// find the last range which starts at or before the address and check that it doesn't end before the address
+
+	const uint32_t *Range = upper_bound( m_Starts, m_Starts + m_NumRanges, ip );
+
+	if( Range == m_Starts )
+		return "??";
+
+	uint32_t i = Range - m_Starts - 1;
+
+	if( m_Ends[i] < ip || m_Countries[i] >= m_NumCountries )
+		return "??";
+
+	return string( m_Names + m_Countries[i] * IPTOCOUNTRY_NAME_SIZE );
+}
+
+bool CIPToCountry :: LoadCache( string cacheFile, bool csvExists, uint32_t csvSize, uint32_t csvTime )
+{
+	const char *Data = NULL;
+	uint32_t Size = 0;
+
+#ifdef WIN32
+	ifstream in;
+	in.open( cacheFile.c_str( ), ios :: binary );
+
+	if( in.fail( ) )
+		return false;
+
+	in.seekg( 0, ios :: end );
+	streamoff Length = in.tellg( );
+	in.seekg( 0, ios :: beg );
+
+	if( Length < (streamoff)sizeof( IPToCountryHeader ) || Length > (streamoff)0xFFFFFFFF )
+		return false;
+
+	Size = (uint32_t)Length;
+	m_Data.resize( Size );
+
+	if( Size > 0 )
+		in.read( &m_Data[0], Size );
+
+	in.close( );
+	Data = m_Data.data( );
+#else
+	int FD = open( cacheFile.c_str( ), O_RDONLY );
+
+	if( FD == -1 )
+		return false;
+
+	struct stat Stat;
+
+	if( fstat( FD, &Stat ) == -1 || Stat.st_size < (off_t)sizeof( IPToCountryHeader ) || (uint64_t)Stat.st_size > 0xFFFFFFFF )
+	{
+		close( FD );
+		return false;
+	}
+
+	void *Mapping = mmap( NULL, Stat.st_size, PROT_READ, MAP_PRIVATE, FD, 0 );
+	close( FD );
+
+	if( Mapping == MAP_FAILED )
+		return false;
+
+	m_Mapping = Mapping;
+	m_MappingSize = Stat.st_size;
+	Data = (const char *)Mapping;
+	Size = Stat.st_size;
+#endif
+
+	if( !SetData( Data, Size ) )
+	{
+		CONSOLE_Print( "[GHOST] iptocountry cache file [" + cacheFile + "] is invalid or out of date, rebuilding it" );
+		Clear( );
+		return false;
+	}
+
+	// if the CSV file has been removed we just keep using the cache
+
+	const IPToCountryHeader *Header = (const IPToCountryHeader *)Data;
+
+	if( csvExists && ( Header->m_CSVSize != csvSize || Header->m_CSVTime != csvTime ) )
+	{
+		CONSOLE_Print( "[GHOST] iptocountry cache file [" + cacheFile + "] is out of date, rebuilding it" );
+		Clear( );
+		return false;
+	}
+
+	return true;
+}
+
+bool CIPToCountry :: LoadCSV( string csvFile, uint32_t csvSize, uint32_t csvTime )
+{
+	ifstream in;
+	in.open( csvFile.c_str( ) );
+
+	if( in.fail( ) )
+		return false;
+
+	CONSOLE_Print( "[GHOST] started loading [" + csvFile + "]" );
+
+	vector<CIPToCountryRange> Ranges;
+	map<string, uint16_t> CountryIndexes;
+	vector<string> Countries;
+	string Line;
+	string IP1;
+	string IP2;
+	string Country;
+	CSVParser parser;
+
+	while( !in.eof( ) )
+	{
+		getline( in, Line );
+
+		if( Line.empty( ) )
+			continue;
+
+		parser << Line;
+		parser >> IP1;
+		parser >> IP2;
+		parser >> Country;
+
+		uint32_t Start = UTIL_ToUInt32( IP1 );
+		uint32_t End = UTIL_ToUInt32( IP2 );
+
+		if( End < Start )
+			continue;
+
+		if( Country.size( ) >= IPTOCOUNTRY_NAME_SIZE )
+			Country = Country.substr( 0, IPTOCOUNTRY_NAME_SIZE - 1 );
+
+		map<string, uint16_t> :: iterator i = CountryIndexes.find( Country );
+
+		if( i == CountryIndexes.end( ) )
+		{
+			if( Countries.size( ) >= 65535 )
+				continue;
+
+			i = CountryIndexes.insert( make_pair( Country, (uint16_t)Countries.size( ) ) ).first;
+			Countries.push_back( Country );
+		}
+
+		Ranges.push_back( CIPToCountryRange( Start, End, i->second ) );
+	}
+
+	in.close( );
+
+	// sort the ranges by their first address and clip any overlapping ranges so a binary search always finds the right one
+	// the data doesn't normally contain overlapping ranges, when it does the range which starts first wins (the database used to return either one)
+
+	stable_sort( Ranges.begin( ), Ranges.end( ) );
+	vector<CIPToCountryRange> Clipped;
+
+	for( vector<CIPToCountryRange> :: iterator i = Ranges.begin( ); i != Ranges.end( ); ++i )
+	{
+		if( !Clipped.empty( ) && i->m_Start <= Clipped.back( ).m_End )
+		{
+			if( i->m_End <= Clipped.back( ).m_End )
+				continue;
+
+			i->m_Start = Clipped.back( ).m_End + 1;
+		}
+
+		Clipped.push_back( *i );
+	}
+
+	// build the cache image
+
+	IPToCountryHeader Header;
+	memset( &Header, 0, sizeof( Header ) );
+	Header.m_Magic = IPTOCOUNTRY_MAGIC;
+	Header.m_Version = IPTOCOUNTRY_VERSION;
+	Header.m_CSVSize = csvSize;
+	Header.m_CSVTime = csvTime;
+	Header.m_NumRanges = Clipped.size( );
+	Header.m_NumCountries = Countries.size( );
+
+	m_Data = string( sizeof( Header ) + Header.m_NumCountries * IPTOCOUNTRY_NAME_SIZE + Header.m_NumRanges * ( 2 * sizeof( uint32_t ) + sizeof( uint16_t ) ), 0 );
+	char *Data = &m_Data[0];
+	memcpy( Data, &Header, sizeof( Header ) );
+	char *Names = Data + sizeof( Header );
+	uint32_t *Starts = (uint32_t *)( Names + Header.m_NumCountries * IPTOCOUNTRY_NAME_SIZE );
+	uint32_t *Ends = Starts + Header.m_NumRanges;
+	uint16_t *CountryIndex = (uint16_t *)( Ends + Header.m_NumRanges );
+
+	for( uint32_t i = 0; i < Countries.size( ); ++i )
+		memcpy( Names + i * IPTOCOUNTRY_NAME_SIZE, Countries[i].c_str( ), Countries[i].size( ) );
+
+	for( uint32_t i = 0; i < Clipped.size( ); ++i )
+	{
+		Starts[i] = Clipped[i].m_Start;
+		Ends[i] = Clipped[i].m_End;
+		CountryIndex[i] = Clipped[i].m_Country;
+	}
+
+	return SetData( m_Data.data( ), m_Data.size( ) );
+}
+
+bool CIPToCountry :: SetData( const char *data, uint32_t size )
+{
+	if( size < sizeof( IPToCountryHeader ) )
+		return false;
+
+	const IPToCountryHeader *Header = (const IPToCountryHeader *)data;
+
+	if( Header->m_Magic != IPTOCOUNTRY_MAGIC || Header->m_Version != IPTOCOUNTRY_VERSION )
+		return false;
+
+	// the counts come from the file so check them against the size by dividing, multiplying a corrupt count could overflow
+
+	uint32_t Remaining = size - sizeof( IPToCountryHeader );
+	uint32_t RangeSize = 2 * sizeof( uint32_t ) + sizeof( uint16_t );
+
+	if( Header->m_NumCountries > Remaining / IPTOCOUNTRY_NAME_SIZE )
+		return false;
+
+	Remaining -= Header->m_NumCountries * IPTOCOUNTRY_NAME_SIZE;
+
+	if( Header->m_NumRanges > Remaining / RangeSize || Remaining != Header->m_NumRanges * RangeSize )
+		return false;
+
+	// Lookup copies the names as C strings so make sure they're all null terminated
+
+	for( uint32_t i = 0; i < Header->m_NumCountries; ++i )
+	{
+		if( data[sizeof( IPToCountryHeader ) + ( i + 1 ) * IPTOCOUNTRY_NAME_SIZE - 1] != 0 )
+			return false;
+	}
+
+	m_NumRanges = Header->m_NumRanges;
+	m_NumCountries = Header->m_NumCountries;
+	m_Names = data + sizeof( IPToCountryHeader );
+	m_Starts = (const uint32_t *)( m_Names + m_NumCountries * IPTOCOUNTRY_NAME_SIZE );
+	m_Ends = m_Starts + m_NumRanges;
+	m_Countries = (const uint16_t *)( m_Ends + m_NumRanges );
+	return true;
+}
+
+void CIPToCountry :: Clear( )
+{
+#ifndef WIN32
+	if( m_Mapping )
+		munmap( m_Mapping, m_MappingSize );
+#endif
+
+	m_Data.clear( );
+	m_Mapping = NULL;
+	m_MappingSize = 0;
+	m_NumRanges = 0;
+	m_NumCountries = 0;
+	m_Names = NULL;
+	m_Starts = NULL;
+	m_Ends = NULL;
+	m_Countries = NULL;
+}
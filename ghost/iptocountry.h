@@ -0,0 +1,77 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#ifndef IPTOCOUNTRY_H
+#define IPTOCOUNTRY_H
+
+//
+// CIPToCountry
+//
+
+// maps IP addresses to countries using the ranges from ip-to-country.csv
+// the ranges are kept sorted by their first address in packed arrays so a lookup is a binary search which doesn't touch the database and is safe to do from any thread
+// parsing the CSV file is slow so the packed arrays are also written to a binary cache file, later startups map the cache file into memory (or read it on Windows) as long as the CSV file hasn't changed
+// the cache file starts with a header (see below) followed by the country names (IPTOCOUNTRY_NAME_SIZE bytes each, null terminated), the first address of every range, the last address of every range and the country index of every range
+
+#define IPTOCOUNTRY_MAGIC		0x43504947		// "GIPC"
+#define IPTOCOUNTRY_VERSION		1
+#define IPTOCOUNTRY_NAME_SIZE	8
+
+struct IPToCountryHeader
+{
+	uint32_t m_Magic;				// IPTOCOUNTRY_MAGIC (this also catches a cache file written on a machine with a different byte order)
+	uint32_t m_Version;				// IPTOCOUNTRY_VERSION
+	uint32_t m_CSVSize;				// the size of the CSV file the cache was built from
+	uint32_t m_CSVTime;				// the modification time of the CSV file the cache was built from
+	uint32_t m_NumRanges;
+	uint32_t m_NumCountries;
+	uint32_t m_Reserved[2];
+};
+
+class CIPToCountry
+{
+private:
+	string m_Data;					// the cache image when it was built from the CSV file or read into memory
+	void *m_Mapping;				// the memory mapped cache file (NULL if the cache isn't memory mapped)
+	uint32_t m_MappingSize;			// the size of the memory mapping
+	uint32_t m_NumRanges;
+	uint32_t m_NumCountries;
+	const char *m_Names;			// the country names
+	const uint32_t *m_Starts;		// the first address of each range (sorted)
+	const uint32_t *m_Ends;			// the last address of each range
+	const uint16_t *m_Countries;	// the country index of each range
+
+public:
+	CIPToCountry( );
+	~CIPToCountry( );
+
+	uint32_t GetNumRanges( )		{ return m_NumRanges; }
+
+	void Load( string csvFile, string cacheFile );
+	string Lookup( uint32_t ip );
+
+private:
+	bool LoadCache( string cacheFile, bool csvExists, uint32_t csvSize, uint32_t csvTime );
+	bool LoadCSV( string csvFile, uint32_t csvSize, uint32_t csvTime );
+	bool SetData( const char *data, uint32_t size );
+	void Clear( );
+};
+
+#endif
@@ -28,9 +28,131 @@
 #define __STORMLIB_SELF__
 #include <stormlib/StormLib.h>
 
+#ifndef WIN32
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
 #define ROTL(x,n) ((x)<<(n))|((x)>>(32-(n)))	// this won't work with signed types
 #define ROTR(x,n) ((x)>>(n))|((x)<<(32-(n)))	// this won't work with signed types
 
+//
+// CMapData
+//
+
+CMapData :: CMapData( CCRC32 *crc, string fileName ) : m_Data( NULL ), m_Size( 0 ), m_Mapped( false ), m_CRC( 0 )
+{
+	// try to memory map the file first
+
+#ifdef WIN32
+	m_File = INVALID_HANDLE_VALUE;
+	m_Mapping = NULL;
+	HANDLE File = CreateFileA( fileName.c_str( ), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if( File != INVALID_HANDLE_VALUE )
+	{
+		DWORD FileSize = GetFileSize( File, NULL );
+		HANDLE Mapping = NULL;
+
+		if( FileSize != INVALID_FILE_SIZE && FileSize > 0 )
+			Mapping = CreateFileMappingA( File, NULL, PAGE_READONLY, 0, 0, NULL );
+
+		void *Data = Mapping ? MapViewOfFile( Mapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+
+		if( Data )
+		{
+			m_File = File;
+			m_Mapping = Mapping;
+			m_Data = (const unsigned char *)Data;
+			m_Size = FileSize;
+			m_Mapped = true;
+		}
+		else
+		{
+			if( Mapping )
+				CloseHandle( Mapping );
+
+			CloseHandle( File );
+		}
+	}
+#else
+	int File = open( fileName.c_str( ), O_RDONLY );
+
+	if( File != -1 )
+	{
+		struct stat FileStat;
+
+		if( fstat( File, &FileStat ) == 0 && FileStat.st_size > 0 )
+		{
+			// we never write to the map data so we use a private mapping, this stops anything we do from reaching the file
+			// but it doesn't protect us from the file being changed, whether those changes show up in a private mapping is unspecified (on Linux they do) and reading past the end of a truncated file raises SIGBUS, see the note in map.h
+
+			void *Data = mmap( NULL, FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0 );
+
+			if( Data != MAP_FAILED )
+			{
+				m_Data = (const unsigned char *)Data;
+				m_Size = FileStat.st_size;
+				m_Mapped = true;
+			}
+		}
+
+		// the mapping stays valid after the file is closed
+
+		close( File );
+	}
+#endif
+
+	// fall back to reading the file into memory
+
+	if( !m_Mapped )
+	{
+		m_Buffer = UTIL_FileRead( fileName );
+
+		if( !m_Buffer.empty( ) )
+		{
+			m_Data = (const unsigned char *)m_Buffer.data( );
+			m_Size = m_Buffer.size( );
+		}
+	}
+
+	// calculate the CRC of every map part now so we don't have to calculate it again for every W3GS_MAPPART packet we send
+	// the CRC of the whole map is combined from the part CRCs so the map data only has to be read once
+
+	if( m_Size > 0 )
+	{
+		m_PartCRCs.reserve( ( m_Size + MAPPART_SIZE - 1 ) / MAPPART_SIZE );
+
+		for( uint32_t Start = 0; Start < m_Size; Start += MAPPART_SIZE )
+		{
+			uint32_t Length = m_Size - Start;
+
+			if( Length > MAPPART_SIZE )
+				Length = MAPPART_SIZE;
+
+			uint32_t PartCRC = crc->FullCRC( (unsigned char *)m_Data + Start, Length );
+			m_PartCRCs.push_back( PartCRC );
+			m_CRC = Start == 0 ? PartCRC : crc->CombineCRC( m_CRC, PartCRC, Length );
+		}
+	}
+}
+
+CMapData :: ~CMapData( )
+{
+	if( m_Mapped )
+	{
+#ifdef WIN32
+		UnmapViewOfFile( m_Data );
+		CloseHandle( m_Mapping );
+		CloseHandle( m_File );
+#else
+		munmap( (void *)m_Data, m_Size );
+#endif
+	}
+}
+
 //
 // CMap
 //
@@ -234,11 +356,20 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 
 	// load the map data
 
+	// games which are still using the previously loaded map keep their own reference to its data
+
 	m_MapLocalPath = CFG->GetString( "map_localpath", string( ) );
-	m_MapData.clear( );
+	m_MapData.reset( );
 
 	if( !m_MapLocalPath.empty( ) )
-		m_MapData = UTIL_FileRead( m_GHost->m_MapPath + m_MapLocalPath );
+	{
+		m_MapData = boost :: shared_ptr<CMapData>( new CMapData( m_GHost->m_CRC, m_GHost->m_MapPath + m_MapLocalPath ) );
+
+		if( m_MapData->GetSize( ) == 0 )
+			m_MapData.reset( );
+		else if( m_MapData->GetMapped( ) )
+			CONSOLE_Print( "[MAP] memory mapped map file [" + m_GHost->m_MapPath + m_MapLocalPath + "]" );
+	}
 
 	// load the map MPQ
 
@@ -261,18 +392,18 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 	BYTEARRAY MapCRC;
 	BYTEARRAY MapSHA1;
 
-	if( !m_MapData.empty( ) )
+	if( m_MapData )
 	{
 		m_GHost->m_SHA->Reset( );
 
 		// calculate map_size
 
-		MapSize = UTIL_CreateByteArray( (uint32_t)m_MapData.size( ), false );
+		MapSize = UTIL_CreateByteArray( m_MapData->GetSize( ), false );
 		CONSOLE_Print( "[MAP] calculated map_size = " + UTIL_ByteArrayToDecString( MapSize ) );
 
 		// calculate map_info (this is actually the CRC)
 
-		MapInfo = UTIL_CreateByteArray( (uint32_t)m_GHost->m_CRC->FullCRC( (unsigned char *)m_MapData.c_str( ), m_MapData.size( ) ), false );
+		MapInfo = UTIL_CreateByteArray( (uint32_t)m_MapData->GetCRC( ), false );
 		CONSOLE_Print( "[MAP] calculated map_info = " + UTIL_ByteArrayToDecString( MapInfo ) );
 
 		// calculate map_crc (this is not the CRC) and map_sha1
@@ -459,7 +590,7 @@ void CMap :: Load( CConfig *CFG, string nCFGFile )
 	uint32_t MapFilterType = MAPFILTER_TYPE_SCENARIO;
 	vector<CGameSlot> Slots;
 
-	if( !m_MapData.empty( ) )
+	if( m_MapData )
 	{
 		if( MapMPQReady )
 		{
@@ -888,7 +1019,7 @@ void CMap :: CheckValid( )
 		m_Valid = false;
 		CONSOLE_Print( "[MAP] invalid map_size detected" );
 	}
-	else if( !m_MapData.empty( ) && m_MapData.size( ) != UTIL_ByteArrayToUInt32( m_MapSize, false ) )
+	else if( m_MapData && m_MapData->GetSize( ) != UTIL_ByteArrayToUInt32( m_MapSize, false ) )
 	{
 		m_Valid = false;
 		CONSOLE_Print( "[MAP] invalid map_size detected - size mismatch with actual map data" );
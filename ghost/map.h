@@ -83,12 +83,57 @@
 #define MAPGAMETYPE_OBSONDEATH			1 << 21
 #define MAPGAMETYPE_OBSNONE				1 << 22
 
+#define MAPPART_SIZE					1442		// the number of map bytes in each W3GS_MAPPART packet
+
 #include "gameslot.h"
 
+#include <boost/shared_ptr.hpp>
+
+//
+// CMapData
+//
+
+// the contents of a map file along with the CRC of every map part (for sending the map to players)
+// a CMapData never changes after it has been loaded so it's shared by reference between every copy of a CMap (i.e. every lobby and running game using the map) instead of being copied
+// the file is memory mapped when possible so the map data only lives in the OS page cache, otherwise it's read into memory
+// note: since the file stays mapped as long as a game is using the map, map files must be replaced by writing a new file and renaming it rather than by overwriting them
+// overwriting a mapped file in place can send corrupt map data to players and truncating it crashes the bot (SIGBUS) on Linux, on Windows the file can't be written while it's mapped
+
+class CMapData
+{
+private:
+	const unsigned char *m_Data;				// the map data (either memory mapped or pointing into m_Buffer)
+	uint32_t m_Size;
+	bool m_Mapped;								// if the map data is memory mapped
+	string m_Buffer;							// the map data if the file couldn't be memory mapped
+	vector<uint32_t> m_PartCRCs;				// the CRC of every MAPPART_SIZE byte part of the map data
+	uint32_t m_CRC;								// the CRC of the whole map data (combined from the part CRCs)
+#ifdef WIN32
+	void *m_File;
+	void *m_Mapping;
+#endif
+
+public:
+	CMapData( CCRC32 *crc, string fileName );
+	~CMapData( );
+
+	const unsigned char *GetData( )			{ return m_Data; }
+	uint32_t GetSize( )						{ return m_Size; }
+	bool GetMapped( )						{ return m_Mapped; }
+	uint32_t GetPartCRC( uint32_t part )	{ return part < m_PartCRCs.size( ) ? m_PartCRCs[part] : 0; }
+	uint32_t GetCRC( )						{ return m_CRC; }
+
+private:
+	CMapData( const CMapData & );
+	CMapData &operator=( const CMapData & );
+};
+
 //
 // CMap
 //
 
+// copying a CMap is cheap since the map data itself is shared
+
 class CMap
 {
 public:
@@ -120,7 +165,7 @@ private:
 	uint32_t m_MapDefaultPlayerScore;			// config value: map default player score (for matchmaking)
 	string m_MapLocalPath;						// config value: map local path
 	bool m_MapLoadInGame;
-	string m_MapData;							// the map data itself, for sending the map to players
+	boost :: shared_ptr<CMapData> m_MapData;	// the map data itself, for sending the map to players (NULL if the map file isn't available)
 	uint32_t m_MapNumPlayers;
 	uint32_t m_MapNumTeams;
 	vector<CGameSlot> m_Slots;
@@ -154,7 +199,7 @@ public:
 	uint32_t GetMapDefaultPlayerScore( )	{ return m_MapDefaultPlayerScore; }
 	string GetMapLocalPath( )				{ return m_MapLocalPath; }
 	bool GetMapLoadInGame( )				{ return m_MapLoadInGame; }
-	string *GetMapData( )					{ return &m_MapData; }
+	CMapData *GetMapData( )					{ return m_MapData.get( ); }
 	uint32_t GetMapNumPlayers( )			{ return m_MapNumPlayers; }
 	uint32_t GetMapNumTeams( )				{ return m_MapNumTeams; }
 	vector<CGameSlot> GetSlots( )			{ return m_Slots; }
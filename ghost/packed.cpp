@@ -25,6 +25,10 @@
 
 #include <zlib.h>
 
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
 // we can't use zlib's uncompress function because it expects a complete compressed buffer
 // however, we're going to be passing it chunks of incomplete data
 // this custom tzuncompress function will do the job
@@ -62,11 +66,87 @@ int tzuncompress( Bytef *dest, uLongf *destLen, const Bytef *source, uLong sourc
 	return err;
 }
 
+// every block is compressed independently of the others so we can compress or decompress a large file on several threads at once
+// PackedForEachBlock splits the blocks [0, numBlocks) into one range per processor and calls function( first, last ) for each range on its own thread
+// small files aren't worth starting threads for so they're handled by the calling thread, as is the last range and any range we can't start a thread for
+
+void PackedForEachBlock( uint32_t numBlocks, boost :: function<void( uint32_t, uint32_t )> function )
+{
+	uint32_t NumThreads = min( max( boost :: thread :: hardware_concurrency( ), 1u ), ( numBlocks + 15 ) / 16 );
+
+	if( NumThreads <= 1 )
+	{
+		function( 0, numBlocks );
+		return;
+	}
+
+	boost :: thread_group Threads;
+	uint32_t BlocksPerThread = ( numBlocks + NumThreads - 1 ) / NumThreads;
+	uint32_t First = 0;
+
+	for( ; First + BlocksPerThread < numBlocks; First += BlocksPerThread )
+	{
+		try
+		{
+			Threads.create_thread( boost :: bind( function, First, First + BlocksPerThread ) );
+		}
+		catch( boost :: thread_resource_error tre )
+		{
+			function( First, First + BlocksPerThread );
+		}
+	}
+
+	function( First, numBlocks );
+	Threads.join_all( );
+}
+
+struct CPackedBlockInfo
+{
+	string :: size_type m_Position;		// the position of the block data in the compressed data
+	uint16_t m_CompressedSize;
+	uint16_t m_DecompressedSize;
+	string :: size_type m_Offset;		// the position of the decompressed block in the decompressed data
+	int m_Result;						// the zlib result
+	uint32_t m_ActualSize;				// the number of bytes the block actually decompressed to
+};
+
+void PackedDecompressBlocks( const string *compressed, char *decompressed, vector<CPackedBlockInfo> *blocks, uint32_t first, uint32_t last )
+{
+	// each block is decompressed straight into its own part of the output so the threads never touch the same memory
+
+	for( uint32_t i = first; i < last; ++i )
+	{
+		CPackedBlockInfo &Block = (*blocks)[i];
+		uLongf BlockDecompressedLong = Block.m_DecompressedSize;
+		Block.m_Result = tzuncompress( (Bytef *)decompressed + Block.m_Offset, &BlockDecompressedLong, (const Bytef *)compressed->data( ) + Block.m_Position, Block.m_CompressedSize );
+		Block.m_ActualSize = BlockDecompressedLong;
+	}
+}
+
+void PackedCompressBlocks( CCRC32 *crc, const string *decompressed, int level, vector<string> *blocks, uint32_t first, uint32_t last )
+{
+	// the last block is padded with zeros
+
+	for( uint32_t i = first; i < last; ++i )
+	{
+		string :: size_type Position = (string :: size_type)i * 8192;
+
+		if( Position + 8192 <= decompressed->size( ) )
+			(*blocks)[i] = CPacked :: CompressBlock( crc, (unsigned char *)decompressed->data( ) + Position, level );
+		else
+		{
+			string Padded = decompressed->substr( Position );
+			Padded.append( 8192 - Padded.size( ), 0 );
+			(*blocks)[i] = CPacked :: CompressBlock( crc, (unsigned char *)Padded.data( ), level );
+		}
+	}
+}
+
 //
 // CPacked
 //
 
-CPacked :: CPacked( ) : m_Valid( true ), m_HeaderSize( 0 ), m_CompressedSize( 0 ), m_HeaderVersion( 0 ), m_DecompressedSize( 0 ), m_NumBlocks( 0 ), m_War3Identifier( 0 ), m_War3Version( 0 ), m_BuildNumber( 0 ), m_Flags( 0 ), m_ReplayLength( 0 )
+CPacked :: CPacked( ) : m_Valid( true ), m_HeaderSize( 0 ), m_CompressedSize( 0 ), m_HeaderVersion( 0 ), m_DecompressedSize( 0 ), m_NumBlocks( 0 ), m_War3Identifier( 0 ), m_War3Version( 0 ), m_BuildNumber( 0 ), m_Flags( 0 ), m_ReplayLength( 0 ), m_CompressionLevel( Z_DEFAULT_COMPRESSION )
 {
 	m_CRC = new CCRC32( );
 	m_CRC->Initialize( );
@@ -183,18 +263,23 @@ void CPacked :: Decompress( bool allBlocks )
 	else
 		CONSOLE_Print( "[PACKED] reading 1/" + UTIL_ToString( m_NumBlocks ) + " blocks" );
 
-	// read blocks
+	// read block headers
+	// we only need to find where each block starts and how large it is here, the blocks are decompressed afterwards
 
-        for( uint32_t i = 0; i < m_NumBlocks; ++i )
+	uint32_t NumBlocks = allBlocks ? m_NumBlocks : min( m_NumBlocks, (uint32_t)1 );
+	vector<CPackedBlockInfo> Blocks;
+	Blocks.reserve( NumBlocks );
+	string :: size_type DecompressedSize = 0;
+
+	for( uint32_t i = 0; i < NumBlocks; ++i )
 	{
-		uint16_t BlockCompressed;
-		uint16_t BlockDecompressed;
+		CPackedBlockInfo Block;
 
 		// read block header
 
-		ISS.read( (char *)&BlockCompressed, 2 );	// block compressed size
-		ISS.read( (char *)&BlockDecompressed, 2 );	// block decompressed size
-		ISS.seekg( 4, ios :: cur );					// checksum
+		ISS.read( (char *)&Block.m_CompressedSize, 2 );		// block compressed size
+		ISS.read( (char *)&Block.m_DecompressedSize, 2 );	// block decompressed size
+		ISS.seekg( 4, ios :: cur );							// checksum
 
 		if( ISS.fail( ) )
 		{
@@ -203,53 +288,49 @@ void CPacked :: Decompress( bool allBlocks )
 			return;
 		}
 
-		// read block data
+		// skip block data
 
-		uLongf BlockCompressedLong = BlockCompressed;
-		uLongf BlockDecompressedLong = BlockDecompressed;
-		unsigned char *CompressedData = new unsigned char[BlockCompressed];
-		unsigned char *DecompressedData = new unsigned char[BlockDecompressed];
-		ISS.read( (char*)CompressedData, BlockCompressed );
+		Block.m_Position = ISS.tellg( );
 
-		if( ISS.fail( ) )
+		if( Block.m_Position + Block.m_CompressedSize > m_Compressed.size( ) )
 		{
 			CONSOLE_Print( "[PACKED] failed to read block data" );
-			delete [] DecompressedData;
-			delete [] CompressedData;
 			m_Valid = false;
 			return;
 		}
 
-		// decompress block data
+		ISS.seekg( Block.m_CompressedSize, ios :: cur );
+		Block.m_Offset = DecompressedSize;
+		Block.m_Result = Z_OK;
+		Block.m_ActualSize = 0;
+		DecompressedSize += Block.m_DecompressedSize;
+		Blocks.push_back( Block );
+	}
+
+	// decompress block data
+
+	m_Decompressed.resize( DecompressedSize );
 
-		int Result = tzuncompress( DecompressedData, &BlockDecompressedLong, CompressedData, BlockCompressedLong );
+	if( !Blocks.empty( ) && DecompressedSize > 0 )
+		PackedForEachBlock( Blocks.size( ), boost :: bind( &PackedDecompressBlocks, &m_Compressed, &m_Decompressed[0], &Blocks, _1, _2 ) );
 
-		if( Result != Z_OK )
+	for( vector<CPackedBlockInfo> :: iterator i = Blocks.begin( ); i != Blocks.end( ); ++i )
+	{
+		if( (*i).m_Result != Z_OK )
 		{
-			CONSOLE_Print( "[PACKED] tzuncompress error " + UTIL_ToString( Result ) );
-			delete [] DecompressedData;
-			delete [] CompressedData;
+			CONSOLE_Print( "[PACKED] tzuncompress error " + UTIL_ToString( (*i).m_Result ) );
+			m_Decompressed.clear( );
 			m_Valid = false;
 			return;
 		}
 
-		if( BlockDecompressedLong != (uLongf)BlockDecompressed )
+		if( (*i).m_ActualSize != (*i).m_DecompressedSize )
 		{
-			CONSOLE_Print( "[PACKED] block decompressed size mismatch, actual = " + UTIL_ToString( BlockDecompressedLong ) + ", expected = " + UTIL_ToString( BlockDecompressed ) );
-			delete [] DecompressedData;
-			delete [] CompressedData;
+			CONSOLE_Print( "[PACKED] block decompressed size mismatch, actual = " + UTIL_ToString( (*i).m_ActualSize ) + ", expected = " + UTIL_ToString( (*i).m_DecompressedSize ) );
+			m_Decompressed.clear( );
 			m_Valid = false;
 			return;
 		}
-
-		m_Decompressed += string( (char *)DecompressedData, BlockDecompressedLong );
-		delete [] DecompressedData;
-		delete [] CompressedData;
-
-		// stop after one iteration if not decompressing all blocks
-
-		if( !allBlocks )
-			break;
 	}
 
 	CONSOLE_Print( "[PACKED] decompressed " + UTIL_ToString( m_Decompressed.size( ) ) + " bytes" );
@@ -279,47 +360,87 @@ void CPacked :: Compress( bool TFT )
 	m_Compressed.clear( );
 
 	// compress data into blocks of size 8192 bytes
-	// use a buffer of size 8213 bytes because in the worst case zlib will grow the data 0.1% plus 12 bytes
+	// the data is always followed by at least one byte of padding so a file which fills its last block gets an extra block of zeros
 
+	uint32_t NumBlocks = m_Decompressed.size( ) / 8192 + 1;
+	vector<string> CompressedBlocks( NumBlocks );
+	PackedForEachBlock( NumBlocks, boost :: bind( &PackedCompressBlocks, m_CRC, &m_Decompressed, m_CompressionLevel, &CompressedBlocks, _1, _2 ) );
 	uint32_t CompressedSize = 0;
-	string Padded = m_Decompressed;
-	Padded.append( 8192 - ( Padded.size( ) % 8192 ), 0 );
-	vector<string> CompressedBlocks;
-	string :: size_type Position = 0;
-	unsigned char *CompressedData = new unsigned char[8213];
 
-	while( Position < Padded.size( ) )
+	for( vector<string> :: iterator i = CompressedBlocks.begin( ); i != CompressedBlocks.end( ); ++i )
 	{
-		uLongf BlockCompressedLong = 8213;
-		int Result = compress( CompressedData, &BlockCompressedLong, (const Bytef *)Padded.c_str( ) + Position, 8192 );
-
-		if( Result != Z_OK )
+		if( (*i).empty( ) )
 		{
-			CONSOLE_Print( "[PACKED] compress error " + UTIL_ToString( Result ) );
-			delete [] CompressedData;
 			m_Valid = false;
 			return;
 		}
 
-		CompressedBlocks.push_back( string( (char *)CompressedData, BlockCompressedLong ) );
-		CompressedSize += BlockCompressedLong;
-		Position += 8192;
+		CompressedSize += (*i).size( );
+	}
+
+	// append header
+
+	m_Compressed.reserve( 68 + CompressedSize );
+	m_Compressed += BuildFileHeader( m_CRC, TFT, 68 + CompressedSize, m_Decompressed.size( ), CompressedBlocks.size( ), m_War3Version, m_BuildNumber, m_Flags, m_ReplayLength );
+
+	// append blocks
+
+	for( vector<string> :: iterator i = CompressedBlocks.begin( ); i != CompressedBlocks.end( ); ++i )
+		m_Compressed += *i;
+}
+
+string CPacked :: CompressBlock( CCRC32 *crc, unsigned char *data, int level )
+{
+	// compress one block of 8192 bytes and return it with its block header
+	// use a buffer of size 8213 bytes because in the worst case zlib will grow the data 0.1% plus 12 bytes
+	// a block stored with level 0 isn't compressed at all so its size only depends on the size of the data
+	// this is called by several threads at once so it mustn't use anything but its arguments
+
+	unsigned char CompressedData[8213];
+	uLongf BlockCompressedLong = 8213;
+	int Result = compress2( CompressedData, &BlockCompressedLong, data, 8192, level );
+
+	if( Result != Z_OK )
+	{
+		CONSOLE_Print( "[PACKED] compress error " + UTIL_ToString( Result ) );
+		return string( );
 	}
 
-	delete [] CompressedData;
+	BYTEARRAY BlockHeader;
+	UTIL_AppendByteArray( BlockHeader, (uint16_t)BlockCompressedLong, false );
+	UTIL_AppendByteArray( BlockHeader, (uint16_t)8192, false );
+
+	// append zero block header CRC
+	UTIL_AppendByteArray( BlockHeader, (uint32_t)0, false );
 
-	// build header
+	// calculate block header CRC
+
+	uint32_t CRC1 = crc->FullCRC( &BlockHeader[0], BlockHeader.size( ) );
+	CRC1 = CRC1 ^ ( CRC1 >> 16 );
+	uint32_t CRC2 = crc->FullCRC( CompressedData, BlockCompressedLong );
+	CRC2 = CRC2 ^ ( CRC2 >> 16 );
+	uint32_t BlockCRC = ( CRC1 & 0xFFFF ) | ( CRC2 << 16 );
+
+	// overwrite the block header CRC with the calculated CRC
+
+	BlockHeader.erase( BlockHeader.end( ) - 4, BlockHeader.end( ) );
+	UTIL_AppendByteArray( BlockHeader, BlockCRC, false );
+	return string( BlockHeader.begin( ), BlockHeader.end( ) ) + string( (char *)CompressedData, BlockCompressedLong );
+}
+
+string CPacked :: BuildFileHeader( CCRC32 *crc, bool TFT, uint32_t compressedSize, uint32_t decompressedSize, uint32_t numBlocks, uint32_t war3Version, uint16_t buildNumber, uint16_t flags, uint32_t replayLength )
+{
+	// the compressed size is the size of the whole file (including this header and the block headers)
 
 	uint32_t HeaderSize = 68;
-	uint32_t HeaderCompressedSize = HeaderSize + CompressedSize + CompressedBlocks.size( ) * 8;
 	uint32_t HeaderVersion = 1;
 	BYTEARRAY Header;
 	UTIL_AppendByteArray( Header, "Warcraft III recorded game\x01A" );
 	UTIL_AppendByteArray( Header, HeaderSize, false );
-	UTIL_AppendByteArray( Header, HeaderCompressedSize, false );
+	UTIL_AppendByteArray( Header, compressedSize, false );
 	UTIL_AppendByteArray( Header, HeaderVersion, false );
-	UTIL_AppendByteArray( Header, (uint32_t)m_Decompressed.size( ), false );
-	UTIL_AppendByteArray( Header, (uint32_t)CompressedBlocks.size( ), false );
+	UTIL_AppendByteArray( Header, decompressedSize, false );
+	UTIL_AppendByteArray( Header, numBlocks, false );
 
 	if( TFT )
 	{
@@ -336,10 +457,10 @@ void CPacked :: Compress( bool TFT )
 		Header.push_back( 'W' );
 	}
 
-	UTIL_AppendByteArray( Header, m_War3Version, false );
-	UTIL_AppendByteArray( Header, m_BuildNumber, false );
-	UTIL_AppendByteArray( Header, m_Flags, false );
-	UTIL_AppendByteArray( Header, m_ReplayLength, false );
+	UTIL_AppendByteArray( Header, war3Version, false );
+	UTIL_AppendByteArray( Header, buildNumber, false );
+	UTIL_AppendByteArray( Header, flags, false );
+	UTIL_AppendByteArray( Header, replayLength, false );
 
 	// append zero header CRC
 	// the header CRC is calculated over the entire header with itself set to zero
@@ -349,46 +470,270 @@ void CPacked :: Compress( bool TFT )
 
 	// calculate header CRC
 
-	string HeaderString = string( Header.begin( ), Header.end( ) );
-	uint32_t CRC = m_CRC->FullCRC( (unsigned char *)HeaderString.c_str( ), HeaderString.size( ) );
+	uint32_t CRC = crc->FullCRC( &Header[0], Header.size( ) );
 
 	// overwrite the (currently zero) header CRC with the calculated CRC
 
 	Header.erase( Header.end( ) - 4, Header.end( ) );
 	UTIL_AppendByteArray( Header, CRC, false );
+	return string( Header.begin( ), Header.end( ) );
+}
 
-	// append header
+//
+// CPackedCompressor
+//
 
-	m_Compressed += string( Header.begin( ), Header.end( ) );
+CPackedCompressor :: CPackedCompressor( ) : m_Thread( NULL ), m_Exiting( false ), m_CompressionLevel( Z_DEFAULT_COMPRESSION )
+{
+	m_CRC = new CCRC32( );
+	m_CRC->Initialize( );
 
-	// append blocks
+	try
+	{
+		m_Thread = new boost :: thread( boost :: bind( &CPackedCompressor :: CompressorThread, this ) );
+	}
+	catch( boost :: thread_resource_error tre )
+	{
+		CONSOLE_Print( "[PACKED] error spawning compressor thread [" + string( tre.what( ) ) + "], compressing blocks on the thread writing them" );
+		m_Thread = NULL;
+	}
+}
 
-        for( vector<string> :: iterator i = CompressedBlocks.begin( ); i != CompressedBlocks.end( ); ++i )
+CPackedCompressor :: ~CPackedCompressor( )
+{
+	if( m_Thread )
 	{
-		BYTEARRAY BlockHeader;
-		UTIL_AppendByteArray( BlockHeader, (uint16_t)(*i).size( ), false );
-		UTIL_AppendByteArray( BlockHeader, (uint16_t)8192, false );
+		{
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+			m_Exiting = true;
+		}
 
-		// append zero block header CRC
-		UTIL_AppendByteArray( BlockHeader, (uint32_t)0, false );
+		m_Changed.notify_all( );
+		m_Thread->join( );
+		delete m_Thread;
+	}
 
-		// calculate block header CRC
+	delete m_CRC;
+}
 
-		string BlockHeaderString = string( BlockHeader.begin( ), BlockHeader.end( ) );
-		uint32_t CRC1 = m_CRC->FullCRC( (unsigned char *)BlockHeaderString.c_str( ), BlockHeaderString.size( ) );
-		CRC1 = CRC1 ^ ( CRC1 >> 16 );
-		uint32_t CRC2 = m_CRC->FullCRC( (unsigned char *)(*i).c_str( ), (*i).size( ) );
-		CRC2 = CRC2 ^ ( CRC2 >> 16 );
-		uint32_t BlockCRC = ( CRC1 & 0xFFFF ) | ( CRC2 << 16 );
+void CPackedCompressor :: SetCompressionLevel( int nCompressionLevel )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	m_CompressionLevel = nCompressionLevel;
+}
 
-		// overwrite the block header CRC with the calculated CRC
+int CPackedCompressor :: GetCompressionLevel( )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+	return m_CompressionLevel;
+}
 
-		BlockHeader.erase( BlockHeader.end( ) - 4, BlockHeader.end( ) );
-		UTIL_AppendByteArray( BlockHeader, BlockCRC, false );
+void CPackedCompressor :: Compress( CPackedWriter *writer, string data )
+{
+	if( !m_Thread )
+	{
+		writer->WriteBlock( CPacked :: CompressBlock( m_CRC, (unsigned char *)data.data( ), GetCompressionLevel( ) ) );
+		return;
+	}
 
-		// append block header and data
+	{
+		boost :: mutex :: scoped_lock Lock( m_Mutex );
+		CPackedBlock Block;
+		Block.m_Writer = writer;
+		Block.m_Data = data;
+		Block.m_Level = m_CompressionLevel;
+		m_Queue.push_back( Block );
+		++writer->m_NumQueued;
+	}
 
-		m_Compressed += string( BlockHeader.begin( ), BlockHeader.end( ) );
-		m_Compressed += *i;
+	m_Changed.notify_all( );
+}
+
+void CPackedCompressor :: Wait( CPackedWriter *writer )
+{
+	boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+	while( writer->m_NumQueued > 0 )
+		m_Changed.wait( Lock );
+}
+
+void CPackedCompressor :: CompressorThread( )
+{
+	while( true )
+	{
+		CPackedBlock Block;
+
+		{
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+
+			while( m_Queue.empty( ) && !m_Exiting )
+				m_Changed.wait( Lock );
+
+			if( m_Queue.empty( ) )
+				break;
+
+			Block = m_Queue.front( );
+			m_Queue.pop_front( );
+		}
+
+		// the writer can't finish until we're done with the block so it's safe to use it without holding the mutex
+
+		Block.m_Writer->WriteBlock( CPacked :: CompressBlock( m_CRC, (unsigned char *)Block.m_Data.data( ), Block.m_Level ) );
+
+		{
+			boost :: mutex :: scoped_lock Lock( m_Mutex );
+			--Block.m_Writer->m_NumQueued;
+		}
+
+		m_Changed.notify_all( );
 	}
 }
+
+//
+// CPackedWriter
+//
+
+CPackedWriter :: CPackedWriter( CPackedCompressor *nCompressor, string nFileName, uint32_t nHeadSize ) : m_Compressor( nCompressor ), m_FileName( nFileName ), m_Valid( true ), m_HeadSize( nHeadSize ), m_HeadBlocks( ( nHeadSize + 8191 ) / 8192 ), m_StoredBlockSize( 0 ), m_DataSize( 0 ), m_NumBlocks( 0 ), m_BlocksSize( 0 ), m_NumQueued( 0 )
+{
+	// measure how large a stored block is so we can reserve space for the file header and the head blocks
+
+	string Zeros( 8192, 0 );
+	m_StoredBlockSize = CPacked :: CompressBlock( m_Compressor->GetCRC( ), (unsigned char *)Zeros.data( ), Z_NO_COMPRESSION ).size( );
+	m_Pending.reserve( 8192 );
+	m_File.open( m_FileName.c_str( ), ios :: out | ios :: binary | ios :: trunc );
+
+	if( m_File.fail( ) || m_StoredBlockSize == 0 )
+	{
+		CONSOLE_Print( "[PACKED] warning - unable to write file [" + m_FileName + "]" );
+		m_Valid = false;
+		return;
+	}
+
+	string Reserved( 68 + m_HeadBlocks * m_StoredBlockSize, 0 );
+	m_File.write( Reserved.data( ), Reserved.size( ) );
+}
+
+CPackedWriter :: ~CPackedWriter( )
+{
+	// if we didn't finish the file it's useless so get rid of it
+
+	m_Compressor->Wait( this );
+
+	if( m_File.is_open( ) )
+	{
+		m_File.close( );
+		remove( m_FileName.c_str( ) );
+	}
+}
+
+void CPackedWriter :: Append( const string &data )
+{
+	m_DataSize += data.size( );
+	string :: size_type Position = 0;
+	string :: size_type HeadRoom = m_HeadBlocks * 8192 - m_HeadSize;
+
+	if( m_HeadData.size( ) < HeadRoom )
+	{
+		Position = min( HeadRoom - m_HeadData.size( ), data.size( ) );
+		m_HeadData.append( data, 0, Position );
+	}
+
+	while( Position < data.size( ) )
+	{
+		string :: size_type Length = min( 8192 - m_Pending.size( ), data.size( ) - Position );
+		m_Pending.append( data, Position, Length );
+		Position += Length;
+
+		if( m_Pending.size( ) == 8192 )
+		{
+			m_Compressor->Compress( this, m_Pending );
+			m_Pending.clear( );
+		}
+	}
+}
+
+bool CPackedWriter :: Finish( string head, bool TFT, uint32_t war3Version, uint16_t buildNumber, uint16_t flags, uint32_t replayLength, string fileName )
+{
+	// wait for the compressor to write our remaining blocks, there's at most a few of them since it compresses them as they're completed
+
+	m_Compressor->Wait( this );
+
+	if( head.size( ) != m_HeadSize )
+	{
+		CONSOLE_Print( "[PACKED] error finishing file [" + m_FileName + "] - head size mismatch, actual = " + UTIL_ToString( head.size( ) ) + ", expected = " + UTIL_ToString( m_HeadSize ) );
+		m_Valid = false;
+	}
+
+	// the last block is padded with zeros
+
+	if( m_Valid && !m_Pending.empty( ) )
+	{
+		m_Pending.append( 8192 - m_Pending.size( ), 0 );
+		WriteBlock( CPacked :: CompressBlock( m_Compressor->GetCRC( ), (unsigned char *)m_Pending.data( ), m_Compressor->GetCompressionLevel( ) ) );
+	}
+
+	// fill in the reserved space at the start of the file
+	// if we didn't append enough data to fill the reserved blocks they hold the last block so they're padded with zeros too
+
+	if( m_Valid )
+	{
+		string Head = head + m_HeadData;
+		Head.append( m_HeadBlocks * 8192 - Head.size( ), 0 );
+		string Header = CPacked :: BuildFileHeader( m_Compressor->GetCRC( ), TFT, 68 + m_HeadBlocks * m_StoredBlockSize + m_BlocksSize, m_HeadSize + m_DataSize, m_HeadBlocks + m_NumBlocks, war3Version, buildNumber, flags, replayLength );
+		m_File.seekp( 0 );
+		m_File.write( Header.data( ), Header.size( ) );
+
+		for( uint32_t i = 0; i < m_HeadBlocks && m_Valid; ++i )
+		{
+			string Block = CPacked :: CompressBlock( m_Compressor->GetCRC( ), (unsigned char *)Head.data( ) + i * 8192, Z_NO_COMPRESSION );
+
+			if( Block.size( ) != m_StoredBlockSize )
+			{
+				CONSOLE_Print( "[PACKED] error finishing file [" + m_FileName + "] - stored block size mismatch, actual = " + UTIL_ToString( Block.size( ) ) + ", expected = " + UTIL_ToString( m_StoredBlockSize ) );
+				m_Valid = false;
+			}
+			else
+				m_File.write( Block.data( ), Block.size( ) );
+		}
+
+		if( m_File.fail( ) )
+			m_Valid = false;
+	}
+
+	m_File.close( );
+
+	if( !m_Valid )
+	{
+		CONSOLE_Print( "[PACKED] failed to write file [" + fileName + "]" );
+		remove( m_FileName.c_str( ) );
+		return false;
+	}
+
+	if( rename( m_FileName.c_str( ), fileName.c_str( ) ) != 0 )
+	{
+		CONSOLE_Print( "[PACKED] warning - unable to rename file [" + m_FileName + "] to [" + fileName + "]" );
+		return false;
+	}
+
+	CONSOLE_Print( "[PACKED] saved " + UTIL_ToString( m_HeadBlocks + m_NumBlocks ) + " blocks to file [" + fileName + "]" );
+	return true;
+}
+
+void CPackedWriter :: WriteBlock( string block )
+{
+	// called by the compressor thread while we're waiting for it and by the thread which owns us otherwise
+
+	if( block.empty( ) )
+	{
+		m_Valid = false;
+		return;
+	}
+
+	m_File.write( block.data( ), block.size( ) );
+
+	if( m_File.fail( ) )
+		m_Valid = false;
+
+	++m_NumBlocks;
+	m_BlocksSize += block.size( );
+}
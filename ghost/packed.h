@@ -21,11 +21,15 @@
 #ifndef PACKED_H
 #define PACKED_H
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 //
 // CPacked
 //
 
 class CCRC32;
+class CPackedWriter;
 
 class CPacked
 {
@@ -46,6 +50,7 @@ protected:
 	uint16_t m_BuildNumber;
 	uint16_t m_Flags;
 	uint32_t m_ReplayLength;
+	int m_CompressionLevel;				// the zlib compression level to compress blocks with
 
 public:
 	CPacked( );
@@ -67,6 +72,7 @@ public:
 	virtual void SetBuildNumber( uint16_t nBuildNumber )			{ m_BuildNumber = nBuildNumber; }
 	virtual void SetFlags( uint16_t nFlags )						{ m_Flags = nFlags; }
 	virtual void SetReplayLength( uint32_t nReplayLength )			{ m_ReplayLength = nReplayLength; }
+	virtual void SetCompressionLevel( int nCompressionLevel )		{ m_CompressionLevel = nCompressionLevel; }
 
 	virtual void Load( string fileName, bool allBlocks );
 	virtual bool Save( bool TFT, string fileName );
@@ -74,6 +80,92 @@ public:
 	virtual bool Pack( bool TFT, string inFileName, string outFileName );
 	virtual void Decompress( bool allBlocks );
 	virtual void Compress( bool TFT );
+
+	static string CompressBlock( CCRC32 *crc, unsigned char *data, int level );
+	static string BuildFileHeader( CCRC32 *crc, bool TFT, uint32_t compressedSize, uint32_t decompressedSize, uint32_t numBlocks, uint32_t war3Version, uint16_t buildNumber, uint16_t flags, uint32_t replayLength );
+};
+
+//
+// CPackedCompressor
+//
+
+// compresses the blocks of every CPackedWriter on a background thread and writes them to the writer's file
+// the blocks are compressed in the order they were queued so each writer's blocks end up in the right order
+// if the thread can't be created the blocks are compressed by the thread queueing them
+
+class CPackedCompressor
+{
+private:
+	struct CPackedBlock
+	{
+		CPackedWriter *m_Writer;
+		string m_Data;
+		int m_Level;
+	};
+
+	CCRC32 *m_CRC;
+	boost :: thread *m_Thread;				// the compressor thread (NULL if it couldn't be created)
+	deque<CPackedBlock> m_Queue;			// the blocks waiting to be compressed
+	bool m_Exiting;							// set when the compressor thread should finish the queue and exit
+	boost :: mutex m_Mutex;					// protects m_Queue, m_Exiting, m_CompressionLevel and the writers' m_NumQueued
+	boost :: condition_variable m_Changed;	// signalled when a block is queued, when a block has been written and when exiting
+	int m_CompressionLevel;					// the zlib compression level to compress blocks with
+
+public:
+	CPackedCompressor( );
+	~CPackedCompressor( );
+
+	CCRC32 *GetCRC( )										{ return m_CRC; }
+	void SetCompressionLevel( int nCompressionLevel );
+	int GetCompressionLevel( );
+
+	void Compress( CPackedWriter *writer, string data );
+	void Wait( CPackedWriter *writer );
+
+private:
+	void CompressorThread( );
+};
+
+//
+// CPackedWriter
+//
+
+// writes a packed file while its data is still being generated so we never have to hold or compress all of it at once
+// each time 8192 bytes have been appended the block is handed to the compressor and written to a temporary file in the background
+// the first headSize bytes of the data (e.g. a replay's header) are only supplied when finishing so the blocks holding them are reserved at the start of the file
+// the reserved blocks are stored without compression when finishing since we can't know how large they'd be otherwise
+
+class CPackedWriter
+{
+	friend class CPackedCompressor;
+
+private:
+	CPackedCompressor *m_Compressor;
+	string m_FileName;					// the temporary file
+	ofstream m_File;
+	bool m_Valid;						// set to false when the file couldn't be written or a block couldn't be compressed
+	uint32_t m_HeadSize;				// the number of bytes at the start of the data which are supplied when finishing
+	uint32_t m_HeadBlocks;				// the number of blocks reserved for the head
+	uint32_t m_StoredBlockSize;			// the size of a reserved block including its block header
+	string m_HeadData;					// the appended data which shares the reserved blocks with the head
+	string m_Pending;					// the appended data which hasn't filled a block yet
+	uint32_t m_DataSize;				// the number of bytes appended
+	uint32_t m_NumBlocks;				// the number of blocks written after the reserved blocks
+	uint32_t m_BlocksSize;				// the size of the blocks written after the reserved blocks including their block headers
+	uint32_t m_NumQueued;				// the number of blocks waiting for the compressor (protected by the compressor's mutex)
+
+public:
+	CPackedWriter( CPackedCompressor *nCompressor, string nFileName, uint32_t nHeadSize );
+	~CPackedWriter( );
+
+	bool GetValid( )		{ return m_Valid; }
+	uint32_t GetHeadSize( )	{ return m_HeadSize; }
+
+	void Append( const string &data );
+	bool Finish( string head, bool TFT, uint32_t war3Version, uint16_t buildNumber, uint16_t flags, uint32_t replayLength, string fileName );
+
+private:
+	void WriteBlock( string block );
 };
 
 #endif
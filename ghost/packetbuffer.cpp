@@ -0,0 +1,290 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+
+#include "ghost.h"
+#include "packetbuffer.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+// the packet counters are kept per thread so creating a packet buffer never takes a lock, every game worker thread creates buffers in its send path
+// each thread's counters are registered the first time the thread creates a buffer and they're never deleted so GetStats can still add them up after the thread has exited
+
+class CPacketStats
+{
+public:
+	uint64_t m_Allocations;			// the number of packet buffers created
+	uint64_t m_BytesAllocated;		// the total size of the packet buffers created
+	uint64_t m_BytesCopied;			// the number of bytes copied into packet buffers (a buffer which takes over an existing packet doesn't copy anything)
+	uint64_t m_References;			// the number of times a packet buffer was queued by reference instead of being copied
+	uint64_t m_BytesShared;			// the number of bytes which would have been copied to queue those references
+
+	CPacketStats( ) : m_Allocations( 0 ), m_BytesAllocated( 0 ), m_BytesCopied( 0 ), m_References( 0 ), m_BytesShared( 0 ) { }
+};
+
+static void KeepPacketStats( CPacketStats *stats )
+{
+
+}
+
+static boost :: thread_specific_ptr<CPacketStats> gPacketStats( KeepPacketStats );
+static boost :: mutex gPacketStatsMutex;				// protects gPacketStatsThreads
+static vector<CPacketStats *> gPacketStatsThreads;		// the counters of every thread which has created a packet buffer
+
+static CPacketStats *GetPacketStats( )
+{
+	CPacketStats *Stats = gPacketStats.get( );
+
+	if( !Stats )
+	{
+		Stats = new CPacketStats( );
+		gPacketStats.reset( Stats );
+		boost :: mutex :: scoped_lock lock( gPacketStatsMutex );
+		gPacketStatsThreads.push_back( Stats );
+		lock.unlock( );
+	}
+
+	return Stats;
+}
+
+//
+// CPacketBuffer
+//
+
+CPacketBuffer :: CPacketBuffer( )
+{
+
+}
+
+CPacketBuffer :: ~CPacketBuffer( )
+{
+
+}
+
+PACKETBUFFER CPacketBuffer :: Create( BYTEARRAY data )
+{
+	// create a packet buffer from a temporary packet such as the return value of a CGameProtocol send function
+	// the compiler constructs the temporary directly in data so nothing is copied unless the caller passes a packet it wants to keep
+
+	return Swap( data );
+}
+
+PACKETBUFFER CPacketBuffer :: Swap( BYTEARRAY &data )
+{
+	// create a packet buffer by taking over the contents of data without copying it
+	// data is left empty
+
+	boost :: shared_ptr<CPacketBuffer> Packet = boost :: make_shared<CPacketBuffer>( );
+	Packet->m_Data.swap( data );
+
+	CPacketStats *Stats = GetPacketStats( );
+	++Stats->m_Allocations;
+	Stats->m_BytesAllocated += Packet->m_Data.size( );
+
+	return Packet;
+}
+
+PACKETBUFFER CPacketBuffer :: Copy( const unsigned char *data, uint32_t size )
+{
+	boost :: shared_ptr<CPacketBuffer> Packet = boost :: make_shared<CPacketBuffer>( );
+	Packet->m_Data.assign( data, data + size );
+
+	CPacketStats *Stats = GetPacketStats( );
+	++Stats->m_Allocations;
+	Stats->m_BytesAllocated += size;
+	Stats->m_BytesCopied += size;
+
+	return Packet;
+}
+
+void CPacketBuffer :: AddReferences( uint32_t references, uint32_t size )
+{
+	// called once per fan out (not once per reference) to keep the thread local lookup out of the send loops
+
+	CPacketStats *Stats = GetPacketStats( );
+	Stats->m_References += references;
+	Stats->m_BytesShared += (uint64_t)references * size;
+}
+
+string CPacketBuffer :: GetStats( )
+{
+	// the other threads' counters aren't locked so this is only exact once the worker threads have stopped (it's printed on shutdown)
+	// the counters are 64 bit so we can't use UTIL_ToString
+
+	CPacketStats Total;
+	boost :: mutex :: scoped_lock lock( gPacketStatsMutex );
+
+	for( vector<CPacketStats *> :: iterator i = gPacketStatsThreads.begin( ); i != gPacketStatsThreads.end( ); ++i )
+	{
+		Total.m_Allocations += (*i)->m_Allocations;
+		Total.m_BytesAllocated += (*i)->m_BytesAllocated;
+		Total.m_BytesCopied += (*i)->m_BytesCopied;
+		Total.m_References += (*i)->m_References;
+		Total.m_BytesShared += (*i)->m_BytesShared;
+	}
+
+	lock.unlock( );
+
+	stringstream SS;
+	SS << Total.m_Allocations << " packet buffers allocated (" << Total.m_BytesAllocated << " bytes), " << Total.m_BytesCopied << " bytes copied, " << Total.m_References << " packets shared by reference (" << Total.m_BytesShared << " bytes not copied)";
+	return SS.str( );
+}
+
+//
+// CPacketLog
+//
+
+CPacketLog :: CPacketLog( ) : m_Start( 0 ), m_Open( 0 )
+{
+	for( uint32_t i = 0; i < PACKETLOG_MAX_PIDS; ++i )
+	{
+		m_Cursors[i] = 0;
+		m_Pending[i] = 0;
+	}
+}
+
+CPacketLog :: ~CPacketLog( )
+{
+
+}
+
+void CPacketLog :: Add( unsigned char PID, PACKETBUFFER packet )
+{
+	if( PID >= PACKETLOG_MAX_PIDS )
+		return;
+
+	uint32_t Bit = (uint32_t)1 << PID;
+
+	// when a packet is sent to every player it's sent to each player in turn so it's usually the last entry in the log already
+	// we can only add the player to the last entry, adding it to an earlier entry would reorder the player's packets
+
+	if( !m_Entries.empty( ) && m_Entries.back( ).m_Packet == packet && !( m_Entries.back( ).m_Recipients & Bit ) )
+		m_Entries.back( ).m_Recipients |= Bit;
+	else
+		m_Entries.push_back( CPacketLogEntry( packet, Bit ) );
+
+	if( !( m_Open & Bit ) )
+	{
+		m_Open |= Bit;
+		m_Cursors[PID] = m_Start + m_Entries.size( ) - 1;
+	}
+
+	++m_Pending[PID];
+}
+
+bool CPacketLog :: GetNext( unsigned char PID, uint32_t &position, PACKETBUFFER &packet )
+{
+	// find the player's next pending packet at or after position and move position past it
+	// start with position = GetCursor( PID ), the log must not be changed while iterating
+
+	if( PID >= PACKETLOG_MAX_PIDS )
+		return false;
+
+	uint32_t Bit = (uint32_t)1 << PID;
+
+	if( !( m_Open & Bit ) )
+		return false;
+
+	if( position < m_Cursors[PID] )
+		position = m_Cursors[PID];
+
+	for( uint32_t i = position - m_Start; i < m_Entries.size( ); ++i )
+	{
+		if( m_Entries[i].m_Recipients & Bit )
+		{
+			packet = m_Entries[i].m_Packet;
+			position = m_Start + i + 1;
+			return true;
+		}
+	}
+
+	position = m_Start + m_Entries.size( );
+	return false;
+}
+
+void CPacketLog :: Skip( unsigned char PID, uint32_t count )
+{
+	// the player doesn't need its oldest count packets anymore
+
+	if( PID >= PACKETLOG_MAX_PIDS )
+		return;
+
+	uint32_t Bit = (uint32_t)1 << PID;
+
+	if( !( m_Open & Bit ) )
+		return;
+
+	if( count > m_Pending[PID] )
+		count = m_Pending[PID];
+
+	uint32_t i = m_Cursors[PID] - m_Start;
+
+	while( count > 0 && i < m_Entries.size( ) )
+	{
+		if( m_Entries[i].m_Recipients & Bit )
+		{
+			m_Entries[i].m_Recipients &= ~Bit;
+			--m_Pending[PID];
+			--count;
+		}
+
+		++i;
+	}
+
+	m_Cursors[PID] = m_Start + i;
+
+	if( m_Pending[PID] == 0 )
+		m_Open &= ~Bit;
+
+	Trim( );
+}
+
+void CPacketLog :: Close( unsigned char PID )
+{
+	// the player left so none of its packets are needed anymore
+
+	if( PID < PACKETLOG_MAX_PIDS )
+		Skip( PID, m_Pending[PID] );
+}
+
+void CPacketLog :: Trim( )
+{
+	// every player's bit is cleared as soon as it doesn't need a packet anymore so the entries up to the oldest cursor have no recipients left
+	// a cursor can point at an entry without the player's bit (one another player was still waiting for) so move any cursors left behind up to the new front
+
+	uint32_t OldStart = m_Start;
+
+	while( !m_Entries.empty( ) && m_Entries.front( ).m_Recipients == 0 )
+	{
+		m_Entries.pop_front( );
+		++m_Start;
+	}
+
+	if( m_Start != OldStart )
+	{
+		for( uint32_t i = 0; i < PACKETLOG_MAX_PIDS; ++i )
+		{
+			if( ( m_Open & ( (uint32_t)1 << i ) ) && m_Cursors[i] < m_Start )
+				m_Cursors[i] = m_Start;
+		}
+	}
+}
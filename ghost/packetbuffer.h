@@ -0,0 +1,106 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+
+#ifndef PACKETBUFFER_H
+#define PACKETBUFFER_H
+
+#include <boost/shared_ptr.hpp>
+
+//
+// CPacketBuffer
+//
+
+// an immutable, reference counted packet
+// a packet which is sent to more than one player is built once by CGameProtocol and then shared by reference between the players' socket send queues (and GProxy++ buffers) instead of being copied for every player
+// the data never changes after the buffer has been created so a buffer can be referenced from any number of places, the reference count itself is thread safe
+// the allocation and copy counters are global and cover every thread, they're printed when the bot exits
+
+class CPacketBuffer;
+
+typedef boost :: shared_ptr<const CPacketBuffer> PACKETBUFFER;
+
+class CPacketBuffer
+{
+private:
+	BYTEARRAY m_Data;
+
+public:
+	CPacketBuffer( );
+	~CPacketBuffer( );
+
+	const unsigned char *GetData( ) const	{ return m_Data.empty( ) ? NULL : &m_Data[0]; }
+	uint32_t GetSize( ) const				{ return m_Data.size( ); }
+	const BYTEARRAY &GetBytes( ) const		{ return m_Data; }
+
+	static PACKETBUFFER Create( BYTEARRAY data );
+	static PACKETBUFFER Swap( BYTEARRAY &data );
+	static PACKETBUFFER Copy( const unsigned char *data, uint32_t size );
+	static void AddReferences( uint32_t references, uint32_t size );
+	static string GetStats( );
+};
+
+//
+// CPacketLog
+//
+
+// an append only log of the packets sent to the players in a game, each packet is stored once no matter how many players it was sent to
+// each player has a cursor pointing at the oldest of its packets which are still needed and the log is trimmed up to the oldest cursor
+// this replaces a queue per player (e.g. the GProxy++ buffers) so a packet sent to every player is only referenced once and resending a player's packets doesn't copy anything
+// players are identified by PID and only PIDs below PACKETLOG_MAX_PIDS can be logged, the bot never assigns PIDs that high
+
+#define PACKETLOG_MAX_PIDS 32
+
+class CPacketLogEntry
+{
+public:
+	PACKETBUFFER m_Packet;		// the packet
+	uint32_t m_Recipients;		// a bitmask of the PIDs the packet was sent to which still need it
+
+	CPacketLogEntry( PACKETBUFFER nPacket, uint32_t nRecipients ) : m_Packet( nPacket ), m_Recipients( nRecipients ) { }
+};
+
+class CPacketLog
+{
+private:
+	deque<CPacketLogEntry> m_Entries;			// the packets, the front entry is at position m_Start
+	uint32_t m_Start;							// the position of the front entry, positions keep counting up as the log is trimmed
+	uint32_t m_Open;							// a bitmask of the PIDs with pending packets
+	uint32_t m_Cursors[PACKETLOG_MAX_PIDS];		// the position of each PID's oldest pending packet (only valid if the PID is open)
+	uint32_t m_Pending[PACKETLOG_MAX_PIDS];		// the number of pending packets for each PID
+
+public:
+	CPacketLog( );
+	~CPacketLog( );
+
+	uint32_t GetNumEntries( )					{ return m_Entries.size( ); }
+	uint32_t GetNumPending( unsigned char PID )	{ return PID < PACKETLOG_MAX_PIDS ? m_Pending[PID] : 0; }
+	uint32_t GetCursor( unsigned char PID )		{ return PID < PACKETLOG_MAX_PIDS && ( m_Open & ( (uint32_t)1 << PID ) ) ? m_Cursors[PID] : m_Start + m_Entries.size( ); }
+
+	void Add( unsigned char PID, PACKETBUFFER packet );
+	bool GetNext( unsigned char PID, uint32_t &position, PACKETBUFFER &packet );
+	void Skip( unsigned char PID, uint32_t count );
+	void Close( unsigned char PID );
+
+private:
+	void Trim( );
+};
+
+#endif
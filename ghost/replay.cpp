@@ -28,14 +28,14 @@
 // CReplay
 //
 
-CReplay :: CReplay( ) : CPacked( ), m_HostPID( 0 ), m_PlayerCount( 0 ), m_MapGameType( 0 ), m_RandomSeed( 0 ), m_SelectMode( 0 ), m_StartSpotCount( 0 )
+CReplay :: CReplay( ) : CPacked( ), m_HostPID( 0 ), m_PlayerCount( 0 ), m_MapGameType( 0 ), m_RandomSeed( 0 ), m_SelectMode( 0 ), m_StartSpotCount( 0 ), m_Writer( NULL )
 {
 	m_CompiledBlocks.reserve( 262144 );
 }
 
 CReplay :: ~CReplay( )
 {
-
+	delete m_Writer;
 }
 
 void CReplay :: AddLeaveGame( uint32_t reason, unsigned char PID, uint32_t result )
@@ -46,7 +46,7 @@ void CReplay :: AddLeaveGame( uint32_t reason, unsigned char PID, uint32_t resul
 	Block.push_back( PID );
 	UTIL_AppendByteArray( Block, result, false );
 	UTIL_AppendByteArray( Block, (uint32_t)1, false );
-	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
+	AddBlock( Block );
 }
 
 void CReplay :: AddLeaveGameDuringLoading( uint32_t reason, unsigned char PID, uint32_t result )
@@ -81,7 +81,7 @@ void CReplay :: AddTimeSlot2( queue<CIncomingAction *> actions )
 	BYTEARRAY LengthBytes = UTIL_CreateByteArray( (uint16_t)( Block.size( ) - 3 ), false );
 	Block[1] = LengthBytes[0];
 	Block[2] = LengthBytes[1];
-	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
+	AddBlock( Block );
 }
 
 void CReplay :: AddTimeSlot( uint16_t timeIncrement, queue<CIncomingAction *> actions )
@@ -105,7 +105,7 @@ void CReplay :: AddTimeSlot( uint16_t timeIncrement, queue<CIncomingAction *> ac
 	BYTEARRAY LengthBytes = UTIL_CreateByteArray( (uint16_t)( Block.size( ) - 3 ), false );
 	Block[1] = LengthBytes[0];
 	Block[2] = LengthBytes[1];
-	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
+	AddBlock( Block );
 	m_ReplayLength += timeIncrement;
 }
 
@@ -124,7 +124,7 @@ void CReplay :: AddChatMessage( unsigned char PID, unsigned char flags, uint32_t
 	BYTEARRAY LengthBytes = UTIL_CreateByteArray( (uint16_t)( Block.size( ) - 4 ), false );
 	Block[2] = LengthBytes[0];
 	Block[3] = LengthBytes[1];
-	m_CompiledBlocks += string( Block.begin( ), Block.end( ) );
+	AddBlock( Block );
 }
 
 void CReplay :: AddLoadingBlock( BYTEARRAY &loadingBlock )
@@ -132,6 +132,14 @@ void CReplay :: AddLoadingBlock( BYTEARRAY &loadingBlock )
 	m_LoadingBlocks.push( loadingBlock );
 }
 
+void CReplay :: AddBlock( BYTEARRAY &block )
+{
+	if( m_Writer )
+		m_Writer->Append( string( block.begin( ), block.end( ) ) );
+	else
+		m_CompiledBlocks += string( block.begin( ), block.end( ) );
+}
+
 void CReplay :: BuildReplay( string gameName, string statString, uint32_t war3Version, uint16_t buildNumber )
 {
 	m_War3Version = war3Version;
@@ -140,6 +148,61 @@ void CReplay :: BuildReplay( string gameName, string statString, uint32_t war3Ve
 
 	CONSOLE_Print( "[REPLAY] building replay" );
 
+	m_Decompressed = BuildHeader( gameName, statString );
+	m_Decompressed += m_CompiledBlocks;
+}
+
+bool CReplay :: StartStreaming( CPackedCompressor *compressor, string tempFileName, string gameName, string statString )
+{
+	// this must only be called once nothing but the host can change in the replay header (i.e. after the game has loaded)
+	// the host record and the player records hold the same players no matter who the host is so the header keeps its size when the host changes
+
+	m_StreamHeader = BuildHeader( gameName, statString );
+	m_Writer = new CPackedWriter( compressor, tempFileName, m_StreamHeader.size( ) );
+
+	if( !m_Writer->GetValid( ) )
+	{
+		CONSOLE_Print( "[REPLAY] unable to stream replay, the replay will be saved when the game ends" );
+		delete m_Writer;
+		m_Writer = NULL;
+		return false;
+	}
+
+	CONSOLE_Print( "[REPLAY] streaming replay to file [" + tempFileName + "]" );
+	m_Writer->Append( m_CompiledBlocks );
+	string( ).swap( m_CompiledBlocks );
+	return true;
+}
+
+bool CReplay :: FinishStreaming( string gameName, string statString, bool TFT, uint32_t war3Version, uint16_t buildNumber, string fileName )
+{
+	if( !m_Writer )
+		return false;
+
+	m_War3Version = war3Version;
+	m_BuildNumber = buildNumber;
+	m_Flags = 32768;
+
+	CONSOLE_Print( "[REPLAY] finishing replay" );
+
+	// the header is rebuilt to record the final host, this should never change its size but if it does we keep the original header rather than losing the replay
+
+	string Header = BuildHeader( gameName, statString );
+
+	if( Header.size( ) != m_StreamHeader.size( ) )
+	{
+		CONSOLE_Print( "[REPLAY] warning - replay header changed size, using the header from when the replay started streaming" );
+		Header = m_StreamHeader;
+	}
+
+	bool Success = m_Writer->Finish( Header, TFT, m_War3Version, m_BuildNumber, m_Flags, m_ReplayLength, fileName );
+	delete m_Writer;
+	m_Writer = NULL;
+	return Success;
+}
+
+string CReplay :: BuildHeader( string gameName, string statString )
+{
 	uint32_t LanguageID = 0x0012F8B0;
 
 	BYTEARRAY Replay;
@@ -195,11 +258,14 @@ void CReplay :: BuildReplay( string gameName, string statString, uint32_t war3Ve
 	UTIL_AppendByteArray( Replay, (uint32_t)1, false );
 
 	// leavers during loading need to be stored between the second and third start blocks
+	// the header can be built more than once (see StartStreaming) so don't consume the loading blocks
 
-	while( !m_LoadingBlocks.empty( ) )
+	queue<BYTEARRAY> LoadingBlocks = m_LoadingBlocks;
+
+	while( !LoadingBlocks.empty( ) )
 	{
-		UTIL_AppendByteArray( Replay, m_LoadingBlocks.front( ) );
-		m_LoadingBlocks.pop( );
+		UTIL_AppendByteArray( Replay, LoadingBlocks.front( ) );
+		LoadingBlocks.pop( );
 	}
 
 	Replay.push_back( REPLAY_THIRDSTARTBLOCK );
@@ -207,13 +273,60 @@ void CReplay :: BuildReplay( string gameName, string statString, uint32_t war3Ve
 
 	// done
 
-	m_Decompressed = string( Replay.begin( ), Replay.end( ) );
-	m_Decompressed += m_CompiledBlocks;
+	return string( Replay.begin( ), Replay.end( ) );
 }
 
 #define READB( x, y, z )	(x).read( (char *)(y), (z) )
 #define READSTR( x, y )		getline( (x), (y), '\0' )
 
+bool CReplay :: LoadHeader( string fileName )
+{
+	// the header and the player list always fit in the first block so we only read the file header and the first block from the file
+	// Load( fileName, false ) only decompresses the first block too but it reads the whole file first
+
+	m_Valid = true;
+	CONSOLE_Print( "[REPLAY] loading header from file [" + fileName + "]" );
+	ifstream IS;
+	IS.open( fileName.c_str( ), ios :: binary );
+
+	if( IS.fail( ) )
+	{
+		CONSOLE_Print( "[REPLAY] warning - unable to read file [" + fileName + "]" );
+		m_Valid = false;
+		return false;
+	}
+
+	// the file header holds its own size at offset 28, the first block follows it and its compressed size can't be more than 65535 bytes (plus an 8 byte block header)
+
+	char Header[32];
+	uint32_t HeaderSize = 0;
+	IS.read( Header, 32 );
+
+	if( IS.gcount( ) == 32 )
+		memcpy( &HeaderSize, Header + 28, 4 );
+
+	if( HeaderSize < 32 || HeaderSize > 1024 )
+	{
+		CONSOLE_Print( "[REPLAY] invalid replay header in file [" + fileName + "]" );
+		m_Valid = false;
+		return false;
+	}
+
+	m_Compressed.assign( Header, 32 );
+	m_Compressed.resize( HeaderSize + 8 + 65535 );
+	IS.read( &m_Compressed[32], m_Compressed.size( ) - 32 );
+	m_Compressed.resize( 32 + IS.gcount( ) );
+	IS.close( );
+	Decompress( false );
+	m_Compressed.clear( );
+
+	if( m_Valid )
+		ParseReplay( false );
+
+	m_Decompressed.clear( );
+	return m_Valid;
+}
+
 void CReplay :: ParseReplay( bool parseBlocks )
 {
 	m_HostPID = 0;
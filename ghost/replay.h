@@ -28,6 +28,8 @@
 //
 
 class CIncomingAction;
+class CPackedCompressor;
+class CPackedWriter;
 
 class CReplay : public CPacked
 {
@@ -59,7 +61,9 @@ private:
 	queue<BYTEARRAY> m_LoadingBlocks;
 	queue<BYTEARRAY> m_Blocks;
 	queue<uint32_t> m_CheckSums;
-	string m_CompiledBlocks;
+	string m_CompiledBlocks;				// the blocks added since the game started (only until the replay starts streaming)
+	CPackedWriter *m_Writer;				// writes the blocks to disk while the game is running (NULL if the replay isn't streaming)
+	string m_StreamHeader;					// the replay header when the replay started streaming
 
 public:
 	CReplay( );
@@ -79,6 +83,7 @@ public:
 	queue<BYTEARRAY> *GetLoadingBlocks( )	{ return &m_LoadingBlocks; }
 	queue<BYTEARRAY> *GetBlocks( )			{ return &m_Blocks; }
 	queue<uint32_t> *GetCheckSums( )		{ return &m_CheckSums; }
+	bool GetStreaming( )					{ return m_Writer != NULL; }
 
 	void AddPlayer( unsigned char nPID, string nName )		{ m_Players.push_back( PIDPlayer( nPID, nName ) ); }
 	void SetSlots( vector<CGameSlot> nSlots )				{ m_Slots = nSlots; }
@@ -96,8 +101,15 @@ public:
 	void AddChatMessage( unsigned char PID, unsigned char flags, uint32_t chatMode, string message );
 	void AddLoadingBlock( BYTEARRAY &loadingBlock );
 	void BuildReplay( string gameName, string statString, uint32_t war3Version, uint16_t buildNumber );
+	bool StartStreaming( CPackedCompressor *compressor, string tempFileName, string gameName, string statString );
+	bool FinishStreaming( string gameName, string statString, bool TFT, uint32_t war3Version, uint16_t buildNumber, string fileName );
 
+	bool LoadHeader( string fileName );
 	void ParseReplay( bool parseBlocks );
+
+private:
+	void AddBlock( BYTEARRAY &block );
+	string BuildHeader( string gameName, string statString );
 };
 
 #endif
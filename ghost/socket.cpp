@@ -28,24 +28,29 @@
  int GetLastError( ) { return errno; }
 #endif
 
+CSocketReactor *gSocketReactor = NULL;
+
 //
 // CSocket
 //
 
-CSocket :: CSocket( ) :  m_Socket( INVALID_SOCKET ), m_HasError( false ), m_Error( 0 )
+CSocket :: CSocket( ) :  m_Socket( INVALID_SOCKET ), m_HasError( false ), m_Error( 0 ), m_Reactor( NULL ), m_Readable( false ), m_Writable( false )
 {
         memset( &m_SIN, 0, sizeof( m_SIN ) );
 }
 
-CSocket :: CSocket( SOCKET nSocket, struct sockaddr_in nSIN ) : m_Socket( nSocket ), m_SIN( nSIN ), m_HasError( false ), m_Error( 0 )
+CSocket :: CSocket( SOCKET nSocket, struct sockaddr_in nSIN ) : m_Socket( nSocket ), m_SIN( nSIN ), m_HasError( false ), m_Error( 0 ), m_Reactor( NULL ), m_Readable( false ), m_Writable( false )
 {
-
+	Register( gSocketReactor );
 }
 
 CSocket :: ~CSocket( )
 {
 	if( m_Socket != INVALID_SOCKET )
+	{
+		Unregister( );
 		closesocket( m_Socket );
+	}
 }
 
 BYTEARRAY CSocket :: GetPort( )
@@ -111,9 +116,35 @@ string CSocket :: GetErrorString( )
 	return "UNKNOWN ERROR (" + UTIL_ToString( m_Error ) + ")";
 }
 
-void CSocket :: SetFD( fd_set *fd, fd_set *send_fd, int *nfds )
+bool CSocket :: IsReadable( fd_set *fd )
 {
 	if( m_Socket == INVALID_SOCKET )
+		return false;
+
+	// when using the reactor the readiness state is pushed to us so the fd set isn't used (and may not even contain this socket)
+
+	if( m_Reactor )
+		return m_Readable;
+
+	return FD_ISSET( m_Socket, fd );
+}
+
+bool CSocket :: IsWritable( fd_set *send_fd )
+{
+	if( m_Socket == INVALID_SOCKET )
+		return false;
+
+	if( m_Reactor )
+		return m_Writable;
+
+	return FD_ISSET( m_Socket, send_fd );
+}
+
+void CSocket :: SetFD( fd_set *fd, fd_set *send_fd, int *nfds )
+{
+	// sockets registered with the reactor don't need to be added to the fd sets
+
+	if( m_Socket == INVALID_SOCKET || m_Reactor )
 		return;
 
 	FD_SET( m_Socket, fd );
@@ -136,12 +167,17 @@ void CSocket :: Allocate( int type )
 		CONSOLE_Print( "[SOCKET] error (socket) - " + GetErrorString( ) );
 		return;
 	}
+
+	Register( gSocketReactor );
 }
 
 void CSocket :: Reset( )
 {
 	if( m_Socket != INVALID_SOCKET )
+	{
+		Unregister( );
 		closesocket( m_Socket );
+	}
 
 	m_Socket = INVALID_SOCKET;
 	memset( &m_SIN, 0, sizeof( m_SIN ) );
@@ -149,11 +185,141 @@ void CSocket :: Reset( )
 	m_Error = 0;
 }
 
+void CSocket :: SetReactor( CSocketReactor *reactor )
+{
+	// move the socket to another reactor (or to none at all if reactor is NULL)
+	// note: a reactor must only be modified by the thread which waits on it so sockets are handed over to other threads by setting the reactor to NULL first
+
+	if( reactor == m_Reactor )
+		return;
+
+	Unregister( );
+	Register( reactor );
+}
+
+void CSocket :: Register( CSocketReactor *reactor )
+{
+#ifdef GHOST_EPOLL
+	if( m_Socket == INVALID_SOCKET || !reactor )
+		return;
+
+	// new sockets start out as not ready, the reactor will tell us when that changes
+
+	m_Readable = false;
+	m_Writable = false;
+
+	if( reactor->Register( this ) )
+		m_Reactor = reactor;
+#endif
+}
+
+void CSocket :: Unregister( )
+{
+#ifdef GHOST_EPOLL
+	if( m_Reactor )
+		m_Reactor->Unregister( this );
+#endif
+
+	m_Reactor = NULL;
+	m_Readable = false;
+	m_Writable = false;
+}
+
+//
+// CRecvBuffer
+//
+
+CRecvBuffer :: CRecvBuffer( ) : m_Start( 0 ), m_End( 0 )
+{
+
+}
+
+CRecvBuffer :: ~CRecvBuffer( )
+{
+
+}
+
+unsigned char *CRecvBuffer :: Reserve( uint32_t size )
+{
+	// make sure there's room for at least size more bytes at the end of the buffer and return a pointer to it
+
+	if( GetFree( ) < size )
+	{
+		// move the unread data back to the start of the buffer first, this is usually less than one packet
+
+		if( m_Start > 0 )
+		{
+			if( m_End > m_Start )
+				memmove( &m_Buffer[0], &m_Buffer[m_Start], m_End - m_Start );
+
+			m_End -= m_Start;
+			m_Start = 0;
+		}
+
+		// grow the buffer if that wasn't enough
+
+		if( GetFree( ) < size )
+		{
+			uint32_t Capacity = m_Buffer.size( ) * 2;
+
+			if( Capacity < m_End + size )
+				Capacity = m_End + size;
+
+			m_Buffer.resize( Capacity );
+		}
+	}
+
+	return &m_Buffer[m_End];
+}
+
+void CRecvBuffer :: Consume( uint32_t size )
+{
+	if( size >= GetSize( ) )
+	{
+		// the buffer is empty so start writing at the beginning again
+
+		m_Start = 0;
+		m_End = 0;
+	}
+	else
+		m_Start += size;
+}
+
+void CRecvBuffer :: Append( const unsigned char *data, uint32_t size )
+{
+	if( size > 0 )
+	{
+		memcpy( Reserve( size ), data, size );
+		Commit( size );
+	}
+}
+
+int32_t CRecvBuffer :: FramePacket( uint32_t lengthOffset, uint16_t minLength )
+{
+	// W3GS, GPS, BNCS and BNLS packets all store their total length (including the header) as a 16 bit little endian value at a fixed offset
+	// returns the length of the packet at the start of the buffer if it has been received completely, 0 if we need more data, or -1 if the length is invalid
+	// the packet itself can be accessed in place at GetData( ) until it's consumed
+
+	if( GetSize( ) < lengthOffset + 2 )
+		return 0;
+
+	const unsigned char *Data = GetData( );
+	uint16_t Length = (uint16_t)( Data[lengthOffset] | ( Data[lengthOffset + 1] << 8 ) );
+
+	if( Length < minLength )
+		return -1;
+
+	if( GetSize( ) < Length )
+		return 0;
+
+	return Length;
+}
+
 //
 // CTCPSocket
 //
 
-CTCPSocket :: CTCPSocket( ) : CSocket( ), m_Connected( false ), m_LastRecv( GetTime( ) ), m_LastSend( GetTime( ) )
+CTCPSocket :: CTCPSocket( ) : CSocket( ), m_Connected( false ), m_SendOffset( 0 ), m_LastRecv( GetTime( ) ), m_LastSend( GetTime( ) )
 {
 	Allocate( SOCK_STREAM );
 
@@ -170,6 +336,7 @@ CTCPSocket :: CTCPSocket( ) : CSocket( ), m_Connected( false ), m_LastRecv( GetT
 CTCPSocket :: CTCPSocket( SOCKET nSocket, struct sockaddr_in nSIN ) : CSocket( nSocket, nSIN )
 {
 	m_Connected = true;
+	m_SendOffset = 0;
 	m_LastRecv = GetTime( );
 	m_LastSend = GetTime( );
 
@@ -194,8 +361,9 @@ void CTCPSocket :: Reset( )
 
 	Allocate( SOCK_STREAM );
 	m_Connected = false;
-	m_RecvBuffer.clear( );
-	m_SendBuffer.clear( );
+	m_RecvBuffer.Clear( );
+	m_SendQueue.clear( );
+	m_SendOffset = 0;
 	m_LastRecv = GetTime( );
 	m_LastSend = GetTime( );
 
@@ -223,12 +391,20 @@ void CTCPSocket :: Reset( )
 
 void CTCPSocket :: PutBytes( string bytes )
 {
-	m_SendBuffer += bytes;
+	if( !bytes.empty( ) )
+		m_SendQueue.push_back( CPacketBuffer :: Copy( (const unsigned char *)bytes.data( ), bytes.size( ) ) );
 }
 
 void CTCPSocket :: PutBytes( BYTEARRAY bytes )
 {
-	m_SendBuffer += string( bytes.begin( ), bytes.end( ) );
+	if( !bytes.empty( ) )
+		m_SendQueue.push_back( CPacketBuffer :: Swap( bytes ) );
+}
+
+void CTCPSocket :: PutBytes( PACKETBUFFER packet )
+{
+	if( packet->GetSize( ) > 0 )
+		m_SendQueue.push_back( packet );
 }
 
 void CTCPSocket :: DoRecv( fd_set *fd )
@@ -236,16 +412,25 @@ void CTCPSocket :: DoRecv( fd_set *fd )
 	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connected )
 		return;
 
-	if( FD_ISSET( m_Socket, fd ) )
+	if( !IsReadable( fd ) )
+		return;
+
+	// data is waiting, receive it directly into the receive buffer
+	// when using the reactor the socket is edge triggered so we have to keep reading until the kernel buffer is empty
+	// otherwise we keep reading as long as the kernel fills all the space we offer it and select will tell us about anything that arrives later
+
+	bool Full = false;
+
+	do
 	{
-		// data is waiting, receive it
+		unsigned char *Buffer = m_RecvBuffer.Reserve( RECVBUFFER_MIN_READ );
+		uint32_t Free = m_RecvBuffer.GetFree( );
+		int c = recv( m_Socket, (char *)Buffer, Free, 0 );
+		Full = false;
 
-		char buffer[1024];
-		int c = recv( m_Socket, buffer, 1024, 0 );
-		
 		if( c > 0 )
 		{
-			// success! add the received data to the buffer
+			// success! the received data is already in the buffer
 
 			if( !m_LogFile.empty( ) )
 			{
@@ -254,47 +439,119 @@ void CTCPSocket :: DoRecv( fd_set *fd )
 
 				if( !Log.fail( ) )
 				{
-					Log << "					RECEIVE <<< " << UTIL_ByteArrayToHexString( UTIL_CreateByteArray( (unsigned char *)buffer, c ) ) << endl;
+					Log << "					RECEIVE <<< " << UTIL_ByteArrayToHexString( UTIL_CreateByteArray( Buffer, c ) ) << endl;
 					Log.close( );
 				}
 			}
 
-			m_RecvBuffer += string( buffer, c );
+			m_RecvBuffer.Commit( c );
 			m_LastRecv = GetTime( );
+			Full = (uint32_t)c == Free;
+		}
+		else if( c == SOCKET_ERROR && GetLastError( ) == EWOULDBLOCK )
+		{
+			// the socket has been drained
+
+			m_Readable = false;
 		}
-		else if( c == SOCKET_ERROR && GetLastError( ) != EWOULDBLOCK )
+		else if( c == SOCKET_ERROR )
 		{
 			// receive error
 
 			m_HasError = true;
 			m_Error = GetLastError( );
+			m_Readable = false;
 			CONSOLE_Print( "[TCPSOCKET] error (recv) - " + GetErrorString( ) );
 			return;
 		}
-		else if( c == 0 )
+		else
 		{
 			// the other end closed the connection
 
 			CONSOLE_Print( "[TCPSOCKET] closed by remote host" );
 			m_Connected = false;
+			m_Readable = false;
+			return;
 		}
-	}
+	} while( ( m_Reactor && m_Readable ) || Full );
 }
 
 void CTCPSocket :: DoSend( fd_set *send_fd )
 {
-	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendBuffer.empty( ) )
+	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendQueue.empty( ) )
 		return;
 
-	if( FD_ISSET( m_Socket, send_fd ) )
+	if( !IsWritable( send_fd ) )
+		return;
+
+	// socket is ready, send it
+	// when using the reactor we keep sending until either the buffer is empty or the kernel send buffer is full
+	// in the latter case the reactor will tell us when there's room again
+
+	do
 	{
-		// socket is ready, send it
+		// gather the queued packets into one send call so we don't have to copy them into a contiguous buffer first
+
+#ifdef WIN32
+		WSABUF Buffers[TCPSOCKET_MAX_SEND_BUFFERS];
+#else
+		struct iovec Buffers[TCPSOCKET_MAX_SEND_BUFFERS];
+#endif
+
+		uint32_t NumBuffers = 0;
+		uint32_t Offset = m_SendOffset;
+
+		for( deque<PACKETBUFFER> :: iterator i = m_SendQueue.begin( ); i != m_SendQueue.end( ) && NumBuffers < TCPSOCKET_MAX_SEND_BUFFERS; ++i )
+		{
+#ifdef WIN32
+			Buffers[NumBuffers].buf = (char *)(*i)->GetData( ) + Offset;
+			Buffers[NumBuffers].len = (*i)->GetSize( ) - Offset;
+#else
+			Buffers[NumBuffers].iov_base = (void *)( (*i)->GetData( ) + Offset );
+			Buffers[NumBuffers].iov_len = (*i)->GetSize( ) - Offset;
+#endif
+			++NumBuffers;
+			Offset = 0;
+		}
+
+#ifdef WIN32
+		DWORD Sent = 0;
+		int s = WSASend( m_Socket, Buffers, NumBuffers, &Sent, 0, NULL, NULL ) == SOCKET_ERROR ? SOCKET_ERROR : (int)Sent;
+#else
+		struct msghdr Message;
+		memset( &Message, 0, sizeof( Message ) );
+		Message.msg_iov = Buffers;
+		Message.msg_iovlen = NumBuffers;
+		int s = sendmsg( m_Socket, &Message, MSG_NOSIGNAL );
+#endif
 
-		int s = send( m_Socket, m_SendBuffer.c_str( ), (int)m_SendBuffer.size( ), MSG_NOSIGNAL );
-		
 		if( s > 0 )
 		{
-			// success! only some of the data may have been sent, remove it from the buffer
+			// success! only some of the data may have been sent, remove the packets which were sent completely from the queue
+
+			BYTEARRAY LogData;
+			uint32_t Remaining = s;
+
+			while( Remaining > 0 )
+			{
+				PACKETBUFFER Packet = m_SendQueue.front( );
+				uint32_t Length = Packet->GetSize( ) - m_SendOffset;
+
+				if( Length > Remaining )
+					Length = Remaining;
+
+				if( !m_LogFile.empty( ) )
+					LogData.insert( LogData.end( ), Packet->GetData( ) + m_SendOffset, Packet->GetData( ) + m_SendOffset + Length );
+
+				m_SendOffset += Length;
+				Remaining -= Length;
+
+				if( m_SendOffset == Packet->GetSize( ) )
+				{
+					m_SendQueue.pop_front( );
+					m_SendOffset = 0;
+				}
+			}
 
 			if( !m_LogFile.empty( ) )
 			{
@@ -303,24 +560,32 @@ void CTCPSocket :: DoSend( fd_set *send_fd )
 
 				if( !Log.fail( ) )
 				{
-					Log << "SEND >>> " << UTIL_ByteArrayToHexString( BYTEARRAY( m_SendBuffer.begin( ), m_SendBuffer.begin( ) + s ) ) << endl;
+					Log << "SEND >>> " << UTIL_ByteArrayToHexString( LogData ) << endl;
 					Log.close( );
 				}
 			}
 
-			m_SendBuffer = m_SendBuffer.substr( s );
 			m_LastSend = GetTime( );
 		}
-		else if( s == SOCKET_ERROR && GetLastError( ) != EWOULDBLOCK )
+		else if( s == SOCKET_ERROR && GetLastError( ) == EWOULDBLOCK )
+		{
+			// the kernel send buffer is full
+
+			m_Writable = false;
+		}
+		else if( s == SOCKET_ERROR )
 		{
 			// send error
 
 			m_HasError = true;
 			m_Error = GetLastError( );
+			m_Writable = false;
 			CONSOLE_Print( "[TCPSOCKET] error (send) - " + GetErrorString( ) );
 			return;
 		}
-	}
+		else
+			return;
+	} while( m_Reactor && m_Writable && !m_SendQueue.empty( ) );
 }
 
 void CTCPSocket :: Disconnect( )
@@ -435,6 +700,34 @@ bool CTCPClient :: CheckConnect( )
 	if( m_Socket == INVALID_SOCKET || m_HasError || !m_Connecting )
 		return false;
 
+#ifdef GHOST_EPOLL
+	if( m_Reactor )
+	{
+		// the socket's descriptor might be too large to fit in an fd set so poll it instead
+
+		struct pollfd PollFD;
+		PollFD.fd = m_Socket;
+		PollFD.events = POLLOUT;
+		PollFD.revents = 0;
+
+		if( poll( &PollFD, 1, 0 ) == SOCKET_ERROR )
+		{
+			m_HasError = true;
+			m_Error = GetLastError( );
+			return false;
+		}
+
+		if( PollFD.revents & ( POLLOUT | POLLERR | POLLHUP ) )
+		{
+			m_Connecting = false;
+			m_Connected = true;
+			return true;
+		}
+
+		return false;
+	}
+#endif
+
 	fd_set fd;
 	FD_ZERO( &fd );
 	FD_SET( m_Socket, &fd );
@@ -531,7 +824,7 @@ CTCPSocket *CTCPServer :: Accept( fd_set *fd )
 	if( m_Socket == INVALID_SOCKET || m_HasError )
 		return NULL;
 
-	if( FD_ISSET( m_Socket, fd ) )
+	if( IsReadable( fd ) )
 	{
 		// a connection is waiting, accept it
 
@@ -546,10 +839,25 @@ CTCPSocket *CTCPServer :: Accept( fd_set *fd )
 #endif
 		{
 			// accept error, ignore it
+			// if there aren't any more connections waiting we have to wait for the reactor to tell us about the next one
+
+			if( GetLastError( ) == EWOULDBLOCK )
+				m_Readable = false;
+
+#ifdef GHOST_EPOLL
+			if( m_Reactor )
+				m_Reactor->RemovePending( this );
+#endif
 		}
 		else
 		{
 			// success! return the new socket
+			// there might be more connections waiting so make sure we check again soon
+
+#ifdef GHOST_EPOLL
+			if( m_Reactor )
+				m_Reactor->AddPending( this );
+#endif
 
 			return new CTCPSocket( NewSocket, Addr );
 		}
@@ -758,7 +1066,7 @@ void CUDPServer :: RecvFrom( fd_set *fd, struct sockaddr_in *sin, string *messag
 
 	int AddrLen = sizeof( *sin );
 
-	if( FD_ISSET( m_Socket, fd ) )
+	if( IsReadable( fd ) )
 	{
 		// data is waiting, receive it
 
@@ -773,16 +1081,260 @@ void CUDPServer :: RecvFrom( fd_set *fd, struct sockaddr_in *sin, string *messag
 		if( c > 0 )
 		{
 			// success!
+			// there might be more datagrams waiting so make sure we check again soon
 
 			*message = string( buffer, c );
+
+#ifdef GHOST_EPOLL
+			if( m_Reactor )
+				m_Reactor->AddPending( this );
+#endif
 		}
-		else if( c == SOCKET_ERROR && GetLastError( ) != EWOULDBLOCK )
+		else
 		{
-			// receive error
+			if( c == SOCKET_ERROR && GetLastError( ) != EWOULDBLOCK )
+			{
+				// receive error
 
-			m_HasError = true;
-			m_Error = GetLastError( );
-			CONSOLE_Print( "[UDPSERVER] error (recvfrom) - " + GetErrorString( ) );
+				m_HasError = true;
+				m_Error = GetLastError( );
+				CONSOLE_Print( "[UDPSERVER] error (recvfrom) - " + GetErrorString( ) );
+			}
+
+			m_Readable = false;
+
+#ifdef GHOST_EPOLL
+			if( m_Reactor )
+				m_Reactor->RemovePending( this );
+#endif
+		}
+	}
+}
+
+//
+// CWakeup
+//
+
+CWakeup :: CWakeup( ) : m_ReadFD( -1 ), m_WriteFD( -1 )
+{
+#ifdef WIN32
+	// select only works with sockets on Windows so there's nothing to signal
+#elif defined( __linux__ )
+	m_ReadFD = eventfd( 0, 0 );
+
+	if( m_ReadFD == -1 )
+		CONSOLE_Print( "[WAKEUP] error (eventfd) - " + UTIL_ToString( GetLastError( ) ) );
+	else
+	{
+		fcntl( m_ReadFD, F_SETFL, fcntl( m_ReadFD, F_GETFL ) | O_NONBLOCK );
+		m_WriteFD = m_ReadFD;
+	}
+#else
+	int FDs[2];
+
+	if( pipe( FDs ) == -1 )
+		CONSOLE_Print( "[WAKEUP] error (pipe) - " + UTIL_ToString( GetLastError( ) ) );
+	else
+	{
+		fcntl( FDs[0], F_SETFL, fcntl( FDs[0], F_GETFL ) | O_NONBLOCK );
+		fcntl( FDs[1], F_SETFL, fcntl( FDs[1], F_GETFL ) | O_NONBLOCK );
+		m_ReadFD = FDs[0];
+		m_WriteFD = FDs[1];
+	}
+#endif
+}
+
+CWakeup :: ~CWakeup( )
+{
+#ifndef WIN32
+	if( m_WriteFD != -1 && m_WriteFD != m_ReadFD )
+		close( m_WriteFD );
+
+	if( m_ReadFD != -1 )
+		close( m_ReadFD );
+#endif
+}
+
+void CWakeup :: Signal( )
+{
+	// this is called from other threads
+	// if the eventfd counter or the pipe is already full the blocked thread is going to wake up anyway so a failed write doesn't matter
+
+#ifndef WIN32
+	if( m_WriteFD == -1 )
+		return;
+
+	uint64_t Value = 1;
+
+	if( write( m_WriteFD, &Value, m_WriteFD == m_ReadFD ? sizeof( Value ) : 1 ) == -1 )
+	{
+		// nothing to do
+	}
+#endif
+}
+
+void CWakeup :: Clear( )
+{
+	// drain the descriptor so the next select or epoll_wait blocks again until the next signal
+
+#ifndef WIN32
+	if( m_ReadFD == -1 )
+		return;
+
+	unsigned char Buffer[64];
+
+	while( read( m_ReadFD, Buffer, sizeof( Buffer ) ) > 0 )
+		;
+#endif
+}
+
+bool CWakeup :: SetFD( fd_set *fd, int *nfds )
+{
+#ifdef WIN32
+	return false;
+#else
+	if( m_ReadFD == -1 )
+		return false;
+
+	FD_SET( m_ReadFD, fd );
+
+	if( m_ReadFD > *nfds )
+		*nfds = m_ReadFD;
+
+	return true;
+#endif
+}
+
+#ifdef GHOST_EPOLL
+
+//
+// CSocketReactor
+//
+
+CSocketReactor :: CSocketReactor( ) : m_NumSockets( 0 ), m_Wakeup( NULL )
+{
+	m_EPoll = epoll_create( 1024 );
+
+	if( m_EPoll == -1 )
+		CONSOLE_Print( "[REACTOR] error (epoll_create) - " + UTIL_ToString( GetLastError( ) ) );
+
+	m_Events.resize( 256 );
+}
+
+CSocketReactor :: ~CSocketReactor( )
+{
+	if( m_EPoll != -1 )
+		close( m_EPoll );
+}
+
+bool CSocketReactor :: Register( CSocket *socket )
+{
+	if( m_EPoll == -1 )
+		return false;
+
+	// each socket is registered exactly once (when it's created) and stays registered until it's closed
+	// we use edge triggered notifications so an idle socket costs nothing, the socket remembers that it's ready until it has been drained
+
+	struct epoll_event Event;
+	memset( &Event, 0, sizeof( Event ) );
+	Event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	Event.data.ptr = socket;
+
+	if( epoll_ctl( m_EPoll, EPOLL_CTL_ADD, socket->GetSocket( ), &Event ) == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error (epoll_ctl add) - " + UTIL_ToString( GetLastError( ) ) );
+		return false;
+	}
+
+	++m_NumSockets;
+	return true;
+}
+
+void CSocketReactor :: Unregister( CSocket *socket )
+{
+	// closing the descriptor would remove it from the epoll set anyway but only if it hasn't been duplicated so be explicit about it
+
+	struct epoll_event Event;
+	memset( &Event, 0, sizeof( Event ) );
+	epoll_ctl( m_EPoll, EPOLL_CTL_DEL, socket->GetSocket( ), &Event );
+	m_Pending.erase( socket );
+
+	if( m_NumSockets > 0 )
+		--m_NumSockets;
+}
+
+bool CSocketReactor :: RegisterWakeup( CWakeup *wakeup )
+{
+	if( m_EPoll == -1 || !wakeup->GetValid( ) )
+		return false;
+
+	// the wakeup is told apart from the sockets by its pointer and isn't counted as a socket
+
+	struct epoll_event Event;
+	memset( &Event, 0, sizeof( Event ) );
+	Event.events = EPOLLIN | EPOLLET;
+	Event.data.ptr = wakeup;
+
+	if( epoll_ctl( m_EPoll, EPOLL_CTL_ADD, wakeup->GetFD( ), &Event ) == -1 )
+	{
+		CONSOLE_Print( "[REACTOR] error (epoll_ctl add wakeup) - " + UTIL_ToString( GetLastError( ) ) );
+		return false;
+	}
+
+	m_Wakeup = wakeup;
+	return true;
+}
+
+int CSocketReactor :: Wait( long usecBlock )
+{
+	if( m_EPoll == -1 )
+		return 0;
+
+	// don't block if there are sockets which still need servicing
+	// note: epoll_wait only has millisecond resolution so round up, otherwise we'd spin when asked to block for less than 1ms
+
+	int Timeout = 0;
+
+	if( m_Pending.empty( ) )
+		Timeout = ( usecBlock + 999 ) / 1000;
+
+	int NumEvents = epoll_wait( m_EPoll, &m_Events[0], m_Events.size( ), Timeout );
+
+	if( NumEvents == -1 )
+	{
+		if( GetLastError( ) != EINTR )
+			CONSOLE_Print( "[REACTOR] error (epoll_wait) - " + UTIL_ToString( GetLastError( ) ) );
+
+		return 0;
+	}
+
+	// dispatch the events to the sockets
+	// errors and hangups are reported as both readable and writable so the next recv or send picks up the error
+
+	for( int i = 0; i < NumEvents; ++i )
+	{
+		if( m_Wakeup && m_Events[i].data.ptr == m_Wakeup )
+		{
+			m_Wakeup->Clear( );
+			continue;
 		}
+
+		CSocket *Socket = (CSocket *)m_Events[i].data.ptr;
+		uint32_t Events = m_Events[i].events;
+
+		if( Events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) )
+			Socket->SetReadable( true );
+
+		if( Events & ( EPOLLOUT | EPOLLHUP | EPOLLERR ) )
+			Socket->SetWritable( true );
 	}
+
+	// if we filled the event buffer there are probably more events waiting so grow it for next time
+
+	if( NumEvents == (int)m_Events.size( ) )
+		m_Events.resize( m_Events.size( ) * 2 );
+
+	return NumEvents;
 }
+
+#endif
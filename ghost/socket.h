@@ -71,8 +71,18 @@
  #include <sys/ioctl.h>
  #include <sys/socket.h>
  #include <sys/types.h>
+ #include <sys/uio.h>
  #include <unistd.h>
 
+ #ifdef GHOST_EPOLL
+  #include <poll.h>
+  #include <sys/epoll.h>
+ #endif
+
+ #ifdef __linux__
+  #include <sys/eventfd.h>
+ #endif
+
  typedef int SOCKET;
 
  #define INVALID_SOCKET -1
@@ -95,6 +105,12 @@
  #define SHUT_RDWR 2
 #endif
 
+#include "packetbuffer.h"
+
+class CSocketReactor;
+
+extern CSocketReactor *gSocketReactor;		// the reactor new sockets register with (NULL when using select)
+
 //
 // CSocket
 //
@@ -106,6 +122,9 @@ protected:
 	struct sockaddr_in m_SIN;
 	bool m_HasError;
 	int m_Error;
+	CSocketReactor *m_Reactor;				// the reactor this socket is registered with (NULL when using select)
+	bool m_Readable;						// if the reactor reported this socket as readable and it hasn't been drained yet
+	bool m_Writable;						// if the reactor reported this socket as writable and the kernel send buffer hasn't filled up yet
 
 public:
 	CSocket( );
@@ -118,15 +137,66 @@ public:
 	virtual bool HasError( )						{ return m_HasError; }
 	virtual int GetError( )							{ return m_Error; }
 	virtual string GetErrorString( );
+	virtual SOCKET GetSocket( )						{ return m_Socket; }
+	virtual CSocketReactor *GetReactor( )			{ return m_Reactor; }
+	virtual void SetReadable( bool nReadable )		{ m_Readable = nReadable; }
+	virtual void SetWritable( bool nWritable )		{ m_Writable = nWritable; }
+	virtual void SetReactor( CSocketReactor *reactor );
+	virtual bool IsReadable( fd_set *fd );
+	virtual bool IsWritable( fd_set *send_fd );
 	virtual void SetFD( fd_set *fd, fd_set *send_fd, int *nfds );
 	virtual void Allocate( int type );
 	virtual void Reset( );
+
+protected:
+	virtual void Register( CSocketReactor *reactor );
+	virtual void Unregister( );
+};
+
+//
+// CRecvBuffer
+//
+
+// a growable receive buffer which the socket reads into directly
+// received data is appended at the write offset and packets are framed and consumed at the read offset without moving the rest of the buffer
+// the unread data is only moved back to the start of the buffer when there isn't enough room left at the end (which doesn't happen at all when the buffer is drained completely)
+// so a framed packet is always contiguous and can be looked at in place
+
+#define RECVBUFFER_MIN_READ 4096
+
+class CRecvBuffer
+{
+private:
+	BYTEARRAY m_Buffer;
+	uint32_t m_Start;						// the read offset
+	uint32_t m_End;							// the write offset
+
+public:
+	CRecvBuffer( );
+	~CRecvBuffer( );
+
+	const unsigned char *GetData( )			{ return m_Buffer.empty( ) ? NULL : &m_Buffer[m_Start]; }
+	uint32_t GetSize( )						{ return m_End - m_Start; }
+	bool empty( )							{ return m_Start == m_End; }
+
+	unsigned char *Reserve( uint32_t size );
+	uint32_t GetFree( )						{ return m_Buffer.size( ) - m_End; }
+	void Commit( uint32_t size )			{ m_End += size; }
+	void Consume( uint32_t size );
+	void Append( const unsigned char *data, uint32_t size );
+	void Clear( )							{ m_Start = 0; m_End = 0; }
+	int32_t FramePacket( uint32_t lengthOffset, uint16_t minLength );
 };
 
 //
 // CTCPSocket
 //
 
+// outgoing data is queued as a list of packet buffer references rather than being copied into one big send buffer
+// shared packets (see CPacketBuffer) are queued on every socket without copying them and DoSend passes up to TCPSOCKET_MAX_SEND_BUFFERS of them to the kernel in one gathered send call
+
+#define TCPSOCKET_MAX_SEND_BUFFERS 64
+
 class CTCPSocket : public CSocket
 {
 protected:
@@ -134,8 +204,9 @@ protected:
 	string m_LogFile;
 
 private:
-	string m_RecvBuffer;
-	string m_SendBuffer;
+	CRecvBuffer m_RecvBuffer;
+	deque<PACKETBUFFER> m_SendQueue;		// the packets waiting to be sent
+	uint32_t m_SendOffset;					// the number of bytes of the first packet in the send queue which have already been sent
 	uint32_t m_LastRecv;
 	uint32_t m_LastSend;
 
@@ -146,11 +217,12 @@ public:
 
 	virtual void Reset( );
 	virtual bool GetConnected( )				{ return m_Connected; }
-	virtual string *GetBytes( )					{ return &m_RecvBuffer; }
+	virtual CRecvBuffer *GetBytes( )			{ return &m_RecvBuffer; }
 	virtual void PutBytes( string bytes );
 	virtual void PutBytes( BYTEARRAY bytes );
-	virtual void ClearRecvBuffer( )				{ m_RecvBuffer.clear( ); }
-	virtual void ClearSendBuffer( )				{ m_SendBuffer.clear( ); }
+	virtual void PutBytes( PACKETBUFFER packet );
+	virtual void ClearRecvBuffer( )				{ m_RecvBuffer.Clear( ); }
+	virtual void ClearSendBuffer( )				{ m_SendQueue.clear( ); m_SendOffset = 0; }
 	virtual uint32_t GetLastRecv( )				{ return m_LastRecv; }
 	virtual uint32_t GetLastSend( )				{ return m_LastSend; }
 	virtual void DoRecv( fd_set *fd );
@@ -228,4 +300,62 @@ public:
 	virtual void RecvFrom( fd_set *fd, struct sockaddr_in *sin, string *message );
 };
 
+//
+// CWakeup
+//
+
+// a descriptor which lets another thread wake up a thread blocked in select or on a socket reactor (e.g. when a database callable completes)
+// on Linux this is an eventfd, on other platforms it's the read end of a pipe
+// on Windows there's nothing we can select on so signalling does nothing and the blocked thread just wakes up when its timeout expires
+
+class CWakeup
+{
+private:
+	int m_ReadFD;				// the descriptor to wait on (-1 if wakeups aren't supported)
+	int m_WriteFD;				// the descriptor to signal (the same descriptor as m_ReadFD for an eventfd)
+
+public:
+	CWakeup( );
+	~CWakeup( );
+
+	int GetFD( )				{ return m_ReadFD; }
+	bool GetValid( )			{ return m_ReadFD != -1; }
+
+	void Signal( );
+	void Clear( );
+	bool SetFD( fd_set *fd, int *nfds );
+};
+
+#ifdef GHOST_EPOLL
+
+//
+// CSocketReactor
+//
+
+class CSocketReactor
+{
+private:
+	int m_EPoll;							// the epoll instance
+	uint32_t m_NumSockets;					// the number of sockets currently registered
+	vector<struct epoll_event> m_Events;	// buffer for the events returned by epoll_wait (grows as needed)
+	set<CSocket *> m_Pending;				// sockets which were only partially drained and must be serviced again without blocking (e.g. listening sockets)
+	CWakeup *m_Wakeup;						// the wakeup which interrupts Wait (NULL if none)
+
+public:
+	CSocketReactor( );
+	~CSocketReactor( );
+
+	bool GetValid( )						{ return m_EPoll != -1; }
+	uint32_t GetNumSockets( )				{ return m_NumSockets; }
+
+	bool Register( CSocket *socket );
+	void Unregister( CSocket *socket );
+	bool RegisterWakeup( CWakeup *wakeup );
+	void AddPending( CSocket *socket )		{ m_Pending.insert( socket ); }
+	void RemovePending( CSocket *socket )	{ m_Pending.erase( socket ); }
+	int Wait( long usecBlock );
+};
+
+#endif
+
 #endif
@@ -343,61 +343,46 @@ bool CStatsW3MMD :: ProcessAction( CIncomingAction *Action )
 	return false;
 }
 
-void CStatsW3MMD :: Save( CGHost *GHost, CGHostDB *DB, uint32_t GameID )
+void CStatsW3MMD :: Save( CDBGameData *GameData )
 {
 	CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] received " + UTIL_ToString( m_NextValueID ) + "/" + UTIL_ToString( m_NextCheckID ) + " value/check messages" );
 
-	if( DB->Begin( ) )
+	GameData->m_W3MMDCategory = m_Category;
+
+	for( map<uint32_t,string> :: iterator i = m_PIDToName.begin( ); i != m_PIDToName.end( ); ++i )
 	{
-		// todotodo: there's no reason to create a new callable for each entry in this map
-		// rewrite ThreadedW3MMDPlayerAdd to act more like ThreadedW3MMDVarAdd
+		string Flags = m_Flags[i->first];
+		uint32_t Leaver = 0;
+		uint32_t Practicing = 0;
 
-                for( map<uint32_t,string> :: iterator i = m_PIDToName.begin( ); i != m_PIDToName.end( ); ++i )
+		if( m_FlagsLeaver.find( i->first ) != m_FlagsLeaver.end( ) && m_FlagsLeaver[i->first] )
 		{
-			string Flags = m_Flags[i->first];
-			uint32_t Leaver = 0;
-			uint32_t Practicing = 0;
-
-			if( m_FlagsLeaver.find( i->first ) != m_FlagsLeaver.end( ) && m_FlagsLeaver[i->first] )
-			{
-				Leaver = 1;
-
-				if( !Flags.empty( ) )
-					Flags += "/";
-
-				Flags += "leaver";
-			}
-
-			if( m_FlagsPracticing.find( i->first ) != m_FlagsPracticing.end( ) && m_FlagsPracticing[i->first] )
-			{
-				Practicing = 1;
-
-				if( !Flags.empty( ) )
-					Flags += "/";
+			Leaver = 1;
 
-				Flags += "practicing";
-			}
+			if( !Flags.empty( ) )
+				Flags += "/";
 
-			CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] recorded flags [" + Flags + "] for player [" + i->second + "] with PID [" + UTIL_ToString( i->first ) + "]" );
-			GHost->m_Callables.push_back( DB->ThreadedW3MMDPlayerAdd( m_Category, GameID, i->first, i->second, m_Flags[i->first], Leaver, Practicing ) );
+			Flags += "leaver";
 		}
 
-		if( !m_VarPInts.empty( ) )
-			GHost->m_Callables.push_back( DB->ThreadedW3MMDVarAdd( GameID, m_VarPInts ) );
+		if( m_FlagsPracticing.find( i->first ) != m_FlagsPracticing.end( ) && m_FlagsPracticing[i->first] )
+		{
+			Practicing = 1;
 
-		if( !m_VarPReals.empty( ) )
-			GHost->m_Callables.push_back( DB->ThreadedW3MMDVarAdd( GameID, m_VarPReals ) );
+			if( !Flags.empty( ) )
+				Flags += "/";
 
-		if( !m_VarPStrings.empty( ) )
-			GHost->m_Callables.push_back( DB->ThreadedW3MMDVarAdd( GameID, m_VarPStrings ) );
+			Flags += "practicing";
+		}
 
-		if( DB->Commit( ) )
-			CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] saving data" );
-		else
-			CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] unable to commit database transaction, data not saved" );
+		CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] recorded flags [" + Flags + "] for player [" + i->second + "] with PID [" + UTIL_ToString( i->first ) + "]" );
+		GameData->m_W3MMDPlayers.push_back( CDBW3MMDPlayer( i->first, i->second, m_Flags[i->first], Leaver, Practicing ) );
 	}
-	else
-		CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] unable to begin database transaction, data not saved" );
+
+	GameData->m_W3MMDVarInts = m_VarPInts;
+	GameData->m_W3MMDVarReals = m_VarPReals;
+	GameData->m_W3MMDVarStrings = m_VarPStrings;
+	CONSOLE_Print( "[STATSW3MMD: " + m_Game->GetGameName( ) + "] saving data" );
 }
 
 vector<string> CStatsW3MMD :: TokenizeKey( string key )
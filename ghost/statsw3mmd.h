@@ -48,7 +48,7 @@ public:
 	virtual ~CStatsW3MMD( );
 
 	virtual bool ProcessAction( CIncomingAction *Action );
-	virtual void Save( CGHost *GHost, CGHostDB *DB, uint32_t GameID );
+	virtual void Save( CDBGameData *GameData );
 	virtual vector<string> TokenizeKey( string key );
 };
 
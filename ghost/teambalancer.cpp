@@ -0,0 +1,225 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#include "ghost.h"
+#include "teambalancer.h"
+
+#include <string.h>
+
+//
+// CTeamBalancer
+//
+
+CTeamBalancer :: CTeamBalancer( ) : m_NumPlayers( 0 ), m_NumTeams( 0 ), m_BestDifference( 0.0 ), m_NumNodes( 0 )
+{
+
+}
+
+CTeamBalancer :: ~CTeamBalancer( )
+{
+
+}
+
+vector<unsigned char> CTeamBalancer :: Balance( vector<unsigned char> playerIDs, unsigned char *teamSizes, double *playerScores )
+{
+	m_NumPlayers = 0;
+	m_NumTeams = 0;
+	m_NumNodes = 0;
+
+	// sort the players by score, highest first
+	// ties are broken by PID so the result doesn't depend on the order the players were passed in
+
+	vector< pair<double, unsigned char> > Players;
+
+	for( vector<unsigned char> :: iterator i = playerIDs.begin( ); i != playerIDs.end( ); ++i )
+		Players.push_back( make_pair( -playerScores[*i], *i ) );
+
+	sort( Players.begin( ), Players.end( ) );
+
+	for( vector< pair<double, unsigned char> > :: iterator i = Players.begin( ); i != Players.end( ) && m_NumPlayers < TEAMBALANCER_MAX_PLAYERS; ++i )
+	{
+		m_PIDs[m_NumPlayers] = i->second;
+		m_Scores[m_NumPlayers] = -i->first;
+		++m_NumPlayers;
+	}
+
+	m_ScoresFrom[m_NumPlayers] = 0.0;
+
+	for( uint32_t i = m_NumPlayers; i > 0; --i )
+		m_ScoresFrom[i - 1] = m_ScoresFrom[i] + m_Scores[i - 1];
+
+	uint32_t NumSlots = 0;
+
+	for( unsigned char i = 0; i < TEAMBALANCER_MAX_TEAMS; ++i )
+	{
+		if( teamSizes[i] > 0 )
+		{
+			m_Teams[m_NumTeams] = i;
+			m_TeamSizes[m_NumTeams] = teamSizes[i];
+			m_TeamCounts[m_NumTeams] = 0;
+			m_TeamScores[m_NumTeams] = 0.0;
+			NumSlots += teamSizes[i];
+			++m_NumTeams;
+		}
+	}
+
+	if( m_NumTeams == 0 || NumSlots != m_NumPlayers )
+		return playerIDs;
+
+	// start with a greedy assignment, each player goes to the team with the lowest total score which still has room
+
+	for( uint32_t i = 0; i < m_NumPlayers; ++i )
+	{
+		uint32_t Team = m_NumTeams;
+
+		for( uint32_t j = 0; j < m_NumTeams; ++j )
+		{
+			if( m_TeamCounts[j] < m_TeamSizes[j] && ( Team == m_NumTeams || m_TeamScores[j] < m_TeamScores[Team] ) )
+				Team = j;
+		}
+
+		m_BestAssignment[i] = Team;
+		m_TeamCounts[Team]++;
+		m_TeamScores[Team] += m_Scores[i];
+	}
+
+	double Lowest = m_TeamScores[0];
+	double Highest = m_TeamScores[0];
+
+	for( uint32_t i = 1; i < m_NumTeams; ++i )
+	{
+		Lowest = min( Lowest, m_TeamScores[i] );
+		Highest = max( Highest, m_TeamScores[i] );
+	}
+
+	m_BestDifference = Highest - Lowest;
+
+	// now search for a better one
+
+	for( uint32_t i = 0; i < m_NumTeams; ++i )
+	{
+		m_TeamCounts[i] = 0;
+		m_TeamScores[i] = 0.0;
+	}
+
+	if( m_NumTeams > 1 )
+		Search( 0 );
+
+	// list the players in team order
+
+	vector<unsigned char> Ordering;
+
+	for( uint32_t i = 0; i < m_NumTeams; ++i )
+	{
+		for( uint32_t j = 0; j < m_NumPlayers; ++j )
+		{
+			if( m_BestAssignment[j] == i )
+				Ordering.push_back( m_PIDs[j] );
+		}
+	}
+
+	return Ordering;
+}
+
+void CTeamBalancer :: Search( uint32_t player )
+{
+	++m_NumNodes;
+
+	if( player == m_NumPlayers )
+	{
+		double Lowest = m_TeamScores[0];
+		double Highest = m_TeamScores[0];
+
+		for( uint32_t i = 1; i < m_NumTeams; ++i )
+		{
+			Lowest = min( Lowest, m_TeamScores[i] );
+			Highest = max( Highest, m_TeamScores[i] );
+		}
+
+		if( Highest - Lowest < m_BestDifference )
+		{
+			m_BestDifference = Highest - Lowest;
+			memcpy( m_BestAssignment, m_Assignment, sizeof( m_Assignment ) );
+		}
+
+		return;
+	}
+
+	// stop if this branch can't beat the best balance (a perfect balance can't be beaten either)
+
+	if( m_BestDifference <= 0.0 || GetLowerBound( player ) >= m_BestDifference )
+		return;
+
+	for( uint32_t i = 0; i < m_NumTeams; ++i )
+	{
+		if( m_TeamCounts[i] == m_TeamSizes[i] )
+			continue;
+
+		// if an earlier team of the same size is still empty this team would give the same balances with the teams swapped
+
+		if( m_TeamCounts[i] == 0 )
+		{
+			bool Symmetric = false;
+
+			for( uint32_t j = 0; j < i; ++j )
+			{
+				if( m_TeamCounts[j] == 0 && m_TeamSizes[j] == m_TeamSizes[i] )
+				{
+					Symmetric = true;
+					break;
+				}
+			}
+
+			if( Symmetric )
+				continue;
+		}
+
+		m_Assignment[player] = i;
+		m_TeamCounts[i]++;
+		m_TeamScores[i] += m_Scores[player];
+		Search( player + 1 );
+		m_TeamCounts[i]--;
+		m_TeamScores[i] -= m_Scores[player];
+	}
+}
+
+double CTeamBalancer :: GetLowerBound( uint32_t player )
+{
+	// the remaining players are sorted by score so the most (or least) a team can still gain is the total of the highest (or lowest) scores which fit on it
+	// no assignment of the remaining players can do better than the highest lowest possible total minus the lowest highest possible total
+
+	double HighestLowest = 0.0;
+	double LowestHighest = 0.0;
+
+	for( uint32_t i = 0; i < m_NumTeams; ++i )
+	{
+		uint32_t Left = m_TeamSizes[i] - m_TeamCounts[i];
+		double Lowest = m_TeamScores[i] + m_ScoresFrom[m_NumPlayers - Left];
+		double Highest = m_TeamScores[i] + m_ScoresFrom[player] - m_ScoresFrom[player + Left];
+
+		if( i == 0 || Lowest > HighestLowest )
+			HighestLowest = Lowest;
+
+		if( i == 0 || Highest < LowestHighest )
+			LowestHighest = Highest;
+	}
+
+	return HighestLowest - LowestHighest;
+}
@@ -0,0 +1,73 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#ifndef TEAMBALANCER_H
+#define TEAMBALANCER_H
+
+//
+// CTeamBalancer
+//
+
+// splits up to 12 players into teams of fixed sizes so the largest difference in total score between any two teams is as small as possible
+// this is a variation of the bin packing problem which is NP but with at most 12 players an exact branch and bound search is fast enough for every team layout
+// 1.) the players are sorted by score (highest first) and assigned to the teams one at a time, the big scores go first so bad branches are found early
+// 2.) a branch is cut as soon as even the best possible assignment of the remaining players can't beat the best balance found so far
+// 3.) empty teams of the same size are interchangeable so a player is only ever tried on the first of them, this removes most of the work for layouts like 4 teams of 3
+// a greedy assignment is used as the starting point so the search begins with a good bound
+// all of the search state is kept in fixed size arrays so nothing is allocated while searching
+
+#define TEAMBALANCER_MAX_PLAYERS	12
+#define TEAMBALANCER_MAX_TEAMS		12
+
+class CTeamBalancer
+{
+private:
+	uint32_t m_NumPlayers;
+	uint32_t m_NumTeams;
+	unsigned char m_PIDs[TEAMBALANCER_MAX_PLAYERS];				// the players sorted by score, highest first
+	double m_Scores[TEAMBALANCER_MAX_PLAYERS];					// the score of each sorted player
+	double m_ScoresFrom[TEAMBALANCER_MAX_PLAYERS + 1];			// the total score of the sorted players from each index to the end
+	unsigned char m_Teams[TEAMBALANCER_MAX_TEAMS];				// the team number of each team we're balancing (teams without any players are skipped)
+	uint32_t m_TeamSizes[TEAMBALANCER_MAX_TEAMS];				// the number of players on each team
+	uint32_t m_TeamCounts[TEAMBALANCER_MAX_TEAMS];				// the number of players assigned to each team so far
+	double m_TeamScores[TEAMBALANCER_MAX_TEAMS];				// the total score of the players assigned to each team so far
+	uint32_t m_Assignment[TEAMBALANCER_MAX_PLAYERS];			// the team each sorted player is assigned to in the current branch
+	uint32_t m_BestAssignment[TEAMBALANCER_MAX_PLAYERS];		// the team each sorted player is assigned to in the best balance found so far
+	double m_BestDifference;									// the largest difference between two teams in the best balance found so far
+	uint32_t m_NumNodes;										// the number of partial assignments the search looked at
+
+public:
+	CTeamBalancer( );
+	~CTeamBalancer( );
+
+	double GetDifference( )		{ return m_BestDifference; }
+	uint32_t GetNumNodes( )		{ return m_NumNodes; }
+
+	// playerIDs are the players to balance (PIDs 0 to 12), playerScores is indexed by PID and teamSizes holds the number of players on each of the 12 teams
+	// returns the players in team order, i.e. the players for the first team with any players first, then the players for the next team, and so on
+
+	vector<unsigned char> Balance( vector<unsigned char> playerIDs, unsigned char *teamSizes, double *playerScores );
+
+private:
+	void Search( uint32_t player );
+	double GetLowerBound( uint32_t player );
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#include "ghost.h"
+#include "timerwheel.h"
+
+//
+// CTimer
+//
+
+CTimer :: CTimer( ) : m_Wheel( NULL ), m_Prev( NULL ), m_Next( NULL ), m_Slot( 0 ), m_Expires( 0 ), m_Pending( false ), m_Expired( false )
+{
+
+}
+
+CTimer :: ~CTimer( )
+{
+	Cancel( );
+}
+
+void CTimer :: Schedule( uint32_t ticks )
+{
+	// schedule the timer without adding it to a wheel
+	// this is only useful when the timer's owner isn't attached to a wheel at the moment (see CTimerWheel :: Add)
+
+	Cancel( );
+
+	if( ticks > TIMERWHEEL_MAX_TICKS )
+		ticks = TIMERWHEEL_MAX_TICKS;
+
+	m_Expires = GetTicks( ) + ticks;
+	m_Pending = true;
+}
+
+void CTimer :: Cancel( )
+{
+	if( m_Wheel )
+		m_Wheel->Remove( this );
+
+	m_Pending = false;
+	m_Expired = false;
+}
+
+//
+// CTimerWheel
+//
+
+CTimerWheel :: CTimerWheel( ) : m_Ticks( GetTicks( ) ), m_NumTimers( 0 )
+{
+	for( uint32_t i = 0; i < TIMERWHEEL_SLOTS; ++i )
+		m_Slots[i] = NULL;
+}
+
+CTimerWheel :: ~CTimerWheel( )
+{
+	// detach any remaining timers so they don't try to remove themselves from a deleted wheel later
+	// the timers stay pending so they can be added to another wheel
+
+	for( uint32_t i = 0; i < TIMERWHEEL_SLOTS; ++i )
+	{
+		while( m_Slots[i] )
+			Unlink( m_Slots[i] );
+	}
+}
+
+void CTimerWheel :: Schedule( CTimer *timer, uint32_t ticks )
+{
+	timer->Schedule( ticks );
+	Link( timer );
+}
+
+void CTimerWheel :: Add( CTimer *timer )
+{
+	// add a timer which was scheduled on another wheel (or while it wasn't attached to any wheel) using its original expiry time
+
+	if( timer->m_Pending && !timer->m_Wheel )
+		Link( timer );
+}
+
+void CTimerWheel :: Remove( CTimer *timer )
+{
+	// remove a timer from the wheel without changing its state
+
+	if( timer->m_Wheel == this )
+		Unlink( timer );
+}
+
+void CTimerWheel :: Update( )
+{
+	uint32_t Ticks = GetTicks( );
+
+	while( (int32_t)( Ticks - m_Ticks ) >= 0 )
+	{
+		// there's nothing to do if the wheel is empty so just skip ahead
+
+		if( m_NumTimers == 0 )
+		{
+			m_Ticks = Ticks + 1;
+			break;
+		}
+
+		uint32_t Index = m_Ticks & ( TIMERWHEEL_LEVEL0_SLOTS - 1 );
+
+		// every time level 0 wraps around move the timers from the next slot of the higher levels down to where they belong
+
+		if( Index == 0 )
+		{
+			for( uint32_t Level = 1; Level < TIMERWHEEL_LEVELS; ++Level )
+			{
+				if( Cascade( Level ) != 0 )
+					break;
+			}
+		}
+
+		// expire every timer in this slot
+
+		while( m_Slots[Index] )
+		{
+			CTimer *Timer = m_Slots[Index];
+			Unlink( Timer );
+			Timer->m_Pending = false;
+			Timer->m_Expired = true;
+		}
+
+		++m_Ticks;
+	}
+}
+
+uint32_t CTimerWheel :: GetNextExpiryTicks( uint32_t maximum )
+{
+	// return the number of ticks (ms) until the next timer expires or maximum if no timer expires before then
+	// we look at the first non empty slot of each level since the timers in a higher level slot can expire before some of the timers in level 0
+
+	if( m_NumTimers == 0 )
+		return maximum;
+
+	bool Found = false;
+	uint32_t Expires = 0;
+
+	for( uint32_t i = 0; i < TIMERWHEEL_LEVEL0_SLOTS; ++i )
+	{
+		if( m_Slots[( m_Ticks + i ) & ( TIMERWHEEL_LEVEL0_SLOTS - 1 )] )
+		{
+			// timers which were already overdue when they were scheduled are stored in the current slot so this isn't necessarily exact, but it's never late
+
+			Expires = m_Ticks + i;
+			Found = true;
+			break;
+		}
+	}
+
+	for( uint32_t Level = 1; Level < TIMERWHEEL_LEVELS; ++Level )
+	{
+		uint32_t Shift = TIMERWHEEL_LEVEL0_BITS + ( Level - 1 ) * TIMERWHEEL_LEVEL_BITS;
+		uint32_t Base = TIMERWHEEL_LEVEL0_SLOTS + ( Level - 1 ) * TIMERWHEEL_LEVEL_SLOTS;
+
+		// the current slot can contain timers which are waiting to be cascaded as well as timers a full rotation away so we always look at it
+		// after that the slots are in order so we can stop at the first non empty one
+
+		for( uint32_t i = 0; i < TIMERWHEEL_LEVEL_SLOTS; ++i )
+		{
+			CTimer *Timer = m_Slots[Base + ( ( ( m_Ticks >> Shift ) + i ) & ( TIMERWHEEL_LEVEL_SLOTS - 1 ) )];
+
+			if( Timer )
+			{
+				for( ; Timer; Timer = Timer->m_Next )
+				{
+					if( !Found || (int32_t)( Timer->m_Expires - Expires ) < 0 )
+					{
+						Expires = Timer->m_Expires;
+						Found = true;
+					}
+				}
+
+				if( i > 0 )
+					break;
+			}
+		}
+	}
+
+	uint32_t Ticks = GetTicks( );
+
+	if( (int32_t)( Expires - Ticks ) <= 0 )
+		return 0;
+	else if( Expires - Ticks < maximum )
+		return Expires - Ticks;
+	else
+		return maximum;
+}
+
+void CTimerWheel :: Link( CTimer *timer )
+{
+	uint32_t Delta = timer->m_Expires - m_Ticks;
+	uint32_t Slot;
+
+	if( (int32_t)Delta < 0 )
+	{
+		// the timer is already overdue so put it in the next slot to be processed
+
+		Slot = m_Ticks & ( TIMERWHEEL_LEVEL0_SLOTS - 1 );
+	}
+	else if( Delta < TIMERWHEEL_LEVEL0_SLOTS )
+		Slot = timer->m_Expires & ( TIMERWHEEL_LEVEL0_SLOTS - 1 );
+	else
+	{
+		if( Delta > TIMERWHEEL_MAX_TICKS )
+		{
+			timer->m_Expires = m_Ticks + TIMERWHEEL_MAX_TICKS;
+			Delta = TIMERWHEEL_MAX_TICKS;
+		}
+
+		uint32_t Level = 1;
+		uint32_t Shift = TIMERWHEEL_LEVEL0_BITS;
+
+		while( Level < TIMERWHEEL_LEVELS - 1 && Delta >= ( (uint32_t)1 << ( Shift + TIMERWHEEL_LEVEL_BITS ) ) )
+		{
+			++Level;
+			Shift += TIMERWHEEL_LEVEL_BITS;
+		}
+
+		Slot = TIMERWHEEL_LEVEL0_SLOTS + ( Level - 1 ) * TIMERWHEEL_LEVEL_SLOTS + ( ( timer->m_Expires >> Shift ) & ( TIMERWHEEL_LEVEL_SLOTS - 1 ) );
+	}
+
+	timer->m_Wheel = this;
+	timer->m_Slot = Slot;
+	timer->m_Prev = NULL;
+	timer->m_Next = m_Slots[Slot];
+
+	if( m_Slots[Slot] )
+		m_Slots[Slot]->m_Prev = timer;
+
+	m_Slots[Slot] = timer;
+	++m_NumTimers;
+}
+
+void CTimerWheel :: Unlink( CTimer *timer )
+{
+	if( timer->m_Prev )
+		timer->m_Prev->m_Next = timer->m_Next;
+	else
+		m_Slots[timer->m_Slot] = timer->m_Next;
+
+	if( timer->m_Next )
+		timer->m_Next->m_Prev = timer->m_Prev;
+
+	timer->m_Wheel = NULL;
+	timer->m_Prev = NULL;
+	timer->m_Next = NULL;
+	--m_NumTimers;
+}
+
+uint32_t CTimerWheel :: Cascade( uint32_t level )
+{
+	// move every timer in the current slot of this level down to a lower level
+	// returns the index of the slot so the caller knows if the next level needs to be cascaded too
+
+	uint32_t Shift = TIMERWHEEL_LEVEL0_BITS + ( level - 1 ) * TIMERWHEEL_LEVEL_BITS;
+	uint32_t Index = ( m_Ticks >> Shift ) & ( TIMERWHEEL_LEVEL_SLOTS - 1 );
+	uint32_t Slot = TIMERWHEEL_LEVEL0_SLOTS + ( level - 1 ) * TIMERWHEEL_LEVEL_SLOTS + Index;
+
+	CTimer *Timer = m_Slots[Slot];
+	m_Slots[Slot] = NULL;
+
+	while( Timer )
+	{
+		CTimer *Next = Timer->m_Next;
+		--m_NumTimers;
+		Link( Timer );
+		Timer = Next;
+	}
+
+	return Index;
+}
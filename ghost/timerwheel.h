@@ -0,0 +1,95 @@
+/*
+
+   Copyright [2008] [Trevor Hogan]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
+
+*/
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+//
+// CTimerWheel
+//
+
+// a hierarchical timer wheel with a resolution of 1ms
+// level 0 has 256 slots of 1ms each, levels 1 to 3 have 64 slots each covering 256ms, 16.4 seconds and 17.5 minutes per slot
+// timers further than 18.6 hours in the future are clamped to the end of the wheel
+// scheduling and cancelling a timer is O(1) and the wheel only touches the timers which are actually due (plus an occasional cascade)
+// each thread which updates games owns one wheel (the main thread and every game worker) and it must only be accessed by that thread (or while holding the worker's lock)
+// instead of calling back into the owner an expired timer is simply flagged as expired, the owner checks the flag in its next update and reschedules the timer if necessary
+
+#define TIMERWHEEL_LEVEL0_BITS	8
+#define TIMERWHEEL_LEVEL_BITS	6
+#define TIMERWHEEL_LEVELS		4
+#define TIMERWHEEL_LEVEL0_SLOTS	( 1 << TIMERWHEEL_LEVEL0_BITS )
+#define TIMERWHEEL_LEVEL_SLOTS	( 1 << TIMERWHEEL_LEVEL_BITS )
+#define TIMERWHEEL_SLOTS		( TIMERWHEEL_LEVEL0_SLOTS + ( TIMERWHEEL_LEVELS - 1 ) * TIMERWHEEL_LEVEL_SLOTS )
+#define TIMERWHEEL_MAX_TICKS	( ( 1 << ( TIMERWHEEL_LEVEL0_BITS + ( TIMERWHEEL_LEVELS - 1 ) * TIMERWHEEL_LEVEL_BITS ) ) - 1 )
+
+class CTimerWheel;
+
+class CTimer
+{
+	friend class CTimerWheel;
+
+private:
+	CTimerWheel *m_Wheel;			// the wheel this timer is linked into (NULL if it isn't linked into a wheel)
+	CTimer *m_Prev;					// the previous timer in the same wheel slot
+	CTimer *m_Next;					// the next timer in the same wheel slot
+	uint32_t m_Slot;				// the wheel slot this timer is linked into
+	uint32_t m_Expires;				// GetTicks when this timer expires
+	bool m_Pending;					// if the timer has been scheduled and hasn't expired yet (it's possible for a pending timer not to be linked into a wheel while it's being moved between threads)
+	bool m_Expired;					// if the timer has expired since it was last scheduled
+
+public:
+	CTimer( );
+	~CTimer( );
+
+	uint32_t GetExpires( )			{ return m_Expires; }
+	bool GetPending( )				{ return m_Pending; }
+	bool GetExpired( )				{ return m_Expired; }
+
+	void Schedule( uint32_t ticks );
+	void Cancel( );
+};
+
+class CTimerWheel
+{
+private:
+	CTimer *m_Slots[TIMERWHEEL_SLOTS];	// the head of the timer list in each slot, level 0 is stored first followed by levels 1 to 3
+	uint32_t m_Ticks;					// the next tick to be processed
+	uint32_t m_NumTimers;				// the number of timers linked into the wheel
+
+public:
+	CTimerWheel( );
+	~CTimerWheel( );
+
+	uint32_t GetNumTimers( )			{ return m_NumTimers; }
+
+	void Schedule( CTimer *timer, uint32_t ticks );
+	void Add( CTimer *timer );
+	void Remove( CTimer *timer );
+	void Update( );
+	uint32_t GetNextExpiryTicks( uint32_t maximum );
+
+private:
+	void Link( CTimer *timer );
+	void Unlink( CTimer *timer );
+	uint32_t Cascade( uint32_t level );
+};
+
+#endif
@@ -86,7 +86,6 @@ vector<string> UTIL_Tokenize( string s, char delim );
 
 uint32_t UTIL_Factorial( uint32_t x );
 
-#define nCr(n, r) (UTIL_Factorial(n) / UTIL_Factorial((n)-(r)) / UTIL_Factorial(r))
 #define nPr(n, r) (UTIL_Factorial(n) / UTIL_Factorial((n)-(r)))
 
 #endif
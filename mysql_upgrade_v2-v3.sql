@@ -0,0 +1,51 @@
+-- the summary tables hold the per player totals for !stats and !statsdota, the bot updates them whenever it saves a game
+-- the INSERT statements fill them from the games which were saved before the upgrade so this may take a while on a large database
+
+CREATE TABLE gameplayersummaries (
+	id INT NOT NULL AUTO_INCREMENT PRIMARY KEY,
+	name VARCHAR(15) NOT NULL,
+	spoofedrealm VARCHAR(100) NOT NULL,
+	firstgame DATE NOT NULL,
+	lastgame DATE NOT NULL,
+	games INT NOT NULL,
+	minloadingtime INT NOT NULL,
+	totalloadingtime BIGINT NOT NULL,
+	maxloadingtime INT NOT NULL,
+	leftpercentgames INT NOT NULL,
+	minleftpercent DOUBLE DEFAULT NULL,
+	totalleftpercent DOUBLE NOT NULL,
+	maxleftpercent DOUBLE DEFAULT NULL,
+	minduration INT NOT NULL,
+	totalduration BIGINT NOT NULL,
+	maxduration INT NOT NULL,
+	UNIQUE( name, spoofedrealm )
+);
+
+CREATE TABLE dotaplayersummaries (
+	id INT NOT NULL AUTO_INCREMENT PRIMARY KEY,
+	name VARCHAR(15) NOT NULL,
+	spoofedrealm VARCHAR(100) NOT NULL,
+	games INT NOT NULL,
+	wins INT NOT NULL,
+	losses INT NOT NULL,
+	kills INT NOT NULL,
+	deaths INT NOT NULL,
+	creepkills INT NOT NULL,
+	creepdenies INT NOT NULL,
+	assists INT NOT NULL,
+	neutralkills INT NOT NULL,
+	towerkills INT NOT NULL,
+	raxkills INT NOT NULL,
+	courierkills INT NOT NULL,
+	UNIQUE( name, spoofedrealm )
+);
+
+INSERT INTO gameplayersummaries ( name, spoofedrealm, firstgame, lastgame, games, minloadingtime, totalloadingtime, maxloadingtime, leftpercentgames, minleftpercent, totalleftpercent, maxleftpercent, minduration, totalduration, maxduration )
+	SELECT name, spoofedrealm, MIN(DATE(datetime)), MAX(DATE(datetime)), COUNT(*), MIN(loadingtime), SUM(loadingtime), MAX(loadingtime), COUNT(`left`/duration), MIN(`left`/duration)*100, IFNULL(SUM(`left`/duration)*100, 0), MAX(`left`/duration)*100, MIN(duration), SUM(duration), MAX(duration)
+	FROM gameplayers JOIN games ON games.id=gameplayers.gameid
+	GROUP BY name, spoofedrealm;
+
+INSERT INTO dotaplayersummaries ( name, spoofedrealm, games, wins, losses, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills )
+	SELECT name, spoofedrealm, COUNT(*), SUM(IFNULL((winner=1 AND newcolour>=1 AND newcolour<=5) OR (winner=2 AND newcolour>=7 AND newcolour<=11), 0)), SUM(IFNULL((winner=2 AND newcolour>=1 AND newcolour<=5) OR (winner=1 AND newcolour>=7 AND newcolour<=11), 0)), SUM(kills), SUM(deaths), SUM(creepkills), SUM(creepdenies), SUM(assists), SUM(neutralkills), SUM(towerkills), SUM(raxkills), SUM(courierkills)
+	FROM gameplayers JOIN dotaplayers ON dotaplayers.gameid=gameplayers.gameid AND dotaplayers.colour=gameplayers.colour LEFT JOIN dotagames ON dotagames.gameid=gameplayers.gameid
+	GROUP BY name, spoofedrealm;
@@ -18,6 +18,7 @@
 
 */
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -37,8 +38,11 @@ using namespace std;
 #include "config.h"
 #include "elo.h"
 
+#include <math.h>
 #include <string.h>
 
+#include <boost/unordered_map.hpp>
+
 #ifdef WIN32
  #include <winsock.h>
 #endif
@@ -118,6 +122,200 @@ float UTIL_ToFloat( string &s )
 	return result;
 }
 
+bool MySQLQuery( MYSQL *conn, string query )
+{
+	if( mysql_real_query( conn, query.c_str( ), query.size( ) ) != 0 )
+	{
+		cout << "error: " << mysql_error( conn ) << endl;
+		return false;
+	}
+
+	return true;
+}
+
+//
+// CEloScore
+//
+
+// every score is kept in memory while scoring so we don't need to query the database for each game's players
+// the scores are keyed by name and server, both lowercased because MySQL compares them without case
+
+class CEloScore
+{
+public:
+	string m_Name;
+	string m_Server;
+	float m_Score;
+	bool m_Changed;			// if the score has to be saved to the database
+
+	CEloScore( ) : m_Score( 1000.0 ), m_Changed( false ) { }
+};
+
+typedef boost :: unordered_map<string, CEloScore> EloScoreMap;
+
+string EloKey( string name, string server )
+{
+	transform( name.begin( ), name.end( ), name.begin( ), (int(*)(int))tolower );
+	transform( server.begin( ), server.end( ), server.begin( ), (int(*)(int))tolower );
+	return name + " " + server;
+}
+
+float EloRound( float score )
+{
+	// the scores are saved with two decimal places and the next game used to read them back from the database
+	// round them the same way after each game so scoring all the games at once gives the same scores as scoring them one at a time
+
+	return (float)( floor( score * 100.0 + 0.5 ) / 100.0 );
+}
+
+bool EloSaveScores( MYSQL *conn, EloScoreMap &scores )
+{
+	// save the changed scores with as few queries as possible
+	// existing scores are found by the table's unique key and new scores get a new row, both in the same multi row insert
+
+	string Query;
+	uint32_t NumRows = 0;
+
+	for( EloScoreMap :: iterator i = scores.begin( ); i != scores.end( ); ++i )
+	{
+		if( !i->second.m_Changed )
+			continue;
+
+		if( Query.empty( ) )
+			Query = "INSERT INTO dota_elo_scores ( name, server, score ) VALUES ";
+		else
+			Query += ", ";
+
+		Query += "( '" + MySQLEscapeString( conn, i->second.m_Name ) + "', '" + MySQLEscapeString( conn, i->second.m_Server ) + "', " + UTIL_ToString( i->second.m_Score, 2 ) + " )";
+
+		if( ++NumRows == 1000 )
+		{
+			if( !MySQLQuery( conn, Query + " ON DUPLICATE KEY UPDATE score=VALUES(score)" ) )
+				return false;
+
+			Query.clear( );
+			NumRows = 0;
+		}
+	}
+
+	if( !Query.empty( ) )
+		return MySQLQuery( conn, Query + " ON DUPLICATE KEY UPDATE score=VALUES(score)" );
+
+	return true;
+}
+
+//
+// CEloGamePlayer
+//
+
+class CEloGamePlayer
+{
+public:
+	string m_Name;
+	string m_Server;
+	uint32_t m_Colour;
+	uint32_t m_Winner;
+};
+
+void ScoreGame( uint32_t gameID, vector<CEloGamePlayer> &players, EloScoreMap &scores )
+{
+	if( players.size( ) > 10 )
+	{
+		cout << "gameid " << UTIL_ToString( gameID ) << " has more than 10 players, ignoring" << endl;
+		return;
+	}
+
+	CEloScore *player_scores[10];
+	int num_players = 0;
+	float player_ratings[10];
+	int player_teams[10];
+	int num_teams = 2;
+	float team_ratings[2];
+	float team_winners[2];
+	int team_numplayers[2];
+	team_ratings[0] = 0.0;
+	team_ratings[1] = 0.0;
+	team_numplayers[0] = 0;
+	team_numplayers[1] = 0;
+
+	for( vector<CEloGamePlayer> :: iterator i = players.begin( ); i != players.end( ); ++i )
+	{
+		if( i->m_Winner != 1 && i->m_Winner != 2 )
+		{
+			cout << "gameid " << UTIL_ToString( gameID ) << " has no winner, ignoring" << endl;
+			return;
+		}
+		else if( i->m_Winner == 1 )
+		{
+			team_winners[0] = 1.0;
+			team_winners[1] = 0.0;
+		}
+		else
+		{
+			team_winners[0] = 0.0;
+			team_winners[1] = 1.0;
+		}
+
+		// new players are added to the map now but they aren't saved unless a game changes their score
+
+		string Key = EloKey( i->m_Name, i->m_Server );
+		EloScoreMap :: iterator Score = scores.find( Key );
+
+		if( Score == scores.end( ) )
+		{
+			cout << "new player [" << i->m_Name << "] found" << endl;
+			Score = scores.insert( make_pair( Key, CEloScore( ) ) ).first;
+			Score->second.m_Name = i->m_Name;
+			Score->second.m_Server = i->m_Server;
+		}
+
+		player_scores[num_players] = &Score->second;
+		player_ratings[num_players] = Score->second.m_Score;
+
+		if( i->m_Colour >= 1 && i->m_Colour <= 5 )
+		{
+			player_teams[num_players] = 0;
+			team_ratings[0] += player_ratings[num_players];
+			team_numplayers[0]++;
+		}
+		else if( i->m_Colour >= 7 && i->m_Colour <= 11 )
+		{
+			player_teams[num_players] = 1;
+			team_ratings[1] += player_ratings[num_players];
+			team_numplayers[1]++;
+		}
+		else
+		{
+			cout << "gameid " << UTIL_ToString( gameID ) << " has a player with an invalid newcolour, ignoring" << endl;
+			return;
+		}
+
+		num_players++;
+	}
+
+	if( num_players == 0 )
+		cout << "gameid " << UTIL_ToString( gameID ) << " has no players, ignoring" << endl;
+	else if( team_numplayers[0] == 0 )
+		cout << "gameid " << UTIL_ToString( gameID ) << " has no Sentinel players, ignoring" << endl;
+	else if( team_numplayers[1] == 0 )
+		cout << "gameid " << UTIL_ToString( gameID ) << " has no Scourge players, ignoring" << endl;
+	else
+	{
+		float old_player_ratings[10];
+		memcpy( old_player_ratings, player_ratings, sizeof( float ) * 10 );
+		team_ratings[0] /= team_numplayers[0];
+		team_ratings[1] /= team_numplayers[1];
+		elo_recalculate_ratings( num_players, player_ratings, player_teams, num_teams, team_ratings, team_winners );
+
+		for( int i = 0; i < num_players; i++ )
+		{
+			cout << "gameid " << UTIL_ToString( gameID ) << " player [" << player_scores[i]->m_Name << "] rating " << UTIL_ToString( (uint32_t)old_player_ratings[i] ) << " -> " << UTIL_ToString( (uint32_t)player_ratings[i] ) << endl;
+			player_scores[i]->m_Score = EloRound( player_ratings[i] );
+			player_scores[i]->m_Changed = true;
+		}
+	}
+}
+
 int main( int argc, char **argv )
 {
 	string CFGFile = "update_dota_elo.cfg";
@@ -164,7 +362,7 @@ int main( int argc, char **argv )
 
 	cout << "creating tables" << endl;
 
-	string QCreate1 = "CREATE TABLE IF NOT EXISTS dota_elo_scores ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, name VARCHAR(15) NOT NULL, server VARCHAR(100) NOT NULL, score REAL NOT NULL )";
+	string QCreate1 = "CREATE TABLE IF NOT EXISTS dota_elo_scores ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, name VARCHAR(15) NOT NULL, server VARCHAR(100) NOT NULL, score REAL NOT NULL, UNIQUE KEY name_server ( name, server ) )";
 	string QCreate2 = "CREATE TABLE IF NOT EXISTS dota_elo_games_scored ( id INT NOT NULL AUTO_INCREMENT PRIMARY KEY, gameid INT NOT NULL )";
 
 	if( mysql_real_query( Connection, QCreate1.c_str( ), QCreate1.size( ) ) != 0 )
@@ -179,12 +377,46 @@ int main( int argc, char **argv )
 		return 1;
 	}
 
+	// older versions created the scores table without a unique key so a player could end up with more than one score
+	// keep the oldest score (which is the one we always used) and delete the others so the key can be added
+
+	string QSelectKey = "SHOW INDEX FROM dota_elo_scores WHERE Key_name='name_server'";
+
+	if( mysql_real_query( Connection, QSelectKey.c_str( ), QSelectKey.size( ) ) != 0 )
+	{
+		cout << "error: " << mysql_error( Connection ) << endl;
+		return 1;
+	}
+	else
+	{
+		MYSQL_RES *Result = mysql_store_result( Connection );
+
+		if( !Result )
+		{
+			cout << "error: " << mysql_error( Connection ) << endl;
+			return 1;
+		}
+
+		bool HasKey = mysql_num_rows( Result ) > 0;
+		mysql_free_result( Result );
+
+		if( !HasKey )
+		{
+			cout << "adding unique key to dota_elo_scores" << endl;
+
+			if( !MySQLQuery( Connection, "DELETE a FROM dota_elo_scores a JOIN dota_elo_scores b ON a.name=b.name AND a.server=b.server AND a.id>b.id" ) || !MySQLQuery( Connection, "ALTER TABLE dota_elo_scores ADD UNIQUE KEY name_server ( name, server )" ) )
+				return 1;
+		}
+	}
+
+	// only score the games which were saved before we started, any games saved while we're running will be scored next time
+
 	cout << "getting unscored games" << endl;
-	queue<uint32_t> UnscoredGames;
+	uint32_t MaxGameID = 0;
 
-	string QSelectUnscored = "SELECT id FROM games WHERE id NOT IN ( SELECT gameid FROM dota_elo_games_scored ) ORDER BY id";
+	string QSelectMaxGameID = "SELECT MAX(id) FROM games";
 
-	if( mysql_real_query( Connection, QSelectUnscored.c_str( ), QSelectUnscored.size( ) ) != 0 )
+	if( mysql_real_query( Connection, QSelectMaxGameID.c_str( ), QSelectMaxGameID.size( ) ) != 0 )
 	{
 		cout << "error: " << mysql_error( Connection ) << endl;
 		return 1;
@@ -197,11 +429,8 @@ int main( int argc, char **argv )
 		{
 			vector<string> Row = MySQLFetchRow( Result );
 
-			while( !Row.empty( ) )
-			{
-				UnscoredGames.push( UTIL_ToUInt32( Row[0] ) );
-				Row = MySQLFetchRow( Result );
-			}
+			if( Row.size( ) == 1 && !Row[0].empty( ) )
+				MaxGameID = UTIL_ToUInt32( Row[0] );
 
 			mysql_free_result( Result );
 		}
@@ -212,186 +441,122 @@ int main( int argc, char **argv )
 		}
 	}
 
-	cout << "found " << UnscoredGames.size( ) << " unscored games" << endl;
+	cout << "loading scores" << endl;
+	EloScoreMap Scores;
 
-	while( !UnscoredGames.empty( ) )
+	string QSelectScores = "SELECT name, server, score FROM dota_elo_scores";
+
+	if( mysql_real_query( Connection, QSelectScores.c_str( ), QSelectScores.size( ) ) != 0 )
 	{
-		uint32_t GameID = UnscoredGames.front( );
-		UnscoredGames.pop( );
+		cout << "error: " << mysql_error( Connection ) << endl;
+		return 1;
+	}
+	else
+	{
+		MYSQL_RES *Result = mysql_use_result( Connection );
+
+		if( Result )
+		{
+			vector<string> Row = MySQLFetchRow( Result );
+
+			while( Row.size( ) == 3 )
+			{
+				string Key = EloKey( Row[0], Row[1] );
+
+				if( Scores.find( Key ) == Scores.end( ) )
+				{
+					CEloScore &Score = Scores[Key];
+					Score.m_Name = Row[0];
+					Score.m_Server = Row[1];
+					Score.m_Score = UTIL_ToFloat( Row[2] );
+				}
 
-		string QSelectPlayers = "SELECT dota_elo_scores.id, gameplayers.name, spoofedrealm, newcolour, winner, score FROM dotaplayers LEFT JOIN dotagames ON dotagames.gameid=dotaplayers.gameid LEFT JOIN gameplayers ON gameplayers.gameid=dotaplayers.gameid AND gameplayers.colour=dotaplayers.colour LEFT JOIN dota_elo_scores ON dota_elo_scores.name=gameplayers.name AND server=spoofedrealm WHERE dotaplayers.gameid=" + UTIL_ToString( GameID );
+				Row = MySQLFetchRow( Result );
+			}
+
+			mysql_free_result( Result );
+		}
 
-		if( mysql_real_query( Connection, QSelectPlayers.c_str( ), QSelectPlayers.size( ) ) != 0 )
+		if( mysql_errno( Connection ) != 0 )
 		{
 			cout << "error: " << mysql_error( Connection ) << endl;
 			return 1;
 		}
-		else
+	}
+
+	cout << "loaded " << Scores.size( ) << " scores" << endl;
+
+	// get every player in every unscored game with one query ordered by game so the games are scored in the order they were played
+	// the rows are streamed from the server and each game is scored as soon as all of its players have arrived
+
+	cout << "scoring games" << endl;
+	uint32_t NumGames = 0;
+
+	string QSelectPlayers = "SELECT dotaplayers.gameid, gameplayers.name, spoofedrealm, newcolour, winner FROM dotaplayers LEFT JOIN dotagames ON dotagames.gameid=dotaplayers.gameid LEFT JOIN gameplayers ON gameplayers.gameid=dotaplayers.gameid AND gameplayers.colour=dotaplayers.colour WHERE dotaplayers.gameid<=" + UTIL_ToString( MaxGameID ) + " AND dotaplayers.gameid NOT IN ( SELECT gameid FROM dota_elo_games_scored ) ORDER BY dotaplayers.gameid";
+
+	if( mysql_real_query( Connection, QSelectPlayers.c_str( ), QSelectPlayers.size( ) ) != 0 )
+	{
+		cout << "error: " << mysql_error( Connection ) << endl;
+		return 1;
+	}
+	else
+	{
+		MYSQL_RES *Result = mysql_use_result( Connection );
+
+		if( Result )
 		{
-			MYSQL_RES *Result = mysql_store_result( Connection );
+			uint32_t GameID = 0;
+			vector<CEloGamePlayer> Players;
+			vector<string> Row = MySQLFetchRow( Result );
 
-			if( Result )
+			while( Row.size( ) == 5 )
 			{
-				cout << "gameid " << UTIL_ToString( GameID ) << " found" << endl;
-
-				bool ignore = false;
-				uint32_t rowids[10];
-				string names[10];
-				string servers[10];
-				bool exists[10];
-				int num_players = 0;
-				float player_ratings[10];
-				int player_teams[10];
-				int num_teams = 2;
-				float team_ratings[2];
-				float team_winners[2];
-				int team_numplayers[2];
-				team_ratings[0] = 0.0;
-				team_ratings[1] = 0.0;
-				team_numplayers[0] = 0;
-				team_numplayers[1] = 0;
-
-				vector<string> Row = MySQLFetchRow( Result );
-
-				while( Row.size( ) == 6 )
+				uint32_t RowGameID = UTIL_ToUInt32( Row[0] );
+
+				if( RowGameID != GameID && !Players.empty( ) )
 				{
-					if( num_players >= 10 )
-					{
-						cout << "gameid " << UTIL_ToString( GameID ) << " has more than 10 players, ignoring" << endl;
-						ignore = true;
-						break;
-					}
-
-					uint32_t Winner = UTIL_ToUInt32( Row[4] );
-
-					if( Winner != 1 && Winner != 2 )
-					{
-						cout << "gameid " << UTIL_ToString( GameID ) << " has no winner, ignoring" << endl;
-						ignore = true;
-						break;
-					}
-					else if( Winner == 1 )
-					{
-						team_winners[0] = 1.0;
-						team_winners[1] = 0.0;
-					}
-					else
-					{
-						team_winners[0] = 0.0;
-						team_winners[1] = 1.0;
-					}
-
-					if( !Row[0].empty( ) )
-						rowids[num_players] = UTIL_ToUInt32( Row[0] );
-					else
-						rowids[num_players] = 0;
-
-					names[num_players] = Row[1];
-					servers[num_players] = Row[2];
-
-					if( !Row[5].empty( ) )
-					{
-						exists[num_players] = true;
-						player_ratings[num_players] = UTIL_ToFloat( Row[5] );
-					}
-					else
-					{
-						cout << "new player [" << Row[1] << "] found" << endl;
-						exists[num_players] = false;
-						player_ratings[num_players] = 1000.0;
-					}
-
-					uint32_t Colour = UTIL_ToUInt32( Row[3] );
-
-					if( Colour >= 1 && Colour <= 5 )
-					{
-						player_teams[num_players] = 0;
-						team_ratings[0] += player_ratings[num_players];
-						team_numplayers[0]++;
-					}
-					else if( Colour >= 7 && Colour <= 11 )
-					{
-						player_teams[num_players] = 1;
-						team_ratings[1] += player_ratings[num_players];
-						team_numplayers[1]++;
-					}
-					else
-					{
-						cout << "gameid " << UTIL_ToString( GameID ) << " has a player with an invalid newcolour, ignoring" << endl;
-						ignore = true;
-						break;
-					}
-
-					num_players++;
-					Row = MySQLFetchRow( Result );
+					ScoreGame( GameID, Players, Scores );
+					Players.clear( );
+					NumGames++;
 				}
 
-				mysql_free_result( Result );
-
-				if( !ignore )
-				{
-					if( num_players == 0 )
-						cout << "gameid " << UTIL_ToString( GameID ) << " has no players, ignoring" << endl;
-					else if( team_numplayers[0] == 0 )
-						cout << "gameid " << UTIL_ToString( GameID ) << " has no Sentinel players, ignoring" << endl;
-					else if( team_numplayers[1] == 0 )
-						cout << "gameid " << UTIL_ToString( GameID ) << " has no Scourge players, ignoring" << endl;
-					else
-					{
-						cout << "gameid " << UTIL_ToString( GameID ) << " is calculating" << endl;
-
-						float old_player_ratings[10];
-						memcpy( old_player_ratings, player_ratings, sizeof( float ) * 10 );
-						team_ratings[0] /= team_numplayers[0];
-						team_ratings[1] /= team_numplayers[1];
-						elo_recalculate_ratings( num_players, player_ratings, player_teams, num_teams, team_ratings, team_winners );
-
-						for( int i = 0; i < num_players; i++ )
-						{
-							cout << "player [" << names[i] << "] rating " << UTIL_ToString( (uint32_t)old_player_ratings[i] ) << " -> " << UTIL_ToString( (uint32_t)player_ratings[i] ) << endl;
-
-							if( exists[i] )
-							{
-								string QUpdateScore = "UPDATE dota_elo_scores SET score=" + UTIL_ToString( player_ratings[i], 2 ) + " WHERE id=" + UTIL_ToString( rowids[i] );
-
-								if( mysql_real_query( Connection, QUpdateScore.c_str( ), QUpdateScore.size( ) ) != 0 )
-								{
-									cout << "error: " << mysql_error( Connection ) << endl;
-									return 1;
-								}
-							}
-							else
-							{
-								string EscName = MySQLEscapeString( Connection, names[i] );
-								string EscServer = MySQLEscapeString( Connection, servers[i] );
-								string QInsertScore = "INSERT INTO dota_elo_scores ( name, server, score ) VALUES ( '" + EscName + "', '" + EscServer + "', " + UTIL_ToString( player_ratings[i], 2 ) + " )";
-
-								if( mysql_real_query( Connection, QInsertScore.c_str( ), QInsertScore.size( ) ) != 0 )
-								{
-									cout << "error: " << mysql_error( Connection ) << endl;
-									return 1;
-								}
-							}
-						}
-					}
-				}				
+				GameID = RowGameID;
+				CEloGamePlayer Player;
+				Player.m_Name = Row[1];
+				Player.m_Server = Row[2];
+				Player.m_Colour = Row[3].empty( ) ? 0 : UTIL_ToUInt32( Row[3] );
+				Player.m_Winner = Row[4].empty( ) ? 0 : UTIL_ToUInt32( Row[4] );
+				Players.push_back( Player );
+				Row = MySQLFetchRow( Result );
 			}
-			else
+
+			mysql_free_result( Result );
+
+			if( !Players.empty( ) )
 			{
-				cout << "error: " << mysql_error( Connection ) << endl;
-				return 1;
+				ScoreGame( GameID, Players, Scores );
+				NumGames++;
 			}
 		}
 
-		string QInsertScored = "INSERT INTO dota_elo_games_scored ( gameid ) VALUES ( " + UTIL_ToString( GameID ) + " )";
-
-		if( mysql_real_query( Connection, QInsertScored.c_str( ), QInsertScored.size( ) ) != 0 )
+		if( mysql_errno( Connection ) != 0 )
 		{
 			cout << "error: " << mysql_error( Connection ) << endl;
 			return 1;
 		}
 	}
 
+	cout << "scored " << NumGames << " games" << endl;
+	cout << "saving scores" << endl;
+
+	if( !EloSaveScores( Connection, Scores ) )
+		return 1;
+
+	// every game is marked as scored even if it wasn't a DotA game or it was ignored so we don't look at it again
+
+	if( !MySQLQuery( Connection, "INSERT INTO dota_elo_games_scored ( gameid ) SELECT id FROM games WHERE id<=" + UTIL_ToString( MaxGameID ) + " AND id NOT IN ( SELECT gameid FROM dota_elo_games_scored )" ) )
+		return 1;
+
 	cout << "copying dota elo scores to scores table" << endl;
 
 	string QCopyScores1 = "DELETE FROM scores WHERE category='dota_elo'";